@@ -52,7 +52,7 @@ void CPlayerHealthProxy::OnBind( void *pArg )
 	/*
 	// Should we draw their health?
 	// If he's not on our team we can't see it unless we're a command with "targetinginfo".
-	if ( GetLocalTeam() != GetTeam() && !(local->HasNamedTechnology("targetinginfo") && IsLocalPlayerClass(TFCLASS_COMMANDO) ))
+	if ( GetLocalTeam() != GetTeam() && !(local->HasTechnology(TECH_TARGETINGINFO) && IsLocalPlayerClass(TFCLASS_COMMANDO) ))
 		return drawn;
 	// Don't draw health bars above myself
 	if ( local == this )
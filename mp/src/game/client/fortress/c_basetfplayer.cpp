@@ -559,12 +559,20 @@ void C_BaseTFPlayer::SetDormant( bool bDormant )
 // Purpose: 
 //-----------------------------------------------------------------------------
 bool C_BaseTFPlayer::HasNamedTechnology( const char *name )
+{
+	return HasTechnology( TechnologyID_Find( name ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Same as HasNamedTechnology, but takes a TECH_xxx or interned ID
+//-----------------------------------------------------------------------------
+bool C_BaseTFPlayer::HasTechnology( int iTechID )
 {
 	CTechnologyTree *pTree = GetTechnologyTreeDoc().GetTechnologyTree();
 	if ( !pTree )
 		return false;
 
-	CBaseTechnology *pItem = pTree->GetTechnology(name);
+	CBaseTechnology *pItem = pTree->GetTechnologyByID( iTechID );
 	// If the tech doesn't exist, everyone has it by default
 	if ( !pItem )
 		return true;
@@ -50,6 +50,7 @@ public:
 	bool			IsDamageBoosted() const;
 
 	bool			HasNamedTechnology( const char *name );
+	bool			HasTechnology( int iTechID );
 
 	float			LastAttackTime() const { return m_flLastAttackTime; }
 	void			SetLastAttackTime( float flTime ) { m_flLastAttackTime = flTime; }
@@ -527,6 +527,11 @@ void C_EnvMeteor::SkyboxToWorldThink( float flTime )
 
 	SetLocalOrigin( m_Meteor.m_vecStartPosition );
 
+	// Work out where it hits the world up front.
+	Vector vecMin, vecMax;
+	GetRenderBounds( vecMin, vecMax );
+	m_Meteor.CalcWorldImpact( vecMin, vecMax );
+
 	// Update (think).
 	WorldThink( flTime );
 }
@@ -539,30 +544,16 @@ void C_EnvMeteor::WorldThink( float flTime )
 	Vector vecEndPosition;
 	m_Meteor.GetPositionAtTime( flTime, vecEndPosition );
 
-	// m_Meteor must return the end position in world space for the trace to work.
+	// m_Meteor must return the end position in world space.
 	Assert( GetMoveParent() == NULL );
 
 //	Msg( "Client: Time = %lf, Position: %4.2f %4.2f %4.2f\n", flTime, vecEndPosition.x, vecEndPosition.y, vecEndPosition.z );
 
-	// Check to see if we struck the world.  If so, cause an explosion.
-	trace_t trace;
-
-	Vector vecMin, vecMax;
-	GetRenderBounds( vecMin, vecMax );
-
-	// NOTE: This code works only if we aren't in hierarchy!!!
-	Assert( !GetMoveParent() );
-
-	CTraceFilterWorldOnly traceFilter;
-	UTIL_TraceHull( GetAbsOrigin(), vecEndPosition, vecMin, vecMax,
-		              MASK_SOLID_BRUSHONLY, &traceFilter, &trace ); 
-	
-	// Collision.
-	if ( ( trace.fraction < 1.0f ) && !( trace.surface.flags & SURF_SKY ) )
+	// Check to see if we struck the world (found when it entered the world).  If so, cause an explosion.
+	if ( m_Meteor.HasImpacted( flTime ) )
 	{
-		// Move up to the end.
-		Vector vecEnd = GetAbsOrigin() + ( ( vecEndPosition - GetAbsOrigin() ) * trace.fraction );
-		
+		Vector vecEnd = m_Meteor.m_vecImpactPoint;
+
 		// Create an explosion effect!
 		BaseExplosionEffect().Create( vecEnd, 10, 32, TE_EXPLFLAG_NONE );
 
@@ -601,6 +592,14 @@ C_EnvMeteor *C_EnvMeteor::Create( int nID, int iMeteorType, const Vector &vecOri
 		// Initialize the meteor.
 		pMeteor->InitializeAsClientEntity( "models/props/common/meteorites/meteor05.mdl", RENDER_GROUP_OPAQUE_ENTITY );
 
+		// Meteors that start out in the world never go through SkyboxToWorldThink.
+		if ( pMeteor->m_Meteor.m_nLocation == METEOR_LOCATION_WORLD )
+		{
+			Vector vecMin, vecMax;
+			pMeteor->GetRenderBounds( vecMin, vecMax );
+			pMeteor->m_Meteor.CalcWorldImpact( vecMin, vecMax );
+		}
+
 		// Handle forward simulation.
 		if ( ( pMeteor->m_Meteor.m_flStartTime + METEOR_MAX_LIFETIME ) < gpGlobals->curtime )
 		{
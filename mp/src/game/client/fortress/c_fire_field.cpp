@@ -0,0 +1,105 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Client side of the per-team gasoline blob field.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "c_fire_field.h"
+#include "c_gasoline_blob.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+IMPLEMENT_CLIENTCLASS_DT_NOBASE( C_FireField, DT_FireField, CFireField )
+	RecvPropArray3( RECVINFO_ARRAY( m_nBlobInfo ), RecvPropInt( RECVINFO( m_nBlobInfo[0] ) ) ),
+	RecvPropArray3( RECVINFO_ARRAY( m_nBlobTimes ), RecvPropInt( RECVINFO( m_nBlobTimes[0] ) ) ),
+	RecvPropArray3( RECVINFO_ARRAY( m_nBlobOrigin ), RecvPropInt( RECVINFO( m_nBlobOrigin[0] ) ) ),
+	RecvPropArray3( RECVINFO_ARRAY( m_nBlobVelocity ), RecvPropInt( RECVINFO( m_nBlobVelocity[0] ) ) ),
+	RecvPropArray3( RECVINFO_ARRAY( m_nBlobNormal ), RecvPropInt( RECVINFO( m_nBlobNormal[0] ) ) ),
+END_RECV_TABLE()
+
+
+C_FireField::C_FireField()
+{
+	memset( m_nBlobInfo, 0, sizeof( m_nBlobInfo ) );
+	memset( m_nBlobTimes, 0, sizeof( m_nBlobTimes ) );
+	memset( m_nBlobOrigin, 0, sizeof( m_nBlobOrigin ) );
+	memset( m_nBlobVelocity, 0, sizeof( m_nBlobVelocity ) );
+	memset( m_nBlobNormal, 0, sizeof( m_nBlobNormal ) );
+	memset( m_nPrevBlobInfo, 0, sizeof( m_nPrevBlobInfo ) );
+	memset( m_pBlobs, 0, sizeof( m_pBlobs ) );
+}
+
+
+C_FireField::~C_FireField()
+{
+	for ( int i=0; i < FIRE_FIELD_MAX_BLOBS; i++ )
+	{
+		if ( m_pBlobs[i] )
+		{
+			m_pBlobs[i]->Release();
+			m_pBlobs[i] = NULL;
+		}
+	}
+}
+
+
+void C_FireField::OnDataChanged( DataUpdateType_t type )
+{
+	BaseClass::OnDataChanged( type );
+
+	for ( int i=0; i < FIRE_FIELD_MAX_BLOBS; i++ )
+	{
+		if ( m_nBlobInfo[i] != m_nPrevBlobInfo[i] )
+		{
+			UpdateSlot( i );
+		}
+	}
+}
+
+
+void C_FireField::UpdateSlot( int iSlot )
+{
+	int nInfo = m_nBlobInfo[iSlot];
+	int iSerial = FireField_InfoSerial( nInfo );
+	bool bNewBlob = ( iSerial != FireField_InfoSerial( m_nPrevBlobInfo[iSlot] ) );
+	m_nPrevBlobInfo[iSlot] = nInfo;
+
+	if ( bNewBlob && m_pBlobs[iSlot] )
+	{
+		m_pBlobs[iSlot]->Release();
+		m_pBlobs[iSlot] = NULL;
+	}
+
+	if ( !iSerial )
+		return;
+
+	Vector vOrigin(
+		FireField_UnpackCoord( m_nBlobOrigin[iSlot*3+0] ),
+		FireField_UnpackCoord( m_nBlobOrigin[iSlot*3+1] ),
+		FireField_UnpackCoord( m_nBlobOrigin[iSlot*3+2] ) );
+
+	int nTimes = m_nBlobTimes[iSlot];
+	float flCreateTime = gpGlobals->curtime - TICKS_TO_TIME( FireField_TimesAge( nTimes, gpGlobals->tickcount ) );
+
+	if ( !m_pBlobs[iSlot] )
+	{
+		Vector vVelocity;
+		FireField_UnpackVelocity( m_nBlobVelocity[iSlot], vVelocity );
+
+		m_pBlobs[iSlot] = C_GasolineBlob::Create( vOrigin, vVelocity, flCreateTime, FireField_InfoLifetime( nInfo ) );
+	}
+
+	int blobFlags = FireField_InfoFlags( nInfo );
+
+	Vector vNormal( 0, 0, 1 );
+	if ( blobFlags & BLOBFLAG_STOPPED )
+	{
+		FireField_UnpackNormal( m_nBlobNormal[iSlot], vNormal );
+	}
+
+	m_pBlobs[iSlot]->SetState( blobFlags, vOrigin, vNormal, flCreateTime + TICKS_TO_TIME( FireField_TimesLitDelay( nTimes ) ) );
+}
@@ -0,0 +1,59 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Client side of the per-team gasoline blob field.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef C_FIRE_FIELD_H
+#define C_FIRE_FIELD_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "c_baseentity.h"
+#include "fire_field_shared.h"
+
+
+class C_GasolineBlob;
+
+
+// Watches the field's slots and keeps a client-only C_GasolineBlob for each one that's in use.
+// The blob in a slot is replaced when the slot's serial number changes, and told about new flags
+// (landed, lit) when just those change.
+class C_FireField : public C_BaseEntity
+{
+public:
+	DECLARE_CLASS( C_FireField, C_BaseEntity );
+	DECLARE_CLIENTCLASS();
+
+					C_FireField();
+	virtual			~C_FireField();
+
+
+// Overrides.
+public:
+
+	virtual void	OnDataChanged( DataUpdateType_t type );
+
+
+private:
+
+	void			UpdateSlot( int iSlot );
+
+
+private:
+
+	int				m_nBlobInfo[FIRE_FIELD_MAX_BLOBS];
+	int				m_nBlobTimes[FIRE_FIELD_MAX_BLOBS];
+	int				m_nBlobOrigin[FIRE_FIELD_MAX_BLOBS * 3];
+	int				m_nBlobVelocity[FIRE_FIELD_MAX_BLOBS];
+	int				m_nBlobNormal[FIRE_FIELD_MAX_BLOBS];
+
+	int				m_nPrevBlobInfo[FIRE_FIELD_MAX_BLOBS];
+	C_GasolineBlob	*m_pBlobs[FIRE_FIELD_MAX_BLOBS];
+};
+
+
+#endif // C_FIRE_FIELD_H
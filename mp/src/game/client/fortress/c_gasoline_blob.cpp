@@ -6,7 +6,7 @@
 //=============================================================================//
 #include "cbase.h"
 #include "c_gasoline_blob.h"
-#include "gasoline_shared.h"
+#include "fire_field_shared.h"
 #include "engine/IEngineSound.h"
 #include "clienteffectprecachesystem.h"
 
@@ -128,24 +128,14 @@ void CGasolineEmitter::UpdateFire( float frametime )
 // C_GasolineBlob.
 // ------------------------------------------------------------------------------------------------ //
 
-IMPLEMENT_CLIENTCLASS_DT_NOBASE( C_GasolineBlob, DT_GasolineBlob, CGasolineBlob )
-	RecvPropInt( RECVINFO( m_BlobFlags ) ),
-	RecvPropVector( RECVINFO_NAME( m_vecNetworkOrigin, m_vecOrigin ) ),
-	RecvPropInt( RECVINFO_NAME(m_hNetworkMoveParent, moveparent), 0, RecvProxy_IntToMoveParent ),
-	RecvPropFloat( RECVINFO( m_flLitStartTime ) ),
-	RecvPropFloat( RECVINFO( m_flCreateTime ) ),
-	RecvPropFloat( RECVINFO( m_flMaxLifetime ) ),
-	RecvPropInt( RECVINFO( m_iTeamNum ) ),
-	RecvPropVector( RECVINFO( m_vSurfaceNormal ) )
-END_RECV_TABLE()
-
-
 C_GasolineBlob::C_GasolineBlob()
 {
 	m_pEmitter = CGasolineEmitter::Create( this );
 	m_vSurfaceNormal.Init();
 	m_flLitStartTime = 0;
+	m_BlobFlags = 0;
 	m_bSoundOn = false;
+	m_nSoundGuid = 0;
 	g_GasolineBlobs.AddToTail( this );
 	m_flPuddleSize = PUDDLE_START_SIZE;
 	m_flPuddleFade = 1;
@@ -168,6 +158,38 @@ C_GasolineBlob::~C_GasolineBlob()
 }
 
 
+C_GasolineBlob* C_GasolineBlob::Create( const Vector &vOrigin, const Vector &vVelocity, float flCreateTime, float flMaxLifetime )
+{
+	C_GasolineBlob *pBlob = new C_GasolineBlob;
+	pBlob->m_vStartOrigin = vOrigin;
+	pBlob->m_vStartVelocity = vVelocity;
+	pBlob->m_flCreateTime = flCreateTime;
+	pBlob->m_flMaxLifetime = flMaxLifetime;
+
+	pBlob->InitializeAsClientEntity( NULL, RENDER_GROUP_TRANSLUCENT_ENTITY );
+	pBlob->SetCollisionBounds( Vector( -PUDDLE_END_SIZE, -PUDDLE_END_SIZE, -PUDDLE_END_SIZE ), Vector( PUDDLE_END_SIZE, PUDDLE_END_SIZE, PUDDLE_END_SIZE ) );
+	pBlob->SetAbsOrigin( vOrigin );
+	pBlob->SetNextClientThink( CLIENT_THINK_ALWAYS );
+
+	return pBlob;
+}
+
+
+void C_GasolineBlob::SetState( int blobFlags, const Vector &vOrigin, const Vector &vNormal, float flLitStartTime )
+{
+	m_BlobFlags = blobFlags;
+	m_flLitStartTime = flLitStartTime;
+
+	if ( IsStopped() )
+	{
+		SetAbsOrigin( vOrigin );
+		m_vSurfaceNormal = vNormal;
+	}
+
+	CheckStartSound();
+}
+
+
 bool C_GasolineBlob::IsLit() const
 {
 	return (m_BlobFlags & BLOBFLAG_LIT) != 0;
@@ -192,21 +214,19 @@ float C_GasolineBlob::GetLitStartTime() const
 }
 
 
-void C_GasolineBlob::OnDataChanged( DataUpdateType_t type )
+void C_GasolineBlob::ClientThink()
 {
-	BaseClass::OnDataChanged( type );
-	
-	if ( type == DATA_UPDATE_CREATED )
+	// Fly along the same path the server does until we hear where we landed.
+	if ( !IsStopped() )
 	{
-		SetNextClientThink( CLIENT_THINK_ALWAYS );
-	}
-
-	CheckStartSound();
-}
+		float t = gpGlobals->curtime - m_flCreateTime;
+		Vector vPos = m_vStartOrigin + m_vStartVelocity * t;
+		if ( m_BlobFlags & BLOBFLAG_USE_GRAVITY )
+			vPos.z -= 0.5f * GASOLINE_BLOB_GRAVITY * t * t;
 
+		SetAbsOrigin( vPos );
+	}
 
-void C_GasolineBlob::ClientThink()
-{
 	if ( m_pEmitter.IsValid() )
 		m_pEmitter->UpdateFire( gpGlobals->frametime );
 
@@ -329,7 +349,10 @@ void C_GasolineBlob::StartSound()
 {
 	if ( !m_bSoundOn )
 	{
-		EmitSound( "GasolineBlob.FlameSound" );
+		// We don't have an entity index, so play it at our spot and remember which one it was.
+		CLocalPlayerFilter filter;
+		EmitSound( filter, SOUND_FROM_WORLD, "GasolineBlob.FlameSound", &GetAbsOrigin() );
+		m_nSoundGuid = enginesound->GetGuidForLastSoundEmitted();
 
 		m_bSoundOn = true;
 	}
@@ -340,7 +363,7 @@ void C_GasolineBlob::StopSound()
 {
 	if ( m_bSoundOn )
 	{
-		BaseClass::StopSound( "GasolineBlob.FlameSound" );
+		enginesound->StopSoundByGuid( m_nSoundGuid );
 		m_bSoundOn = false;
 	}
 }
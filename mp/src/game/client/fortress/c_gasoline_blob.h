@@ -42,18 +42,24 @@ private:
 };
 
 
+// A client-only entity for one slot of a C_FireField. It flies itself from the spawn velocity
+// until the field says it landed.
 class C_GasolineBlob : public C_BaseEntity
 {
 friend class CGasolineEmitter;
 
 public:
 	DECLARE_CLASS( C_GasolineBlob, C_BaseEntity );
-	DECLARE_CLIENTCLASS();
 
 
 					C_GasolineBlob();
 	virtual			~C_GasolineBlob();
 
+	static C_GasolineBlob*	Create( const Vector &vOrigin, const Vector &vVelocity, float flCreateTime, float flMaxLifetime );
+
+	// Called when the field gets new flags for the blob. vOrigin and vNormal are only used once it's stopped.
+	void			SetState( int blobFlags, const Vector &vOrigin, const Vector &vNormal, float flLitStartTime );
+
 	bool			IsLit() const;
 	bool			IsStopped() const;
 	const Vector&	GetSurfaceNormal() const;
@@ -63,7 +69,6 @@ public:
 // Overrides.
 public:
 
-	virtual void	OnDataChanged( DataUpdateType_t type );
 	virtual void	ClientThink();
 	virtual int		DrawModel( int flags );
 	virtual bool	ShouldDraw();
@@ -88,6 +93,7 @@ private:
 private:
 
 	bool			m_bSoundOn;
+	int				m_nSoundGuid;
 	float			m_flPuddleSize;
 	float			m_flPuddleFade;
 
@@ -98,6 +104,9 @@ private:
 	float			m_flCreateTime;
 	float			m_flMaxLifetime;
 
+	Vector			m_vStartOrigin;
+	Vector			m_vStartVelocity;
+
 	Vector			m_vSurfaceNormal;
 
 	int				m_BlobFlags;		// Combination of BLOBFLAG_ defines.
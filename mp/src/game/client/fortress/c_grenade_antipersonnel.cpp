@@ -8,6 +8,7 @@
 #include "hud.h"
 #include "grenade_base_empable.h"
 #include "particles_simple.h"
+#include "tf_entity_pool.h"
 
 //-----------------------------------------------------------------------------
 // Purpose: Client side entity for the antipersonnel grenades
@@ -15,6 +16,7 @@
 class C_GrenadeAntiPersonnel : public C_BaseEMPableGrenade
 {
 	DECLARE_CLASS( C_GrenadeAntiPersonnel, C_BaseEMPableGrenade );
+	DECLARE_ENTITY_POOL( C_GrenadeAntiPersonnel );
 public:
 	DECLARE_CLIENTCLASS();
 
@@ -30,6 +32,8 @@ public:
 IMPLEMENT_CLIENTCLASS_DT(C_GrenadeAntiPersonnel, DT_GrenadeAntiPersonnel, CGrenadeAntiPersonnel)
 END_RECV_TABLE()
 
+DEFINE_ENTITY_POOL( C_GrenadeAntiPersonnel, 32 );
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
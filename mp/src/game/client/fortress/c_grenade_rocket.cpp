@@ -7,6 +7,7 @@
 #include "cbase.h"
 #include "hud.h"
 #include "particles_simple.h"
+#include "tf_entity_pool.h"
 
 //-----------------------------------------------------------------------------
 // Purpose: Client side entity for the antipersonnel grenades
@@ -14,6 +15,7 @@
 class C_GrenadeRocket : public C_BaseAnimating
 {
 	DECLARE_CLASS( C_GrenadeRocket, C_BaseAnimating );
+	DECLARE_ENTITY_POOL( C_GrenadeRocket );
 public:
 	DECLARE_CLIENTCLASS();
 
@@ -29,6 +31,8 @@ public:
 IMPLEMENT_CLIENTCLASS_DT(C_GrenadeRocket, DT_GrenadeRocket, CGrenadeRocket)
 END_RECV_TABLE()
 
+DEFINE_ENTITY_POOL( C_GrenadeRocket, 32 );
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
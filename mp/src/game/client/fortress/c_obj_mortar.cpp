@@ -122,7 +122,7 @@ void C_ObjectMortar::Select( void )
 		if ( MortarAmmoTechs[ m_iRoundType ] && MortarAmmoTechs[ m_iRoundType ][0] )
 		{
 			// Does the player have the technology?
-			if ( pPlayer->HasNamedTechnology( MortarAmmoTechs[ m_iRoundType ] ) )
+			if ( pPlayer->HasTechnology( MortarAmmoTechIDs[ m_iRoundType ] ) )
 			{
 				// Do we have ammo?
 				if ( m_iMortarRounds[ m_iRoundType ] > 0 )
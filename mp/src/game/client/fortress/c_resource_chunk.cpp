@@ -1,9 +1,11 @@
 #include "cbase.h"
 #include "particles_simple.h"
+#include "tf_entity_pool.h"
 
 class C_ResourceChunk : public C_BaseAnimating
 {
 	DECLARE_CLASS( C_ResourceChunk, C_BaseAnimating );
+	DECLARE_ENTITY_POOL( C_ResourceChunk );
 public:
 	DECLARE_CLIENTCLASS();
 };
@@ -11,3 +13,5 @@ public:
 IMPLEMENT_CLIENTCLASS_DT( C_ResourceChunk, DT_ResourceChunk, CResourceChunk )
 END_RECV_TABLE()
 
+DEFINE_ENTITY_POOL( C_ResourceChunk, 64 );
+
@@ -549,7 +549,7 @@ void C_WeaponMortar::Redraw()
 		Vector vecStart = m_vecMortarOrigin + (vecForward * MORTAR_RANGE_MIN);
 
 		float flRange = MORTAR_RANGE_MAX_INITIAL;
-		if ( pPlayer->HasNamedTechnology( "mortar_range" ) )
+		if ( pPlayer->HasTechnology( TECH_MORTAR_RANGE ) )
 			flRange = MORTAR_RANGE_MAX_UPGRADED;
 		Vector vecEnd = m_vecMortarOrigin + (vecForward * flRange);
 
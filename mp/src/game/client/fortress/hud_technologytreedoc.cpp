@@ -9,6 +9,7 @@
 #include "commanderoverlaypanel.h"
 #include "tf_hints.h"
 #include "c_tf_hintmanager.h"
+#include "tf_tech_replication.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -17,6 +18,7 @@ static CTechnologyTreeDoc s_TechnologyTreeDoc;
 
 // Hook network messages
 DECLARE_MESSAGE( s_TechnologyTreeDoc, Technology )
+DECLARE_MESSAGE( s_TechnologyTreeDoc, TechnologyBatch )
 
 // Create object singleton on stack
 CTechnologyTreeDoc& GetTechnologyTreeDoc()
@@ -79,6 +81,7 @@ void CTechnologyTreeDoc::ReloadTechTree( void )
 {
 	// FIXME, CTechnologyTreeDoc should be an entity /MO
 	HOOK_HUD_MESSAGE( s_TechnologyTreeDoc, Technology );
+	HOOK_HUD_MESSAGE( s_TechnologyTreeDoc, TechnologyBatch );
 
 	// Reconstruct the tech tree
 	delete m_pTree;
@@ -122,15 +125,6 @@ int CTechnologyTreeDoc::MsgFunc_Technology(bf_read &msg)
 	CBaseTechnology *item = m_pTree->GetTechnology( index );
 	if ( item )
 	{	
-		bool wasactive = item->GetActive();
-
-		bool justactivated = !wasactive && available;
-
-		// Set data elements
-		item->SetActive( available ? true : false );
-		item->SetVoters( voters );
-		item->SetResourceLevel( resourcelevel );
-
 		// If this is the tech I am voting for, clear my vote
 		if ( preferred )
 		{
@@ -143,6 +137,68 @@ int CTechnologyTreeDoc::MsgFunc_Technology(bf_read &msg)
 			item->SetPreferred( false );
 		}
 
+		ApplyTechnology( index, available != 0, voters, resourcelevel );
+	}
+	
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Receive a batch of technologies from the server (see tf_tech_replication.h)
+//-----------------------------------------------------------------------------
+int CTechnologyTreeDoc::MsgFunc_TechnologyBatch(bf_read &msg)
+{
+	int preferred = msg.ReadByte();
+	int first = msg.ReadByte();
+	int count = msg.ReadByte();
+
+	bool allpresent = ( count & TECH_BATCH_ALL_PRESENT ) ? true : false;
+	count &= ~TECH_BATCH_ALL_PRESENT;
+	if ( count > TECH_BATCH_MAX_TECHS )
+		return 1;
+
+	bool present[ TECH_BATCH_MAX_TECHS ];
+	for ( int i = 0; i < count; i++ )
+	{
+		present[i] = allpresent || msg.ReadOneBit();
+	}
+
+	// The server always tells us where our vote is
+	m_pTree->SetPreferredTechnology( preferred != TECH_BATCH_NO_PREFERENCE ? m_pTree->GetTechnology( preferred ) : NULL );
+
+	for ( int i = 0; i < count; i++ )
+	{
+		if ( !present[i] )
+			continue;
+
+		bool available;
+		int voters;
+		int resourcelevel;
+		TechBatch_ReadState( msg, available, voters, resourcelevel );
+
+		ApplyTechnology( first + i, available, voters, (float)resourcelevel );
+	}
+
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copy one technology's state from the server into the tree
+//-----------------------------------------------------------------------------
+void CTechnologyTreeDoc::ApplyTechnology( int index, bool available, int voters, float resourcelevel )
+{
+	CBaseTechnology *item = m_pTree->GetTechnology( index );
+	if ( item )
+	{	
+		bool wasactive = item->GetActive();
+
+		bool justactivated = !wasactive && available;
+
+		// Set data elements
+		item->SetActive( available );
+		item->SetVoters( voters );
+		item->SetResourceLevel( resourcelevel );
+
 		if ( justactivated && item->GetLevel() > 0 && !item->GetHintsGiven( TF_HINT_NEWTECHNOLOGY ) )
 		{
 			// So we only give this hint once this game, even if we respawn, etc.
@@ -155,8 +211,6 @@ int CTechnologyTreeDoc::MsgFunc_Technology(bf_read &msg)
 		CCommanderStatusPanel::StatusPanel()->SetTechnology(item);
 		// hogsy end
 	}
-	
-	return 1;
 }
 
 //-----------------------------------------------------------------------------
@@ -29,9 +29,12 @@ public:
 
 	// Network input
 	int							MsgFunc_Technology( bf_read &msg );
+	int							MsgFunc_TechnologyBatch( bf_read &msg );
 	int							MsgFunc_Resource( bf_read &msg );
 
 private:
+	void						ApplyTechnology( int index, bool available, int voters, float resourcelevel );
+
 	// The underlying technology data tree
 	CTechnologyTree				*m_pTree;
 };
@@ -14,9 +14,8 @@
 #include "vgui_bitmapimage.h"
 #include "c_shield.h"
 #include "c_obj_respawn_station.h"
+#include "tf_tacticalmap.h"
 
-bool IsEntityVisibleToTactical( int iLocalTeamNumber, int iLocalTeamPlayers, 
-	int iLocalTeamObjects, int iEntIndex, const char *pEntName, int pEntTeamNumber, const Vector &pEntOrigin );
 
 // All of the parsing occurs mapdata_parse.cpp
 bool ParseMinimapData( const char *filename, MinimapData_t *pMinimap, CMapZones *pZones, CMapTeamColors *pTeamColors, KeyValues *pKV );
@@ -24,6 +24,21 @@
 
 #include "ndebugoverlay.h"
 
+// The client builds every meteor from the spawner's seed on its own, so the server
+// only needs to know where they land.
+ConVar tf_meteor_analytic( "tf_meteor_analytic", "1", 0, "Resolve meteor impacts from their seeded paths instead of creating an entity that traces every think." );
+
+// How often the old meteor entities thought (and swept for direct hits).
+#define METEOR_THINK_INTERVAL	0.2f
+
+static struct
+{
+	int		m_nCreated;			// Meteors that entered the world without an entity.
+	int		m_nImpacts;
+	int		m_nTraces;
+	int		m_nEntities;		// Meteor entities created (tf_meteor_analytic 0).
+} s_MeteorStats;
+
 //=============================================================================
 //
 // Enumerator for swept bbox collision.
@@ -56,6 +71,123 @@ private:
 	Ray_t			*m_pRay;
 };
 
+//-----------------------------------------------------------------------------
+// Purpose: Get the bounds of the world meteor model.
+//-----------------------------------------------------------------------------
+static void GetMeteorBounds( Vector &vecMin, Vector &vecMax )
+{
+	vecMin.Init( -10.0f, -10.0f, -10.0f );
+	vecMax.Init( 10.0f, 10.0f, 10.0f );
+
+	int iModel = modelinfo->GetModelIndex( "models/props/common/meteorites/meteor04.mdl" );
+	if ( iModel > 0 )
+	{
+		const model_t *pModel = modelinfo->GetModel( iModel );
+		modelinfo->GetModelBounds( pModel, vecMin, vecMax );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hit everything the meteor sweeps through between two points.
+//-----------------------------------------------------------------------------
+static void MeteorSweepDamage( CBaseEntity *pInflictor, const Vector &vecStart, const Vector &vecEnd,
+							   const Vector &vecMin, const Vector &vecMax, const Vector &vecDirection )
+{
+	Ray_t ray;
+	ray.Init( vecStart, vecEnd, vecMin, vecMax );
+
+	CCollideList collideList( &ray, pInflictor, MASK_SOLID );
+	enginetrace->EnumerateEntities( ray, false, &collideList );
+
+	// Now get each entity and react accordinly!
+	for( int iEntity = collideList.m_Entities.Count(); --iEntity >= 0; )
+	{
+		CBaseEntity *pEntity = collideList.m_Entities[iEntity];
+
+		if  ( pEntity )
+		{
+			Vector vecForceDir = vecDirection;
+
+			// Check for a physics object and apply force!
+			IPhysicsObject *pPhysObject = pEntity->VPhysicsGetObject();
+			if ( pPhysObject )
+			{
+//				float flMass = pPhysObject->GetMass();
+				
+				// Send it flying!!!
+				vecForceDir *= 5000000000000.0f;
+				pPhysObject->ApplyForceCenter( vecForceDir );
+			}
+
+			if ( pEntity->m_takedamage )
+			{
+				CTakeDamageInfo info( pInflictor, pInflictor, 200.0f, DMG_CLUB );
+				CalculateExplosiveDamageForce( &info, vecForceDir, pEntity->GetAbsOrigin() );
+				pEntity->TakeDamage( info );
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Splash damage around the point where the meteor hit the world.
+//-----------------------------------------------------------------------------
+static void MeteorImpactDamage( CBaseEntity *pInflictor, const Vector &vecImpactPoint,
+							    const Vector &vecDirection, float flDamageRadius )
+{
+#if 0
+	// Suppress resources for now!!
+
+	// Create a random number or resource chunks.
+	int nChunkCount = random->RandomInt( 0, 4 );
+	for( int iChunk = 0; iChunk < nChunkCount; ++iChunk )
+	{
+		// Generate a random velocity vector.
+		Vector vVelocity = Vector( random->RandomFloat( -20,20 ), random->RandomFloat( -20,20 ), random->RandomFloat( 100,150 ) );
+		CResourceChunk::Create( false, vecImpactPoint, vVelocity );
+	}
+#endif
+
+	// Debugging!!
+//	NDebugOverlay::Box( vecImpactPoint, Vector( -10, -10, -10 ), Vector( 10, 10, 10 ), 0, 255, 0, 0, 5 );
+
+	//Iterate on all entities in the vicinity.
+	CBaseEntity *pEntity;
+	for ( CEntitySphereQuery sphere( vecImpactPoint, flDamageRadius ); (pEntity = sphere.GetCurrentEntity()) != NULL; sphere.NextEntity() )
+	{
+		// Get distance to object and use it as a scale value.
+		Vector vecSegment;
+		vecSegment = pEntity->GetAbsOrigin() - vecImpactPoint;
+		float flDistance = vecSegment.Length();
+
+		float flScale = flDistance / ( flDamageRadius * 0.75f );
+		if ( flScale > 1.0f ) 
+		{ 
+			flScale = 1.0f; 
+		}
+		
+		Vector vecForceDir = vecDirection;
+
+		// Check for a physics object and apply force!
+		IPhysicsObject *pPhysObject = pEntity->VPhysicsGetObject();
+		if ( pPhysObject )
+		{
+//			float flMass = pPhysObject->GetMass();
+
+			// Send it flying!!!
+			vecForceDir *= 5000000000000.0f * flScale;
+			pPhysObject->ApplyForceCenter( vecForceDir );
+		}
+
+		if ( pEntity->m_takedamage )
+		{
+			CTakeDamageInfo info( pInflictor, pInflictor, 300.0f * flScale, DMG_CLUB );
+			CalculateExplosiveDamageForce( &info, vecForceDir, pEntity->GetAbsOrigin() );
+			pEntity->TakeDamage( info );
+		}
+	}
+}
+
 
 //=============================================================================
 //
@@ -69,8 +201,86 @@ void CMeteorFactory::CreateMeteor( int nID, int iType,
 		                           float flSpeed, float flStartTime, float flDamageRadius,
 								   const Vector &vecTriggerMins, const Vector &vecTriggerMaxs )
 {
-	CEnvMeteor::Create( nID, iType, vecPosition, vecDirection, flSpeed, flStartTime, flDamageRadius,
-		                vecTriggerMins, vecTriggerMaxs );
+	if ( !tf_meteor_analytic.GetBool() )
+	{
+		++s_MeteorStats.m_nEntities;
+		CEnvMeteor::Create( nID, iType, vecPosition, vecDirection, flSpeed, flStartTime, flDamageRadius,
+			                vecTriggerMins, vecTriggerMaxs );
+		return;
+	}
+
+	CEnvMeteorShared meteor;
+	meteor.Init( nID, flStartTime, METEOR_PASSIVE_TIME, vecPosition, vecDirection, flSpeed,
+		         flDamageRadius, vecTriggerMins, vecTriggerMaxs );
+
+	// Meteors that never enter the world or are already dead can't hurt anything.
+	if ( meteor.m_flWorldEnterTime == METEOR_INVALID_TIME )
+		return;
+
+	if ( ( meteor.m_flStartTime + METEOR_MAX_LIFETIME ) < gpGlobals->curtime )
+		return;
+
+	if ( meteor.m_nLocation == METEOR_LOCATION_SKYBOX )
+	{
+		meteor.ConvertFromSkyboxToWorld();
+	}
+
+	++s_MeteorStats.m_nCreated;
+	++s_MeteorStats.m_nTraces;
+
+	// One trace against the static world for the whole path.  If it flies out
+	// of the world without hitting anything, there's nothing left to do.
+	Vector vecMin, vecMax;
+	GetMeteorBounds( vecMin, vecMax );
+	if ( !meteor.CalcWorldImpact( vecMin, vecMax ) )
+		return;
+
+	m_Meteors.AddToTail( meteor );
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+void CMeteorFactory::UpdateImpacts( CBaseEntity *pInflictor, float flTime )
+{
+	if ( !m_Meteors.Count() )
+		return;
+
+	Vector vecMin, vecMax;
+	GetMeteorBounds( vecMin, vecMax );
+
+	for ( int iMeteor = m_Meteors.Count(); --iMeteor >= 0; )
+	{
+		CEnvMeteorShared &meteor = m_Meteors[iMeteor];
+		if ( !meteor.HasImpacted( flTime ) )
+			continue;
+
+		// The entity swept for direct hits along its whole flight through the
+		// world, so sweep from where it came into the world to where it hit.
+		Vector vecSweepStart;
+		meteor.GetPositionAtTime( meteor.m_flPosTime, vecSweepStart );
+		MeteorSweepDamage( pInflictor, vecSweepStart, meteor.m_vecImpactPoint, vecMin, vecMax, meteor.m_vecDirection );
+		MeteorImpactDamage( pInflictor, meteor.m_vecImpactPoint, meteor.m_vecDirection, meteor.GetDamageRadius() );
+
+		++s_MeteorStats.m_nImpacts;
+		m_Meteors.FastRemove( iMeteor );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+float CMeteorFactory::GetNextImpactTime( void )
+{
+	float flNextImpact = METEOR_INVALID_TIME;
+	for ( int iMeteor = 0; iMeteor < m_Meteors.Count(); ++iMeteor )
+	{
+		float flImpact = m_Meteors[iMeteor].m_flImpactTime;
+		if ( ( flNextImpact == METEOR_INVALID_TIME ) || ( flImpact < flNextImpact ) )
+		{
+			flNextImpact = flImpact;
+		}
+	}
+
+	return flNextImpact;
 }
 
 //=============================================================================
@@ -215,7 +425,7 @@ void CEnvMeteorSpawner::InputEnable( inputdata_t &inputdata )
 
 	// Set the think function and time.
 	SetThink( &CEnvMeteorSpawner::MeteorSpawnerThink );
-	SetNextThink( gpGlobals->curtime + m_SpawnerShared.m_flNextSpawnTime );
+	ScheduleNextThink( gpGlobals->curtime + m_SpawnerShared.m_flNextSpawnTime );
 }
 
 //-----------------------------------------------------------------------------
@@ -223,7 +433,33 @@ void CEnvMeteorSpawner::InputEnable( inputdata_t &inputdata )
 void CEnvMeteorSpawner::InputDisable( inputdata_t &inputdata )
 {
 	m_fDisabled = true;
-	SetThink( NULL );
+
+	// Meteors that are already falling still need to land.
+	ScheduleNextThink( METEOR_INVALID_TIME );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Think at the earlier of the next spawn and the next impact.  Pass
+//          METEOR_INVALID_TIME when there's nothing to spawn.
+//-----------------------------------------------------------------------------
+void CEnvMeteorSpawner::ScheduleNextThink( float flNextSpawnThink )
+{
+	float flNextThink = flNextSpawnThink;
+	float flNextImpact = m_Factory.GetNextImpactTime();
+	if ( ( flNextImpact != METEOR_INVALID_TIME ) && 
+		 ( ( flNextThink == METEOR_INVALID_TIME ) || ( flNextImpact < flNextThink ) ) )
+	{
+		flNextThink = flNextImpact;
+	}
+
+	if ( flNextThink == METEOR_INVALID_TIME )
+	{
+		SetThink( NULL );
+		return;
+	}
+
+	SetThink( &CEnvMeteorSpawner::MeteorSpawnerThink );
+	SetNextThink( flNextThink );
 }
 
 //-----------------------------------------------------------------------------
@@ -257,7 +493,17 @@ void CEnvMeteorSpawner::Precache( void )
 //-----------------------------------------------------------------------------
 void CEnvMeteorSpawner::MeteorSpawnerThink( void )
 {
-	SetNextThink( gpGlobals->curtime + m_SpawnerShared.MeteorThink( gpGlobals->curtime ) );
+	float flTime = gpGlobals->curtime;
+
+	// We also think for impacts (even while disabled), so only spawn when it's time to.
+	if ( !m_fDisabled && ( flTime >= m_SpawnerShared.m_flNextSpawnTime ) )
+	{
+		m_SpawnerShared.MeteorThink( flTime );
+	}
+
+	m_Factory.UpdateImpacts( this, flTime );
+
+	ScheduleNextThink( m_fDisabled ? METEOR_INVALID_TIME : m_SpawnerShared.m_flNextSpawnTime );
 }
 
 //-----------------------------------------------------------------------------
@@ -417,12 +663,7 @@ void CEnvMeteor::Spawn( void )
 	// Pass data.
 	BaseClass::Spawn();
 
-	int iModel = modelinfo->GetModelIndex( "models/props/common/meteorites/meteor04.mdl" );
-	if ( iModel > 0 )
-	{
-		const model_t *pModel = modelinfo->GetModel( iModel );
-		modelinfo->GetModelBounds( pModel, m_vecMin, m_vecMax );
-	}
+	GetMeteorBounds( m_vecMin, m_vecMax );
 
 	// Assumes we start life in a skybox!
 	SetThink( &CEnvMeteor::MeteorSkyboxThink );
@@ -437,7 +678,7 @@ void CEnvMeteor::Spawn( void )
 void CEnvMeteor::MeteorSkyboxThink( void )
 {
 	SetThink( &CEnvMeteor::MeteorWorldThink );
-	SetNextThink( gpGlobals->curtime + 0.2f );
+	SetNextThink( gpGlobals->curtime + METEOR_THINK_INTERVAL );
 }
 
 //-----------------------------------------------------------------------------
@@ -466,40 +707,9 @@ void CEnvMeteor::MeteorWorldThink( void )
 //	NDebugOverlay::Box( GetAbsOrigin(), m_vecMin * 0.5f, m_vecMax * 0.5f, 255, 255, 0, 0, 5 );
 //	NDebugOverlay::Box( vecEndPosition, m_vecMin, m_vecMax, 255, 0, 0, 0, 5 );
 
-	Ray_t ray;
-	ray.Init( GetAbsOrigin(), vecEndPosition, m_vecMin, m_vecMax );
+	MeteorSweepDamage( this, GetAbsOrigin(), vecEndPosition, m_vecMin, m_vecMax, m_Meteor.m_vecDirection );
 
-	CCollideList collideList( &ray, this, MASK_SOLID );
-	enginetrace->EnumerateEntities( ray, false, &collideList );
-
-	// Now get each entity and react accordinly!
-	for( int iEntity = collideList.m_Entities.Count(); --iEntity >= 0; )
-	{
-		CBaseEntity *pEntity = collideList.m_Entities[iEntity];
-
-		if  ( pEntity )
-		{
-			Vector vecForceDir = m_Meteor.m_vecDirection;
-
-			// Check for a physics object and apply force!
-			IPhysicsObject *pPhysObject = pEntity->VPhysicsGetObject();
-			if ( pPhysObject )
-			{
-//				float flMass = pPhysObject->GetMass();
-				
-				// Send it flying!!!
-				vecForceDir *= 5000000000000.0f;
-				pPhysObject->ApplyForceCenter( vecForceDir );
-			}
-
-			if ( pEntity->m_takedamage )
-			{
-				CTakeDamageInfo info( this, this, 200.0f, DMG_CLUB );
-				CalculateExplosiveDamageForce( &info, vecForceDir, pEntity->GetAbsOrigin() );
-				pEntity->TakeDamage( info );
-			}
-		}
-	}
+	++s_MeteorStats.m_nTraces;
 
 	trace_t trace;
 	UTIL_TraceHull( GetAbsOrigin(), vecEndPosition, m_vecMin, m_vecMax,
@@ -512,60 +722,10 @@ void CEnvMeteor::MeteorWorldThink( void )
 			// Hit the world? The meteor is destroyed!
 			if ( pEntity->GetSolid() == SOLID_BSP )
 			{
-#if 0
-				// Suppress resources for now!!
-
-				// Create a random number or resource chunks.
-				int nChunkCount = random->RandomInt( 0, 4 );
-				for( int iChunk = 0; iChunk < nChunkCount; ++iChunk )
-				{
-					// Generate a random velocity vector.
-					Vector vVelocity = Vector( random->RandomFloat( -20,20 ), random->RandomFloat( -20,20 ), random->RandomFloat( 100,150 ) );
-					CResourceChunk::Create( false, GetAbsOrigin(), vVelocity );
-				}
-#endif
-
 				// Splash damage!
 				Vector vecImpactPoint;
 				vecImpactPoint = GetAbsOrigin() + ( ( vecEndPosition - GetAbsOrigin() ) * trace.fraction ); 
-
-				// Debugging!!
-//				NDebugOverlay::Box( vecImpactPoint, m_vecMin, m_vecMax, 0, 255, 0, 0, 5 );
-
-				//Iterate on all entities in the vicinity.
-				for ( CEntitySphereQuery sphere( vecImpactPoint, m_Meteor.GetDamageRadius() ); (pEntity = sphere.GetCurrentEntity()) != NULL; sphere.NextEntity() )
-				{
-					// Get distance to object and use it as a scale value.
-					Vector vecSegment;
-					vecSegment = pEntity->GetAbsOrigin() - vecImpactPoint;
-					float flDistance = vecSegment.Length();
-
-					float flScale = flDistance / ( m_Meteor.GetDamageRadius() * 0.75f );
-					if ( flScale > 1.0f ) 
-					{ 
-						flScale = 1.0f; 
-					}
-					
-					Vector vecForceDir = m_Meteor.m_vecDirection;
-
-					// Check for a physics object and apply force!
-					IPhysicsObject *pPhysObject = pEntity->VPhysicsGetObject();
-					if ( pPhysObject )
-					{
-//						float flMass = pPhysObject->GetMass();
-
-						// Send it flying!!!
-						vecForceDir *= 5000000000000.0f * flScale;
-						pPhysObject->ApplyForceCenter( vecForceDir );
-					}
-
-					if ( pEntity->m_takedamage )
-					{
-						CTakeDamageInfo info( this, this, 300.0f * flScale, DMG_CLUB );
-						CalculateExplosiveDamageForce( &info, vecForceDir, pEntity->GetAbsOrigin() );
-						pEntity->TakeDamage( info );
-					}
-				}
+				MeteorImpactDamage( this, vecImpactPoint, m_Meteor.m_vecDirection, m_Meteor.GetDamageRadius() );
 
 				UTIL_Remove( this );
 				return;
@@ -575,7 +735,7 @@ void CEnvMeteor::MeteorWorldThink( void )
 
 	// Always move full movement.
 	UTIL_SetOrigin( this, vecEndPosition );
-	SetNextThink( gpGlobals->curtime + 0.2f );
+	SetNextThink( gpGlobals->curtime + METEOR_THINK_INTERVAL );
 
 	// Check for death.
 	if ( flTime >= m_Meteor.m_flWorldExitTime )
@@ -585,6 +745,29 @@ void CEnvMeteor::MeteorWorldThink( void )
 	}
 }
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+static void CC_MeteorStats( const CCommand &args )
+{
+	int nInFlight = 0;
+	CBaseEntity *pEntity = NULL;
+	while ( ( pEntity = gEntList.FindEntityByClassname( pEntity, "env_meteorspawner" ) ) != NULL )
+	{
+		nInFlight += static_cast<CEnvMeteorSpawner*>( pEntity )->GetFactory().GetMeteorCount();
+	}
+
+	Msg( "Meteors (tf_meteor_analytic %d):\n", tf_meteor_analytic.GetInt() );
+	Msg( "  %d entered the world without an entity, %d waiting to hit, %d hit\n", s_MeteorStats.m_nCreated, nInFlight, s_MeteorStats.m_nImpacts );
+	Msg( "  %d meteor entities created, %d world traces\n", s_MeteorStats.m_nEntities, s_MeteorStats.m_nTraces );
+
+	if ( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) )
+	{
+		memset( &s_MeteorStats, 0, sizeof( s_MeteorStats ) );
+	}
+}
+
+static ConCommand tf_meteor_stats( "tf_meteor_stats", CC_MeteorStats, "Print how many meteors were simulated with and without entities and how many world traces they cost. Pass 'reset' to clear them afterwards." );
+
 //=============================================================================
 // 
 // Shooting Star Spawner Functionality.
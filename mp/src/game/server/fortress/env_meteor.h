@@ -26,6 +26,19 @@ public:
 		               const Vector &vecDirection, float flSpeed, float flStartTime,
 					   float flDamageRadius,
 					   const Vector &vecTriggerMins, const Vector &vecTriggerMaxs );
+
+	//-------------------------------------------------------------------------
+	// Meteors created with tf_meteor_analytic on aren't entities.  Their world
+	// impact is found when they're created, and the spawner calls this to do
+	// the damage for the ones whose impact time has passed.
+	//-------------------------------------------------------------------------
+	void	UpdateImpacts( CBaseEntity *pInflictor, float flTime );
+	float	GetNextImpactTime( void );
+	int		GetMeteorCount( void ) const { return m_Meteors.Count(); }
+
+private:
+
+	CUtlVector<CEnvMeteorShared>	m_Meteors;
 };
 
 //=============================================================================
@@ -49,6 +62,8 @@ public:
 	int		ShouldTransmit( const CCheckTransmitInfo *pInfo );
 	void	Activate( void );
 
+	const CMeteorFactory &GetFactory( void ) const { return m_Factory; }
+
 private:
 
 	// Inputs
@@ -56,6 +71,7 @@ private:
 	void	InputDisable( inputdata_t &inputdata );
 
 	void	Get3DSkyboxWorldBounds( Vector &vecTriggerMins, Vector &vecTriggerMaxs );
+	void	ScheduleNextThink( float flNextSpawnThink );
 
 	CMeteorFactory				m_Factory;
 	CNetworkVarEmbedded( CEnvMeteorSpawnerShared, m_SpawnerShared );
@@ -9,9 +9,11 @@
 #include "fire_damage_mgr.h"
 #include "entity_burn_effect.h"
 #include "gasoline_blob.h"
+#include "gasoline_shared.h"
 #include "tf_obj.h"
 #include "ai_basenpc.h"
 #include "tf_gamerules.h"
+#include "mathlib/ssemath.h"
 
 
 #define FIRE_DAMAGE_APPLY_INTERVAL	0.5	// Apply the damage at this interval.
@@ -29,9 +31,93 @@
 ConVar fire_damageall( "fire_damageall", "0", 0, "Enable fire damaging team members." );
 
 
+// ------------------------------------------------------------------------------------------------ //
+// Kernels.
+// ------------------------------------------------------------------------------------------------ //
+
+void FireDamage_ComputeTargetScales(
+	const int *pAttackerTarget,
+	const float *pAttackerVelocity,
+	int nAttackers,
+	float *pTargetVelocity,
+	float *pTargetScale,
+	int nTargets,
+	float flFrameDecay,
+	float flMaxDamagePerSecond )
+{
+	// Sum up each target's attacker velocities.
+	memset( pTargetVelocity, 0, nTargets * sizeof( float ) );
+	for ( int i=0; i < nAttackers; i++ )
+		pTargetVelocity[ pAttackerTarget[i] ] += pAttackerVelocity[i];
+
+	// Decay each target's total velocity, then uniformly scale it down so the sum total
+	// doesn't exceed our maximum.
+	fltx4 fl4Decay = ReplicateX4( flFrameDecay );
+	fltx4 fl4Max = ReplicateX4( flMaxDamagePerSecond );
+
+	int i = 0;
+	for ( ; i + 4 <= nTargets; i += 4 )
+	{
+		fltx4 fl4Total = MulSIMD( LoadUnalignedSIMD( &pTargetVelocity[i] ), fl4Decay );
+		fltx4 fl4Clamp = DivSIMD( fl4Max, fl4Total );
+		fl4Clamp = MaskedAssign( CmpGtSIMD( fl4Total, fl4Max ), fl4Clamp, Four_Ones );
+		StoreUnalignedSIMD( &pTargetScale[i], MulSIMD( fl4Decay, fl4Clamp ) );
+	}
+
+	for ( ; i < nTargets; i++ )
+	{
+		float flTotal = pTargetVelocity[i] * flFrameDecay;
+		float flClamp = ( flTotal > flMaxDamagePerSecond ) ? ( flMaxDamagePerSecond / flTotal ) : 1;
+		pTargetScale[i] = flFrameDecay * flClamp;
+	}
+}
+
+
+void FireDamage_IntegrateAttackers(
+	const int *pAttackerTarget,
+	const float *pTargetScale,
+	float *pAttackerScale,
+	float *pAttackerVelocity,
+	float *pAttackerDamageSum,
+	int nAttackers,
+	float flFrameTime )
+{
+	// Gather the target scales into a lane that lines up with the attackers.
+	for ( int i=0; i < nAttackers; i++ )
+		pAttackerScale[i] = pTargetScale[ pAttackerTarget[i] ];
+
+	fltx4 fl4FrameTime = ReplicateX4( flFrameTime );
+
+	int i = 0;
+	for ( ; i + 4 <= nAttackers; i += 4 )
+	{
+		fltx4 fl4Velocity = MulSIMD( LoadUnalignedSIMD( &pAttackerVelocity[i] ), LoadUnalignedSIMD( &pAttackerScale[i] ) );
+		fltx4 fl4Sum = MaddSIMD( fl4Velocity, fl4FrameTime, LoadUnalignedSIMD( &pAttackerDamageSum[i] ) );
+		StoreUnalignedSIMD( &pAttackerVelocity[i], fl4Velocity );
+		StoreUnalignedSIMD( &pAttackerDamageSum[i], fl4Sum );
+	}
+
+	for ( ; i < nAttackers; i++ )
+	{
+		pAttackerVelocity[i] *= pAttackerScale[i];
+		pAttackerDamageSum[i] += pAttackerVelocity[i] * flFrameTime;
+	}
+}
+
+
+// ------------------------------------------------------------------------------------------------ //
+// CFireDamageMgr implementation.
+// ------------------------------------------------------------------------------------------------ //
+
+CFireDamageMgr::CFireDamageMgr() : CAutoGameSystemPerFrame( "CFireDamageMgr" )
+{
+}
+
+
 bool CFireDamageMgr::Init()
 {
 	m_flApplyDamageCountdown = FIRE_DAMAGE_APPLY_INTERVAL;
+	m_bApplyDamageThisFrame = false;
 
 	// Fire decays exponentially: B = A * e^(-kt)
 	// So we set B=FIRE_DECAY_END_VALUE, A=flMaxDamagePerSecond, and t=flFireDecaySeconds, then solve for K.
@@ -42,154 +128,209 @@ bool CFireDamageMgr::Init()
 }
 
 
-void CFireDamageMgr::AddDamage( CBaseEntity *pTarget, CBaseEntity *pAttacker, float flDamageAccel, bool bMakeBurnEffect )
+void CFireDamageMgr::LevelShutdownPostEntity()
 {
-	FOR_EACH_LL( m_DamageEnts, iDamageEnt )
+	m_TargetEnts.Purge();
+	m_TargetBurnEffects.Purge();
+	m_TargetWasAlive.Purge();
+	m_TargetAttackerCount.Purge();
+	m_TargetVelocity.Purge();
+	m_TargetScale.Purge();
+
+	m_AttackerTarget.Purge();
+	m_AttackerEnts.Purge();
+	m_AttackerVelocity.Purge();
+	m_AttackerDamageSum.Purge();
+	m_AttackerScale.Purge();
+
+	m_flApplyDamageCountdown = FIRE_DAMAGE_APPLY_INTERVAL;
+	m_bApplyDamageThisFrame = false;
+}
+
+
+int CFireDamageMgr::FindTarget( CBaseEntity *pTarget ) const
+{
+	for ( int i=0; i < m_TargetEnts.Count(); i++ )
 	{
-		CDamageEnt *pEnt = &m_DamageEnts[iDamageEnt];
+		if ( m_TargetEnts[i] == pTarget )
+			return i;
+	}
 
-		if ( pEnt->m_hEnt != pTarget )
-			continue;
-	
-		for ( int i=0; i < pEnt->m_nAttackers; i++ )
-		{
-			if ( pEnt->m_Attackers[i].m_hAttacker == pAttacker )
-			{
-				pEnt->m_Attackers[i].m_flVelocity += flDamageAccel * gpGlobals->frametime;
-				return;
-			}
-		}
+	return -1;
+}
 
-		
-		if ( pEnt->m_nAttackers < CDamageEnt::MAX_ATTACKERS )
-		{
-			// Add a new attacker.
-			pEnt->m_Attackers[pEnt->m_nAttackers].Init( pAttacker, flDamageAccel * gpGlobals->frametime );
-			++pEnt->m_nAttackers;
-			return;
-		}
-		else
+
+int CFireDamageMgr::FindAttacker( int iTarget, CBaseEntity *pAttacker ) const
+{
+	for ( int i=0; i < m_AttackerTarget.Count(); i++ )
+	{
+		if ( m_AttackerTarget[i] == iTarget && m_AttackerEnts[i] == pAttacker )
+			return i;
+	}
+
+	return -1;
+}
+
+
+void CFireDamageMgr::AddDamage( CBaseEntity *pTarget, CBaseEntity *pAttacker, float flDamageAccel, bool bMakeBurnEffect )
+{
+	int iTarget = FindTarget( pTarget );
+	if ( iTarget == -1 )
+	{
+		// Add a new target.
+		iTarget = m_TargetEnts.AddToTail( pTarget );
+		m_TargetBurnEffects.AddToTail( bMakeBurnEffect ? CEntityBurnEffect::Create( pTarget ) : NULL );
+		m_TargetWasAlive.AddToTail( pTarget->IsAlive() );
+		m_TargetAttackerCount.AddToTail( 0 );
+		m_TargetVelocity.AddToTail( 0 );
+		m_TargetScale.AddToTail( 1 );
+	}
+	else
+	{
+		int iAttacker = FindAttacker( iTarget, pAttacker );
+		if ( iAttacker != -1 )
 		{
-			// No room for more attackers.
-			Warning( "CFireDamageMgr: ran out of attackers\n" );
+			m_AttackerVelocity[iAttacker] += flDamageAccel * gpGlobals->frametime;
 			return;
 		}
 	}
 
-	// Add a new CDamageEnt.
-	int iNew = m_DamageEnts.AddToTail();
-	CDamageEnt *pEnt = &m_DamageEnts[iNew];
-	pEnt->m_hEnt = pTarget;
-	pEnt->m_bWasAlive = pTarget->IsAlive();
-	pEnt->m_nAttackers = 1;
-	pEnt->m_Attackers[0].Init( pAttacker, flDamageAccel * gpGlobals->frametime );
-	if ( bMakeBurnEffect )
-		pEnt->m_pBurnEffect = CEntityBurnEffect::Create( pTarget );
-	else
-		pEnt->m_pBurnEffect = NULL;
+	// Add a new attacker.
+	m_AttackerTarget.AddToTail( iTarget );
+	m_AttackerEnts.AddToTail( pAttacker );
+	m_AttackerVelocity.AddToTail( flDamageAccel * gpGlobals->frametime );
+	m_AttackerDamageSum.AddToTail( 0 );
+	m_AttackerScale.AddToTail( 1 );
+	++m_TargetAttackerCount[iTarget];
 }
 
 
-void CFireDamageMgr::RemoveDamageEnt( int iEnt )
+void CFireDamageMgr::RemoveAttacker( int iAttacker )
 {
-	UTIL_Remove( m_DamageEnts[iEnt].m_pBurnEffect );
-	m_DamageEnts.Remove( iEnt );
+	--m_TargetAttackerCount[ m_AttackerTarget[iAttacker] ];
+
+	m_AttackerTarget.FastRemove( iAttacker );
+	m_AttackerEnts.FastRemove( iAttacker );
+	m_AttackerVelocity.FastRemove( iAttacker );
+	m_AttackerDamageSum.FastRemove( iAttacker );
+	m_AttackerScale.FastRemove( iAttacker );
 }
 
 
-void CFireDamageMgr::FrameUpdatePostEntityThink()
+void CFireDamageMgr::RemoveTarget( int iTarget )
 {
-	VPROF( "CFireDamageMgr::FrameUpdatePostEntityThink" );
-	float frametime = gpGlobals->frametime;
-	
-	// Update the damage countdown.
+	// Drop any attackers still pointing at it.
+	for ( int i=m_AttackerTarget.Count()-1; i >= 0; i-- )
+	{
+		if ( m_AttackerTarget[i] == iTarget )
+			RemoveAttacker( i );
+	}
+
+	UTIL_Remove( m_TargetBurnEffects[iTarget] );
+
+	// The last target gets swapped into this slot, so point its attackers at the new index.
+	int iLast = m_TargetEnts.Count() - 1;
+	if ( iTarget != iLast )
+	{
+		for ( int i=0; i < m_AttackerTarget.Count(); i++ )
+		{
+			if ( m_AttackerTarget[i] == iLast )
+				m_AttackerTarget[i] = iTarget;
+		}
+	}
+
+	m_TargetEnts.FastRemove( iTarget );
+	m_TargetBurnEffects.FastRemove( iTarget );
+	m_TargetWasAlive.FastRemove( iTarget );
+	m_TargetAttackerCount.FastRemove( iTarget );
+	m_TargetVelocity.FastRemove( iTarget );
+	m_TargetScale.FastRemove( iTarget );
+}
+
+
+void CFireDamageMgr::FrameUpdatePreEntityThink()
+{
+	// Update the damage countdown. This is done before the entities think so the gasoline blobs
+	// can apply their heat on the same frames.
 	m_flApplyDamageCountdown -= gpGlobals->frametime;
-	bool bApplyDamageThisFrame = false;
+	m_bApplyDamageThisFrame = false;
 	if ( m_flApplyDamageCountdown <= 0 )
 	{
-		bApplyDamageThisFrame = true;
+		m_bApplyDamageThisFrame = true;
 		m_flApplyDamageCountdown += FIRE_DAMAGE_APPLY_INTERVAL;
 	}
+}
 
 
-	//   													   (-kt)
-	// Figure out how much all the damage decays this frame:  e
-	float flFrameDecay = powf( 2.718281828459045235360, -m_flDecayConstant * frametime );
+void CFireDamageMgr::FrameUpdatePostEntityThink()
+{
+	VPROF( "CFireDamageMgr::FrameUpdatePostEntityThink" );
+	float frametime = gpGlobals->frametime;
+	bool bApplyDamageThisFrame = m_bApplyDamageThisFrame;
 
+	if ( m_TargetEnts.Count() == 0 )
+		return;
 
-	int iNext;
-	for ( int iCur = m_DamageEnts.Head(); iCur != m_DamageEnts.InvalidIndex(); iCur = iNext )
+	// If the entity was dead and is now alive, stop damage to them so their new body doesn't burn.
+	for ( int iTarget=m_TargetEnts.Count()-1; iTarget >= 0; iTarget-- )
 	{
-		iNext = m_DamageEnts.Next( iCur );
-		CDamageEnt *pEnt = &m_DamageEnts[iCur];
-
-
-		// If the entity was dead and is now alive, stop damage to them so their new body doesn't burn.
-		if ( !pEnt->m_hEnt.Get() || ( !pEnt->m_bWasAlive && pEnt->m_hEnt->IsAlive() ) )
+		CBaseEntity *pEnt = m_TargetEnts[iTarget];
+		if ( !pEnt || ( !m_TargetWasAlive[iTarget] && pEnt->IsAlive() ) )
 		{
-			RemoveDamageEnt( iCur );
-			pEnt = NULL;
+			RemoveTarget( iTarget );
 			continue;
 		}
-		
-		pEnt->m_bWasAlive = pEnt->m_hEnt->IsAlive();
 
-		// Sum up each attacker's velocity.
-		float flTotalVelocity = 0;
-		int i;
-		for ( i=0; i < pEnt->m_nAttackers; i++ )
-			flTotalVelocity += pEnt->m_Attackers[i].m_flVelocity;
+		m_TargetWasAlive[iTarget] = pEnt->IsAlive();
+	}
 
 
-		// Figure out each attacker's contribution.
-		float flContributionPercent[CDamageEnt::MAX_ATTACKERS];
-		for ( i=0; i < pEnt->m_nAttackers; i++ )
-			flContributionPercent[i] = pEnt->m_Attackers[i].m_flVelocity / flTotalVelocity;
-		
-		
-		// Decay each attacker's velocity.
-		flTotalVelocity *= flFrameDecay;
-
-		// Uniformly scale each attacker's velocity down so the sum total doesn't exceed our maximum.
-		float flPercentScale = 1;
-		if ( flTotalVelocity > m_flMaxDamagePerSecond )
-			flPercentScale = m_flMaxDamagePerSecond / flTotalVelocity;
+	//   													   (-kt)
+	// Figure out how much all the damage decays this frame:  e
+	float flFrameDecay = expf( -m_flDecayConstant * frametime );
+
+	FireDamage_ComputeTargetScales( 
+		m_AttackerTarget.Base(), 
+		m_AttackerVelocity.Base(), 
+		m_AttackerTarget.Count(), 
+		m_TargetVelocity.Base(), 
+		m_TargetScale.Base(), 
+		m_TargetEnts.Count(), 
+		flFrameDecay, 
+		m_flMaxDamagePerSecond );
+
+	FireDamage_IntegrateAttackers( 
+		m_AttackerTarget.Base(), 
+		m_TargetScale.Base(), 
+		m_AttackerScale.Base(), 
+		m_AttackerVelocity.Base(), 
+		m_AttackerDamageSum.Base(), 
+		m_AttackerTarget.Count(), 
+		frametime );
+
+	// Walk backwards so swap-removes only move attackers we've already looked at.
+	for ( int i=m_AttackerTarget.Count()-1; i >= 0; i-- )
+	{
+		bool bEntsValid = (m_AttackerEnts[i].Get() != NULL);
+		if ( !bEntsValid || m_AttackerVelocity[i] <= 0.001 )
+		{
+			if ( bEntsValid )
+				ApplyCollectedDamage( i );	// Apply the last-remaining damage from this guy.
 
-		for ( i=0; i < pEnt->m_nAttackers; i++ )
+			RemoveAttacker( i );
+		}
+		else if ( bApplyDamageThisFrame )
 		{
-			CDamageAttacker *pAttacker = &pEnt->m_Attackers[i];
-
-			pAttacker->m_flVelocity *= flFrameDecay * flPercentScale;
-
-			bool bEntsValid = (pEnt->m_Attackers[i].m_hAttacker.Get() != NULL);
-			if ( !bEntsValid ||
-				pEnt->m_Attackers[i].m_flVelocity <= 0.001 )
-			{
-				if ( bEntsValid )
-					ApplyCollectedDamage( pEnt, i );	// Apply the last-remaining damage from this guy.
-
-				V_memmove( &pEnt->m_Attackers[i], &pEnt->m_Attackers[i+1], sizeof( pEnt->m_Attackers[0] ) * (pEnt->m_nAttackers-i-1) );
-				V_memmove( &flContributionPercent[i], &flContributionPercent[i+1], sizeof( flContributionPercent[0] ) * (pEnt->m_nAttackers-i-1) );
-				
-				--pEnt->m_nAttackers;
-				if ( pEnt->m_nAttackers == 0 )
-				{
-					// This ent isn't being damaged anymore.
-					RemoveDamageEnt( iCur );
-					break;
-				}
-
-				--i;
-			}
-
-			// Update their current damage sum and maybe apply the damage.
-			pAttacker->m_flDamageSum += pAttacker->m_flVelocity * frametime;
-			if ( bApplyDamageThisFrame )
-			{
-				ApplyCollectedDamage( pEnt, i );
-			}
+			ApplyCollectedDamage( i );
 		}
 	}
+
+	// Anything that isn't being damaged anymore goes away.
+	for ( int iTarget=m_TargetEnts.Count()-1; iTarget >= 0; iTarget-- )
+	{
+		if ( m_TargetAttackerCount[iTarget] == 0 )
+			RemoveTarget( iTarget );
+	}
 }
 
 
@@ -200,14 +341,17 @@ float GetFireDamageScale( CBaseEntity *pEnt )
 }
 
 
-void CFireDamageMgr::ApplyCollectedDamage( CFireDamageMgr::CDamageEnt *pEnt, int iAttacker )
+void CFireDamageMgr::ApplyCollectedDamage( int iAttacker )
 {
-	CDamageAttacker *pAttacker = &pEnt->m_Attackers[iAttacker];
+	CBaseEntity *pEnt = m_TargetEnts[ m_AttackerTarget[iAttacker] ];
+	float flDamageSum = m_AttackerDamageSum[iAttacker];
+	m_AttackerDamageSum[iAttacker] = 0;
 
-	CTakeDamageInfo info( NULL, pAttacker->m_hAttacker, pAttacker->m_flDamageSum * GetFireDamageScale( pEnt->m_hEnt ), DMG_BURN );
-	pEnt->m_hEnt->TakeDamage( info );
+	if ( !pEnt )
+		return;
 
-	pAttacker->m_flDamageSum = 0;
+	CTakeDamageInfo info( NULL, m_AttackerEnts[iAttacker], flDamageSum * GetFireDamageScale( pEnt ), DMG_BURN );
+	pEnt->TakeDamage( info );
 }
 
 
@@ -220,11 +364,6 @@ bool IsBurnableEnt( CBaseEntity *pEntity, int iIgnoreTeam ) {
 		return false;
 	}
 
-	CGasolineBlob *pBlob = dynamic_cast< CGasolineBlob* >( pEntity );
-	if ( pBlob ) {
-		return !pBlob->IsLit();
-	}
-
 	if ( pEntity->GetTeamNumber() == iIgnoreTeam && !fire_damageall.GetInt() ) {
 		// Don't damage anyone on the pyro's team (including the pyro himself).
 		return false;
@@ -291,3 +430,117 @@ CFireDamageMgr* GetFireDamageMgr()
 	return &g_FireDamageMgr;
 }
 
+
+
+// ------------------------------------------------------------------------------------------------ //
+// Benchmark.
+//
+// Drives 64 targets x 16 attackers through the fire damage kernels, and through the scalar
+// per-entity math the manager used to do, then checks they agree and prints the timings.
+// ------------------------------------------------------------------------------------------------ //
+
+#define FIRE_BENCH_TARGETS		64
+#define FIRE_BENCH_ATTACKERS	16
+#define FIRE_BENCH_TOTAL		(FIRE_BENCH_TARGETS * FIRE_BENCH_ATTACKERS)
+
+static void FireDamage_ReferenceStep( 
+	float pVelocity[FIRE_BENCH_TARGETS][FIRE_BENCH_ATTACKERS], 
+	float pDamageSum[FIRE_BENCH_TARGETS][FIRE_BENCH_ATTACKERS], 
+	float flFrameDecay, 
+	float flMaxDamagePerSecond, 
+	float flFrameTime )
+{
+	for ( int iTarget=0; iTarget < FIRE_BENCH_TARGETS; iTarget++ )
+	{
+		// Sum up each attacker's velocity.
+		float flTotalVelocity = 0;
+		int i;
+		for ( i=0; i < FIRE_BENCH_ATTACKERS; i++ )
+			flTotalVelocity += pVelocity[iTarget][i];
+
+		// Decay each attacker's velocity.
+		flTotalVelocity *= flFrameDecay;
+
+		// Uniformly scale each attacker's velocity down so the sum total doesn't exceed our maximum.
+		float flPercentScale = 1;
+		if ( flTotalVelocity > flMaxDamagePerSecond )
+			flPercentScale = flMaxDamagePerSecond / flTotalVelocity;
+
+		for ( i=0; i < FIRE_BENCH_ATTACKERS; i++ )
+		{
+			pVelocity[iTarget][i] *= flFrameDecay * flPercentScale;
+			pDamageSum[iTarget][i] += pVelocity[iTarget][i] * flFrameTime;
+		}
+	}
+}
+
+
+void CC_FireDamageBenchmark( const CCommand &args )
+{
+	int nFrames = args.ArgC() > 1 ? max( atoi( args[1] ), 1 ) : 10000;
+	const float flFrameTime = 0.015f;
+	const float flMaxDamagePerSecond = GetFireDamageMgr()->GetMaxDamagePerSecond();
+	const float flFrameDecay = expf( -GetFireDamageMgr()->GetDecayConstant() * flFrameTime );
+
+	// Attacker i burns target (i % FIRE_BENCH_TARGETS) so the lanes aren't grouped by target.
+	static float s_flAccel[FIRE_BENCH_TOTAL];
+	static int s_iAttackerTarget[FIRE_BENCH_TOTAL];
+	static float s_flVelocity[FIRE_BENCH_TOTAL];
+	static float s_flDamageSum[FIRE_BENCH_TOTAL];
+	static float s_flAttackerScale[FIRE_BENCH_TOTAL];
+	static float s_flTargetVelocity[FIRE_BENCH_TARGETS];
+	static float s_flTargetScale[FIRE_BENCH_TARGETS];
+
+	static float s_flRefVelocity[FIRE_BENCH_TARGETS][FIRE_BENCH_ATTACKERS];
+	static float s_flRefDamageSum[FIRE_BENCH_TARGETS][FIRE_BENCH_ATTACKERS];
+
+	for ( int i=0; i < FIRE_BENCH_TOTAL; i++ )
+	{
+		s_flAccel[i] = RandomFloat( 1, FIRE_DAMAGE_PER_SEC );
+		s_iAttackerTarget[i] = i % FIRE_BENCH_TARGETS;
+		s_flVelocity[i] = s_flDamageSum[i] = 0;
+		s_flRefVelocity[i % FIRE_BENCH_TARGETS][i / FIRE_BENCH_TARGETS] = 0;
+		s_flRefDamageSum[i % FIRE_BENCH_TARGETS][i / FIRE_BENCH_TARGETS] = 0;
+	}
+
+	// Scalar reference.
+	double flStart = Plat_FloatTime();
+	for ( int iFrame=0; iFrame < nFrames; iFrame++ )
+	{
+		for ( int i=0; i < FIRE_BENCH_TOTAL; i++ )
+			s_flRefVelocity[i % FIRE_BENCH_TARGETS][i / FIRE_BENCH_TARGETS] += s_flAccel[i] * flFrameTime;
+
+		FireDamage_ReferenceStep( s_flRefVelocity, s_flRefDamageSum, flFrameDecay, flMaxDamagePerSecond, flFrameTime );
+	}
+	double flRefTime = Plat_FloatTime() - flStart;
+
+	// Lanes.
+	flStart = Plat_FloatTime();
+	for ( int iFrame=0; iFrame < nFrames; iFrame++ )
+	{
+		for ( int i=0; i < FIRE_BENCH_TOTAL; i++ )
+			s_flVelocity[i] += s_flAccel[i] * flFrameTime;
+
+		FireDamage_ComputeTargetScales( s_iAttackerTarget, s_flVelocity, FIRE_BENCH_TOTAL, s_flTargetVelocity, s_flTargetScale, FIRE_BENCH_TARGETS, flFrameDecay, flMaxDamagePerSecond );
+		FireDamage_IntegrateAttackers( s_iAttackerTarget, s_flTargetScale, s_flAttackerScale, s_flVelocity, s_flDamageSum, FIRE_BENCH_TOTAL, flFrameTime );
+	}
+	double flLaneTime = Plat_FloatTime() - flStart;
+
+	// Compare.
+	float flMaxError = 0;
+	for ( int i=0; i < FIRE_BENCH_TOTAL; i++ )
+	{
+		float flRefVelocity = s_flRefVelocity[i % FIRE_BENCH_TARGETS][i / FIRE_BENCH_TARGETS];
+		float flRefDamageSum = s_flRefDamageSum[i % FIRE_BENCH_TARGETS][i / FIRE_BENCH_TARGETS];
+
+		flMaxError = max( flMaxError, fabs( s_flVelocity[i] - flRefVelocity ) / max( fabs( flRefVelocity ), 1.0f ) );
+		flMaxError = max( flMaxError, fabs( s_flDamageSum[i] - flRefDamageSum ) / max( fabs( flRefDamageSum ), 1.0f ) );
+	}
+
+	Msg( "fire_damage_benchmark: %d targets x %d attackers, %d frames\n", FIRE_BENCH_TARGETS, FIRE_BENCH_ATTACKERS, nFrames );
+	Msg( "    scalar: %.3f us / frame\n", 1000000.0 * flRefTime / nFrames );
+	Msg( "    lanes:  %.3f us / frame\n", 1000000.0 * flLaneTime / nFrames );
+	Msg( "    max relative error: %g (%s)\n", flMaxError, ( flMaxError < 1e-4f ) ? "ok" : "FAILED" );
+}
+
+static ConCommand fire_damage_benchmark( "fire_damage_benchmark", CC_FireDamageBenchmark, "Benchmark the fire damage kernels against the scalar decay math.", FCVAR_CHEAT );
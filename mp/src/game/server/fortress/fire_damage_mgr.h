@@ -13,7 +13,7 @@
 
 
 #include "igamesystem.h"
-#include "utllinkedlist.h"
+#include "utlvector.h"
 #include "ehandle.h"
 
 
@@ -26,14 +26,23 @@ class CEntityBurnEffect;
 // This class manages fire damage being applied to entities. It uses velocity, acceleration,
 // and decay to model fire damage building up, and it puts a cap on the maximum amount of damage
 // an entity can take from fire during a given frame.
+//
+// The state is kept as structure-of-arrays: one set of lanes per burning target and one set
+// per (target, attacker) pair, so the decay and scaling can run 4-wide across everything that's
+// burning. There is no limit on how many attackers a target can have.
 // ------------------------------------------------------------------------------------------ //
 
-class CFireDamageMgr : public CAutoGameSystem
+class CFireDamageMgr : public CAutoGameSystemPerFrame
 {
+public:
+	CFireDamageMgr();
+
 // Overrides.
 public:
 
 	virtual bool	Init();
+	virtual void	LevelShutdownPostEntity();
+	virtual void	FrameUpdatePreEntityThink();
 	virtual void	FrameUpdatePostEntityThink();
 
 
@@ -45,62 +54,76 @@ public:
 	//       will be applied since it will decay faster than 
 	void		AddDamage( CBaseEntity *pTarget, CBaseEntity *pAttacker, float flDamageAccel, bool bMakeBurnEffect );
 
+	float		GetMaxDamagePerSecond() const	{ return m_flMaxDamagePerSecond; }
+	float		GetDecayConstant() const		{ return m_flDecayConstant; }
 
-private:
-	class CDamageAttacker
-	{
-	public:
-		void	Init( CBaseEntity *pAttacker, float flVelocity )
-		{
-			m_hAttacker = pAttacker;
-			m_flVelocity = flVelocity;
-			m_flDamageSum = 0;
-		}		
-		
-		EHANDLE	m_hAttacker{ nullptr };
-		float	m_flVelocity{ 0.0f };	// Current damage velocity.
-		
-		float	m_flDamageSum{ 0.0f };	// Damage is summed up and applied a couple times per second instead of 
-										// each frame since fractional damage is rounded to 1.
-	};
-
-	class CDamageEnt
-	{
-	public:
-		enum
-		{
-			MAX_ATTACKERS = 4
-		};
-
-		bool				m_bWasAlive;
-
-		EHANDLE				m_hEnt;
-		CHandle<CEntityBurnEffect>	m_pBurnEffect;
-		
-		// Each attacker gets credit for a portion of 
-		CDamageAttacker	m_Attackers[MAX_ATTACKERS];
-		int				m_nAttackers;
-	};
+	// True on the frames where the collected damage gets applied (every FIRE_DAMAGE_APPLY_INTERVAL).
+	// Anything else that builds up heat, like gasoline blobs, uses this to stay in step.
+	bool		IsApplyingDamageThisFrame() const	{ return m_bApplyDamageThisFrame; }
 
 
 private:
 
-	void		ApplyCollectedDamage( CFireDamageMgr::CDamageEnt *pEnt, int iAttacker );
-	void		RemoveDamageEnt( int iEnt );
+	int			FindTarget( CBaseEntity *pTarget ) const;
+	int			FindAttacker( int iTarget, CBaseEntity *pAttacker ) const;
+
+	void		ApplyCollectedDamage( int iAttacker );
+	void		RemoveAttacker( int iAttacker );
+	void		RemoveTarget( int iTarget );
 
 
 private:
-	
-	CUtlLinkedList<CDamageEnt,int>	m_DamageEnts;
+
+	// Per-target lanes.
+	CUtlVector<EHANDLE>						m_TargetEnts;
+	CUtlVector<CHandle<CEntityBurnEffect> >	m_TargetBurnEffects;
+	CUtlVector<bool>						m_TargetWasAlive;
+	CUtlVector<int>							m_TargetAttackerCount;
+	CUtlVector<float>						m_TargetVelocity;	// Sum of all attacker velocities.
+	CUtlVector<float>						m_TargetScale;		// Decay * clamp for this frame.
+
+	// Per-attacker lanes. Each attacker gets credit for a portion of the damage to its target.
+	CUtlVector<int>							m_AttackerTarget;	// Index into the target lanes.
+	CUtlVector<EHANDLE>						m_AttackerEnts;
+	CUtlVector<float>						m_AttackerVelocity;	// Current damage velocity.
+	CUtlVector<float>						m_AttackerDamageSum;	// Damage is summed up and applied a couple times per second instead of 
+																	// each frame since fractional damage is rounded to 1.
+	CUtlVector<float>						m_AttackerScale;	// Scratch lane for the target scale.
 
 	float	m_flMaxDamagePerSecond;
 	float 	m_flDecayConstant;
 
 	// This counts down to zero so we only apply fire damage every so often.
 	float	m_flApplyDamageCountdown;
+	bool	m_bApplyDamageThisFrame;
 };
 
 
+// Fire damage kernels. These work on raw lanes so they can be benchmarked without entities.
+
+// Sums attacker velocities into their targets and works out each target's scale for the frame:
+// the decay, times whatever it takes to keep the decayed total under flMaxDamagePerSecond.
+void FireDamage_ComputeTargetScales(
+	const int *pAttackerTarget,
+	const float *pAttackerVelocity,
+	int nAttackers,
+	float *pTargetVelocity,
+	float *pTargetScale,
+	int nTargets,
+	float flFrameDecay,
+	float flMaxDamagePerSecond );
+
+// Scales each attacker's velocity by its target's scale and adds this frame's damage to its sum.
+void FireDamage_IntegrateAttackers(
+	const int *pAttackerTarget,
+	const float *pTargetScale,
+	float *pAttackerScale,
+	float *pAttackerVelocity,
+	float *pAttackerDamageSum,
+	int nAttackers,
+	float flFrameTime );
+
+
 // Returns true if the entity is burnable by the specified team.
 bool IsBurnableEnt( CBaseEntity *pEntity, int iTeam );
 
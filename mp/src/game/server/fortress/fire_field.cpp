@@ -0,0 +1,320 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-team entity that owns and networks that team's gasoline blobs.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "fire_field.h"
+#include "tier0/vprof.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+// Roughly what one blob entity used to cost in a snapshot when it was created, and each tick
+// it was flying (origin only). Only used to print comparisons in fire_field_stats.
+#define OLD_BLOB_ENTITY_CREATE_BITS		260
+#define OLD_BLOB_ENTITY_MOVE_BITS		70
+
+// Roughly what each changed int costs in a delta on top of its value (the property index).
+#define FIRE_FIELD_PROP_INDEX_BITS		7
+
+// Bits in one slot's worth of record, and the most one UpdateSlot can add to a delta.
+#define FIRE_FIELD_SLOT_BITS			(FIRE_FIELD_INFO_BITS + FIRE_FIELD_TIMES_BITS + FIRE_FIELD_COORD_BITS * 3 + FIRE_FIELD_VELOCITY_BITS + FIRE_FIELD_NORMAL_BITS)
+#define FIRE_FIELD_SLOT_UPDATE_BITS		(FIRE_FIELD_INFO_BITS + FIRE_FIELD_TIMES_BITS + FIRE_FIELD_COORD_BITS * 3 + FIRE_FIELD_VELOCITY_BITS + FIRE_FIELD_PROP_INDEX_BITS * 6)
+
+
+static CUtlVector<CFireField*> g_FireFields;
+
+
+// ------------------------------------------------------------------------------------------ //
+// CFireField implementation.
+// ------------------------------------------------------------------------------------------ //
+
+IMPLEMENT_SERVERCLASS_ST_NOBASE( CFireField, DT_FireField )
+	SendPropArray3( SENDINFO_ARRAY3( m_nBlobInfo ), SendPropInt( SENDINFO_ARRAY( m_nBlobInfo ), FIRE_FIELD_INFO_BITS, SPROP_UNSIGNED ) ),
+	SendPropArray3( SENDINFO_ARRAY3( m_nBlobTimes ), SendPropInt( SENDINFO_ARRAY( m_nBlobTimes ), FIRE_FIELD_TIMES_BITS, SPROP_UNSIGNED ) ),
+	SendPropArray3( SENDINFO_ARRAY3( m_nBlobOrigin ), SendPropInt( SENDINFO_ARRAY( m_nBlobOrigin ), FIRE_FIELD_COORD_BITS, SPROP_UNSIGNED ) ),
+	SendPropArray3( SENDINFO_ARRAY3( m_nBlobVelocity ), SendPropInt( SENDINFO_ARRAY( m_nBlobVelocity ), FIRE_FIELD_VELOCITY_BITS, SPROP_UNSIGNED ) ),
+	SendPropArray3( SENDINFO_ARRAY3( m_nBlobNormal ), SendPropInt( SENDINFO_ARRAY( m_nBlobNormal ), FIRE_FIELD_NORMAL_BITS, SPROP_UNSIGNED ) ),
+END_SEND_TABLE()
+
+
+LINK_ENTITY_TO_CLASS( fire_field, CFireField );
+
+
+CFireField::CFireField()
+{
+	m_nBlobs = 0;
+	m_iNextSlot = 0;
+	m_iNextSerial = 1;
+
+	for ( int i=0; i < FIRE_FIELD_MAX_BLOBS; i++ )
+	{
+		m_Blobs[i].m_pField = this;
+		m_Blobs[i].m_iSlot = i;
+	}
+
+	ResetStats();
+	g_FireFields.AddToTail( this );
+}
+
+
+CFireField::~CFireField()
+{
+	g_FireFields.FindAndRemove( this );
+}
+
+
+CFireField* CFireField::GetTeamField( int iTeam )
+{
+	for ( int i=0; i < g_FireFields.Count(); i++ )
+	{
+		CFireField *pField = g_FireFields[i];
+		if ( pField->GetTeamNumber() == iTeam && !pField->IsMarkedForDeletion() )
+			return pField;
+	}
+
+	CFireField *pField = (CFireField*)CreateEntityByName( "fire_field" );
+	if ( !pField )
+		return NULL;
+
+	pField->ChangeTeam( iTeam );
+	DispatchSpawn( pField );
+	return pField;
+}
+
+
+int CFireField::GetNumFields()
+{
+	return g_FireFields.Count();
+}
+
+
+CFireField* CFireField::GetField( int i )
+{
+	return g_FireFields[i];
+}
+
+
+void CFireField::Spawn()
+{
+	BaseClass::Spawn();
+
+	SetMoveType( MOVETYPE_NONE );
+	SetSolid( SOLID_NONE );
+
+	SetThink( &CFireField::FieldThink );
+	SetNextThink( gpGlobals->curtime );
+}
+
+
+int CFireField::UpdateTransmitState()
+{
+	// The blobs are spread all over, so there's no one spot to do a PVS check against.
+	return SetTransmitState( FL_EDICT_ALWAYS );
+}
+
+
+CGasolineBlob* CFireField::AllocBlob()
+{
+	CGasolineBlob *pBlob = &m_Blobs[m_iNextSlot];
+
+	// Wrapped around onto one that's still going. Unlit puddles last a lot longer than the
+	// blobs around them, so look for a slot that's been freed since before dropping anything.
+	if ( pBlob->m_iSerial && m_nBlobs < FIRE_FIELD_MAX_BLOBS )
+	{
+		for ( int i=1; i < FIRE_FIELD_MAX_BLOBS; i++ )
+		{
+			CGasolineBlob *pTest = &m_Blobs[( m_iNextSlot + i ) % FIRE_FIELD_MAX_BLOBS];
+			if ( !pTest->m_iSerial )
+			{
+				pBlob = pTest;
+				break;
+			}
+		}
+	}
+
+	m_iNextSlot = ( pBlob->m_iSlot + 1 ) % FIRE_FIELD_MAX_BLOBS;
+
+	// Every slot's taken, so the one in the next slot goes.
+	if ( pBlob->m_iSerial )
+	{
+		++m_nStatEvictions;
+		FreeBlob( pBlob );
+	}
+
+	pBlob->m_iSerial = m_iNextSerial;
+	m_iNextSerial = ( m_iNextSerial % ((1 << FIRE_FIELD_SERIAL_BITS) - 1) ) + 1;
+
+	pBlob->m_AutoBurnBlobs.RemoveAll();
+	++m_nBlobs;
+	m_nStatMaxBlobs = max( m_nStatMaxBlobs, m_nBlobs );
+
+	return pBlob;
+}
+
+
+void CFireField::FreeBlob( CGasolineBlob *pBlob )
+{
+	Assert( pBlob->m_pField == this && pBlob->m_iSerial );
+
+	pBlob->m_iSerial = 0;
+	pBlob->m_AutoBurnBlobs.Purge();
+	--m_nBlobs;
+
+	UpdateSlot( pBlob );
+}
+
+
+CGasolineBlob* CFireField::GetBlob( int iSlot )
+{
+	CGasolineBlob *pBlob = &m_Blobs[iSlot];
+	return pBlob->m_iSerial ? pBlob : NULL;
+}
+
+
+void CFireField::UpdateSlot( CGasolineBlob *pBlob )
+{
+	int iSlot = pBlob->m_iSlot;
+	++m_nStatSlotUpdates;
+
+	if ( !pBlob->m_iSerial )
+	{
+		// The client only needs to know the slot is empty.
+		m_nBlobInfo.Set( iSlot, 0 );
+		return;
+	}
+
+	// Only the serial matters on the client, so it's fine that it's smaller than ours.
+	m_nBlobInfo.Set( iSlot, FireField_PackInfo( pBlob->m_iSerial, pBlob->m_BlobFlags, pBlob->m_flMaxLifetime ) );
+	m_nBlobTimes.Set( iSlot, FireField_PackTimes( pBlob->m_nCreateTick, pBlob->IsLit() ? pBlob->m_nLitTick : -1 ) );
+	m_nBlobOrigin.Set( iSlot*3+0, FireField_PackCoord( pBlob->m_vecOrigin.x ) );
+	m_nBlobOrigin.Set( iSlot*3+1, FireField_PackCoord( pBlob->m_vecOrigin.y ) );
+	m_nBlobOrigin.Set( iSlot*3+2, FireField_PackCoord( pBlob->m_vecOrigin.z ) );
+
+	// Flying blobs need their velocity, landed blobs need their surface.
+	if ( pBlob->IsStopped() )
+	{
+		m_nBlobNormal.Set( iSlot, FireField_PackNormal( pBlob->m_vSurfaceNormal ) );
+	}
+	else
+	{
+		m_nBlobVelocity.Set( iSlot, FireField_PackVelocity( pBlob->m_vecVelocity ) );
+	}
+}
+
+
+void CFireField::FieldThink()
+{
+	VPROF( "CFireField::FieldThink" );
+
+	double flStart = Plat_FloatTime();
+
+	if ( m_nBlobs )
+	{
+		for ( int i=0; i < FIRE_FIELD_MAX_BLOBS; i++ )
+		{
+			if ( m_Blobs[i].m_iSerial )
+			{
+				m_Blobs[i].Think();
+			}
+		}
+	}
+
+	++m_nStatTicks;
+	m_flStatThinkTime += Plat_FloatTime() - flStart;
+
+	VPROF_INCREMENT_COUNTER( "FireField: blobs", m_nBlobs );
+
+	SetNextThink( gpGlobals->curtime );
+}
+
+
+void CFireField::ResetStats()
+{
+	m_nStatTicks = 0;
+	m_nStatSlotUpdates = 0;
+	m_nStatEvictions = 0;
+	m_nStatMaxBlobs = m_nBlobs;
+	m_flStatThinkTime = 0;
+}
+
+
+void CFireField::PrintStats()
+{
+	int nTicks = max( m_nStatTicks, 1 );
+	float flUpdatesPerTick = (float)m_nStatSlotUpdates / nTicks;
+
+	Msg( "Fire field for team %d: %d blobs (max %d), %d evicted, over %d ticks\n", GetTeamNumber(), m_nBlobs, m_nStatMaxBlobs, m_nStatEvictions, m_nStatTicks );
+	Msg( "    think:    avg %.3f ms/tick\n", m_flStatThinkTime * 1000.0 / nTicks );
+	Msg( "    slot updates: avg %.2f/tick, <= %d bytes/tick delta, ~%d bytes full update\n",
+		flUpdatesPerTick,
+		(int)( flUpdatesPerTick * FIRE_FIELD_SLOT_UPDATE_BITS / 8 ),
+		( m_nBlobs * FIRE_FIELD_SLOT_BITS ) / 8 );
+
+	int nFlying = 0;
+	for ( int i=0; i < FIRE_FIELD_MAX_BLOBS; i++ )
+	{
+		if ( m_Blobs[i].m_iSerial && !m_Blobs[i].IsStopped() )
+			++nFlying;
+	}
+
+	Msg( "    as entities: %d edicts, ~%d bytes full update, ~%d bytes/tick for the %d flying\n",
+		m_nBlobs,
+		( m_nBlobs * OLD_BLOB_ENTITY_CREATE_BITS ) / 8,
+		( nFlying * OLD_BLOB_ENTITY_MOVE_BITS ) / 8,
+		nFlying );
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// Global functions.
+// ------------------------------------------------------------------------------------------ //
+
+int FindGasolineBlobsInSphere( CGasolineBlob **ppBlobs, int nMaxBlobs, const Vector &vCenter, float flRadius )
+{
+	float flRadiusSqr = flRadius * flRadius;
+	int nBlobs = 0;
+
+	for ( int iField=0; iField < CFireField::GetNumFields(); iField++ )
+	{
+		CFireField *pField = CFireField::GetField( iField );
+		if ( !pField->GetNumBlobs() )
+			continue;
+
+		for ( int i=0; i < FIRE_FIELD_MAX_BLOBS; i++ )
+		{
+			CGasolineBlob *pBlob = pField->GetBlob( i );
+			if ( !pBlob || pBlob->GetAbsOrigin().DistToSqr( vCenter ) > flRadiusSqr )
+				continue;
+
+			ppBlobs[nBlobs++] = pBlob;
+			if ( nBlobs >= nMaxBlobs )
+				return nBlobs;
+		}
+	}
+
+	return nBlobs;
+}
+
+
+static void CC_FireFieldStats( const CCommand &args )
+{
+	Msg( "%d edicts in use, %d fire fields\n", engine->GetEntityCount(), CFireField::GetNumFields() );
+
+	for ( int i=0; i < CFireField::GetNumFields(); i++ )
+	{
+		CFireField *pField = CFireField::GetField( i );
+		pField->PrintStats();
+
+		if ( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) )
+		{
+			pField->ResetStats();
+		}
+	}
+}
+
+static ConCommand fire_field_stats( "fire_field_stats", CC_FireFieldStats, "Print gasoline blob counts, think time and estimated network cost per fire field. Pass 'reset' to clear them afterwards." );
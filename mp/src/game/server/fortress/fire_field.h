@@ -0,0 +1,104 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-team entity that owns and networks that team's gasoline blobs.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef FIRE_FIELD_H
+#define FIRE_FIELD_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "baseentity.h"
+#include "gasoline_blob.h"
+#include "fire_field_shared.h"
+
+
+// ------------------------------------------------------------------------------------------ //
+// CFireField.
+//
+// Every gasoline blob used to be its own networked entity, so a few pyros could eat hundreds
+// of edicts and make CheckTransmit and the snapshots crawl. Now each team gets one of these.
+// It keeps the team's blobs in a fixed ring of slots, thinks for all of them at once, and
+// sends each slot as a few fixed-point ints (see fire_field_shared.h). A slot's ints are only
+// touched when the blob spawns, lands, lights or goes away, so the delta for a tick is just
+// the slots that had one of those happen.
+//
+// New blobs take the next slot in the ring. If the ring wraps around onto a blob that's still
+// alive, the next free slot after it is used instead. Only when every slot is taken is the
+// blob in the next slot dropped.
+// ------------------------------------------------------------------------------------------ //
+
+class CFireField : public CBaseEntity
+{
+public:
+	DECLARE_CLASS( CFireField, CBaseEntity );
+	DECLARE_SERVERCLASS();
+
+					CFireField();
+	virtual			~CFireField();
+
+	// Returns the team's field, creating it if it's not there yet.
+	static CFireField*	GetTeamField( int iTeam );
+
+	// Iterate every field with these.
+	static int			GetNumFields();
+	static CFireField*	GetField( int i );
+
+
+// Overrides.
+public:
+
+	virtual void	Spawn();
+	virtual int		UpdateTransmitState();
+
+
+public:
+
+	// Takes the next slot in the ring and resets it.
+	CGasolineBlob*	AllocBlob();
+	void			FreeBlob( CGasolineBlob *pBlob );
+
+	// NULL if the slot is free.
+	CGasolineBlob*	GetBlob( int iSlot );
+	int				GetNumBlobs() const		{ return m_nBlobs; }
+
+	// The blobs call this when something the client needs to know about changes.
+	void			UpdateSlot( CGasolineBlob *pBlob );
+
+	void			FieldThink();
+
+	// Stats for fire_field_stats.
+	void			PrintStats();
+	void			ResetStats();
+
+
+private:
+
+	int				m_nBlobs;
+	int				m_iNextSlot;
+	int				m_iNextSerial;
+	CGasolineBlob	m_Blobs[FIRE_FIELD_MAX_BLOBS];
+
+	int				m_nStatTicks;
+	int				m_nStatSlotUpdates;
+	int				m_nStatEvictions;
+	int				m_nStatMaxBlobs;
+	double			m_flStatThinkTime;
+
+	CNetworkArray( int, m_nBlobInfo, FIRE_FIELD_MAX_BLOBS );
+	CNetworkArray( int, m_nBlobTimes, FIRE_FIELD_MAX_BLOBS );
+	CNetworkArray( int, m_nBlobOrigin, FIRE_FIELD_MAX_BLOBS * 3 );
+	CNetworkArray( int, m_nBlobVelocity, FIRE_FIELD_MAX_BLOBS );
+	CNetworkArray( int, m_nBlobNormal, FIRE_FIELD_MAX_BLOBS );
+};
+
+
+// Fills in the blobs whose centers are within flRadius of vCenter. Returns the number found.
+int FindGasolineBlobsInSphere( CGasolineBlob **ppBlobs, int nMaxBlobs, const Vector &vCenter, float flRadius );
+
+
+#endif // FIRE_FIELD_H
@@ -0,0 +1,507 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-tick broadphase that pairs lit gasoline blobs with burnable entities.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "fire_spatial_hash.h"
+#include "fire_damage_mgr.h"
+#include "gasoline_blob.h"
+#include "gasoline_shared.h"
+#include "fire_field.h"
+#include "tf_gamerules.h"
+#include "tf_team.h"
+#include "tf_obj.h"
+#include "ai_basenpc.h"
+#include "collisionutils.h"
+#include "tier0/vprof.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+// Blobs are hashed into cubes this big. Using the search distance means an entity's bounds,
+// expanded by the search radius, only ever touch a handful of cells.
+#define FIRE_HASH_CELL_SIZE			FIRE_DAMAGE_SEARCH_DISTANCE
+
+#define FIRE_HASH_CELL_BITS			10
+#define FIRE_HASH_CELL_MASK			((1 << FIRE_HASH_CELL_BITS) - 1)
+
+
+ConVar fire_hash_enable( "fire_hash_enable", "1", 0, "Use the per-tick spatial hash to find things for lit gasoline blobs to burn." );
+
+
+CBasePlayer *BotPutInServer( bool bFrozen, int iTeam, int iClass );
+
+
+static inline int FireHashCellCoord( float flCoord )
+{
+	return (int)floor( flCoord / FIRE_HASH_CELL_SIZE );
+}
+
+static inline unsigned int FireHashCellKey( int x, int y, int z )
+{
+	return	( (unsigned int)( x & FIRE_HASH_CELL_MASK ) << (FIRE_HASH_CELL_BITS * 2) ) |
+			( (unsigned int)( y & FIRE_HASH_CELL_MASK ) << FIRE_HASH_CELL_BITS ) |
+			(unsigned int)( z & FIRE_HASH_CELL_MASK );
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// CFireSpatialHash implementation.
+// ------------------------------------------------------------------------------------------ //
+
+CFireSpatialHash::CFireSpatialHash() : CAutoGameSystemPerFrame( "CFireSpatialHash" )
+{
+	m_iStressState = STRESS_OFF;
+	m_nStressFrames = 0;
+	m_nStressFramesLeft = 0;
+	m_flStressEmitTime = 0;
+	m_flStressFrameStart = 0;
+	m_flStressTotal[0] = m_flStressTotal[1] = 0;
+	m_nStressSaveEnable = 1;
+}
+
+
+void CFireSpatialHash::LevelShutdownPostEntity()
+{
+	m_LitBlobs.Purge();
+	m_Cells.Purge();
+	m_StressPyros.Purge();
+	m_iStressState = STRESS_OFF;
+}
+
+
+bool CFireSpatialHash::IsActive() const
+{
+	return fire_hash_enable.GetBool();
+}
+
+
+int __cdecl CFireSpatialHash::SortCellEntries( const CellEntry_t *pLeft, const CellEntry_t *pRight )
+{
+	if ( pLeft->m_nKey < pRight->m_nKey )
+		return -1;
+	if ( pLeft->m_nKey > pRight->m_nKey )
+		return 1;
+	return pLeft->m_iBlob - pRight->m_iBlob;
+}
+
+
+void CFireSpatialHash::BuildGrid()
+{
+	m_LitBlobs.RemoveAll();
+	m_Cells.RemoveAll();
+
+	for ( int iField=0; iField < CFireField::GetNumFields(); iField++ )
+	{
+		CFireField *pField = CFireField::GetField( iField );
+		if ( !pField->GetNumBlobs() )
+			continue;
+
+		for ( int i=0; i < FIRE_FIELD_MAX_BLOBS; i++ )
+		{
+			CGasolineBlob *pBlob = pField->GetBlob( i );
+			if ( !pBlob || !pBlob->IsLit() )
+				continue;
+
+			CBaseEntity *pOwner = pBlob->GetBlobOwner();
+			if ( !pOwner )
+				continue;
+
+			float flLitPercent = pBlob->GetLitPercent();
+			if ( flLitPercent <= 0 )
+				continue;
+
+			int iBlob = m_LitBlobs.AddToTail();
+			LitBlob_t &blob = m_LitBlobs[iBlob];
+			blob.m_vecOrigin = pBlob->GetAbsOrigin();
+			blob.m_hOwner = pOwner;
+			blob.m_iOwnerTeam = pOwner->GetTeamNumber();
+			blob.m_flLitPercent = flLitPercent;
+
+			int iCell = m_Cells.AddToTail();
+			m_Cells[iCell].m_nKey = FireHashCellKey(
+				FireHashCellCoord( blob.m_vecOrigin.x ),
+				FireHashCellCoord( blob.m_vecOrigin.y ),
+				FireHashCellCoord( blob.m_vecOrigin.z ) );
+			m_Cells[iCell].m_iBlob = iBlob;
+		}
+	}
+
+	m_Cells.Sort( SortCellEntries );
+
+	VPROF_INCREMENT_COUNTER( "FireHash: lit blobs", m_LitBlobs.Count() );
+}
+
+
+int CFireSpatialHash::FindFirstInCell( unsigned int nKey ) const
+{
+	// Lower bound.
+	int iLow = 0;
+	int iHigh = m_Cells.Count();
+	while ( iLow < iHigh )
+	{
+		int iMid = (iLow + iHigh) >> 1;
+		if ( m_Cells[iMid].m_nKey < nKey )
+			iLow = iMid + 1;
+		else
+			iHigh = iMid;
+	}
+
+	if ( iLow < m_Cells.Count() && m_Cells[iLow].m_nKey == nKey )
+		return iLow;
+
+	return -1;
+}
+
+
+void CFireSpatialHash::BurnEntity( CBaseEntity *pEntity )
+{
+	if ( pEntity->m_takedamage == DAMAGE_NO || pEntity->IsMarkedForDeletion() )
+		return;
+
+	// Same bounds the engine's sphere query tests against.
+	Vector vecMins, vecMaxs;
+	pEntity->CollisionProp()->WorldSpaceSurroundingBounds( &vecMins, &vecMaxs );
+
+	int nMinX = FireHashCellCoord( vecMins.x - FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMinY = FireHashCellCoord( vecMins.y - FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMinZ = FireHashCellCoord( vecMins.z - FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMaxX = FireHashCellCoord( vecMaxs.x + FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMaxY = FireHashCellCoord( vecMaxs.y + FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMaxZ = FireHashCellCoord( vecMaxs.z + FIRE_DAMAGE_SEARCH_DISTANCE );
+
+	Vector vecCenter = pEntity->WorldSpaceCenter();
+	const Vector &mins = pEntity->WorldAlignMins();
+	const Vector &maxs = pEntity->WorldAlignMaxs();
+	float flApproxTargetRadius = ( Vector( maxs.x, maxs.y, 0 ) - Vector( mins.x, mins.y, 0 )).Length() * 0.5f;
+
+	int nPairTests = 0;
+	int nTraces = 0;
+
+	for ( int x=nMinX; x <= nMaxX; x++ )
+	{
+		for ( int y=nMinY; y <= nMaxY; y++ )
+		{
+			for ( int z=nMinZ; z <= nMaxZ; z++ )
+			{
+				unsigned int nKey = FireHashCellKey( x, y, z );
+				int iCell = FindFirstInCell( nKey );
+				if ( iCell == -1 )
+					continue;
+
+				for ( ; iCell < m_Cells.Count() && m_Cells[iCell].m_nKey == nKey; iCell++ )
+				{
+					const LitBlob_t &blob = m_LitBlobs[ m_Cells[iCell].m_iBlob ];
+					++nPairTests;
+
+					if ( !IsBoxIntersectingSphere( vecMins, vecMaxs, blob.m_vecOrigin, FIRE_DAMAGE_SEARCH_DISTANCE ) )
+						continue;
+
+					// When the line of sight is clear, the distance the blob's own search used to
+					// compute is just center to center. Anything that far away takes no damage, so
+					// reject it before paying for any traces.
+					float flDistFromBorder = FIRE_DAMAGE_DISTANCE - ( ( blob.m_vecOrigin - vecCenter ).Length() - flApproxTargetRadius );
+					if ( flDistFromBorder <= 0 )
+						continue;
+
+					if ( !IsBurnableEnt( pEntity, blob.m_iOwnerTeam ) )
+						continue;
+
+					CBaseEntity *pOwner = blob.m_hOwner;
+					if ( !pOwner )
+						continue;
+
+					// Make sure it's not blocked.
+					++nTraces;
+					trace_t tr;
+					UTIL_TraceLine( blob.m_vecOrigin, vecCenter, MASK_SHOT & (~CONTENTS_HITBOX), NULL, COLLISION_GROUP_NONE, &tr );
+					if ( tr.fraction != 1.0 && tr.m_pEnt != pEntity )
+						continue;
+
+					if ( TFGameRules()->IsTraceBlockedByWorldOrShield( blob.m_vecOrigin, vecCenter, pOwner, DMG_BURN | DMG_PROBE, &tr ) )
+						continue;
+
+					float flDamage = blob.m_flLitPercent * flDistFromBorder / FIRE_DAMAGE_DISTANCE * FIRE_DAMAGE_PER_SEC;
+					GetFireDamageMgr()->AddDamage( pEntity, pOwner, flDamage, true );
+				}
+			}
+		}
+	}
+
+	VPROF_INCREMENT_COUNTER( "FireHash: pair tests", nPairTests );
+	VPROF_INCREMENT_COUNTER( "FireHash: visibility traces", nTraces );
+}
+
+
+void CFireSpatialHash::HeatBlob( CGasolineBlob *pBlob )
+{
+	const Vector &vecOrigin = pBlob->GetAbsOrigin();
+	int nMinX = FireHashCellCoord( vecOrigin.x - FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMinY = FireHashCellCoord( vecOrigin.y - FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMinZ = FireHashCellCoord( vecOrigin.z - FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMaxX = FireHashCellCoord( vecOrigin.x + FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMaxY = FireHashCellCoord( vecOrigin.y + FIRE_DAMAGE_SEARCH_DISTANCE );
+	int nMaxZ = FireHashCellCoord( vecOrigin.z + FIRE_DAMAGE_SEARCH_DISTANCE );
+
+	for ( int x=nMinX; x <= nMaxX; x++ )
+	{
+		for ( int y=nMinY; y <= nMaxY; y++ )
+		{
+			for ( int z=nMinZ; z <= nMaxZ; z++ )
+			{
+				unsigned int nKey = FireHashCellKey( x, y, z );
+				int iCell = FindFirstInCell( nKey );
+				if ( iCell == -1 )
+					continue;
+
+				for ( ; iCell < m_Cells.Count() && m_Cells[iCell].m_nKey == nKey; iCell++ )
+				{
+					const LitBlob_t &blob = m_LitBlobs[ m_Cells[iCell].m_iBlob ];
+					pBlob->HeatFrom( blob.m_vecOrigin, blob.m_flLitPercent, blob.m_hOwner );
+
+					if ( pBlob->IsLit() )
+						return;
+				}
+			}
+		}
+	}
+}
+
+
+void CFireSpatialHash::BurnAllEntities()
+{
+	// Players.
+	for ( int i=1; i <= gpGlobals->maxClients; i++ )
+	{
+		CBasePlayer *pPlayer = UTIL_PlayerByIndex( i );
+		if ( pPlayer )
+			BurnEntity( pPlayer );
+	}
+
+	// NPCs.
+	CAI_BaseNPC **ppAIs = g_AI_Manager.AccessAIs();
+	for ( int i=0; i < g_AI_Manager.NumAIs(); i++ )
+	{
+		if ( ppAIs[i] )
+			BurnEntity( ppAIs[i] );
+	}
+
+	// Objects.
+	for ( int iTeam=0; iTeam < GetNumberOfTeams(); iTeam++ )
+	{
+		CTFTeam *pTeam = GetGlobalTFTeam( iTeam );
+		if ( !pTeam )
+			continue;
+
+		for ( int i=0; i < pTeam->GetNumObjects(); i++ )
+		{
+			CBaseObject *pObject = pTeam->GetObject( i );
+			if ( pObject )
+				BurnEntity( pObject );
+		}
+	}
+
+	// Unlit gasoline heats up when fire gets near it.
+	for ( int iField=0; iField < CFireField::GetNumFields(); iField++ )
+	{
+		CFireField *pField = CFireField::GetField( iField );
+		if ( !pField->GetNumBlobs() )
+			continue;
+
+		for ( int i=0; i < FIRE_FIELD_MAX_BLOBS; i++ )
+		{
+			CGasolineBlob *pBlob = pField->GetBlob( i );
+			if ( pBlob && !pBlob->IsLit() )
+				HeatBlob( pBlob );
+		}
+	}
+}
+
+
+void CFireSpatialHash::FrameUpdatePreEntityThink()
+{
+	if ( m_iStressState != STRESS_OFF )
+		UpdateStress();
+
+	if ( !IsActive() || !fire_enable.GetBool() )
+		return;
+
+	VPROF( "CFireSpatialHash::FrameUpdatePreEntityThink" );
+
+	BuildGrid();
+	if ( m_LitBlobs.Count() == 0 )
+		return;
+
+	BurnAllEntities();
+}
+
+
+void CFireSpatialHash::FrameUpdatePostEntityThink()
+{
+	if ( m_iStressState == STRESS_MEASURE_BRUTE || m_iStressState == STRESS_MEASURE_HASH )
+	{
+		m_flStressTotal[ m_iStressState - STRESS_MEASURE_BRUTE ] += Plat_FloatTime() - m_flStressFrameStart;
+	}
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// Stress scenario.
+//
+// Spawns N frozen pyro bots that keep dropping lit gasoline around a point in front of the
+// player, and M frozen enemy bots standing in the fire. It then times the entity think part
+// of the server frame with the brute force search and with the hash, and prints both.
+// ------------------------------------------------------------------------------------------ //
+
+#define FIRE_STRESS_WARMUP_FRAMES	(int)( MAX_LIT_GASOLINE_BLOB_LIFETIME / 0.015f )
+#define FIRE_STRESS_RADIUS			300.0f
+
+
+void CFireSpatialHash::StartStress( CBasePlayer *pPlayer, int nPyros, int nTargets, int nFrames )
+{
+	if ( m_iStressState != STRESS_OFF )
+	{
+		Msg( "fire_hash_stress: already running.\n" );
+		return;
+	}
+
+	CTFTeam *pTeam = (CTFTeam*)pPlayer->GetTeam();
+	CTFTeam *pEnemyTeam = pTeam ? pTeam->GetEnemyTeam() : NULL;
+	if ( !pTeam || !pEnemyTeam )
+	{
+		Msg( "fire_hash_stress: join a team first.\n" );
+		return;
+	}
+
+	Vector vecForward;
+	AngleVectors( pPlayer->EyeAngles(), &vecForward );
+	vecForward.z = 0;
+	VectorNormalize( vecForward );
+	m_vecStressTarget = pPlayer->GetAbsOrigin() + vecForward * ( FIRE_STRESS_RADIUS + 200 );
+
+	m_StressPyros.RemoveAll();
+	for ( int i=0; i < nPyros; i++ )
+	{
+		CBasePlayer *pBot = BotPutInServer( true, pTeam->GetTeamNumber(), TFCLASS_PYRO );
+		if ( !pBot )
+			break;
+
+		float flAngle = 2 * M_PI * i / nPyros;
+		Vector vecPos = m_vecStressTarget + Vector( cos( flAngle ), sin( flAngle ), 0 ) * ( FIRE_STRESS_RADIUS + 150 );
+		pBot->Teleport( &vecPos, NULL, &vec3_origin );
+		m_StressPyros.AddToTail( pBot );
+	}
+
+	for ( int i=0; i < nTargets; i++ )
+	{
+		CBasePlayer *pBot = BotPutInServer( true, pEnemyTeam->GetTeamNumber(), -1 );
+		if ( !pBot )
+			break;
+
+		Vector vecPos = m_vecStressTarget + RandomVector( -FIRE_STRESS_RADIUS, FIRE_STRESS_RADIUS );
+		vecPos.z = m_vecStressTarget.z;
+		pBot->Teleport( &vecPos, NULL, &vec3_origin );
+	}
+
+	Msg( "fire_hash_stress: %d pyros, %d targets, %d frames per pass.\n", m_StressPyros.Count(), nTargets, nFrames );
+
+	m_nStressSaveEnable = fire_hash_enable.GetInt();
+	fire_hash_enable.SetValue( 0 );
+	m_nStressFrames = nFrames;
+	m_nStressFramesLeft = FIRE_STRESS_WARMUP_FRAMES;
+	m_flStressEmitTime = 0;
+	m_flStressTotal[0] = m_flStressTotal[1] = 0;
+	m_iStressState = STRESS_WARMUP;
+}
+
+
+void CFireSpatialHash::UpdateStress()
+{
+	// Advance the state machine.
+	if ( --m_nStressFramesLeft < 0 )
+	{
+		if ( m_iStressState == STRESS_WARMUP )
+		{
+			for ( int i=0; i < CFireField::GetNumFields(); i++ )
+			{
+				CFireField::GetField( i )->ResetStats();
+			}
+			m_iStressState = STRESS_MEASURE_BRUTE;
+		}
+		else if ( m_iStressState == STRESS_MEASURE_BRUTE )
+		{
+			fire_hash_enable.SetValue( 1 );
+			m_iStressState = STRESS_MEASURE_HASH;
+		}
+		else
+		{
+			Msg( "fire_hash_stress: %d lit blobs\n", m_LitBlobs.Count() );
+			Msg( "    brute force: %.3f ms / frame\n", 1000.0 * m_flStressTotal[0] / m_nStressFrames );
+			Msg( "    spatial hash: %.3f ms / frame\n", 1000.0 * m_flStressTotal[1] / m_nStressFrames );
+
+			// The blobs' network cost (see fire_field.cpp).
+			Msg( "%d edicts in use\n", engine->GetEntityCount() );
+			for ( int i=0; i < CFireField::GetNumFields(); i++ )
+			{
+				CFireField::GetField( i )->PrintStats();
+			}
+
+			fire_hash_enable.SetValue( m_nStressSaveEnable );
+			m_iStressState = STRESS_OFF;
+			return;
+		}
+
+		m_nStressFramesLeft = m_nStressFrames;
+	}
+
+	// Each pyro hoses the target area with one lit blob per tick.
+	for ( int i=0; i < m_StressPyros.Count(); i++ )
+	{
+		CBaseEntity *pPyro = m_StressPyros[i];
+		if ( !pPyro )
+			continue;
+
+		Vector vecPos = m_vecStressTarget + RandomVector( -FIRE_STRESS_RADIUS, FIRE_STRESS_RADIUS );
+		vecPos.z = m_vecStressTarget.z + 16;
+
+		CGasolineBlob *pBlob = CGasolineBlob::Create( pPyro, vecPos, vec3_origin, false, MAX_LIT_GASOLINE_BLOB_LIFETIME, MAX_LIT_GASOLINE_BLOB_LIFETIME );
+		if ( pBlob )
+			pBlob->SetLit( true );
+	}
+
+	m_flStressFrameStart = Plat_FloatTime();
+}
+
+
+CFireSpatialHash g_FireSpatialHash;
+
+CFireSpatialHash* GetFireSpatialHash()
+{
+	return &g_FireSpatialHash;
+}
+
+
+void CC_FireHashStress( const CCommand &args )
+{
+	CBasePlayer *pPlayer = UTIL_GetCommandClient();
+	if ( !pPlayer )
+		return;
+
+	if ( args.ArgC() < 3 )
+	{
+		Msg( "Usage: fire_hash_stress <num pyros> <num targets> [frames per pass]\n" );
+		return;
+	}
+
+	int nPyros = clamp( atoi( args[1] ), 1, 16 );
+	int nTargets = clamp( atoi( args[2] ), 1, 32 );
+	int nFrames = args.ArgC() > 3 ? max( atoi( args[3] ), 1 ) : 300;
+
+	GetFireSpatialHash()->StartStress( pPlayer, nPyros, nTargets, nFrames );
+}
+
+static ConCommand fire_hash_stress( "fire_hash_stress", CC_FireHashStress, "Time lit gasoline with and without the fire spatial hash.", FCVAR_CHEAT );
@@ -0,0 +1,112 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-tick broadphase that pairs lit gasoline blobs with burnable entities.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef FIRE_SPATIAL_HASH_H
+#define FIRE_SPATIAL_HASH_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "igamesystem.h"
+#include "utlvector.h"
+#include "ehandle.h"
+
+
+class CGasolineBlob;
+
+
+// ------------------------------------------------------------------------------------------ //
+// CFireSpatialHash.
+//
+// Once per tick, before entities think, all lit gasoline blobs are hashed into a uniform grid.
+// Each burnable entity then only looks at the blobs in the cells its bounds touch, so the
+// cost is roughly O(ents * nearby blobs) instead of a sphere query + traces per blob.
+// Every entity/blob pair is visited (and traced) at most once per tick.
+//
+// While this is enabled, lit blobs don't search for things to burn in their own Think.
+// ------------------------------------------------------------------------------------------ //
+
+class CFireSpatialHash : public CAutoGameSystemPerFrame
+{
+public:
+	CFireSpatialHash();
+
+// Overrides.
+public:
+
+	virtual void	LevelShutdownPostEntity();
+	virtual void	FrameUpdatePreEntityThink();
+	virtual void	FrameUpdatePostEntityThink();
+
+
+public:
+
+	// Returns true if the broadphase is handling lit blob damage this tick.
+	bool			IsActive() const;
+
+	// Kicks off the fire_hash_stress scenario.
+	void			StartStress( CBasePlayer *pPlayer, int nPyros, int nTargets, int nFrames );
+
+
+private:
+
+	struct LitBlob_t
+	{
+		Vector		m_vecOrigin;
+		EHANDLE		m_hOwner;
+		int			m_iOwnerTeam;
+		float		m_flLitPercent;
+	};
+
+	struct CellEntry_t
+	{
+		unsigned int	m_nKey;
+		int				m_iBlob;
+	};
+
+	static int __cdecl	SortCellEntries( const CellEntry_t *pLeft, const CellEntry_t *pRight );
+
+	void			BuildGrid();
+	int				FindFirstInCell( unsigned int nKey ) const;
+	void			BurnEntity( CBaseEntity *pEntity );
+	void			HeatBlob( CGasolineBlob *pBlob );
+	void			BurnAllEntities();
+
+	void			UpdateStress();
+
+
+private:
+
+	CUtlVector<LitBlob_t>	m_LitBlobs;
+	CUtlVector<CellEntry_t>	m_Cells;		// Sorted by cell key.
+
+	// Stress scenario state.
+	enum
+	{
+		STRESS_OFF=0,
+		STRESS_WARMUP,
+		STRESS_MEASURE_BRUTE,
+		STRESS_MEASURE_HASH
+	};
+
+	int						m_iStressState;
+	int						m_nStressFrames;
+	int						m_nStressFramesLeft;
+	float					m_flStressEmitTime;
+	Vector					m_vecStressTarget;
+	CUtlVector<EHANDLE>		m_StressPyros;
+	double					m_flStressFrameStart;
+	double					m_flStressTotal[2];
+	int						m_nStressSaveEnable;
+};
+
+
+CFireSpatialHash* GetFireSpatialHash();
+
+
+#endif // FIRE_SPATIAL_HASH_H
@@ -8,8 +8,9 @@
 #include "cbase.h"
 #include "gasoline_blob.h"
 #include "gasoline_shared.h"
-#include "utllinkedlist.h"
+#include "fire_field.h"
 #include "fire_damage_mgr.h"
+#include "fire_spatial_hash.h"
 #include "tf_gamerules.h"
 
 
@@ -22,84 +23,112 @@
 #define IGNITION_HEAT			0.1
 
 
-#define FIRE_DAMAGE_SEARCH_DISTANCE	200		// It searches within this sphere for entities to damage.
-#define FIRE_DAMAGE_DISTANCE		90		// This is how far fire can damage an entity from.
-
-
 ConVar fire_enable( "fire_enable", "1", 0, "Enable or disable fire." );
 
 
 // ------------------------------------------------------------------------------------------ //
-// CGasolineBlob implementation.
+// CGasolineBlobHandle implementation.
 // ------------------------------------------------------------------------------------------ //
 
-IMPLEMENT_SERVERCLASS_ST_NOBASE( CGasolineBlob, DT_GasolineBlob )
-	SendPropVector( SENDINFO(m_vecOrigin), -1,  SPROP_COORD ),
-	SendPropEHandle (SENDINFO_NAME(m_hMoveParent, moveparent)),
-	SendPropFloat( SENDINFO(m_flLitStartTime), -1, SPROP_NOSCALE ),
-	
-	SendPropFloat( SENDINFO(m_flCreateTime), -1, SPROP_NOSCALE ),
-	SendPropFloat( SENDINFO(m_flMaxLifetime), -1, SPROP_NOSCALE ),
-	
-	SendPropInt( SENDINFO(m_iTeamNum),		TEAMNUM_NUM_BITS, 0 ),
-	SendPropInt( SENDINFO( m_BlobFlags ), NUM_BLOB_FLAGS, SPROP_UNSIGNED ),
-	SendPropVector( SENDINFO( m_vSurfaceNormal ), 0, SPROP_NORMAL ),
-END_SEND_TABLE()
+CGasolineBlobHandle::CGasolineBlobHandle()
+{
+	m_iSlot = 0;
+	m_iSerial = 0;
+}
+
+
+CGasolineBlobHandle::CGasolineBlobHandle( CGasolineBlob *pBlob )
+{
+	if ( pBlob )
+	{
+		m_hField = pBlob->m_pField;
+		m_iSlot = pBlob->m_iSlot;
+		m_iSerial = pBlob->m_iSerial;
+	}
+	else
+	{
+		m_iSlot = 0;
+		m_iSerial = 0;
+	}
+}
+
 
+CGasolineBlob* CGasolineBlobHandle::Get() const
+{
+	CFireField *pField = m_hField;
+	if ( !pField )
+		return NULL;
 
-LINK_ENTITY_TO_CLASS( gasoline_blob, CGasolineBlob );
+	CGasolineBlob *pBlob = pField->GetBlob( m_iSlot );
+	if ( !pBlob || pBlob->m_iSerial != m_iSerial )
+		return NULL;
 
+	return pBlob;
+}
 
-CUtlLinkedList<CGasolineBlob*, int> g_GasolineBlobs;
 
+// ------------------------------------------------------------------------------------------ //
+// CGasolineBlob implementation.
+// ------------------------------------------------------------------------------------------ //
 
-CGasolineBlob* CGasolineBlob::Create( 
-	CBaseEntity *pOwner, 
-	const Vector &vOrigin, 
-	const Vector &vStartVelocity, 
+CGasolineBlob::CGasolineBlob()
+{
+	m_pField = NULL;
+	m_iSlot = 0;
+	m_iSerial = 0;
+	m_BlobFlags = 0;
+}
+
+
+CGasolineBlob* CGasolineBlob::Create(
+	CBaseEntity *pOwner,
+	const Vector &vOrigin,
+	const Vector &vStartVelocity,
 	bool bUseGravity,
 	float flAirLifetime,
 	float flLifetime )
 {
-	CGasolineBlob *pBlob = (CGasolineBlob*)CreateEntityByName( "gasoline_blob" );
-	if ( !pBlob )
+	CFireField *pField = CFireField::GetTeamField( pOwner->GetTeamNumber() );
+	if ( !pField )
 		return NULL;
 
-	// The "constructor".	
-	pBlob->SetLocalOrigin( vOrigin );
-	pBlob->SetAbsVelocity( vStartVelocity );
-	pBlob->SetThink( &CGasolineBlob::Think );
-	pBlob->SetNextThink( gpGlobals->curtime );
-	pBlob->SetCollisionBounds( Vector( -GASOLINE_BLOB_RADIUS, -GASOLINE_BLOB_RADIUS, -GASOLINE_BLOB_RADIUS ), Vector( GASOLINE_BLOB_RADIUS, GASOLINE_BLOB_RADIUS, GASOLINE_BLOB_RADIUS ) );
-	pBlob->SetMoveType( MOVETYPE_NONE );
-	pBlob->SetSolid( SOLID_BBOX );
-	pBlob->AddSolidFlags( FSOLID_NOT_SOLID );
-	pBlob->AddEFlags( EFL_FORCE_CHECK_TRANSMIT );
+	CGasolineBlob *pBlob = pField->AllocBlob();
+
+	// The "constructor".
+	pBlob->m_vecOrigin = vOrigin;
+	pBlob->m_vecVelocity = vStartVelocity;
+	pBlob->m_vSurfaceNormal.Init();
 	pBlob->m_BlobFlags = 0;
 	pBlob->m_HeatLevel = 0;
+	pBlob->m_flPendingHeat = 0;
 	pBlob->m_hOwner = pOwner;
+	pBlob->m_iTeamNum = pOwner->GetTeamNumber();
 	pBlob->m_flCreateTime = gpGlobals->curtime;
+	pBlob->m_nCreateTick = gpGlobals->tickcount;
 	pBlob->m_flMaxLifetime = flLifetime;
-	pBlob->m_takedamage = DAMAGE_YES;
-	pBlob->m_flLitStartTime = 0;
-	pBlob->ChangeTeam( pOwner->GetTeamNumber() );
-	
+	pBlob->m_nLitTick = 0;
+
 	if ( bUseGravity )
 		pBlob->m_BlobFlags |= BLOBFLAG_USE_GRAVITY;
 
 	pBlob->m_flAirLifetime = flAirLifetime;
 	pBlob->m_flTimeInAir = 0;
-	
-	pBlob->SetNextThink( gpGlobals->curtime );
-	g_GasolineBlobs.AddToTail( pBlob );
+
+	pBlob->NetworkStateChanged();
 
 	return pBlob;
 }
 
 
-CGasolineBlob::~CGasolineBlob()
+void CGasolineBlob::Remove()
+{
+	m_pField->FreeBlob( this );
+}
+
+
+void CGasolineBlob::NetworkStateChanged()
 {
-	g_GasolineBlobs.Remove( g_GasolineBlobs.Find( this ) );
+	m_pField->UpdateSlot( this );
 }
 
 
@@ -110,13 +139,41 @@ void CGasolineBlob::AddAutoBurnBlob( CGasolineBlob *pBlob )
 }
 
 
-int CGasolineBlob::OnTakeDamage( const CTakeDamageInfo &info )
+void CGasolineBlob::AddHeat( float flHeat )
 {
-	m_HeatLevel += info.GetDamage();
+	m_HeatLevel += flHeat;
 	if ( m_HeatLevel >= IGNITION_HEAT )
 		SetLit( true );
+}
+
+
+void CGasolineBlob::QueueHeat( float flHeatPerSecond )
+{
+	m_flPendingHeat += flHeatPerSecond * gpGlobals->frametime;
+}
+
+
+void CGasolineBlob::HeatFrom( const Vector &vFireOrigin, float flLitPercent, CBaseEntity *pFireOwner )
+{
+	if ( IsLit() || !pFireOwner )
+		return;
+
+	// Same falloff as fire uses on entities, with the blob as a GASOLINE_BLOB_RADIUS box.
+	float flDistFromBorder = FIRE_DAMAGE_DISTANCE - ( vFireOrigin.DistTo( m_vecOrigin ) - GASOLINE_BLOB_RADIUS );
+	if ( flDistFromBorder <= 0 )
+		return;
+
+	// Make sure it's not blocked.
+	trace_t tr;
+	UTIL_TraceLine( vFireOrigin, m_vecOrigin, MASK_SHOT & (~CONTENTS_HITBOX), NULL, COLLISION_GROUP_NONE, &tr );
+	if ( tr.fraction != 1.0 )
+		return;
 
-	return 0;
+	if ( TFGameRules()->IsTraceBlockedByWorldOrShield( vFireOrigin, m_vecOrigin, pFireOwner, DMG_BURN | DMG_PROBE, &tr ) )
+		return;
+
+	float flHeat = flLitPercent * flDistFromBorder / FIRE_DAMAGE_DISTANCE * FIRE_DAMAGE_PER_SEC;
+	QueueHeat( flHeat );
 }
 
 
@@ -127,12 +184,14 @@ void CGasolineBlob::SetLit( bool bLit )
 		if ( bLit )
 		{
 			m_BlobFlags |= BLOBFLAG_LIT;
-			m_flLitStartTime = gpGlobals->curtime;
+			m_nLitTick = gpGlobals->tickcount;
 		}
 		else
 		{
 			m_BlobFlags &= ~BLOBFLAG_LIT;
 		}
+
+		NetworkStateChanged();
 	}
 }
 
@@ -149,6 +208,30 @@ bool CGasolineBlob::IsStopped() const
 }
 
 
+CBaseEntity* CGasolineBlob::GetBlobOwner() const
+{
+	return m_hOwner;
+}
+
+
+int CGasolineBlob::GetTeamNumber() const
+{
+	return m_iTeamNum;
+}
+
+
+const Vector& CGasolineBlob::GetAbsOrigin() const
+{
+	return m_vecOrigin;
+}
+
+
+float CGasolineBlob::GetLitPercent() const
+{
+	return 1 - ((gpGlobals->curtime - m_flCreateTime) / m_flMaxLifetime);
+}
+
+
 void CGasolineBlob::AutoBurn_R( CGasolineBlob *pParent )
 {
 	SetLit( true );
@@ -171,12 +254,22 @@ void CGasolineBlob::AutoBurn_R( CGasolineBlob *pParent )
 }
 
 
-void CGasolineBlob::Think()
+bool CGasolineBlob::Think()
 {
 	if ( !fire_enable.GetInt() )
 	{
-		UTIL_Remove( this );
-		return;
+		Remove();
+		return false;
+	}
+
+	// Queued heat goes in when the fire damage manager applies its damage.
+	if ( m_flPendingHeat > 0 && GetFireDamageMgr()->IsApplyingDamageThisFrame() )
+	{
+		float flHeat = m_flPendingHeat;
+		m_flPendingHeat = 0;
+
+		if ( !IsLit() )
+			AddHeat( flHeat );
 	}
 
 	// Decay quickly while in the air.
@@ -185,16 +278,16 @@ void CGasolineBlob::Think()
 		m_flTimeInAir += gpGlobals->frametime;
 		if ( m_flTimeInAir >= m_flAirLifetime )
 		{
-			UTIL_Remove( this );
-			return;
+			Remove();
+			return false;
 		}
 	}
 
 	float flLifetime = gpGlobals->curtime - m_flCreateTime;
 	if ( flLifetime >= m_flMaxLifetime )
 	{
-		UTIL_Remove( this );
-		return;
+		Remove();
+		return false;
 	}
 
 	if ( IsLit() )
@@ -203,23 +296,34 @@ void CGasolineBlob::Think()
 		float litPercent = 1 - (flLifetime / m_flMaxLifetime);
 		if ( litPercent <= 0 )
 		{
-			UTIL_Remove( this );
-			return;
+			Remove();
+			return false;
 		}
 
-		// Look for nearby entities to burn.
-		CBaseEntity *ents[512];
-		float dists[512];
-		int nEnts = FindBurnableEntsInSphere( ents, dists, ARRAYSIZE( ents ), GetAbsOrigin(), FIRE_DAMAGE_SEARCH_DISTANCE, m_hOwner );
-		
-		for ( int i=0; i < nEnts; i++ )
+		// Look for nearby entities and gasoline to burn. The fire spatial hash does this for all
+		// lit blobs at once at the start of the frame when it's enabled.
+		if ( !GetFireSpatialHash()->IsActive() && m_hOwner.Get() )
 		{
-			float flDistFromBorder = max( 0, FIRE_DAMAGE_DISTANCE - dists[i] );
-			if ( flDistFromBorder <= 0 )
-				continue;
+			CBaseEntity *ents[512];
+			float dists[512];
+			int nEnts = FindBurnableEntsInSphere( ents, dists, ARRAYSIZE( ents ), m_vecOrigin, FIRE_DAMAGE_SEARCH_DISTANCE, m_hOwner );
 
-			float flDamage = litPercent * flDistFromBorder / FIRE_DAMAGE_DISTANCE * FIRE_DAMAGE_PER_SEC;
-			GetFireDamageMgr()->AddDamage( ents[i], m_hOwner, flDamage, !IsGasolineBlob( ents[i] ) );
+			for ( int i=0; i < nEnts; i++ )
+			{
+				float flDistFromBorder = max( 0, FIRE_DAMAGE_DISTANCE - dists[i] );
+				if ( flDistFromBorder <= 0 )
+					continue;
+
+				float flDamage = litPercent * flDistFromBorder / FIRE_DAMAGE_DISTANCE * FIRE_DAMAGE_PER_SEC;
+				GetFireDamageMgr()->AddDamage( ents[i], m_hOwner, flDamage, true );
+			}
+
+			CGasolineBlob *pBlobs[512];
+			int nBlobs = FindGasolineBlobsInSphere( pBlobs, ARRAYSIZE( pBlobs ), m_vecOrigin, FIRE_DAMAGE_SEARCH_DISTANCE );
+			for ( int i=0; i < nBlobs; i++ )
+			{
+				pBlobs[i]->HeatFrom( m_vecOrigin, litPercent, m_hOwner );
+			}
 		}
 
 		// Ignite our "auto burn" blobs.
@@ -230,50 +334,46 @@ void CGasolineBlob::Think()
 	if ( !IsStopped() )
 	{
 		// Apply gravity.
-		Vector vecNewVelocity = GetAbsVelocity();
 		if ( m_BlobFlags & BLOBFLAG_USE_GRAVITY )
 		{
-			vecNewVelocity.z -= 800 * gpGlobals->frametime;
-			SetAbsVelocity( vecNewVelocity );
+			m_vecVelocity.z -= GASOLINE_BLOB_GRAVITY * gpGlobals->frametime;
 		}
-		
-		Vector vNewPos = GetAbsOrigin() + vecNewVelocity * gpGlobals->frametime;
+
+		Vector vNewPos = m_vecOrigin + m_vecVelocity * gpGlobals->frametime;
 
 		// Can we go there?
 		trace_t trace;
-		UTIL_TraceLine( GetAbsOrigin(), vNewPos, CONTENTS_SOLID, NULL, COLLISION_GROUP_NONE, &trace );
+		UTIL_TraceLine( m_vecOrigin, vNewPos, CONTENTS_SOLID, NULL, COLLISION_GROUP_NONE, &trace );
 		bool bStopped = (trace.fraction != 1);
 
 		if ( !bStopped )
 		{
 			// Trace against shields.
-			if ( TFGameRules()->IsTraceBlockedByWorldOrShield( GetAbsOrigin(), vNewPos, m_hOwner, DMG_BURN, &trace ) )
+			if ( TFGameRules()->IsTraceBlockedByWorldOrShield( m_vecOrigin, vNewPos, m_hOwner, DMG_BURN, &trace ) )
 			{
 				// Blobs just fizzle out when they hit a shield.
-				UTIL_Remove( this );
+				Remove();
+				return false;
 			}
 		}
 
 		if( bStopped )
 		{
-			SetLocalOrigin( trace.endpos + trace.plane.normal * 2 );
-			
+			m_vecOrigin = trace.endpos + trace.plane.normal * 2;
+
 			// Ok, we hit something. Stop moving.
 			m_BlobFlags |= BLOBFLAG_STOPPED;
 			m_vSurfaceNormal = trace.plane.normal;
+
+			// The client flies its copy from the spawn velocity, so it only needs to hear about
+			// where it landed.
+			NetworkStateChanged();
 		}
 		else
 		{
-			SetLocalOrigin( vNewPos );
+			m_vecOrigin = vNewPos;
 		}
-	}	
-
-	SetNextThink( gpGlobals->curtime );
-}
-
+	}
 
-bool IsGasolineBlob( CBaseEntity *pEnt )
-{
-	return FClassnameIs( pEnt, "gasoline_blob" );
+	return true;
 }
-
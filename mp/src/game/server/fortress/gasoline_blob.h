@@ -15,25 +15,58 @@
 #include "baseentity.h"
 
 
-class CGasolineBlob : public CBaseEntity
+#define FIRE_DAMAGE_SEARCH_DISTANCE	200		// It searches within this sphere for entities to damage.
+#define FIRE_DAMAGE_DISTANCE		90		// This is how far fire can damage an entity from.
+
+
+class CFireField;
+class CGasolineBlob;
+
+
+// Blobs live in a fire field's slots and the slots get reused, so this checks the slot's
+// serial number before handing the blob back.
+class CGasolineBlobHandle
+{
+public:
+					CGasolineBlobHandle();
+					CGasolineBlobHandle( CGasolineBlob *pBlob );
+
+	CGasolineBlob*	Get() const;
+
+	operator CGasolineBlob*() const		{ return Get(); }
+	CGasolineBlob* operator->() const	{ return Get(); }
+
+private:
+	CHandle<CFireField>	m_hField;
+	int					m_iSlot;
+	int					m_iSerial;
+};
+
+
+// ------------------------------------------------------------------------------------------ //
+// CGasolineBlob.
+//
+// A blob of gasoline, lit or not. These used to be entities, but a pyro makes a lot of them,
+// so now they're records in their team's CFireField, which simulates them and sends them to
+// clients (see fire_field.h).
+// ------------------------------------------------------------------------------------------ //
+
+class CGasolineBlob
 {
 public:
-	DECLARE_CLASS( CGasolineBlob, CBaseEntity );
-	DECLARE_SERVERCLASS();
 
+					CGasolineBlob();
 
 	// Create a gasoline blob.
 	// flAirLifetime specifies how long it takes to fizzle out in the air.
-	static CGasolineBlob*	Create( 
-		CBaseEntity *pOwner, 
-		const Vector &vOrigin, 
-		const Vector &vStartVelocity, 
+	static CGasolineBlob*	Create(
+		CBaseEntity *pOwner,
+		const Vector &vOrigin,
+		const Vector &vStartVelocity,
 		bool bUseGravity,
 		float flAirLifetime,
 		float flLifetime );
 
-	virtual					~CGasolineBlob();
-
 	// A lit blob will always apply at least 25% damage to its "auto burn" blob.
 	//
 	// This is used when laying down gasoline blobs in a line. Since it's fairly easy to accidentally
@@ -41,53 +74,80 @@ public:
 	// can be linked together using this.
 	void			AddAutoBurnBlob( CGasolineBlob *pBlob );
 
+	// Heat from nearby fire. The blob lights up once it's had enough.
+	void			AddHeat( float flHeat );
 
-// Overrides.
-public:
+	// Heat from something burning next to the blob, in heat per second. This is collected and
+	// handed to AddHeat when the fire damage manager applies its damage, so blobs catch at the
+	// same rate everything else burns.
+	void			QueueHeat( float flHeatPerSecond );
 
-	virtual int		OnTakeDamage( const CTakeDamageInfo &info );
+	// Queues heat if the blob's close enough to the fire at vFireOrigin and nothing's in the way.
+	void			HeatFrom( const Vector &vFireOrigin, float flLitPercent, CBaseEntity *pFireOwner );
 
+	// Frees the blob's slot. Handles to it go NULL.
+	void			Remove();
 
 
 // Implementation.
 public:
-	
+
 	bool	IsLit() const;
 	bool	IsStopped() const;
 	void	SetLit( bool bLit );
 
-	void	Think();
+	CBaseEntity*	GetBlobOwner() const;
+	int				GetTeamNumber() const;
+	const Vector&	GetAbsOrigin() const;
+
+	// How much of its lifetime the blob has left (1 = just created, 0 = burnt out).
+	float	GetLitPercent() const;
 
 	void	AutoBurn_R( CGasolineBlob *pParent );
 
 
 private:
-	
-	typedef CHandle<CGasolineBlob> CGasolineBlobHandle;
+
+	friend class CFireField;
+	friend class CGasolineBlobHandle;
+
+	// Called by the field every tick. Returns false if the blob went away.
+	bool	Think();
+
+	void	NetworkStateChanged();
+
+
+	CFireField		*m_pField;
+	int				m_iSlot;
+	int				m_iSerial;			// 0 when the slot is free.
+
 	CUtlVector<CGasolineBlobHandle>	m_AutoBurnBlobs;
-	
+
+	Vector			m_vecOrigin;
+	Vector			m_vecVelocity;
+	Vector			m_vSurfaceNormal;	// This is sent to the client so it can spread the fire out.
+
 	float			m_flTimeInAir;		// How long we've been in the air.
 	float			m_flAirLifetime;	// How long we're allowed to exist in the air.
 
-	CNetworkVar( float, m_flLitStartTime );	// What time did the blob become lit at?
-	
-	CNetworkVar( int, m_BlobFlags );	// Combination of BLOBFLAG_ defines.
-	
+	int				m_nLitTick;			// What tick did the blob become lit on?
+	int				m_BlobFlags;		// Combination of BLOBFLAG_ defines.
+
 	// This is set at the start and is used to know the percentage of lifetime left.
-	CNetworkVar( float, m_flMaxLifetime );
+	float			m_flMaxLifetime;
 
 	// When the blob was created.
-	CNetworkVar( float, m_flCreateTime );
-
-	CNetworkVector( m_vSurfaceNormal );	// This is sent to the client so it can spread the fire out.
+	float			m_flCreateTime;
+	int				m_nCreateTick;
 
 	EHANDLE			m_hOwner;
+	int				m_iTeamNum;
 	float			m_HeatLevel;	// This rises when other flames are nearby until we ignite.
+	float			m_flPendingHeat;	// Queued heat that hasn't been added to m_HeatLevel yet.
 };
 
 
-// Returns true if the entity is a gasoline blob.
-bool IsGasolineBlob( CBaseEntity *pEnt );
+extern ConVar fire_enable;
 
 
 #endif // GASOLINE_BLOB_H
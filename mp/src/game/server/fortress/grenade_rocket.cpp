@@ -24,6 +24,7 @@ BEGIN_DATADESC( CGrenadeRocket )
 
 END_DATADESC()
 LINK_ENTITY_TO_CLASS( grenade_rocket, CGrenadeRocket );
+DEFINE_ENTITY_POOL( CGrenadeRocket, 32 );
 PRECACHE_REGISTER(grenade_rocket);
 
 
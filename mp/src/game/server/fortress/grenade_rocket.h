@@ -11,6 +11,8 @@
 #pragma once
 #endif
 
+#include "tf_entity_pool.h"
+
 #define ROCKET_VELOCITY			1000
 
 //====================================================================================
@@ -19,6 +21,7 @@
 class CGrenadeRocket : public CBaseAnimating
 {
 	DECLARE_CLASS( CGrenadeRocket, CBaseAnimating );
+	DECLARE_ENTITY_POOL( CGrenadeRocket );
 public:
 
 	DECLARE_DATADESC();
@@ -30,6 +30,7 @@ BEGIN_DATADESC( CMortarRound )
 END_DATADESC()
 
 LINK_ENTITY_TO_CLASS( mortar_round, CMortarRound );
+DEFINE_ENTITY_POOL( CMortarRound, 32 );
 PRECACHE_WEAPON_REGISTER(mortar_round);
 
 CMortarRound::CMortarRound()
@@ -14,10 +14,12 @@
 
 #include "tf_vehicle_mortar.h"
 #include "smoke_trail.h"
+#include "tf_entity_pool.h"
 
 
 class CMortarRound : public CBaseAnimating
 {
+	DECLARE_ENTITY_POOL( CMortarRound );
 public:
 	DECLARE_CLASS( CMortarRound, CBaseAnimating );
 
@@ -27,6 +27,8 @@
 #include "npc_bug_warrior.h"
 #include "npc_bug_builder.h"
 #include "npc_bug_hole.h"
+#include "querycache.h"
+#include "tier0/vprof.h"
 
 LINK_ENTITY_TO_CLASS( npc_bughole, CMaker_BugHole );
 
@@ -47,7 +49,26 @@ END_DATADESC()
 // Maximum speed at which a bughole thinks. Regen/Spawn times faster than this won't make it work faster.
 #define BUGHOLE_THINK_SPEED		3.0
 
+// How far around the hole it looks for players and objects, and how many it keeps track of.
+#define BUGHOLE_THREAT_RANGE		768
+#define BUGHOLE_MAX_THREATS			32
+
 static ConVar	npc_bughole_health( "npc_bughole_health","300", FCVAR_NONE, "Bug hole's health." );
+static ConVar	npc_bughole_threat_interval( "npc_bughole_threat_interval", "0.5", FCVAR_NONE, "How often a bug hole rebuilds the list of players and objects it can see." );
+
+//-----------------------------------------------------------------------------
+// Purpose: Things that don't block LOS don't hide threats from the bug hole.
+//          The query cache skips the hole and the threat itself, so together
+//          this is CTraceFilterLOS.  This runs on the query cache's job threads.
+//-----------------------------------------------------------------------------
+static bool BugHoleThreatShouldHit( IHandleEntity *pHandleEntity, int contentsMask )
+{
+	CBaseEntity *pEntity = EntityFromEntityHandle( pHandleEntity );
+	if ( !pEntity )
+		return true;
+
+	return pEntity->BlocksLOS();
+}
 
 //-----------------------------------------------------------------------------
 // Purpose: 
@@ -57,6 +78,7 @@ CMaker_BugHole::CMaker_BugHole( void)
 	m_iszNPCClassname_Warrior = MAKE_STRING( "npc_bug_warrior" );
 	m_iszNPCClassname_Builder = MAKE_STRING( "npc_bug_builder" );
 	m_iszNPCClassname = m_iszNPCClassname_Warrior;
+	m_flThreatBoardTime = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -124,17 +146,9 @@ void CMaker_BugHole::BugHoleThink( void )
 	else
 	{
 		// If I can see a player, try and spawn a bug
-		CBaseEntity *pList[100];
-		Vector vecDelta( 768, 768, 768 );
-		int count = UTIL_EntitiesInBox( pList, 32, GetAbsOrigin() - vecDelta, GetAbsOrigin() + vecDelta, FL_CLIENT|FL_OBJECT );
-		for ( int i = 0; i < count; i++ )
+		if ( HasVisibleThreat() )
 		{
-			CBaseEntity *pEnt = pList[i];
-			if ( pEnt->IsAlive() && FVisible(pEnt) )
-			{
-				BugHoleUnderAttack();
-				break;
-			}
+			BugHoleUnderAttack();
 		}
 	}
 
@@ -149,6 +163,57 @@ void CMaker_BugHole::BugHoleThink( void )
 	SetNextThink( gpGlobals->curtime + BUGHOLE_THINK_SPEED );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Rebuild the threat board if it's older than npc_bughole_threat_interval.
+//          The LOS checks go through the query cache, which refreshes the ones
+//          we keep asking for on the job threads between rebuilds.
+//-----------------------------------------------------------------------------
+void CMaker_BugHole::UpdateThreatBoard( void )
+{
+	float flInterval = npc_bughole_threat_interval.GetFloat();
+	if ( m_flThreatBoardTime && ( gpGlobals->curtime - m_flThreatBoardTime ) < flInterval )
+		return;
+
+	VPROF( "CMaker_BugHole::UpdateThreatBoard" );
+
+	m_flThreatBoardTime = gpGlobals->curtime;
+	m_ThreatBoard.RemoveAll();
+
+	CBaseEntity *pList[BUGHOLE_MAX_THREATS];
+	Vector vecDelta( BUGHOLE_THREAT_RANGE, BUGHOLE_THREAT_RANGE, BUGHOLE_THREAT_RANGE );
+	int count = UTIL_EntitiesInBox( pList, ARRAYSIZE( pList ), GetAbsOrigin() - vecDelta, GetAbsOrigin() + vecDelta, FL_CLIENT|FL_OBJECT );
+	for ( int i = 0; i < count; i++ )
+	{
+		CBaseEntity *pEnt = pList[i];
+		if ( !pEnt->IsAlive() )
+			continue;
+
+		int iThreat = m_ThreatBoard.AddToTail();
+		m_ThreatBoard[iThreat].m_hEntity = pEnt;
+		m_ThreatBoard[iThreat].m_bVisible = IsLineOfSightBetweenTwoEntitiesClear( this, EOFFSET_MODE_EYEPOSITION,
+			pEnt, EOFFSET_MODE_EYEPOSITION, this, COLLISION_GROUP_NONE, MASK_BLOCKLOS, BugHoleThreatShouldHit, flInterval, true );
+	}
+
+	VPROF_INCREMENT_COUNTER( "BugHole: threats", m_ThreatBoard.Count() );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Return true if the hole can see a live player or object
+//-----------------------------------------------------------------------------
+bool CMaker_BugHole::HasVisibleThreat( void )
+{
+	UpdateThreatBoard();
+
+	for ( int i = 0; i < m_ThreatBoard.Count(); i++ )
+	{
+		CBaseEntity *pEnt = m_ThreatBoard[i].m_hEntity;
+		if ( pEnt && m_ThreatBoard[i].m_bVisible && pEnt->IsAlive() && !( pEnt->GetFlags() & FL_NOTARGET ) )
+			return true;
+	}
+
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Spawn a bug, if we're not waiting to spawn one already
 //-----------------------------------------------------------------------------
@@ -14,6 +14,13 @@
 class CNPC_Bug_Warrior;
 class CNPC_Bug_Builder;
 
+// A player or object near a bug hole, and whether the hole can see it.
+struct BugHoleThreat_t
+{
+	EHANDLE	m_hEntity;
+	bool	m_bVisible;
+};
+
 //-----------------------------------------------------------------------------
 // Purpose: BUG HOLE
 //-----------------------------------------------------------------------------
@@ -45,6 +52,13 @@ public:
 	void	IncomingFleeingBug( CAI_BaseNPC *pBug );
 	void	BugReturned( void );
 
+	// Threat board. The hole looks for players and objects around it at most once per
+	// npc_bughole_threat_interval, through the query cache. It only drives the hole's own
+	// spawning: its candidates come from a box smaller than a warrior's look distance and
+	// its traces start at the hole's eyes, so the warriors still do their own sensing.
+	void	UpdateThreatBoard( void );
+	bool	HasVisibleThreat( void );
+
 private:
 	string_t	m_iszNPCClassname_Warrior;
 	string_t	m_iszNPCClassname_Builder;
@@ -71,6 +85,10 @@ private:
 	CUtlVector<WarriorHandle_t>	m_aWarriorBugs;
 	typedef	CHandle<CNPC_Bug_Builder> BuilderHandle_t;
 	CUtlVector<BuilderHandle_t>	m_aBuilderBugs;
+
+	// Threat board
+	CUtlVector<BugHoleThreat_t>	m_ThreatBoard;
+	float		m_flThreatBoardTime;
 };
 
 #endif // NPC_BUG_HOLE_H
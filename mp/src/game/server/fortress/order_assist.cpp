@@ -9,6 +9,8 @@
 #include "order_assist.h"
 #include "tf_team.h"
 #include "order_helpers.h"
+#include "order_planner.h"
+#include "tier0/vprof.h"
 
 
 // If a player has been shot within this time delta, commandos will get orders to assist.
@@ -66,11 +68,49 @@ static bool IsValidFn_PlayersWantingAssist( void *pUserData, int a )
 }
 
 
-bool COrderAssist::CreateOrder( CPlayerClass *pClass )
+static bool FilterFn_WantsAssist( void *pUserData, CBaseEntity *pEntity )
+{
+	// Don't try to assist yourself...
+	if ( pEntity == (CBaseEntity*)pUserData )
+		return false;
+
+	// Make sure this guy was shot recently.
+	CBaseTFPlayer *pPlayer = (CBaseTFPlayer*)pEntity;
+	return (gpGlobals->curtime - pPlayer->LastTimeDamagedByEnemy()) <= COMMANDO_ASSIST_SHOT_DELAY;
+}
+
+
+CBaseTFPlayer* COrderAssist::FindTarget( CBaseTFPlayer *pPlayer, CBaseEntity **ppEnemies, int *pnEnemies )
 {
+	*pnEnemies = 0;
+
+	if ( COrderPlanner::IsActive() )
+	{
+		COrderPlanner *pPlanner = pPlayer->GetTFTeam()->GetOrderPlanner();
+
+		CBaseTFPlayer *pPlayerToAssist = (CBaseTFPlayer*)pPlanner->FindNearest( 
+			COrderPlanner::SET_LIVE_PLAYERS, 
+			pPlayer->GetAbsOrigin(), 
+			COMMAND_ASSIST_DISTANCE, 
+			FilterFn_WantsAssist, 
+			pPlayer );
+
+		if ( pPlayerToAssist )
+		{
+			*pnEnemies = pPlanner->SelectNearest( 
+				COrderPlanner::SET_ENEMY_PLAYERS, 
+				pPlayer->GetAbsOrigin(), 
+				FLT_MAX, 
+				ppEnemies, 
+				NUM_ASSIST_ENEMIES );
+		}
+
+		return pPlayerToAssist;
+	}
+
 	// Search for a (live) nearby player who's just been shot.
 	CSortBase info;
-	info.m_pPlayer = pClass->GetPlayer();
+	info.m_pPlayer = pPlayer;
 
 	int sorted[512];
 	int nSorted = BuildSortedActiveList(
@@ -79,43 +119,64 @@ bool COrderAssist::CreateOrder( CPlayerClass *pClass )
 		SortFn_TeamPlayersByDistance,
 		IsValidFn_PlayersWantingAssist,
 		&info,
-		pClass->GetTeam()->GetNumPlayers()
+		pPlayer->GetTeam()->GetNumPlayers()
 		);
 
-	if ( nSorted )
+	if ( !nSorted )
+		return NULL;
+
+	CBaseTFPlayer *pPlayerToAssist = (CBaseTFPlayer*)pPlayer->GetTeam()->GetPlayer( sorted[0] );
+
+	// Add the closest enemies.
+	CSortBase enemySortInfo;
+	enemySortInfo.m_pPlayer = pPlayerToAssist;
+
+	int sortedEnemies[256];
+	int nSortedEnemies = BuildSortedActiveList(	
+		sortedEnemies,
+		ARRAYSIZE( sortedEnemies ),
+		SortFn_PlayerEntitiesByDistance,
+		IsValidFn_OnEnemyTeam,
+		&info,
+		gpGlobals->maxClients
+		);
+
+	nSortedEnemies = min( nSortedEnemies, NUM_ASSIST_ENEMIES );
+	for ( int i=0; i < nSortedEnemies; i++ )
 	{
-		COrderAssist *pOrder = new COrderAssist;
+		CBaseEntity *pEnt = CBaseEntity::Instance( engine->PEntityOfEntIndex( sortedEnemies[i] + 1 ) );
+		Assert( dynamic_cast<CBasePlayer*>( pEnt ) );
+		ppEnemies[i] = pEnt;
+	}
+	*pnEnemies = nSortedEnemies;
 
-		CBaseTFPlayer *pPlayerToAssist = (CBaseTFPlayer*)pClass->GetTeam()->GetPlayer( sorted[0] );
+	return pPlayerToAssist;
+}
+
+
+bool COrderAssist::CreateOrder( CPlayerClass *pClass )
+{
+	VPROF( "COrderAssist::CreateOrder" );
+
+	CBaseEntity *pEnemies[NUM_ASSIST_ENEMIES];
+	int nEnemies;
+
+	CBaseTFPlayer *pPlayerToAssist = FindTarget( pClass->GetPlayer(), pEnemies, &nEnemies );
+	if ( pPlayerToAssist )
+	{
+		COrderAssist *pOrder = new COrderAssist;
 
 		pClass->GetTeam()->AddOrder( 
 			ORDER_ASSIST, 
 			pPlayerToAssist, 
-			info.m_pPlayer, 
+			pClass->GetPlayer(), 
 			COMMAND_ASSIST_DISTANCE,
 			25,
 			pOrder );
 
-		// Add the closest enemies.
-		CSortBase enemySortInfo;
-		enemySortInfo.m_pPlayer = pPlayerToAssist;
-
-		int sortedEnemies[256];
-		int nSortedEnemies = BuildSortedActiveList(	
-			sortedEnemies,
-			ARRAYSIZE( sortedEnemies ),
-			SortFn_PlayerEntitiesByDistance,
-			IsValidFn_OnEnemyTeam,
-			&info,
-			gpGlobals->maxClients
-			);
-
-		nSortedEnemies = min( nSortedEnemies, NUM_ASSIST_ENEMIES );
-		for ( int i=0; i < nSortedEnemies; i++ )
+		for ( int i=0; i < nEnemies; i++ )
 		{
-			CBaseEntity *pEnt = CBaseEntity::Instance( engine->PEntityOfEntIndex( sortedEnemies[i] + 1 ) );
-			Assert( dynamic_cast<CBasePlayer*>( pEnt ) );
-			pOrder->m_Enemies[i] = pEnt;
+			pOrder->m_Enemies[i] = pEnemies[i];
 		}
 	}
 
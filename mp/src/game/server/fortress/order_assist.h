@@ -16,6 +16,7 @@
 
 
 class CPlayerClass;
+class CBaseTFPlayer;
 
 
 class COrderAssist : public COrderPlayer
@@ -27,6 +28,15 @@ public:
 	// Create an order for the player.
 	static bool		CreateOrder( CPlayerClass *pClass );
 
+	// The teammate CreateOrder would send the player to help, or NULL. The closest
+	// enemies (up to NUM_ASSIST_ENEMIES) go in ppEnemies.
+	static CBaseTFPlayer*	FindTarget( CBaseTFPlayer *pPlayer, CBaseEntity **ppEnemies, int *pnEnemies );
+
+	enum
+	{
+		NUM_ASSIST_ENEMIES = 2
+	};
+
 
 // COrder overrides.
 public:
@@ -36,11 +46,6 @@ public:
 
 
 private:
-	
-	enum
-	{
-		NUM_ASSIST_ENEMIES = 2
-	};
 
 	// The order goes away when the player who has the assist order shoots
 	// one of these enemies.
@@ -10,6 +10,7 @@
 #include "tf_class_defender.h"
 #include "tf_team.h"
 #include "order_helpers.h"
+#include "tier0/vprof.h"
 
 
 // The defender will get orders to cover objects with sentry guns this far away.
@@ -22,6 +23,8 @@ END_SEND_TABLE()
 
 bool COrderBuildSentryGun::CreateOrder( CPlayerClassDefender *pClass )
 {
+	VPROF( "COrderBuildSentryGun::CreateOrder" );
+
 	if ( !pClass->CanBuildSentryGun() )
 		return false;
 
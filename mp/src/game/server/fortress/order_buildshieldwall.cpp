@@ -9,6 +9,7 @@
 #include "order_buildshieldwall.h"
 #include "tf_team.h"
 #include "order_helpers.h"
+#include "tier0/vprof.h"
 
 
 // The defender will get orders to cover objects with sentry guns this far away.
@@ -21,6 +22,8 @@ END_SEND_TABLE()
 
 bool COrderBuildShieldWall::CreateOrder( CPlayerClass *pClass )
 {
+	VPROF( "COrderBuildShieldWall::CreateOrder" );
+
 	COrderBuildShieldWall *pOrder = new COrderBuildShieldWall;
 	if ( OrderCreator_GenericObject( pClass, OBJ_SHIELDWALL, 2000, pOrder ) )
 	{
@@ -10,6 +10,8 @@
 #include "tf_team.h"
 #include "tf_playerclass.h"
 #include "order_helpers.h"
+#include "order_planner.h"
+#include "tier0/vprof.h"
 
 
 #define MAX_HEAL_DIST 1500
@@ -49,12 +51,28 @@ int SortFn_Heal( void *pUserData, int a, int b )
 }
 
 
-bool COrderHeal::CreateOrder( CPlayerClass *pClass )
+static bool FilterFn_NotSelf( void *pUserData, CBaseEntity *pEntity )
 {
-	CTFTeam *pTeam = pClass->GetTeam();
+	return pEntity != (CBaseEntity*)pUserData;
+}
+
+
+CBaseEntity* COrderHeal::FindTarget( CBaseTFPlayer *pPlayer )
+{
+	CTFTeam *pTeam = pPlayer->GetTFTeam();
+
+	if ( COrderPlanner::IsActive() )
+	{
+		return pTeam->GetOrderPlanner()->FindNearest( 
+			COrderPlanner::SET_HURT_PLAYERS, 
+			pPlayer->GetAbsOrigin(), 
+			MAX_HEAL_DIST, 
+			FilterFn_NotSelf, 
+			pPlayer );
+	}
 
 	CSortBase info;
-	info.m_pPlayer = pClass->GetPlayer();
+	info.m_pPlayer = pPlayer;
 
 	int sorted[MAX_PLAYERS];
 	int nSorted = BuildSortedActiveList( 
@@ -66,13 +84,22 @@ bool COrderHeal::CreateOrder( CPlayerClass *pClass )
 		pTeam->GetNumPlayers()
 		);
 
-	if ( nSorted )
+	return nSorted ? pTeam->GetPlayer( sorted[0] ) : NULL;
+}
+
+
+bool COrderHeal::CreateOrder( CPlayerClass *pClass )
+{
+	VPROF( "COrderHeal::CreateOrder" );
+
+	CBaseEntity *pTarget = FindTarget( pClass->GetPlayer() );
+	if ( pTarget )
 	{
 		COrderHeal *pOrder = new COrderHeal;
 		
 		pClass->GetTeam()->AddOrder( 
 			ORDER_HEAL, 
-			pTeam->GetPlayer( sorted[0] ), 
+			pTarget, 
 			pClass->GetPlayer(), 
 			1e24,
 			60,
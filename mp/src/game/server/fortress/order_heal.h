@@ -16,6 +16,7 @@
 
 
 class CPlayerClass;
+class CBaseTFPlayer;
 
 
 class COrderHeal : public COrderPlayer
@@ -27,6 +28,9 @@ public:
 	// Create an order for the player.
 	static bool		CreateOrder( CPlayerClass *pClass );
 
+	// The teammate CreateOrder would make the player heal, or NULL.
+	static CBaseEntity*	FindTarget( CBaseTFPlayer *pPlayer );
+
 
 // COrder overrides.
 public:
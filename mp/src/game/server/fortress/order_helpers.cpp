@@ -11,6 +11,8 @@
 #include "tf_team.h"
 #include "tf_func_resource.h"
 #include "tf_obj.h"
+#include "order_planner.h"
+#include "tier0/vprof.h"
 
 
 // ------------------------------------------------------------------------ //
@@ -105,21 +107,37 @@ int BuildSortedActiveList(
 }
 
 	
-// Finds the closest resource zone without the specified object on it and
-// gives an order to the player to build the object.
-bool OrderCreator_ResourceZoneObject( 
+static bool FilterFn_NoPumpOnZone( void *pUserData, CBaseEntity *pEntity )
+{
+	CBaseTFPlayer *pPlayer = (CBaseTFPlayer*)pUserData;
+	return pPlayer->NumPumpsOnResourceZone( (CResourceZone*)pEntity ) == 0;
+}
+
+
+CResourceZone* FindTarget_ResourceZoneObject( 
 	CBaseTFPlayer *pPlayer, 
-	int objType,
-	COrder *pOrder
+	int objType
 	)
 {
-	// Can we even build a resource box?
-	if ( pPlayer->CanBuild( objType ) != CB_CAN_BUILD )
-		return false;
+	VPROF( "FindTarget_ResourceZoneObject" );
 
 	CTFTeam *pTeam = pPlayer->GetTFTeam();
 	if( !pTeam )
-		return false;
+		return NULL;
+
+	// Only pumps go on resource zones.
+	if ( objType != OBJ_RESOURCEPUMP )
+		return NULL;
+
+	if ( COrderPlanner::IsActive() )
+	{
+		return (CResourceZone*)pTeam->GetOrderPlanner()->FindNearest( 
+			COrderPlanner::SET_RESOURCE_ZONES, 
+			pPlayer->GetAbsOrigin(), 
+			100000000, 
+			FilterFn_NoPumpOnZone, 
+			pPlayer );
+	}
 
 	// Let's have one near each resource zone that we own.
 	CResourceZone *pClosest = 0;
@@ -137,7 +155,7 @@ bool OrderCreator_ResourceZoneObject(
 		Vector vZoneCenter = pZone->WorldSpaceCenter();
 
 		// Look for a resource pump on this zone.
-		bool bPump = objType == OBJ_RESOURCEPUMP && pPlayer->NumPumpsOnResourceZone( pZone ) == 0;
+		bool bPump = pPlayer->NumPumpsOnResourceZone( pZone ) == 0;
 		if ( bPump )
 		{
 			// Make sure it's their preferred tech.
@@ -150,6 +168,23 @@ bool OrderCreator_ResourceZoneObject(
 		}
 	}
 
+	return pClosest;
+}
+
+	
+// Finds the closest resource zone without the specified object on it and
+// gives an order to the player to build the object.
+bool OrderCreator_ResourceZoneObject( 
+	CBaseTFPlayer *pPlayer, 
+	int objType,
+	COrder *pOrder
+	)
+{
+	// Can we even build a resource box?
+	if ( pPlayer->CanBuild( objType ) != CB_CAN_BUILD )
+		return false;
+
+	CResourceZone *pClosest = FindTarget_ResourceZoneObject( pPlayer, objType );
 	if ( pClosest )
 	{
 		// No pump here. Build one!
@@ -292,19 +327,27 @@ bool IsValidFn_NearAndNotCovered( void *pUserData, int a )
 }
 
 
-bool OrderCreator_GenericObject( 
-	CPlayerClass *pClass, 
+CBaseEntity* FindTarget_GenericObject( 
+	CBaseTFPlayer *pPlayer, 
 	int objectType, 
-	float flMaxDist,
-	COrder *pOrder
+	float flMaxDist
 	)
 {
-	// Can we build one?
-	if ( pClass->CanBuild( objectType ) != CB_CAN_BUILD )
-		return false;
+	VPROF( "FindTarget_GenericObject" );
 
-	CBaseTFPlayer *pPlayer = pClass->GetPlayer();
-	CTFTeam *pTeam = pClass->GetTeam();
+	CTFTeam *pTeam = pPlayer->GetTFTeam();
+
+	if ( COrderPlanner::IsActive() )
+	{
+		int iSet = COrderPlanner::GetCoverSetForObjectType( objectType );
+		if ( iSet < 0 )
+		{
+			Assert( !"Unsupported object type" );
+			return NULL;
+		}
+
+		return pTeam->GetOrderPlanner()->FindNearest( iSet, pPlayer->GetAbsOrigin(), flMaxDist );
+	}
 
 	// Sort nearby objects.
 	CSortBase info;
@@ -322,11 +365,28 @@ bool OrderCreator_GenericObject(
 		pTeam->GetNumObjects()					// number of objects to check
 		);
 
-	if( nSorted )
+	return nSorted ? pTeam->GetObject( sorted[0] ) : NULL;
+}
+
+
+bool OrderCreator_GenericObject( 
+	CPlayerClass *pClass, 
+	int objectType, 
+	float flMaxDist,
+	COrder *pOrder
+	)
+{
+	// Can we build one?
+	if ( pClass->CanBuild( objectType ) != CB_CAN_BUILD )
+		return false;
+
+	CBaseTFPlayer *pPlayer = pClass->GetPlayer();
+	CTFTeam *pTeam = pClass->GetTeam();
+
+	CBaseEntity *pEnt = FindTarget_GenericObject( pPlayer, objectType, flMaxDist );
+	if( pEnt )
 	{
 		// Ok, make an order to cover the closest object with a sentry gun.
-		CBaseEntity *pEnt = pTeam->GetObject( sorted[0] );
-
 		pTeam->AddOrder( 
 			ORDER_BUILD,
 			pEnt,
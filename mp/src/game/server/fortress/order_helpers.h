@@ -16,6 +16,7 @@
 
 
 class CTFTeam;
+class CResourceZone;
 
 
 class CSortBase
@@ -101,6 +102,13 @@ int BuildSortedActiveList(
 	int nItems				// Number of items in the list to sort.
 	);
 
+// Finds the closest resource zone the player doesn't have a pump on, or NULL.
+// Uses the team's order planner when it's active.
+CResourceZone* FindTarget_ResourceZoneObject( 
+	CBaseTFPlayer *pPlayer, 
+	int objType
+	);
+
 // Finds the closest resource zone without the specified object on it and
 // gives an order to the player to build the object.
 // This function supports OBJ_RESOURCEBOX, OBJ_RESOURCEPUMP, and OBJ_ZONE_INCREASER.
@@ -110,6 +118,14 @@ bool OrderCreator_ResourceZoneObject(
 	COrder *pOrder
 	);
 
+// Finds the team object OrderCreator_GenericObject would make an order for, or NULL.
+// Uses the team's order planner when it's active.
+CBaseEntity* FindTarget_GenericObject( 
+	CBaseTFPlayer *pPlayer, 
+	int objectType, 
+	float flMaxDist
+	);
+
 // This function is shared by lots of the order creation functions.
 // It makes an order to create a specific type of object by looking for nearby 
 // concentrations of team objects that aren't "covered" by objectType.
@@ -9,6 +9,8 @@
 #include "order_helpers.h"
 #include "order_killmortarguy.h"
 #include "tf_team.h"
+#include "order_planner.h"
+#include "tier0/vprof.h"
 
 
 #define KILLMORTARGUY_DIST		3500
@@ -68,10 +70,18 @@ static int SortFn_PlayerEntsByDistance( void *pUserData, int a, int b )
 }
 
 
-bool COrderKillMortarGuy::CreateOrder( CPlayerClass *pClass )
+CBaseTFPlayer* COrderKillMortarGuy::FindTarget( CBaseTFPlayer *pPlayer )
 {
+	if ( COrderPlanner::IsActive() )
+	{
+		return (CBaseTFPlayer*)pPlayer->GetTFTeam()->GetOrderPlanner()->FindNearest( 
+			COrderPlanner::SET_ENEMY_MORTARS, 
+			pPlayer->GetAbsOrigin(), 
+			KILLMORTARGUY_DIST );
+	}
+
 	CSortBase info;
-	info.m_pPlayer = pClass->GetPlayer();
+	info.m_pPlayer = pPlayer;
 	
 	// Look for an enemy sniper visible to the 
 	int supports[MAX_PLAYERS];
@@ -84,12 +94,18 @@ bool COrderKillMortarGuy::CreateOrder( CPlayerClass *pClass )
 		gpGlobals->maxClients				// how many players to look through
 		);
 
+	return nSupports ? (CBaseTFPlayer*)UTIL_PlayerByIndex( supports[0]+1 ) : NULL;
+}
+
+
+bool COrderKillMortarGuy::CreateOrder( CPlayerClass *pClass )
+{
+	VPROF( "COrderKillMortarGuy::CreateOrder" );
+
 	// Kill the closest punk.
-	if( nSupports )
+	CBaseTFPlayer *pBrian = FindTarget( pClass->GetPlayer() );
+	if( pBrian )
 	{
-		CBaseTFPlayer *pBrian = (CBaseTFPlayer*)UTIL_PlayerByIndex( supports[0]+1 );
-		Assert( pBrian );
-
 		COrderKillMortarGuy *pOrder = new COrderKillMortarGuy;
 		pClass->GetTeam()->AddOrder( 
 			ORDER_KILL,
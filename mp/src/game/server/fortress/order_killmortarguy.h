@@ -16,6 +16,7 @@
 
 
 class CPlayerClass;
+class CBaseTFPlayer;
 
 
 class COrderKillMortarGuy : public COrderPlayer
@@ -27,6 +28,9 @@ public:
 	// Create an order for the player.
 	static bool		CreateOrder( CPlayerClass *pClass );
 
+	// The enemy CreateOrder would send the player after, or NULL.
+	static CBaseTFPlayer*	FindTarget( CBaseTFPlayer *pPlayer );
+
 
 // COrder overrides.
 public:
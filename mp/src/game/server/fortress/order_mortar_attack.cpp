@@ -10,6 +10,8 @@
 #include "tf_team.h"
 #include "order_helpers.h"
 #include "tf_obj.h"
+#include "order_planner.h"
+#include "tier0/vprof.h"
 
 
 // How far away the escort guy will get orders to shell enemy objects.
@@ -28,15 +30,21 @@ static bool IsValidFn_WithinMortarRange( void *pUserData, int a )
 }
 
 
-bool COrderMortarAttack::CreateOrder( CPlayerClass *pClass )
+CBaseEntity* COrderMortarAttack::FindTarget( CBaseTFPlayer *pPlayer )
 {
 	// Look for some nearby enemy objects that would be fun to destroy.
 	CTFTeam *pEnemyTeam;
-	if ( !pClass->GetTeam() || (pEnemyTeam = pClass->GetTeam()->GetEnemyTeam()) == NULL )
-		return false;
+	if ( !pPlayer->GetTFTeam() || (pEnemyTeam = pPlayer->GetTFTeam()->GetEnemyTeam()) == NULL )
+		return NULL;
+
+	if ( COrderPlanner::IsActive() )
+	{
+		return pEnemyTeam->GetOrderPlanner()->FindNearest( 
+			COrderPlanner::SET_OBJECTS, 
+			pPlayer->GetAbsOrigin(), 
+			ENEMYOBJ_MORTAR_DIST );
+	}
 
-	CBaseTFPlayer *pPlayer = pClass->GetPlayer();
-	
 	CSortBase info;
 	info.m_pPlayer = pPlayer;
 	info.m_pTeam = pEnemyTeam;
@@ -51,10 +59,22 @@ bool COrderMortarAttack::CreateOrder( CPlayerClass *pClass )
 		pEnemyTeam->GetNumObjects()				// number of objects to check
 		);
 
-	if( nSorted > 0 )
-	{
-		CBaseEntity *pEnt = pEnemyTeam->GetObject( sorted[0] );
+	return ( nSorted > 0 ) ? pEnemyTeam->GetObject( sorted[0] ) : NULL;
+}
+
 
+bool COrderMortarAttack::CreateOrder( CPlayerClass *pClass )
+{
+	VPROF( "COrderMortarAttack::CreateOrder" );
+
+	if ( !pClass->GetTeam() )
+		return false;
+
+	CBaseTFPlayer *pPlayer = pClass->GetPlayer();
+
+	CBaseEntity *pEnt = FindTarget( pPlayer );
+	if( pEnt )
+	{
 		COrderMortarAttack *pOrder = new COrderMortarAttack;
 
 		pClass->GetTeam()->AddOrder( 
@@ -15,6 +15,8 @@
 #include "orders.h"
 
 
+class CBaseTFPlayer;
+
 class COrderMortarAttack : public COrder
 {
 public:
@@ -23,6 +25,9 @@ public:
 
 	// Create an order for the player.
 	static bool		CreateOrder( CPlayerClass *pClass );
+
+	// The enemy object CreateOrder would have the player shell, or NULL.
+	static CBaseEntity*	FindTarget( CBaseTFPlayer *pPlayer );
 };
 
 
@@ -0,0 +1,536 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-team candidate sets shared by the personal order creators.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "order_planner.h"
+#include "tf_team.h"
+#include "tf_player.h"
+#include "tf_obj.h"
+#include "tf_func_resource.h"
+#include "order_helpers.h"
+#include "order_heal.h"
+#include "order_repair.h"
+#include "order_assist.h"
+#include "order_killmortarguy.h"
+#include "order_mortar_attack.h"
+#include "bot_base.h"
+#include "tier0/vprof.h"
+
+#include "tier0/valve_minmax_off.h"
+#include <algorithm>
+#include "tier0/valve_minmax_on.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+// Each rope attachment counts as this many units closer when picking objects to cover,
+// so orders favor covering groups of objects together (see SortFn_DistanceAndConcentration).
+#define ORDER_ROPE_CONCENTRATION_BIAS	200
+
+
+ConVar tf_order_planner( "tf_order_planner", "1", 0, "Personal order creators pick their targets from per-team candidate sets instead of sorting per player." );
+
+
+static const char *s_pSetNames[COrderPlanner::NUM_CANDIDATE_SETS] =
+{
+	"COrderPlanner: resource zones",
+	"COrderPlanner: damaged objects",
+	"COrderPlanner: hurt players",
+	"COrderPlanner: live players",
+	"COrderPlanner: enemy players",
+	"COrderPlanner: enemy mortars",
+	"COrderPlanner: objects",
+	"COrderPlanner: sentrygun cover",
+	"COrderPlanner: shieldwall cover",
+	"COrderPlanner: resupply cover",
+	"COrderPlanner: respawn station cover",
+};
+
+
+// ------------------------------------------------------------------------------------------ //
+// COrderPlanner implementation.
+// ------------------------------------------------------------------------------------------ //
+
+COrderPlanner::COrderPlanner()
+{
+	m_pTeam = NULL;
+	Invalidate();
+}
+
+
+void COrderPlanner::Init( CTFTeam *pTeam )
+{
+	m_pTeam = pTeam;
+	Invalidate();
+}
+
+
+void COrderPlanner::Purge()
+{
+	for ( int i = 0; i < NUM_CANDIDATE_SETS; i++ )
+	{
+		m_Sets[i].m_Candidates.Purge();
+	}
+	m_Keys.Purge();
+	Invalidate();
+}
+
+
+bool COrderPlanner::IsActive()
+{
+	return tf_order_planner.GetBool();
+}
+
+
+void COrderPlanner::Invalidate()
+{
+	for ( int i = 0; i < NUM_CANDIDATE_SETS; i++ )
+	{
+		m_Sets[i].m_nBuildTick = -1;
+	}
+}
+
+
+int COrderPlanner::GetCoverSetForObjectType( int iObjectType )
+{
+	switch( iObjectType )
+	{
+		case OBJ_SENTRYGUN_PLASMA:	return SET_COVER_SENTRYGUN;
+		case OBJ_SHIELDWALL:		return SET_COVER_SHIELDWALL;
+		case OBJ_RESUPPLY:			return SET_COVER_RESUPPLY;
+		case OBJ_RESPAWN_STATION:	return SET_COVER_RESPAWN;
+		default:					return -1;
+	}
+}
+
+
+COrderPlanner::CandidateSet_t &COrderPlanner::GetSet( int iSet )
+{
+	CandidateSet_t &set = m_Sets[iSet];
+	if ( set.m_nBuildTick != gpGlobals->tickcount )
+	{
+		VPROF( s_pSetNames[iSet] );
+
+		set.m_Candidates.RemoveAll();
+		BuildSet( iSet, set.m_Candidates );
+		set.m_nBuildTick = gpGlobals->tickcount;
+	}
+	return set;
+}
+
+
+int COrderPlanner::GetCandidateCount( int iSet )
+{
+	return GetSet( iSet ).m_Candidates.Count();
+}
+
+
+void COrderPlanner::AddCandidate( CUtlVector<OrderCandidate_t> &candidates, CBaseEntity *pEntity, const Vector &vecOrigin, float flBias )
+{
+	int i = candidates.AddToTail();
+	candidates[i].m_hEntity = pEntity;
+	candidates[i].m_vecOrigin = vecOrigin;
+	candidates[i].m_flBias = flBias;
+}
+
+
+void COrderPlanner::BuildSet( int iSet, CUtlVector<OrderCandidate_t> &candidates )
+{
+	if ( !m_pTeam )
+		return;
+
+	switch( iSet )
+	{
+		case SET_RESOURCE_ZONES:
+		{
+			CBaseEntity *pEntity = NULL;
+			while ( (pEntity = gEntList.FindEntityByClassname( pEntity, "trigger_resourcezone" )) != NULL )
+			{
+				CResourceZone *pZone = (CResourceZone*)pEntity;
+				if ( pZone->IsEmpty() || !pZone->GetActive() )
+					continue;
+
+				AddCandidate( candidates, pZone, pZone->WorldSpaceCenter() );
+			}
+		}
+		break;
+
+		case SET_DAMAGED_OBJECTS:
+		{
+			for ( int i = 0; i < m_pTeam->GetNumObjects(); i++ )
+			{
+				CBaseObject *pObject = m_pTeam->GetObject( i );
+				if ( pObject->IsBuilding() || pObject->m_iHealth >= pObject->m_iMaxHealth )
+					continue;
+
+				AddCandidate( candidates, pObject, pObject->GetAbsOrigin() );
+			}
+		}
+		break;
+
+		case SET_HURT_PLAYERS:
+		case SET_LIVE_PLAYERS:
+		{
+			for ( int i = 0; i < m_pTeam->GetNumPlayers(); i++ )
+			{
+				CBasePlayer *pPlayer = m_pTeam->GetPlayer( i );
+				if ( !pPlayer->IsAlive() )
+					continue;
+
+				if ( iSet == SET_HURT_PLAYERS && pPlayer->m_iHealth >= pPlayer->m_iMaxHealth )
+					continue;
+
+				AddCandidate( candidates, pPlayer, pPlayer->GetAbsOrigin() );
+			}
+		}
+		break;
+
+		case SET_ENEMY_PLAYERS:
+		case SET_ENEMY_MORTARS:
+		{
+			for ( int i = 1; i <= gpGlobals->maxClients; i++ )
+			{
+				CBaseTFPlayer *pPlayer = (CBaseTFPlayer*)UTIL_PlayerByIndex( i );
+				if ( !pPlayer || pPlayer->GetTeam() == m_pTeam )
+					continue;
+
+				if ( iSet == SET_ENEMY_MORTARS )
+				{
+					if ( pPlayer->IsClass( TFCLASS_UNDECIDED ) || !pPlayer->GetTeam() || !pPlayer->IsAlive() )
+						continue;
+				}
+
+				AddCandidate( candidates, pPlayer, pPlayer->GetAbsOrigin() );
+			}
+		}
+		break;
+
+		case SET_OBJECTS:
+		case SET_COVER_SENTRYGUN:
+		case SET_COVER_SHIELDWALL:
+		case SET_COVER_RESUPPLY:
+		case SET_COVER_RESPAWN:
+		{
+			for ( int i = 0; i < m_pTeam->GetNumObjects(); i++ )
+			{
+				CBaseObject *pObject = m_pTeam->GetObject( i );
+				const Vector &vecOrigin = pObject->GetAbsOrigin();
+
+				bool bCovered;
+				switch( iSet )
+				{
+					case SET_OBJECTS:
+						bCovered = false;
+						break;
+					case SET_COVER_SENTRYGUN:
+						bCovered = !pObject->WantsCoverFromSentryGun() || m_pTeam->IsCoveredBySentryGun( vecOrigin );
+						break;
+					case SET_COVER_SHIELDWALL:
+						bCovered = !pObject->WantsCover() || m_pTeam->GetNumShieldWallsCoveringPosition( vecOrigin );
+						break;
+					case SET_COVER_RESUPPLY:
+						bCovered = m_pTeam->GetNumResuppliesCoveringPosition( vecOrigin ) != 0;
+						break;
+					default:
+						bCovered = m_pTeam->GetNumRespawnStationsCoveringPosition( vecOrigin ) != 0;
+						break;
+				}
+
+				if ( bCovered )
+					continue;
+
+				AddCandidate( candidates, pObject, vecOrigin, pObject->RopeCount() * ORDER_ROPE_CONCENTRATION_BIAS );
+			}
+		}
+		break;
+
+		default:
+		{
+			Assert( !"Unknown candidate set" );
+		}
+		break;
+	}
+
+	VPROF_INCREMENT_COUNTER( "COrderPlanner: candidates", candidates.Count() );
+}
+
+
+int COrderPlanner::SelectNearest(
+	int iSet,
+	const Vector &vPos,
+	float flMaxDist,
+	CBaseEntity **ppEntities,
+	int nWanted,
+	candidateFilterFn pFilter,
+	void *pUserData )
+{
+	const CUtlVector<OrderCandidate_t> &candidates = GetSet( iSet ).m_Candidates;
+	if ( !candidates.Count() || nWanted <= 0 )
+		return 0;
+
+	bool bBiased = ( iSet >= SET_OBJECTS );
+	float flMaxDistSqr = flMaxDist * flMaxDist;
+
+	m_Keys.RemoveAll();
+	for ( int i = 0; i < candidates.Count(); i++ )
+	{
+		const OrderCandidate_t &candidate = candidates[i];
+		CBaseEntity *pEntity = candidate.m_hEntity;
+		if ( !pEntity )
+			continue;
+
+		float flDistSqr = vPos.DistToSqr( candidate.m_vecOrigin );
+		if ( flDistSqr > flMaxDistSqr )
+			continue;
+
+		if ( pFilter && !pFilter( pUserData, pEntity ) )
+			continue;
+
+		int j = m_Keys.AddToTail();
+		m_Keys[j].m_flKey = bBiased ? FastSqrt( flDistSqr ) - candidate.m_flBias : flDistSqr;
+		m_Keys[j].m_iCandidate = i;
+	}
+
+	int nFound = MIN( nWanted, m_Keys.Count() );
+	if ( nFound )
+	{
+		std::partial_sort( m_Keys.Base(), m_Keys.Base() + nFound, m_Keys.Base() + m_Keys.Count() );
+	}
+
+	for ( int i = 0; i < nFound; i++ )
+	{
+		ppEntities[i] = candidates[ m_Keys[i].m_iCandidate ].m_hEntity;
+	}
+
+	return nFound;
+}
+
+
+CBaseEntity *COrderPlanner::FindNearest( int iSet, const Vector &vPos, float flMaxDist, candidateFilterFn pFilter, void *pUserData )
+{
+	CBaseEntity *pEntity = NULL;
+	SelectNearest( iSet, vPos, flMaxDist, &pEntity, 1, pFilter, pUserData );
+	return pEntity;
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// Benchmark.
+// ------------------------------------------------------------------------------------------ //
+
+enum
+{
+	ORDER_TEST_HEAL = 0,
+	ORDER_TEST_REPAIR_FRIENDLY,
+	ORDER_TEST_REPAIR_OWN,
+	ORDER_TEST_ASSIST,
+	ORDER_TEST_KILLMORTARGUY,
+	ORDER_TEST_MORTAR_ATTACK,
+	ORDER_TEST_RESOURCEPUMP,
+	ORDER_TEST_SENTRYGUN,
+	ORDER_TEST_SHIELDWALL,
+	ORDER_TEST_RESUPPLY,
+
+	NUM_ORDER_TESTS
+};
+
+static const char *s_pOrderTestNames[NUM_ORDER_TESTS] =
+{
+	"heal",
+	"repair friendly",
+	"repair own",
+	"assist",
+	"kill mortar guy",
+	"mortar attack",
+	"resource pump",
+	"sentrygun",
+	"shieldwall",
+	"resupply",
+};
+
+
+// Same distances the order creators use.
+static CBaseEntity *FindOrderTestTarget( int iTest, CBaseTFPlayer *pPlayer )
+{
+	switch( iTest )
+	{
+		case ORDER_TEST_HEAL:				return COrderHeal::FindTarget( pPlayer );
+		case ORDER_TEST_REPAIR_FRIENDLY:	return COrderRepair::FindTarget_RepairFriendlyObjects( pPlayer );
+		case ORDER_TEST_REPAIR_OWN:			return COrderRepair::FindTarget_RepairOwnObjects( pPlayer );
+		case ORDER_TEST_KILLMORTARGUY:		return COrderKillMortarGuy::FindTarget( pPlayer );
+		case ORDER_TEST_MORTAR_ATTACK:		return COrderMortarAttack::FindTarget( pPlayer );
+		case ORDER_TEST_RESOURCEPUMP:		return FindTarget_ResourceZoneObject( pPlayer, OBJ_RESOURCEPUMP );
+		case ORDER_TEST_SENTRYGUN:			return FindTarget_GenericObject( pPlayer, OBJ_SENTRYGUN_PLASMA, 3500 );
+		case ORDER_TEST_SHIELDWALL:			return FindTarget_GenericObject( pPlayer, OBJ_SHIELDWALL, 2000 );
+		case ORDER_TEST_RESUPPLY:			return FindTarget_GenericObject( pPlayer, OBJ_RESUPPLY, 2000 );
+
+		case ORDER_TEST_ASSIST:
+		{
+			CBaseEntity *pEnemies[COrderAssist::NUM_ASSIST_ENEMIES];
+			int nEnemies;
+			return COrderAssist::FindTarget( pPlayer, pEnemies, &nEnemies );
+		}
+
+		default:
+			return NULL;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills the server out with bots and objects, then times how long each
+//			order type takes to pick targets for every player, with and without
+//			the order planner.
+//-----------------------------------------------------------------------------
+static void CC_OrderPlannerBenchmark( const CCommand &args )
+{
+	CBasePlayer *pCommandPlayer = UTIL_GetCommandClient();
+	if ( !pCommandPlayer )
+		return;
+
+	int nPlayers = args.ArgC() > 1 ? atoi( args[1] ) : 32;
+	nPlayers = clamp( nPlayers, 2, gpGlobals->maxClients );
+	int nObjects = args.ArgC() > 2 ? clamp( atoi( args[2] ), 1, MAX_TEAM_OBJECTS ) : 300;
+	int nIterations = args.ArgC() > 3 ? MAX( atoi( args[3] ), 1 ) : 100;
+
+	Vector vecCenter = pCommandPlayer->GetAbsOrigin();
+	Vector vecExtent( 4096, 4096, 512 );
+
+	int nClients = 0;
+	for ( int i = 1; i <= gpGlobals->maxClients; i++ )
+	{
+		if ( UTIL_PlayerByIndex( i ) )
+			++nClients;
+	}
+
+	// Frozen bots, alternating teams, spread over the map.
+	CUtlVector<CBaseTFPlayer*> bots;
+	for ( int i = nClients; i < nPlayers; i++ )
+	{
+		CBaseTFPlayer *pBot = (CBaseTFPlayer*)BotPutInServer( true, ( i & 1 ) ? TEAM_ALIENS : TEAM_HUMANS, -1 );
+		if ( !pBot )
+			break;
+
+		pBot->SetAbsOrigin( vecCenter + Vector( random->RandomFloat( -vecExtent.x, vecExtent.x ), random->RandomFloat( -vecExtent.y, vecExtent.y ), 0 ) );
+		bots.AddToTail( pBot );
+	}
+
+	// Have every other bot get shot by an enemy, so there's someone to heal and assist.
+	for ( int i = 0; i + 1 < bots.Count(); i += 2 )
+	{
+		CBaseTFPlayer *pAttacker = bots[i+1];
+		if ( !pAttacker->InSameTeam( bots[i] ) )
+		{
+			bots[i]->TakeDamage( CTakeDamageInfo( pAttacker, pAttacker, 10, DMG_GENERIC ) );
+		}
+	}
+
+	// Objects split between the teams, half of them damaged, some of them owned by bots.
+	static const char *s_pObjectNames[] = { "obj_sentrygun_plasma", "obj_shieldwall", "obj_respawn_station", "obj_resupply" };
+
+	CUtlVector<CBaseObject*> objects;
+	for ( int i = 0; i < nObjects; i++ )
+	{
+		CBaseObject *pObject = (CBaseObject*)CreateEntityByName( s_pObjectNames[ i % ARRAYSIZE(s_pObjectNames) ] );
+		if ( !pObject )
+			break;
+
+		pObject->SetAbsOrigin( vecCenter + Vector( random->RandomFloat( -vecExtent.x, vecExtent.x ), random->RandomFloat( -vecExtent.y, vecExtent.y ), random->RandomFloat( -vecExtent.z, vecExtent.z ) ) );
+		DispatchSpawn( pObject );
+		pObject->ChangeTeam( ( i & 1 ) ? TEAM_ALIENS : TEAM_HUMANS );
+
+		if ( i & 2 )
+		{
+			pObject->SetHealth( MAX( pObject->GetMaxHealth() / 2, 1 ) );
+		}
+
+		if ( bots.Count() )
+		{
+			CBaseTFPlayer *pBuilder = bots[ i % bots.Count() ];
+			if ( pBuilder->GetTeamNumber() == pObject->GetTeamNumber() )
+			{
+				pObject->SetBuilder( pBuilder );
+				pBuilder->AddObject( pObject );
+			}
+		}
+
+		objects.AddToTail( pObject );
+	}
+
+	CUtlVector<CBaseTFPlayer*> players;
+	for ( int i = 1; i <= gpGlobals->maxClients; i++ )
+	{
+		CBaseTFPlayer *pPlayer = (CBaseTFPlayer*)UTIL_PlayerByIndex( i );
+		if ( pPlayer && pPlayer->GetTFTeam() )
+		{
+			players.AddToTail( pPlayer );
+		}
+	}
+
+	Msg( "tf_order_planner_benchmark: %d players, %d objects, %d iterations\n", players.Count(), objects.Count(), nIterations );
+	Msg( "  order type          sorted lists (ms)    planner (ms)    targets    mismatches\n" );
+
+	bool bSavePlanner = tf_order_planner.GetBool();
+
+	CUtlVector<CBaseEntity*> picks[2];
+	double flTotal[2] = { 0, 0 };
+	for ( int iTest = 0; iTest < NUM_ORDER_TESTS; iTest++ )
+	{
+		double flTime[2];
+		for ( int iPass = 0; iPass < 2; iPass++ )
+		{
+			tf_order_planner.SetValue( iPass );
+			picks[iPass].SetCount( players.Count() );
+
+			double flStart = Plat_FloatTime();
+			for ( int iIter = 0; iIter < nIterations; iIter++ )
+			{
+				// Each iteration is a fresh evaluation, so the planner rebuilds its sets.
+				for ( int iTeam = 0; iTeam < GetNumberOfTeams(); iTeam++ )
+				{
+					GetGlobalTFTeam( iTeam )->GetOrderPlanner()->Invalidate();
+				}
+
+				for ( int i = 0; i < players.Count(); i++ )
+				{
+					picks[iPass][i] = FindOrderTestTarget( iTest, players[i] );
+				}
+			}
+			flTime[iPass] = ( Plat_FloatTime() - flStart ) * 1000.0 / nIterations;
+			flTotal[iPass] += flTime[iPass];
+		}
+
+		int nTargets = 0;
+		int nMismatches = 0;
+		for ( int i = 0; i < players.Count(); i++ )
+		{
+			if ( picks[1][i] )
+				++nTargets;
+			if ( picks[0][i] != picks[1][i] )
+				++nMismatches;
+		}
+
+		Msg( "  %-16s    %17.4f    %12.4f    %7d    %10d\n", s_pOrderTestNames[iTest], flTime[0], flTime[1], nTargets, nMismatches );
+	}
+
+	Msg( "  %-16s    %17.4f    %12.4f\n", "total", flTotal[0], flTotal[1] );
+
+	tf_order_planner.SetValue( bSavePlanner );
+
+	for ( int i = 0; i < objects.Count(); i++ )
+	{
+		UTIL_Remove( objects[i] );
+	}
+
+	for ( int i = 0; i < bots.Count(); i++ )
+	{
+		engine->ServerCommand( UTIL_VarArgs( "kickid %d\n", bots[i]->GetUserID() ) );
+	}
+}
+
+static ConCommand tf_order_planner_benchmark( "tf_order_planner_benchmark", CC_OrderPlannerBenchmark, "Time personal order target selection with and without the order planner: tf_order_planner_benchmark [players] [objects] [iterations]", FCVAR_CHEAT );
@@ -0,0 +1,137 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-team candidate sets shared by the personal order creators.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef ORDER_PLANNER_H
+#define ORDER_PLANNER_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "utlvector.h"
+#include "ehandle.h"
+
+
+class CTFTeam;
+
+
+struct OrderCandidate_t
+{
+	EHANDLE		m_hEntity;
+	Vector		m_vecOrigin;
+	float		m_flBias;		// Subtracted from the distance in the object sets.
+};
+
+
+// Returns false to skip a candidate. pUserData is whatever was passed to SelectNearest.
+typedef bool (*candidateFilterFn)( void *pUserData, CBaseEntity *pEntity );
+
+
+// ------------------------------------------------------------------------------------------ //
+// COrderPlanner.
+//
+// The order creators used to filter and insertion sort a team's objects or players for every
+// player they looked at. The planner builds each filtered set once per evaluation, with
+// positions copied out, and every player on the team picks from the same set. Picking is a
+// pass over the set to key it by squared distance, then a partial sort for the few entries
+// that are wanted. Ties go to the entry that comes first in the team's list, same as the
+// old insertion sort.
+//
+// Sets are built the first time they're asked for in a tick, so a tick that doesn't
+// evaluate any orders doesn't pay for them.
+// ------------------------------------------------------------------------------------------ //
+
+class COrderPlanner
+{
+public:
+	enum
+	{
+		SET_RESOURCE_ZONES = 0,	// Active zones that still have resources
+		SET_DAMAGED_OBJECTS,	// Team objects that aren't building and aren't at full health
+		SET_HURT_PLAYERS,		// Live teammates that aren't at full health
+		SET_LIVE_PLAYERS,		// Live teammates
+		SET_ENEMY_PLAYERS,		// Clients that aren't on this team
+		SET_ENEMY_MORTARS,		// Live enemies that have picked a class (see COrderKillMortarGuy)
+
+		// These are keyed by distance minus a bias for objects roped to other objects.
+		SET_OBJECTS,			// All team objects
+		SET_COVER_SENTRYGUN,	// Team objects wanting cover that no sentry gun covers
+		SET_COVER_SHIELDWALL,	// Team objects wanting cover that no shield wall covers
+		SET_COVER_RESUPPLY,		// Team objects that no resupply covers
+		SET_COVER_RESPAWN,		// Team objects that no respawn station covers
+
+		NUM_CANDIDATE_SETS
+	};
+
+					COrderPlanner();
+
+	void			Init( CTFTeam *pTeam );
+	void			Purge();
+
+	// Returns true if the order creators should use the planner instead of sorting per player.
+	static bool		IsActive();
+
+	// Forces every set to be rebuilt the next time it's asked for.
+	void			Invalidate();
+
+	// The SET_COVER_ set for one of the object types supported by IsValidFn_NearAndNotCovered,
+	// or -1 if it's not supported.
+	static int		GetCoverSetForObjectType( int iObjectType );
+
+	// Fills in up to nWanted entities from the set, nearest to vPos first, skipping anything
+	// further than flMaxDist and anything pFilter rejects. The object sets favor groups of
+	// objects, so they're keyed by distance minus the candidate's bias. Returns the number found.
+	int				SelectNearest(
+		int iSet,
+		const Vector &vPos,
+		float flMaxDist,
+		CBaseEntity **ppEntities,
+		int nWanted,
+		candidateFilterFn pFilter = NULL,
+		void *pUserData = NULL );
+
+	// Shortcut for picking a single entity.
+	CBaseEntity		*FindNearest( int iSet, const Vector &vPos, float flMaxDist, candidateFilterFn pFilter = NULL, void *pUserData = NULL );
+
+	int				GetCandidateCount( int iSet );
+
+
+private:
+
+	struct CandidateSet_t
+	{
+		CUtlVector<OrderCandidate_t>	m_Candidates;
+		int								m_nBuildTick;
+	};
+
+	struct SortKey_t
+	{
+		float	m_flKey;
+		int		m_iCandidate;
+
+		bool operator<( const SortKey_t &other ) const
+		{
+			if ( m_flKey != other.m_flKey )
+				return m_flKey < other.m_flKey;
+			return m_iCandidate < other.m_iCandidate;
+		}
+	};
+
+	CandidateSet_t	&GetSet( int iSet );
+	void			BuildSet( int iSet, CUtlVector<OrderCandidate_t> &candidates );
+	void			AddCandidate( CUtlVector<OrderCandidate_t> &candidates, CBaseEntity *pEntity, const Vector &vecOrigin, float flBias = 0 );
+
+
+private:
+
+	CTFTeam				*m_pTeam;
+	CandidateSet_t		m_Sets[NUM_CANDIDATE_SETS];
+	CUtlVector<SortKey_t>	m_Keys;		// Scratch space for SelectNearest.
+};
+
+
+#endif // ORDER_PLANNER_H
@@ -11,6 +11,8 @@
 #include "tf_class_defender.h"
 #include "order_helpers.h"
 #include "tf_obj.h"
+#include "order_planner.h"
+#include "tier0/vprof.h"
 
 
 IMPLEMENT_SERVERCLASS_ST( COrderRepair, DT_OrderRepair )
@@ -56,13 +58,27 @@ static bool IsValidFn_RepairOwnObjects( void *pUserData, int a )
 }
 
 
-bool COrderRepair::CreateOrder_RepairFriendlyObjects( CPlayerClassDefender *pClass )
+static bool FilterFn_BuiltBy( void *pUserData, CBaseEntity *pEntity )
 {
-	if( !pClass->CanBuildSentryGun() )
-		return false;
+	return ((CBaseObject*)pEntity)->GetBuilder() == (CBaseTFPlayer*)pUserData;
+}
 
-	CBaseTFPlayer *pPlayer = pClass->GetPlayer();
-	CTFTeam *pTeam = pClass->GetTeam();
+
+// Defenders only get orders for damaged objects closer than this.
+#define REPAIR_FRIENDLY_OBJECTS_DIST	1024
+
+
+CBaseObject* COrderRepair::FindTarget_RepairFriendlyObjects( CBaseTFPlayer *pPlayer )
+{
+	CTFTeam *pTeam = pPlayer->GetTFTeam();
+
+	if ( COrderPlanner::IsActive() )
+	{
+		return (CBaseObject*)pTeam->GetOrderPlanner()->FindNearest( 
+			COrderPlanner::SET_DAMAGED_OBJECTS, 
+			pPlayer->GetAbsOrigin(), 
+			REPAIR_FRIENDLY_OBJECTS_DIST );
+	}
 
 	// Sort the list and filter out fully healed objects..
 	CSortBase info;
@@ -81,32 +97,61 @@ bool COrderRepair::CreateOrder_RepairFriendlyObjects( CPlayerClassDefender *pCla
 	if( nSorted )
 	{
 		CBaseObject *pObjToHeal = pTeam->GetObject( sorted[0] );
+		if( pPlayer->GetAbsOrigin().DistTo( pObjToHeal->GetAbsOrigin() ) < REPAIR_FRIENDLY_OBJECTS_DIST )
+			return pObjToHeal;
+	}
+
+	return NULL;
+}
+
+
+bool COrderRepair::CreateOrder_RepairFriendlyObjects( CPlayerClassDefender *pClass )
+{
+	VPROF( "COrderRepair::CreateOrder_RepairFriendlyObjects" );
+
+	if( !pClass->CanBuildSentryGun() )
+		return false;
+
+	CBaseTFPlayer *pPlayer = pClass->GetPlayer();
 
-		static float flClosestDist = 1024;
-		if( pPlayer->GetAbsOrigin().DistTo( pObjToHeal->GetAbsOrigin() ) < flClosestDist )
-		{
-			COrder *pOrder = new COrderRepair;
-
-			pTeam->AddOrder( 
-				ORDER_REPAIR,
-				pObjToHeal,
-				pPlayer,
-				1e24,
-				60,
-				pOrder
-				);
-			
-			return true;
-		}
+	CBaseObject *pObjToHeal = FindTarget_RepairFriendlyObjects( pPlayer );
+	if( pObjToHeal )
+	{
+		COrder *pOrder = new COrderRepair;
+
+		pClass->GetTeam()->AddOrder( 
+			ORDER_REPAIR,
+			pObjToHeal,
+			pPlayer,
+			1e24,
+			60,
+			pOrder
+			);
+		
+		return true;
 	}
 
 	return false;
 }
 
-bool COrderRepair::CreateOrder_RepairOwnObjects( CPlayerClass *pClass )
+
+CBaseObject* COrderRepair::FindTarget_RepairOwnObjects( CBaseTFPlayer *pPlayer )
 {
+	if ( COrderPlanner::IsActive() )
+	{
+		if ( !pPlayer->GetObjectCount() )
+			return NULL;
+
+		return (CBaseObject*)pPlayer->GetTFTeam()->GetOrderPlanner()->FindNearest( 
+			COrderPlanner::SET_DAMAGED_OBJECTS, 
+			pPlayer->GetAbsOrigin(), 
+			FLT_MAX, 
+			FilterFn_BuiltBy, 
+			pPlayer );
+	}
+
 	CSortBase info;
-	info.m_pPlayer = pClass->GetPlayer();
+	info.m_pPlayer = pPlayer;
 
 	int sorted[16];
 	int nSorted = BuildSortedActiveList(
@@ -117,18 +162,25 @@ bool COrderRepair::CreateOrder_RepairOwnObjects( CPlayerClass *pClass )
 		&info,
 		info.m_pPlayer->GetObjectCount() );
 
-	if( nSorted )
-	{
-		// Make an order to repair the closest damaged object.
-		CBaseObject *pObj = info.m_pPlayer->GetObject( sorted[0] );
-		if (!pObj)
-			return false;
+	return nSorted ? pPlayer->GetObject( sorted[0] ) : NULL;
+}
+
 
+bool COrderRepair::CreateOrder_RepairOwnObjects( CPlayerClass *pClass )
+{
+	VPROF( "COrderRepair::CreateOrder_RepairOwnObjects" );
+
+	CBaseTFPlayer *pPlayer = pClass->GetPlayer();
+
+	// Make an order to repair the closest damaged object.
+	CBaseObject *pObj = FindTarget_RepairOwnObjects( pPlayer );
+	if( pObj )
+	{
 		COrderRepair *pOrder = new COrderRepair;
-		info.m_pPlayer->GetTFTeam()->AddOrder( 
+		pPlayer->GetTFTeam()->AddOrder( 
 			ORDER_REPAIR,
 			pObj,
-			info.m_pPlayer,
+			pPlayer,
 			1e24,
 			60,
 			pOrder
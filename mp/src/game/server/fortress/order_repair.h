@@ -17,6 +17,8 @@
 
 class CPlayerClass;
 class CPlayerClassDefender;
+class CBaseTFPlayer;
+class CBaseObject;
 
 
 class COrderRepair : public COrder
@@ -31,6 +33,10 @@ public:
 	// Create an order for anyone to repair their own objects.
 	static bool		CreateOrder_RepairOwnObjects( CPlayerClass *pClass );
 
+	// The objects the CreateOrder_ functions would make the player repair, or NULL.
+	static CBaseObject*	FindTarget_RepairFriendlyObjects( CBaseTFPlayer *pPlayer );
+	static CBaseObject*	FindTarget_RepairOwnObjects( CBaseTFPlayer *pPlayer );
+
 
 // COrder overrides.
 public:
@@ -11,6 +11,7 @@
 #include "tf_obj_resourcepump.h"
 #include "tf_func_resource.h"
 #include "order_helpers.h"
+#include "tier0/vprof.h"
 
 
 IMPLEMENT_SERVERCLASS_ST( COrderResourcePump, DT_OrderResourcePump )
@@ -19,6 +20,8 @@ END_SEND_TABLE()
 
 bool COrderResourcePump::CreateOrder( CPlayerClass *pClass )
 {
+	VPROF( "COrderResourcePump::CreateOrder" );
+
 	COrderResourcePump *pOrder = new COrderResourcePump;
 
 	if ( OrderCreator_ResourceZoneObject( pClass->GetPlayer(), OBJ_RESOURCEPUMP, pOrder ) )
@@ -10,6 +10,7 @@
 #include "tf_team.h"
 #include "tf_playerclass.h"
 #include "order_helpers.h"
+#include "tier0/vprof.h"
 
 
 // Orders to build resupplies near objects come in within this range.
@@ -22,6 +23,8 @@ END_SEND_TABLE()
 
 bool COrderResupply::CreateOrder( CPlayerClass *pClass )
 {
+	VPROF( "COrderResupply::CreateOrder" );
+
 	COrderResupply *pOrder = new COrderResupply;
 	if ( OrderCreator_GenericObject( pClass, OBJ_RESUPPLY, RESUPPLY_ORDER_MAXDIST, pOrder ) )
 	{
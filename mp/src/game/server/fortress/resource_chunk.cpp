@@ -30,6 +30,7 @@ IMPLEMENT_SERVERCLASS_ST( CResourceChunk, DT_ResourceChunk )
 END_SEND_TABLE()
 
 LINK_ENTITY_TO_CLASS( resource_chunk, CResourceChunk );
+DEFINE_ENTITY_POOL( CResourceChunk, 64 );
 PRECACHE_REGISTER( resource_chunk );
 
 //-----------------------------------------------------------------------------
@@ -6,6 +6,7 @@
 
 
 #include "props.h"
+#include "tf_entity_pool.h"
 
 class CResourceZone;
 
@@ -18,6 +19,7 @@ extern ConVar	resource_chunk_processed_value;
 class CResourceChunk : public CBaseProp
 {
 	DECLARE_CLASS( CResourceChunk, CBaseProp );
+	DECLARE_ENTITY_POOL( CResourceChunk );
 public:
 	DECLARE_DATADESC();
 	DECLARE_SERVERCLASS();
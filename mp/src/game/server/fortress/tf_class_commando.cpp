@@ -172,7 +172,7 @@ int CPlayerClassCommando::CanBuild( int iObjectType )
 {
 	if ( iObjectType == OBJ_RALLYFLAG )
 	{
-		if ( !m_pPlayer->HasNamedTechnology( "com_obj_rallyflag" ) )
+		if ( !m_pPlayer->HasTechnology( TECH_COM_OBJ_RALLYFLAG ) )
 			return CB_NOT_RESEARCHED;
 	}
 
@@ -192,20 +192,20 @@ void CPlayerClassCommando::FinishedObject( CBaseObject *pObject )
 void CPlayerClassCommando::CalculateRush( void )
 {
 	// Adrenalin Rush
-	if ( m_pPlayer->HasNamedTechnology( "com_adrenalin_rush" ) )
+	if ( m_pPlayer->HasTechnology( TECH_COM_ADRENALIN_RUSH ) )
 		m_bCanRush = true;
 	else
 		m_bCanRush = false;
 
 	// Battlecry
-	m_bHasBattlecry = m_pPlayer->HasNamedTechnology( "com_adrenalin_battlecry" );
+	m_bHasBattlecry = m_pPlayer->HasTechnology( TECH_COM_ADRENALIN_BATTLECRY );
 
 	// Boot
 	// ROBIN: Removed for now
 	m_bCanBoot = false;//m_pPlayer->HasNamedTechnology( "com_automatic_boot" );
 
 	// Killing Rush
-	m_pPlayer->SetRampage( m_pPlayer->HasNamedTechnology( "com_adrenalin_rampage" ) );
+	m_pPlayer->SetRampage( m_pPlayer->HasTechnology( TECH_COM_ADRENALIN_RAMPAGE ) );
 }
 
 //-----------------------------------------------------------------------------
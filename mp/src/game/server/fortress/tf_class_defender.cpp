@@ -190,11 +190,11 @@ void CPlayerClassDefender::SetupSizeData( void )
 void CPlayerClassDefender::GainedNewTechnology( CBaseTechnology *pTechnology )
 {
 	// Calculate the number of sentryguns allowed
-	if ( m_pPlayer->HasNamedTechnology( "sentrygun_three" ) )
+	if ( m_pPlayer->HasTechnology( TECH_SENTRYGUN_THREE ) )
 	{
 		m_iNumberOfSentriesAllowed = 3;
 	}
-	else if ( m_pPlayer->HasNamedTechnology( "sentrygun_two" ) )
+	else if ( m_pPlayer->HasTechnology( TECH_SENTRYGUN_TWO ) )
 	{
 		m_iNumberOfSentriesAllowed = 2;
 	}
@@ -208,17 +208,17 @@ void CPlayerClassDefender::GainedNewTechnology( CBaseTechnology *pTechnology )
 	m_bHasRocketlauncher = false;
 
 	// Sentrygun levels
-	if ( m_pPlayer->HasNamedTechnology( "sentrygun_ai" ) )
+	if ( m_pPlayer->HasTechnology( TECH_SENTRYGUN_AI ) )
 	{
 		m_bHasSmarterSentryguns = true;
 	}
-	if ( m_pPlayer->HasNamedTechnology( "sentrygun_sensors" ) )
+	if ( m_pPlayer->HasTechnology( TECH_SENTRYGUN_SENSORS ) )
 	{
 		m_bHasSensorSentryguns = true;
 	}
 
 	// Sentrygun types
-	if ( m_pPlayer->HasNamedTechnology( "sentrygun_rocket" ) )
+	if ( m_pPlayer->HasTechnology( TECH_SENTRYGUN_ROCKET ) )
 	{
 		m_bHasRocketlauncher = true;
 	}
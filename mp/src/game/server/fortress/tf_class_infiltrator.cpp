@@ -154,7 +154,7 @@ void CPlayerClassInfiltrator::SetupSizeData( void )
 void CPlayerClassInfiltrator::GainedNewTechnology( CBaseTechnology *pTechnology )
 {
 	// Consume corpse technology?
-	m_bCanConsumeCorpses = m_pPlayer->HasNamedTechnology( "inf_consume_corpse" );
+	m_bCanConsumeCorpses = m_pPlayer->HasTechnology( TECH_INF_CONSUME_CORPSE );
 
 	BaseClass::GainedNewTechnology( pTechnology );
 }
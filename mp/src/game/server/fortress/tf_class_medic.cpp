@@ -195,7 +195,7 @@ int CPlayerClassMedic::CanBuild( int iObjectType )
 void CPlayerClassMedic::GainedNewTechnology( CBaseTechnology *pTechnology )
 {
 	// Autorepair
-	m_bHasAutoRepair = m_pPlayer->HasNamedTechnology( "obj_autorepair" );
+	m_bHasAutoRepair = m_pPlayer->HasTechnology( TECH_OBJ_AUTOREPAIR );
 
 	BaseClass::GainedNewTechnology( pTechnology );
 }
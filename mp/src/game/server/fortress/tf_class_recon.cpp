@@ -163,7 +163,7 @@ void CPlayerClassRecon::CreatePersonalOrder()
 void CPlayerClassRecon::GainedNewTechnology( CBaseTechnology *pTechnology )
 {
 	// Radar Scanner
-	if ( m_pPlayer->HasNamedTechnology( "rec_b_radar_scanners" ) )
+	if ( m_pPlayer->HasTechnology( TECH_REC_B_RADAR_SCANNERS ) )
 	{
 		m_bHasRadarScanner = true;
 	}
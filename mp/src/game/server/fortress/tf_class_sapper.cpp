@@ -197,22 +197,22 @@ void CPlayerClassSapper::GainedNewTechnology( CBaseTechnology *pTechnology )
 	m_bHasHugeRadiusEMP = false;
 	m_bHasLongerLastingEMPEffect = false;
 
-	if ( m_pPlayer->HasNamedTechnology( "emp1" ) )
+	if ( m_pPlayer->HasTechnology( TECH_EMP1 ) )
 	{
 		m_bHasFasterRechargingEMP = true;
 	}
 
-	if ( m_pPlayer->HasNamedTechnology( "emp3" ) )
+	if ( m_pPlayer->HasTechnology( TECH_EMP3 ) )
 	{
 		m_bHasMediumRangeEMP = true;
 	}
 
-	if ( m_pPlayer->HasNamedTechnology( "emp4" ) )
+	if ( m_pPlayer->HasTechnology( TECH_EMP4 ) )
 	{
 		m_bHasLongerLastingEMPEffect = true;
 	}
 
-	if ( m_pPlayer->HasNamedTechnology( "emp5" ) )
+	if ( m_pPlayer->HasTechnology( TECH_EMP5 ) )
 	{
 		m_bHasHugeRadiusEMP = true;
 	}
@@ -12,10 +12,9 @@
 #include "tf_team.h"
 #include "tf_class_support.h"
 #include "order_killmortarguy.h"
+#include "tf_tacticalmap.h"
 
 
-bool IsEntityVisibleToTactical( int iLocalTeamNumber, int iLocalTeamPlayers, 
-	int iLocalTeamScanners, int iEntIndex, const char *pEntName, int pEntTeamNumber, const Vector &pEntOrigin );
 
 ConVar	class_sniper_speed( "class_sniper_speed","200", FCVAR_NONE, "Sniper movement speed" );
 
@@ -180,7 +179,7 @@ void CPlayerClassSniper::ClassThink( void )
 void CPlayerClassSniper::GainedNewTechnology( CBaseTechnology *pTechnology )
 {
 	// Stealthed on deploy
-	if ( m_pPlayer->HasNamedTechnology( "sniper_deploy_stealth" ) )
+	if ( m_pPlayer->HasTechnology( TECH_SNIPER_DEPLOY_STEALTH ) )
 	{
 		m_bCanHide = true;
 	}
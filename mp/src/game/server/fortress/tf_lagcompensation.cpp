@@ -0,0 +1,749 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Lag compensation for fortress hitscan: players, vehicles and objects.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "tf_lagcompensation.h"
+#include "tf_player.h"
+#include "tf_team.h"
+#include "tf_obj.h"
+#include "usercmd.h"
+#include "inetchannelinfo.h"
+#include "gamevars_shared.h"
+#include "tier0/vprof.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+// Same as the stock manager: anything that moved further than this between two records
+// teleported, and can't be taken back past that.
+#define TF_LAG_TELEPORT_DIST_SQR	( 64.0f * 64.0f )
+
+#define TF_LAG_EPS_SQR				( 0.1f * 0.1f )
+
+// Hitboxes stick out of the collision bounds a bit (arms, heads), so the cone gets this much
+// extra room.
+#define TF_LAG_CONE_SLACK			24.0f
+
+
+ConVar sv_unlag( "sv_unlag", "1", FCVAR_DEVELOPMENTONLY, "Enables player lag compensation" );
+ConVar sv_maxunlag( "sv_maxunlag", "1.0", FCVAR_DEVELOPMENTONLY, "Maximum lag compensation in seconds", true, 0.0f, true, 1.0f );
+ConVar sv_lagflushbonecache( "sv_lagflushbonecache", "1", FCVAR_DEVELOPMENTONLY, "Flushes entity bone cache on lag compensation" );
+
+ConVar tf_lagcomp_objects( "tf_lagcomp_objects", "1", 0, "Lag compensate vehicles and other objects as well as players." );
+
+
+static CTFLagCompensation g_TFLagCompensation;
+ILagCompensationManager *lagcompensation = &g_TFLagCompensation;
+
+CTFLagCompensation* GetTFLagCompensation()
+{
+	return &g_TFLagCompensation;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Does the box touch the cone that starts at vecSrc and goes flRange along
+//			vecDir (normalized), widening by flSpread per unit? Conservative: the box
+//			is treated as the sphere around it.
+//-----------------------------------------------------------------------------
+static bool BoundsInShotCone( const Vector &vecMins, const Vector &vecMaxs, const Vector &vecSrc, const Vector &vecDir, float flRange, float flSpread )
+{
+	Vector vecCenter = ( vecMins + vecMaxs ) * 0.5f;
+	float flRadius = ( vecMaxs - vecCenter ).Length() + TF_LAG_CONE_SLACK;
+
+	float t = DotProduct( vecCenter - vecSrc, vecDir );
+	if ( t < -flRadius || t > flRange + flRadius )
+		return false;
+
+	float flAllowed = flRadius + ( t + flRadius ) * flSpread;
+	t = clamp( t, 0.0f, flRange );
+
+	Vector vecClosest;
+	VectorMA( vecSrc, t, vecDir, vecClosest );
+	return vecCenter.DistToSqr( vecClosest ) <= flAllowed * flAllowed;
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// CTFLagCompensation implementation.
+// ------------------------------------------------------------------------------------------ //
+
+CTFLagCompensation::CTFLagCompensation() : CAutoGameSystemPerFrame( "CTFLagCompensation" )
+{
+	for ( int i=0; i < MAX_EDICTS; i++ )
+	{
+		m_iEntityTrack[i] = -1;
+	}
+
+	m_nFrame = 0;
+	m_nShot = 0;
+	m_bCompensating = false;
+	ResetStats();
+}
+
+
+void CTFLagCompensation::Shutdown()
+{
+	ClearHistory();
+}
+
+
+void CTFLagCompensation::LevelShutdownPostEntity()
+{
+	ClearHistory();
+}
+
+
+void CTFLagCompensation::ClearHistory()
+{
+	for ( int i=0; i < m_Tracks.Count(); i++ )
+	{
+		delete m_Tracks[i];
+	}
+
+	m_Tracks.Purge();
+	m_FreeTracks.Purge();
+
+	for ( int i=0; i < MAX_EDICTS; i++ )
+	{
+		m_iEntityTrack[i] = -1;
+	}
+}
+
+
+int CTFLagCompensation::FindTrack( CBaseEntity *pEntity ) const
+{
+	int iTrack = m_iEntityTrack[pEntity->entindex()];
+	if ( iTrack < 0 || m_Tracks[iTrack]->m_hEntity.Get() != pEntity )
+		return -1;
+
+	return iTrack;
+}
+
+
+int CTFLagCompensation::AllocTrack( CBaseEntity *pEntity, bool bPlayer )
+{
+	int iTrack;
+	if ( m_FreeTracks.Count() )
+	{
+		iTrack = m_FreeTracks.Tail();
+		m_FreeTracks.Remove( m_FreeTracks.Count() - 1 );
+	}
+	else
+	{
+		iTrack = m_Tracks.AddToTail( new LagTrack_t );
+	}
+
+	LagTrack_t *pTrack = m_Tracks[iTrack];
+	pTrack->m_hEntity = pEntity;
+	pTrack->m_bPlayer = bPlayer;
+	pTrack->m_nFrameSeen = m_nFrame;
+	pTrack->m_nShotSeen = 0;
+	pTrack->m_nHead = 0;
+	pTrack->m_nRecords = 0;
+	pTrack->m_flLastChangeTime = 0;
+	pTrack->m_flRadius = 0;
+
+	m_iEntityTrack[pEntity->entindex()] = iTrack;
+	return iTrack;
+}
+
+
+void CTFLagCompensation::FreeTrack( int iTrack )
+{
+	LagTrack_t *pTrack = m_Tracks[iTrack];
+
+	// The entity index might belong to something else by now.
+	for ( int i=0; i < MAX_EDICTS; i++ )
+	{
+		if ( m_iEntityTrack[i] == iTrack )
+		{
+			m_iEntityTrack[i] = -1;
+			break;
+		}
+	}
+
+	pTrack->m_hEntity = NULL;
+	pTrack->m_nFrameSeen = -1;
+	pTrack->m_nRecords = 0;
+	m_FreeTracks.AddToTail( iTrack );
+}
+
+
+void CTFLagCompensation::RecordEntity( CBaseEntity *pEntity, bool bPlayer )
+{
+	int iTrack = FindTrack( pEntity );
+	if ( iTrack < 0 )
+	{
+		// Its index may still point at the track of whatever had it before.
+		int iOld = m_iEntityTrack[pEntity->entindex()];
+		if ( iOld >= 0 )
+		{
+			FreeTrack( iOld );
+		}
+
+		iTrack = AllocTrack( pEntity, bPlayer );
+	}
+
+	LagTrack_t *pTrack = m_Tracks[iTrack];
+	pTrack->m_nFrameSeen = m_nFrame;
+
+	// Objects only bump their simulation time when they move themselves, which leaves big gaps
+	// to interpolate over (and none at all for things riding on a vehicle), so they get a record
+	// every tick.
+	float flSimTime = bPlayer ? pEntity->GetSimulationTime() : max( pEntity->GetSimulationTime(), gpGlobals->curtime );
+
+	// Nothing new since the last record.
+	if ( pTrack->m_nRecords && pTrack->m_flSimTime[pTrack->m_nHead] >= flSimTime )
+		return;
+
+	int iPrev = pTrack->m_nHead;
+	int iSlot = ( pTrack->m_nHead + 1 ) & TF_LAG_HISTORY_MASK;
+
+	CCollisionProperty *pCollision = pEntity->CollisionProp();
+
+	pTrack->m_flSimTime[iSlot]		= flSimTime;
+	pTrack->m_vecAbsOrigin[iSlot]	= pEntity->GetAbsOrigin();
+	pTrack->m_vecOrigin[iSlot]		= pEntity->GetLocalOrigin();
+	pTrack->m_angAngles[iSlot]		= pEntity->GetLocalAngles();
+	pTrack->m_vecMins[iSlot]		= pCollision->OBBMinsPreScaled();
+	pTrack->m_vecMaxs[iSlot]		= pCollision->OBBMaxsPreScaled();
+	pTrack->m_fFlags[iSlot]			= pEntity->IsAlive() ? LAG_ALIVE : 0;
+
+	if ( bPlayer )
+	{
+		CBaseAnimating *pAnimating = pEntity->GetBaseAnimating();
+		pTrack->m_nSequence[iSlot]	= pAnimating->GetSequence();
+		pTrack->m_flCycle[iSlot]	= pAnimating->GetCycle();
+	}
+
+	pTrack->m_flRadius = max( pCollision->OBBMins().Length(), pCollision->OBBMaxs().Length() );
+
+	if ( !pTrack->m_nRecords ||
+		pTrack->m_vecAbsOrigin[iSlot] != pTrack->m_vecAbsOrigin[iPrev] ||
+		pTrack->m_angAngles[iSlot] != pTrack->m_angAngles[iPrev] ||
+		pTrack->m_vecMins[iSlot] != pTrack->m_vecMins[iPrev] ||
+		pTrack->m_vecMaxs[iSlot] != pTrack->m_vecMaxs[iPrev] )
+	{
+		pTrack->m_flLastChangeTime = flSimTime;
+	}
+
+	pTrack->m_nHead = iSlot;
+	pTrack->m_nRecords = min( pTrack->m_nRecords + 1, TF_LAG_HISTORY_SIZE );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Called once per frame after all entities have had a chance to think
+//-----------------------------------------------------------------------------
+void CTFLagCompensation::FrameUpdatePostEntityThink()
+{
+	if ( (gpGlobals->maxClients <= 1) || !sv_unlag.GetBool() )
+	{
+		if ( m_Tracks.Count() )
+		{
+			ClearHistory();
+		}
+		return;
+	}
+
+	VPROF( "CTFLagCompensation::FrameUpdatePostEntityThink" );
+
+	double flStart = Plat_FloatTime();
+	++m_nFrame;
+
+	for ( int i = 1; i <= gpGlobals->maxClients; i++ )
+	{
+		CBasePlayer *pPlayer = UTIL_PlayerByIndex( i );
+		if ( pPlayer )
+		{
+			RecordEntity( pPlayer, true );
+		}
+	}
+
+	if ( tf_lagcomp_objects.GetBool() )
+	{
+		for ( int iTeam = 0; iTeam < GetNumberOfTeams(); iTeam++ )
+		{
+			CTFTeam *pTeam = GetGlobalTFTeam( iTeam );
+			if ( !pTeam )
+				continue;
+
+			for ( int i = 0; i < pTeam->GetNumObjects(); i++ )
+			{
+				CBaseObject *pObject = pTeam->GetObject( i );
+				if ( pObject && pObject->m_takedamage != DAMAGE_NO )
+				{
+					RecordEntity( pObject, false );
+				}
+			}
+		}
+	}
+
+	// Drop the tracks of anything that's gone (or can't be shot any more).
+	for ( int i=0; i < m_Tracks.Count(); i++ )
+	{
+		LagTrack_t *pTrack = m_Tracks[i];
+		if ( pTrack->m_nFrameSeen >= 0 && pTrack->m_nFrameSeen != m_nFrame )
+		{
+			FreeTrack( i );
+		}
+	}
+
+	++m_nStatTicks;
+	m_flStatRecordTime += Plat_FloatTime() - flStart;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: When the shooter saw the world, same as the stock manager works it out.
+//-----------------------------------------------------------------------------
+float CTFLagCompensation::GetTargetTime( CBasePlayer *pShooter ) const
+{
+	float correct = 0.0f;
+
+	INetChannelInfo *nci = engine->GetPlayerNetInfo( pShooter->entindex() );
+	if ( nci )
+	{
+		correct += nci->GetLatency( FLOW_OUTGOING );
+	}
+
+	int lerpTicks = TIME_TO_TICKS( pShooter->m_fLerpTime );
+	correct += TICKS_TO_TIME( lerpTicks );
+	correct = clamp( correct, 0.0f, sv_maxunlag.GetFloat() );
+
+	int targettick = gpGlobals->tickcount - TIME_TO_TICKS( correct );
+
+	// Trust the command's tick when it's close to what the latency says.
+	CUserCmd *pCmd = pShooter->GetCurrentCommand();
+	if ( pCmd )
+	{
+		int cmdtick = pCmd->tick_count - lerpTicks;
+		float deltaTime = correct - TICKS_TO_TIME( gpGlobals->tickcount - cmdtick );
+		if ( fabs( deltaTime ) <= 0.2f )
+		{
+			targettick = cmdtick;
+		}
+	}
+
+	return TICKS_TO_TIME( targettick );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Bounds of everywhere the entity's been between flTargetTime and now.
+//			Returns false if it hasn't moved in that time.
+//-----------------------------------------------------------------------------
+bool CTFLagCompensation::GetSweptBounds( const LagTrack_t *pTrack, float flTargetTime, Vector &vecMins, Vector &vecMaxs ) const
+{
+	if ( !pTrack->m_nRecords || pTrack->m_flLastChangeTime <= flTargetTime )
+		return false;
+
+	vecMins = vecMaxs = pTrack->m_hEntity->GetAbsOrigin();
+
+	for ( int i=0; i < pTrack->m_nRecords; i++ )
+	{
+		int iSlot = ( pTrack->m_nHead - i ) & TF_LAG_HISTORY_MASK;
+		VectorMin( vecMins, pTrack->m_vecAbsOrigin[iSlot], vecMins );
+		VectorMax( vecMaxs, pTrack->m_vecAbsOrigin[iSlot], vecMaxs );
+
+		// This one's at or before the target time, so nothing older matters.
+		if ( pTrack->m_flSimTime[iSlot] <= flTargetTime )
+			break;
+	}
+
+	vecMins -= Vector( pTrack->m_flRadius, pTrack->m_flRadius, pTrack->m_flRadius );
+	vecMaxs += Vector( pTrack->m_flRadius, pTrack->m_flRadius, pTrack->m_flRadius );
+	return true;
+}
+
+
+void CTFLagCompensation::AddToShot( int iTrack )
+{
+	if ( iTrack < 0 || m_Tracks[iTrack]->m_nShotSeen == m_nShot )
+		return;
+
+	m_Tracks[iTrack]->m_nShotSeen = m_nShot;
+	m_ShotTracks.AddToTail( iTrack );
+}
+
+
+bool CTFLagCompensation::StartShot( CBasePlayer *pShooter, const Vector &vecSrc, const Vector &vecDir, float flRange, float flSpread )
+{
+	return StartRewind( pShooter, true, vecSrc, vecDir, flRange, flSpread );
+}
+
+
+void CTFLagCompensation::StartLagCompensation( CBasePlayer *player, CUserCmd *cmd )
+{
+	StartRewind( player, false, vec3_origin, vec3_origin, 0.0f, 0.0f );
+}
+
+
+void CTFLagCompensation::FinishLagCompensation( CBasePlayer *player )
+{
+	if ( m_bCompensating )
+	{
+		FinishShot();
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Moves back what pShooter saw, only what's in the cone if bCone is set.
+//-----------------------------------------------------------------------------
+bool CTFLagCompensation::StartRewind( CBasePlayer *pShooter, bool bCone, const Vector &vecSrc, const Vector &vecDir, float flRange, float flSpread )
+{
+	if ( m_bCompensating || !pShooter )
+		return false;
+
+	if ( !pShooter->m_bLagCompensation		// Player not wanting lag compensation
+		 || (gpGlobals->maxClients <= 1)	// no lag compensation in single player
+		 || !sv_unlag.GetBool()				// disabled by server admin
+		 || pShooter->IsBot()				// not for bots
+		 || pShooter->IsObserver()			// not for spectators
+		)
+		return false;
+
+	VPROF( "CTFLagCompensation::StartRewind" );
+
+	double flStart = Plat_FloatTime();
+
+	++m_nShot;
+	++m_nStatShots;
+	m_ShotTracks.RemoveAll();
+	m_Restore.RemoveAll();
+
+	float flTargetTime = GetTargetTime( pShooter );
+
+	Vector vecShotDir = vecDir;
+	VectorNormalize( vecShotDir );
+
+	// The spread's applied to the direction without renormalizing it, so a spread shot can
+	// go a little further than flRange.
+	float flShotRange = flRange * ( 1.0f + flSpread );
+
+	CBaseEntity *pShooterRoot = pShooter->GetRootMoveParent();
+	const CBitVec<MAX_EDICTS> *pEntityTransmitBits = engine->GetEntityTransmitBitsForClient( pShooter->entindex() - 1 );
+
+	for ( int iTrack=0; iTrack < m_Tracks.Count(); iTrack++ )
+	{
+		LagTrack_t *pTrack = m_Tracks[iTrack];
+		CBaseEntity *pEntity = pTrack->m_hEntity;
+		if ( !pEntity || pEntity == pShooter || pEntity == pShooterRoot )
+			continue;
+
+		// Team members shouldn't be adjusted unless friendly fire is on.
+		if ( !friendlyfire.GetInt() && pEntity->GetTeamNumber() == pShooter->GetTeamNumber() )
+			continue;
+
+		// If this entity hasn't been transmitted to us and acked, then don't bother lag compensating it.
+		if ( pEntityTransmitBits && !pEntityTransmitBits->Get( pEntity->entindex() ) )
+			continue;
+
+		++m_nStatTracksTested;
+
+		Vector vecMins, vecMaxs;
+		if ( !GetSweptBounds( pTrack, flTargetTime, vecMins, vecMaxs ) )
+		{
+			// Hasn't moved, but players still need their animation put back if they're in the way.
+			if ( !pTrack->m_bPlayer )
+				continue;
+
+			pEntity->CollisionProp()->WorldSpaceAABB( &vecMins, &vecMaxs );
+		}
+
+		if ( bCone && !BoundsInShotCone( vecMins, vecMaxs, vecSrc, vecShotDir, flShotRange, flSpread ) )
+			continue;
+
+		++m_nStatTracksInCone;
+		AddToShot( iTrack );
+
+		// Things riding on something only move when it does.
+		if ( pEntity->GetMoveParent() )
+		{
+			CBaseEntity *pRoot = pEntity->GetRootMoveParent();
+			if ( pRoot != pShooterRoot )
+			{
+				AddToShot( FindTrack( pRoot ) );
+			}
+		}
+	}
+
+	for ( int i=0; i < m_ShotTracks.Count(); i++ )
+	{
+		BacktrackEntity( m_ShotTracks[i], flTargetTime );
+	}
+
+	m_nStatTracksRewound += m_Restore.Count();
+	VPROF_INCREMENT_COUNTER( "TFLagComp: shots", 1 );
+	VPROF_INCREMENT_COUNTER( "TFLagComp: entities rewound", m_Restore.Count() );
+
+	double flTime = Plat_FloatTime() - flStart;
+	m_flStatStartTime += flTime;
+	m_flStatMaxShotTime = max( m_flStatMaxShotTime, flTime );
+
+	m_bCompensating = true;
+	return true;
+}
+
+
+void CTFLagCompensation::BacktrackEntity( int iTrack, float flTargetTime )
+{
+	LagTrack_t *pTrack = m_Tracks[iTrack];
+	CBaseEntity *pEntity = pTrack->m_hEntity;
+	if ( !pTrack->m_nRecords )
+		return;
+
+	float flDeadTime = gpGlobals->curtime - sv_maxunlag.GetFloat();
+
+	int iRecord = -1;
+	int iPrevRecord = -1;
+	Vector prevOrg = pEntity->GetLocalOrigin();
+
+	// Walk back looking for the record at the target time, or anything invalidating.
+	for ( int i=0; i < pTrack->m_nRecords; i++ )
+	{
+		int iSlot = ( pTrack->m_nHead - i ) & TF_LAG_HISTORY_MASK;
+		if ( pTrack->m_flSimTime[iSlot] < flDeadTime )
+			break;
+
+		iPrevRecord = iRecord;
+		iRecord = iSlot;
+
+		// Has to have been alive, or we lost track of it.
+		if ( !( pTrack->m_fFlags[iSlot] & LAG_ALIVE ) )
+			return;
+
+		Vector delta = pTrack->m_vecOrigin[iSlot] - prevOrg;
+		if ( delta.Length2DSqr() > TF_LAG_TELEPORT_DIST_SQR )
+			return;
+
+		if ( pTrack->m_flSimTime[iSlot] <= flTargetTime )
+			break;
+
+		prevOrg = pTrack->m_vecOrigin[iSlot];
+	}
+
+	if ( iRecord < 0 )
+		return;
+
+	Vector org, minsPreScaled, maxsPreScaled;
+	QAngle ang;
+
+	float frac = 0.0f;
+	if ( iPrevRecord >= 0 &&
+		 (pTrack->m_flSimTime[iRecord] < flTargetTime) &&
+		 (pTrack->m_flSimTime[iRecord] < pTrack->m_flSimTime[iPrevRecord]) )
+	{
+		// Between two records, so interpolate.
+		frac = ( flTargetTime - pTrack->m_flSimTime[iRecord] ) /
+			( pTrack->m_flSimTime[iPrevRecord] - pTrack->m_flSimTime[iRecord] );
+
+		ang				= Lerp( frac, pTrack->m_angAngles[iRecord], pTrack->m_angAngles[iPrevRecord] );
+		org				= Lerp( frac, pTrack->m_vecOrigin[iRecord], pTrack->m_vecOrigin[iPrevRecord] );
+		minsPreScaled	= Lerp( frac, pTrack->m_vecMins[iRecord], pTrack->m_vecMins[iPrevRecord] );
+		maxsPreScaled	= Lerp( frac, pTrack->m_vecMaxs[iRecord], pTrack->m_vecMaxs[iPrevRecord] );
+	}
+	else
+	{
+		org				= pTrack->m_vecOrigin[iRecord];
+		ang				= pTrack->m_angAngles[iRecord];
+		minsPreScaled	= pTrack->m_vecMins[iRecord];
+		maxsPreScaled	= pTrack->m_vecMaxs[iRecord];
+	}
+
+	LagRestore_t restore;
+	restore.m_iTrack = iTrack;
+	restore.m_fChanged = 0;
+	restore.m_flSimTime = pEntity->GetSimulationTime();
+
+	CCollisionProperty *pCollision = pEntity->CollisionProp();
+
+	if ( ( pEntity->GetLocalAngles() - ang ).LengthSqr() > TF_LAG_EPS_SQR )
+	{
+		restore.m_fChanged |= LAG_ANGLES_CHANGED;
+		restore.m_angAngles = pEntity->GetLocalAngles();
+		restore.m_angChangedAngles = ang;
+		pEntity->SetLocalAngles( ang );
+	}
+
+	if ( minsPreScaled != pCollision->OBBMinsPreScaled() || maxsPreScaled != pCollision->OBBMaxsPreScaled() )
+	{
+		restore.m_fChanged |= LAG_SIZE_CHANGED;
+		restore.m_vecMins = pCollision->OBBMinsPreScaled();
+		restore.m_vecMaxs = pCollision->OBBMaxsPreScaled();
+		restore.m_vecChangedMins = minsPreScaled;
+		restore.m_vecChangedMaxs = maxsPreScaled;
+		pEntity->SetSize( minsPreScaled, maxsPreScaled );
+	}
+
+	// Origin last, since it relinks.
+	if ( ( pEntity->GetLocalOrigin() - org ).LengthSqr() > TF_LAG_EPS_SQR )
+	{
+		restore.m_fChanged |= LAG_ORIGIN_CHANGED;
+		restore.m_vecOrigin = pEntity->GetLocalOrigin();
+		restore.m_vecChangedOrigin = org;
+		pEntity->SetLocalOrigin( org );
+	}
+
+	// Players' hitboxes follow their animation. Objects are shot at their collision models.
+	if ( pTrack->m_bPlayer )
+	{
+		CBaseAnimating *pAnimating = pEntity->GetBaseAnimating();
+
+		restore.m_fChanged |= LAG_ANIMATION_CHANGED;
+		restore.m_nSequence = pAnimating->GetSequence();
+		restore.m_flCycle = pAnimating->GetCycle();
+
+		if ( frac > 0.0f && pTrack->m_nSequence[iRecord] == pTrack->m_nSequence[iPrevRecord] )
+		{
+			float flCycle = pTrack->m_flCycle[iRecord];
+			float flPrevCycle = pTrack->m_flCycle[iPrevRecord];
+
+			// The older one being further along means it wrapped around.
+			if ( flCycle > flPrevCycle )
+			{
+				flPrevCycle += 1.0f;
+			}
+
+			flCycle = Lerp( frac, flCycle, flPrevCycle );
+			pAnimating->SetSequence( pTrack->m_nSequence[iRecord] );
+			pAnimating->SetCycle( flCycle < 1.0f ? flCycle : flCycle - 1.0f );
+		}
+		else
+		{
+			pAnimating->SetSequence( pTrack->m_nSequence[iRecord] );
+			pAnimating->SetCycle( pTrack->m_flCycle[iRecord] );
+		}
+
+		if ( sv_lagflushbonecache.GetBool() )
+		{
+			pAnimating->InvalidateBoneCache();
+		}
+	}
+
+	if ( restore.m_fChanged )
+	{
+		m_Restore.AddToTail( restore );
+	}
+}
+
+
+void CTFLagCompensation::FinishShot()
+{
+	Assert( m_bCompensating );
+	if ( !m_bCompensating )
+		return;
+
+	VPROF( "CTFLagCompensation::FinishShot" );
+
+	double flStart = Plat_FloatTime();
+
+	for ( int i = m_Restore.Count(); --i >= 0; )
+	{
+		const LagRestore_t &restore = m_Restore[i];
+		CBaseEntity *pEntity = m_Tracks[restore.m_iTrack]->m_hEntity;
+		if ( !pEntity )
+			continue;
+
+		CCollisionProperty *pCollision = pEntity->CollisionProp();
+
+		// Leave anything the shot itself changed.
+		if ( restore.m_fChanged & LAG_SIZE_CHANGED )
+		{
+			if ( pCollision->OBBMinsPreScaled() == restore.m_vecChangedMins &&
+				pCollision->OBBMaxsPreScaled() == restore.m_vecChangedMaxs )
+			{
+				pEntity->SetSize( restore.m_vecMins, restore.m_vecMaxs );
+			}
+		}
+
+		if ( restore.m_fChanged & LAG_ANGLES_CHANGED )
+		{
+			if ( pEntity->GetLocalAngles() == restore.m_angChangedAngles )
+			{
+				pEntity->SetLocalAngles( restore.m_angAngles );
+			}
+		}
+
+		if ( restore.m_fChanged & LAG_ORIGIN_CHANGED )
+		{
+			// Keep whatever the shot did to it, unless that was a teleport.
+			Vector delta = pEntity->GetLocalOrigin() - restore.m_vecChangedOrigin;
+			if ( delta.Length2DSqr() < TF_LAG_TELEPORT_DIST_SQR )
+			{
+				pEntity->SetLocalOrigin( restore.m_vecOrigin + delta );
+			}
+		}
+
+		if ( restore.m_fChanged & LAG_ANIMATION_CHANGED )
+		{
+			CBaseAnimating *pAnimating = pEntity->GetBaseAnimating();
+			pAnimating->SetSequence( restore.m_nSequence );
+			pAnimating->SetCycle( restore.m_flCycle );
+
+			if ( sv_lagflushbonecache.GetBool() )
+			{
+				pAnimating->InvalidateBoneCache();
+			}
+		}
+
+		pEntity->SetSimulationTime( restore.m_flSimTime );
+	}
+
+	m_Restore.RemoveAll();
+	m_ShotTracks.RemoveAll();
+	m_bCompensating = false;
+
+	double flTime = Plat_FloatTime() - flStart;
+	m_flStatFinishTime += flTime;
+}
+
+
+void CTFLagCompensation::ResetStats()
+{
+	m_nStatTicks = 0;
+	m_nStatShots = 0;
+	m_nStatTracksTested = 0;
+	m_nStatTracksInCone = 0;
+	m_nStatTracksRewound = 0;
+	m_flStatRecordTime = 0;
+	m_flStatStartTime = 0;
+	m_flStatFinishTime = 0;
+	m_flStatMaxShotTime = 0;
+}
+
+
+void CTFLagCompensation::PrintStats()
+{
+	int nTracks = m_Tracks.Count() - m_FreeTracks.Count();
+	int nTicks = max( m_nStatTicks, 1 );
+	int nShots = max( m_nStatShots, 1 );
+
+	Msg( "Lag compensation: %d entities tracked (%d KB of history), %d shots over %d ticks\n",
+		nTracks, ( m_Tracks.Count() * (int)sizeof( LagTrack_t ) ) / 1024, m_nStatShots, m_nStatTicks );
+	Msg( "    record:  avg %.3f ms/tick\n", m_flStatRecordTime * 1000.0 / nTicks );
+	Msg( "    per shot: %.2f tested, %.2f in the cone, %.2f rewound\n",
+		(float)m_nStatTracksTested / nShots, (float)m_nStatTracksInCone / nShots, (float)m_nStatTracksRewound / nShots );
+	Msg( "    per shot: avg %.4f ms rewind, %.4f ms restore, max %.4f ms rewind\n",
+		m_flStatStartTime * 1000.0 / nShots, m_flStatFinishTime * 1000.0 / nShots, m_flStatMaxShotTime * 1000.0 );
+}
+
+
+static void CC_TFLagCompStats( const CCommand &args )
+{
+	GetTFLagCompensation()->PrintStats();
+
+	if ( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) )
+	{
+		GetTFLagCompensation()->ResetStats();
+	}
+}
+
+static ConCommand tf_lagcomp_stats( "tf_lagcomp_stats", CC_TFLagCompStats, "Print how many entities fortress lag compensation tracks and rewinds per shot, and how long it takes. Pass 'reset' to clear them afterwards." );
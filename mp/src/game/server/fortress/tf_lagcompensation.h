@@ -0,0 +1,177 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Lag compensation for fortress hitscan: players, vehicles and objects.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef TF_LAGCOMPENSATION_H
+#define TF_LAGCOMPENSATION_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "igamesystem.h"
+#include "ilagcompensationmanager.h"
+#include "utlvector.h"
+#include "ehandle.h"
+
+
+class CBasePlayer;
+
+
+// Records kept per entity. Has to cover sv_maxunlag at the tick rate, so 128 is good up to
+// 128 tick; past that the rewind gets clamped to the oldest record.
+#define TF_LAG_HISTORY_BITS		7
+#define TF_LAG_HISTORY_SIZE		(1 << TF_LAG_HISTORY_BITS)
+#define TF_LAG_HISTORY_MASK		(TF_LAG_HISTORY_SIZE - 1)
+
+
+// ------------------------------------------------------------------------------------------ //
+// CTFLagCompensation.
+//
+// The stock lag compensation manager only knows about players and nothing in fortress ever
+// called it, so it isn't built into this game; this one replaces it as lagcompensation and is
+// the only player history kept. It also tracks vehicles and anything else built that can be
+// shot, and is driven per shot from CTeamFortress::FireBullets and WeaponTraceLine.
+//
+// Every tick after entities think, each tracked entity gets a record in its own fixed ring:
+// players whenever their simulation time moves on, objects every tick, since they only touch
+// their simulation time when they move themselves.
+// The rings are split into one array per field, so working out how far something has moved
+// over the rewind window only touches its times and origins.
+//
+// A shot passes in its cone (source, direction, range, spread). Only entities whose bounds,
+// swept over the rewind window, touch the cone get moved back; FinishShot puts them back.
+// ------------------------------------------------------------------------------------------ //
+
+class CTFLagCompensation : public CAutoGameSystemPerFrame, public ILagCompensationManager
+{
+public:
+	CTFLagCompensation();
+
+// Overrides.
+public:
+
+	virtual void	Shutdown();
+	virtual void	LevelShutdownPostEntity();
+	virtual void	FrameUpdatePostEntityThink();
+
+	// ILagCompensationManager. Without a shot to go on, everything the player can see is rewound.
+	virtual void	StartLagCompensation( CBasePlayer *player, CUserCmd *cmd );
+	virtual void	FinishLagCompensation( CBasePlayer *player );
+	virtual bool	IsCurrentlyDoingLagCompensation() const	{ return m_bCompensating; }
+
+
+public:
+
+	// Moves everything in the shot's cone back to where pShooter saw it. Returns false if
+	// nothing needs to be done (or a shot is already being compensated), in which case
+	// FinishShot mustn't be called. flSpread is the tangent of the cone's half angle.
+	bool			StartShot( CBasePlayer *pShooter, const Vector &vecSrc, const Vector &vecDir, float flRange, float flSpread );
+	void			FinishShot();
+
+	bool			IsCompensating() const	{ return m_bCompensating; }
+
+	// Stats for tf_lagcomp_stats.
+	void			PrintStats();
+	void			ResetStats();
+
+
+private:
+
+	enum
+	{
+		LAG_ALIVE			= (1<<0),
+	};
+
+	enum
+	{
+		LAG_ORIGIN_CHANGED		= (1<<0),
+		LAG_ANGLES_CHANGED		= (1<<1),
+		LAG_SIZE_CHANGED		= (1<<2),
+		LAG_ANIMATION_CHANGED	= (1<<3),
+	};
+
+	struct LagTrack_t
+	{
+		EHANDLE			m_hEntity;
+		bool			m_bPlayer;
+		int				m_nFrameSeen;
+		int				m_nShotSeen;		// So an entity only gets moved once per shot.
+		int				m_nHead;			// Slot of the newest record.
+		int				m_nRecords;
+		float			m_flLastChangeTime;	// Sim time of the first record in its current place.
+		float			m_flRadius;			// Bounds radius around the origin, at any angle.
+
+		float			m_flSimTime[TF_LAG_HISTORY_SIZE];
+		Vector			m_vecAbsOrigin[TF_LAG_HISTORY_SIZE];
+		Vector			m_vecOrigin[TF_LAG_HISTORY_SIZE];
+		QAngle			m_angAngles[TF_LAG_HISTORY_SIZE];
+		Vector			m_vecMins[TF_LAG_HISTORY_SIZE];
+		Vector			m_vecMaxs[TF_LAG_HISTORY_SIZE];
+		int				m_nSequence[TF_LAG_HISTORY_SIZE];
+		float			m_flCycle[TF_LAG_HISTORY_SIZE];
+		unsigned char	m_fFlags[TF_LAG_HISTORY_SIZE];
+	};
+
+	// What an entity was like before the rewind, and what the rewind changed it to.
+	struct LagRestore_t
+	{
+		int				m_iTrack;
+		int				m_fChanged;
+		float			m_flSimTime;
+		Vector			m_vecOrigin;
+		Vector			m_vecChangedOrigin;
+		QAngle			m_angAngles;
+		QAngle			m_angChangedAngles;
+		Vector			m_vecMins;
+		Vector			m_vecMaxs;
+		Vector			m_vecChangedMins;
+		Vector			m_vecChangedMaxs;
+		int				m_nSequence;
+		float			m_flCycle;
+	};
+
+	void			ClearHistory();
+	int				FindTrack( CBaseEntity *pEntity ) const;
+	int				AllocTrack( CBaseEntity *pEntity, bool bPlayer );
+	void			FreeTrack( int iTrack );
+	void			RecordEntity( CBaseEntity *pEntity, bool bPlayer );
+
+	bool			StartRewind( CBasePlayer *pShooter, bool bCone, const Vector &vecSrc, const Vector &vecDir, float flRange, float flSpread );
+	float			GetTargetTime( CBasePlayer *pShooter ) const;
+	bool			GetSweptBounds( const LagTrack_t *pTrack, float flTargetTime, Vector &vecMins, Vector &vecMaxs ) const;
+	void			AddToShot( int iTrack );
+	void			BacktrackEntity( int iTrack, float flTargetTime );
+
+
+private:
+
+	CUtlVector<LagTrack_t*>		m_Tracks;
+	CUtlVector<int>				m_FreeTracks;
+	short						m_iEntityTrack[MAX_EDICTS];
+	int							m_nFrame;
+
+	bool						m_bCompensating;
+	int							m_nShot;
+	CUtlVector<int>				m_ShotTracks;	// Tracks in the current shot's cone.
+	CUtlVector<LagRestore_t>	m_Restore;
+
+	int							m_nStatTicks;
+	int							m_nStatShots;
+	int							m_nStatTracksTested;
+	int							m_nStatTracksInCone;
+	int							m_nStatTracksRewound;
+	double						m_flStatRecordTime;
+	double						m_flStatStartTime;
+	double						m_flStatFinishTime;
+	double						m_flStatMaxShotTime;
+};
+
+
+CTFLagCompensation* GetTFLagCompensation();
+
+
+#endif // TF_LAGCOMPENSATION_H
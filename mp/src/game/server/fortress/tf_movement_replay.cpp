@@ -0,0 +1,496 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Records player movement and replays it through the game movement code to
+//			check the results and time it.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "tf_movement_replay.h"
+#include "tf_player.h"
+#include "tf_shareddefs.h"
+#include "igamemovement.h"
+#include "movehelper_server.h"
+#include "filesystem.h"
+#include "tier0/fasttimer.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+#define MOVEMENT_REPLAY_MAGIC		MAKEID( 'T', 'F', 'M', 'R' )
+#define MOVEMENT_REPLAY_VERSION		1
+
+// How many mismatched moves get printed before it just counts them.
+#define MOVEMENT_REPLAY_MAX_REPORTS	10
+
+// Recordings only ever live here, as <name>.tfmr.
+#define MOVEMENT_REPLAY_DIR			"movement_replays"
+#define MOVEMENT_REPLAY_EXTENSION	"tfmr"
+
+
+ConVar tf_movement_replay_tolerance( "tf_movement_replay_tolerance", "0.01", 0, "How far (in units, and units/sec for velocity) a replayed move can be from the recording before it counts as a mismatch." );
+
+
+CBasePlayer *BotPutInServer( bool bFrozen, int iTeam, int iClass );
+extern IGameMovement *g_pGameMovement;
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Turns a recording name into its path under MOVEMENT_REPLAY_DIR.
+//			Only plain names are allowed (letters, digits, '_' and '-'), so
+//			nothing can escape the directory or pick its own extension.
+//-----------------------------------------------------------------------------
+static bool MovementReplayPath( const char *pName, char *pPath, int nPathSize )
+{
+	int nLength = Q_strlen( pName );
+	if ( nLength == 0 || nLength > 64 )
+		return false;
+
+	for ( const char *pChar = pName; *pChar; ++pChar )
+	{
+		if ( !V_isalnum( *pChar ) && *pChar != '_' && *pChar != '-' )
+			return false;
+	}
+
+	Q_snprintf( pPath, nPathSize, "%s/%s.%s", MOVEMENT_REPLAY_DIR, pName, MOVEMENT_REPLAY_EXTENSION );
+	return true;
+}
+
+
+struct MovementReplayHeader_t
+{
+	int		m_nMagic;
+	int		m_nVersion;
+	int		m_nMoveSize;		// sizeof( Move_t ) when it was recorded.
+	int		m_nMoves;
+	char	m_szMap[64];
+};
+
+
+CTFMovementReplay g_TFMovementReplay;
+
+CTFMovementReplay* TFMovementReplay()
+{
+	return &g_TFMovementReplay;
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// CTFMovementReplay implementation.
+// ------------------------------------------------------------------------------------------ //
+
+CTFMovementReplay::CTFMovementReplay() : CAutoGameSystem( "CTFMovementReplay" )
+{
+	m_szRecordFile[0] = 0;
+	m_nRecordMaxMoves = 0;
+	m_bMovePending = false;
+}
+
+
+void CTFMovementReplay::LevelShutdownPreEntity()
+{
+	// Write out what we have before the player goes away.
+	if ( m_hRecordPlayer.Get() )
+	{
+		StopRecording();
+	}
+
+	m_hRecordPlayer = NULL;
+	m_hReplayBot = NULL;
+	m_Moves.Purge();
+}
+
+
+void CTFMovementReplay::SaveState( CBaseTFPlayer *pPlayer, PlayerState_t &state )
+{
+	CBaseEntity *pGround = pPlayer->GetGroundEntity();
+
+	state.m_fFlags = pPlayer->GetFlags();
+	state.m_iGroundEntity = pGround ? pGround->entindex() : -1;
+	state.m_MoveType = pPlayer->GetMoveType();
+	state.m_nWaterLevel = pPlayer->GetWaterLevel();
+	state.m_bDucked = pPlayer->m_Local.m_bDucked;
+	state.m_bDucking = pPlayer->m_Local.m_bDucking;
+	state.m_flDucktime = pPlayer->m_Local.m_flDucktime;
+	state.m_flFallVelocity = pPlayer->m_Local.m_flFallVelocity;
+	state.m_flStepSize = pPlayer->m_Local.m_flStepSize;
+	state.m_flWaterJumpTime = pPlayer->m_flWaterJumpTime;
+	state.m_surfaceFriction = pPlayer->m_surfaceFriction;
+	state.m_vecBaseVelocity = pPlayer->GetBaseVelocity();
+	state.m_vecViewOffset = pPlayer->GetViewOffset();
+}
+
+
+void CTFMovementReplay::RestoreState( CBaseTFPlayer *pPlayer, const PlayerState_t &state )
+{
+	// This touches FL_ONGROUND, so do it before the flags.
+	pPlayer->SetGroundEntity( state.m_iGroundEntity >= 0 ? CBaseEntity::Instance( state.m_iGroundEntity ) : NULL );
+
+	pPlayer->ClearFlags();
+	pPlayer->AddFlag( state.m_fFlags );
+	pPlayer->SetMoveType( (MoveType_t)state.m_MoveType );
+	pPlayer->SetWaterLevel( state.m_nWaterLevel );
+	pPlayer->m_Local.m_bDucked = state.m_bDucked;
+	pPlayer->m_Local.m_bDucking = state.m_bDucking;
+	pPlayer->m_Local.m_flDucktime = state.m_flDucktime;
+	pPlayer->m_Local.m_flFallVelocity = state.m_flFallVelocity;
+	pPlayer->m_Local.m_flStepSize = state.m_flStepSize;
+	pPlayer->m_flWaterJumpTime = state.m_flWaterJumpTime;
+	pPlayer->m_surfaceFriction = state.m_surfaceFriction;
+	pPlayer->SetBaseVelocity( state.m_vecBaseVelocity );
+	pPlayer->SetViewOffset( state.m_vecViewOffset );
+}
+
+
+void CTFMovementReplay::OnSetupMove( CBaseTFPlayer *pPlayer, CTFMoveData *pMove )
+{
+	if ( m_hRecordPlayer.Get() != pPlayer )
+		return;
+
+	// The vehicles do their own thing with the move data, and dead players don't move.
+	m_bMovePending = false;
+	if ( pPlayer->IsInAVehicle() || pPlayer->pl.deadflag || pMove->m_nClassID == TFCLASS_UNDECIDED )
+		return;
+
+	Move_t &move = m_Moves[m_Moves.AddToTail()];
+	move.m_flCurTime = gpGlobals->curtime;
+	move.m_flFrameTime = gpGlobals->frametime;
+	SaveState( pPlayer, move.m_State );
+	move.m_Move = *pMove;
+
+	m_bMovePending = true;
+}
+
+
+void CTFMovementReplay::OnFinishMove( CBaseTFPlayer *pPlayer, CTFMoveData *pMove )
+{
+	if ( !m_bMovePending || m_hRecordPlayer.Get() != pPlayer )
+		return;
+
+	Move_t &move = m_Moves.Tail();
+	move.m_vecEndOrigin = pMove->GetAbsOrigin();
+	move.m_vecEndVelocity = pMove->m_vecVelocity;
+	m_bMovePending = false;
+
+	if ( m_Moves.Count() >= m_nRecordMaxMoves )
+	{
+		StopRecording();
+	}
+}
+
+
+void CTFMovementReplay::StartRecording( CBaseTFPlayer *pPlayer, const char *pFilename, int nMaxMoves )
+{
+	char szPath[MAX_PATH];
+	if ( !MovementReplayPath( pFilename, szPath, sizeof( szPath ) ) )
+	{
+		Warning( "tf_movement_record: bad name '%s' (use letters, digits, '_' and '-' only).\n", pFilename );
+		return;
+	}
+
+	if ( m_hRecordPlayer.Get() )
+	{
+		StopRecording();
+	}
+
+	Q_strncpy( m_szRecordFile, szPath, sizeof( m_szRecordFile ) );
+	m_nRecordMaxMoves = nMaxMoves;
+	m_bMovePending = false;
+	m_Moves.Purge();
+	m_hRecordPlayer = pPlayer;
+
+	Msg( "tf_movement_record: recording %s into %s (up to %d moves).\n", pPlayer->GetPlayerName(), m_szRecordFile, m_nRecordMaxMoves );
+}
+
+
+void CTFMovementReplay::StopRecording()
+{
+	if ( !m_hRecordPlayer.Get() )
+		return;
+
+	m_hRecordPlayer = NULL;
+
+	// Drop a move that never finished.
+	if ( m_bMovePending )
+	{
+		m_Moves.RemoveMultiple( m_Moves.Count() - 1, 1 );
+		m_bMovePending = false;
+	}
+
+	filesystem->CreateDirHierarchy( MOVEMENT_REPLAY_DIR, "MOD" );
+	FileHandle_t hFile = filesystem->Open( m_szRecordFile, "wb", "MOD" );
+	if ( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( "tf_movement_record: couldn't open %s for writing.\n", m_szRecordFile );
+		m_Moves.Purge();
+		return;
+	}
+
+	MovementReplayHeader_t header;
+	memset( &header, 0, sizeof( header ) );
+	header.m_nMagic = MOVEMENT_REPLAY_MAGIC;
+	header.m_nVersion = MOVEMENT_REPLAY_VERSION;
+	header.m_nMoveSize = sizeof( Move_t );
+	header.m_nMoves = m_Moves.Count();
+	Q_strncpy( header.m_szMap, STRING( gpGlobals->mapname ), sizeof( header.m_szMap ) );
+
+	filesystem->Write( &header, sizeof( header ), hFile );
+	filesystem->Write( m_Moves.Base(), m_Moves.Count() * sizeof( Move_t ), hFile );
+	filesystem->Close( hFile );
+
+	Msg( "tf_movement_record: wrote %d moves to %s.\n", m_Moves.Count(), m_szRecordFile );
+	m_Moves.Purge();
+}
+
+
+bool CTFMovementReplay::Load( const char *pFilename )
+{
+	m_Moves.Purge();
+
+	char szPath[MAX_PATH];
+	if ( !MovementReplayPath( pFilename, szPath, sizeof( szPath ) ) )
+	{
+		Warning( "tf_movement_replay: bad name '%s' (use letters, digits, '_' and '-' only).\n", pFilename );
+		return false;
+	}
+
+	FileHandle_t hFile = filesystem->Open( szPath, "rb", "MOD" );
+	if ( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( "tf_movement_replay: couldn't open %s.\n", szPath );
+		return false;
+	}
+
+	MovementReplayHeader_t header;
+	bool bValid = ( filesystem->Read( &header, sizeof( header ), hFile ) == sizeof( header ) ) &&
+		( header.m_nMagic == MOVEMENT_REPLAY_MAGIC ) &&
+		( header.m_nVersion == MOVEMENT_REPLAY_VERSION ) &&
+		( header.m_nMoves >= 0 );
+
+	if ( !bValid )
+	{
+		Warning( "tf_movement_replay: %s isn't a movement recording.\n", pFilename );
+	}
+	else if ( header.m_nMoveSize != sizeof( Move_t ) )
+	{
+		Warning( "tf_movement_replay: %s was recorded with a different CTFMoveData, record it again.\n", pFilename );
+		bValid = false;
+	}
+	else if ( Q_stricmp( header.m_szMap, STRING( gpGlobals->mapname ) ) )
+	{
+		Warning( "tf_movement_replay: %s was recorded on %s, not %s.\n", pFilename, header.m_szMap, STRING( gpGlobals->mapname ) );
+		bValid = false;
+	}
+	else
+	{
+		m_Moves.SetCount( header.m_nMoves );
+		int nBytes = header.m_nMoves * sizeof( Move_t );
+		if ( filesystem->Read( m_Moves.Base(), nBytes, hFile ) != nBytes )
+		{
+			Warning( "tf_movement_replay: %s is truncated.\n", pFilename );
+			bValid = false;
+		}
+	}
+
+	filesystem->Close( hFile );
+
+	if ( !bValid )
+	{
+		m_Moves.Purge();
+	}
+
+	return bValid;
+}
+
+
+CBaseTFPlayer* CTFMovementReplay::GetReplayBot()
+{
+	if ( !m_hReplayBot.Get() )
+	{
+		m_hReplayBot = (CBaseTFPlayer*)BotPutInServer( true, TEAM_HUMANS, -1 );
+	}
+
+	return m_hReplayBot.Get();
+}
+
+
+void CTFMovementReplay::Replay( const char *pFilename, int nPasses )
+{
+	if ( m_hRecordPlayer.Get() )
+	{
+		Msg( "tf_movement_replay: stop recording first.\n" );
+		return;
+	}
+
+	if ( !Load( pFilename ) || !m_Moves.Count() )
+		return;
+
+	CBaseTFPlayer *pBot = GetReplayBot();
+	if ( !pBot )
+	{
+		Warning( "tf_movement_replay: couldn't add a bot to replay with.\n" );
+		m_Moves.Purge();
+		return;
+	}
+
+	int nMoves[TFCLASS_CLASS_COUNT];
+	int nMismatches[TFCLASS_CLASS_COUNT];
+	float flMaxError[TFCLASS_CLASS_COUNT];
+	double flMicroseconds[TFCLASS_CLASS_COUNT];
+	memset( nMoves, 0, sizeof( nMoves ) );
+	memset( nMismatches, 0, sizeof( nMismatches ) );
+	memset( flMaxError, 0, sizeof( flMaxError ) );
+	memset( flMicroseconds, 0, sizeof( flMicroseconds ) );
+
+	float flSaveCurTime = gpGlobals->curtime;
+	float flSaveFrameTime = gpGlobals->frametime;
+	float flTolerance = tf_movement_replay_tolerance.GetFloat();
+	int nReports = 0;
+
+	CTFMoveData move;
+	MoveHelperServer()->SetHost( pBot );
+
+	for ( int iPass = 0; iPass < nPasses; iPass++ )
+	{
+		for ( int i = 0; i < m_Moves.Count(); i++ )
+		{
+			const Move_t &recorded = m_Moves[i];
+			int iClass = recorded.m_Move.m_nClassID;
+			if ( iClass <= TFCLASS_UNDECIDED || iClass >= TFCLASS_CLASS_COUNT )
+				continue;
+
+			gpGlobals->curtime = recorded.m_flCurTime;
+			gpGlobals->frametime = recorded.m_flFrameTime;
+			RestoreState( pBot, recorded.m_State );
+
+			// The traces skip the player the move belongs to, which is the bot now.
+			move = recorded.m_Move;
+			move.m_nPlayerHandle = pBot->GetRefEHandle();
+
+			CFastTimer timer;
+			timer.Start();
+			g_pGameMovement->ProcessMovement( pBot, &move );
+			timer.End();
+			flMicroseconds[iClass] += timer.GetDuration().GetMicrosecondsF();
+
+			if ( iPass > 0 )
+				continue;
+
+			++nMoves[iClass];
+
+			float flError = MAX( move.GetAbsOrigin().DistTo( recorded.m_vecEndOrigin ), move.m_vecVelocity.DistTo( recorded.m_vecEndVelocity ) );
+			flMaxError[iClass] = MAX( flMaxError[iClass], flError );
+			if ( flError > flTolerance )
+			{
+				++nMismatches[iClass];
+				if ( nReports++ < MOVEMENT_REPLAY_MAX_REPORTS )
+				{
+					Msg( "    move %d (%s): ended at (%.2f %.2f %.2f) vel (%.2f %.2f %.2f), recorded (%.2f %.2f %.2f) vel (%.2f %.2f %.2f)\n",
+						i, GetTFClassInfo( iClass )->m_pClassName,
+						move.GetAbsOrigin().x, move.GetAbsOrigin().y, move.GetAbsOrigin().z,
+						move.m_vecVelocity.x, move.m_vecVelocity.y, move.m_vecVelocity.z,
+						recorded.m_vecEndOrigin.x, recorded.m_vecEndOrigin.y, recorded.m_vecEndOrigin.z,
+						recorded.m_vecEndVelocity.x, recorded.m_vecEndVelocity.y, recorded.m_vecEndVelocity.z );
+				}
+			}
+		}
+	}
+
+	MoveHelperServer()->SetHost( NULL );
+	gpGlobals->curtime = flSaveCurTime;
+	gpGlobals->frametime = flSaveFrameTime;
+
+	int nTotalMoves = 0;
+	int nTotalMismatches = 0;
+	Msg( "tf_movement_replay: %s, %d moves, %d passes\n", pFilename, m_Moves.Count(), nPasses );
+	for ( int iClass = TFCLASS_UNDECIDED + 1; iClass < TFCLASS_CLASS_COUNT; iClass++ )
+	{
+		if ( !nMoves[iClass] )
+			continue;
+
+		Msg( "    %-12s %6d moves, %4d mismatched (max error %.3f), %.0f ns/move\n",
+			GetTFClassInfo( iClass )->m_pClassName, nMoves[iClass], nMismatches[iClass], flMaxError[iClass],
+			flMicroseconds[iClass] * 1000.0 / ( (double)nMoves[iClass] * nPasses ) );
+
+		nTotalMoves += nMoves[iClass];
+		nTotalMismatches += nMismatches[iClass];
+	}
+
+	if ( nTotalMismatches )
+	{
+		Msg( "tf_movement_replay: FAIL (%d of %d moves mismatched)\n", nTotalMismatches, nTotalMoves );
+	}
+	else
+	{
+		Msg( "tf_movement_replay: PASS\n" );
+	}
+
+	m_Moves.Purge();
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// Commands.
+// ------------------------------------------------------------------------------------------ //
+
+static void CC_MovementRecord( const CCommand &args )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	if ( args.ArgC() < 2 )
+	{
+		Msg( "Usage: tf_movement_record <name> [max moves]\n" );
+		return;
+	}
+
+	// From the dedicated server console, record the first real player.
+	CBasePlayer *pPlayer = UTIL_GetCommandClient();
+	for ( int i = 1; !pPlayer && i <= gpGlobals->maxClients; i++ )
+	{
+		CBasePlayer *pTest = UTIL_PlayerByIndex( i );
+		if ( pTest && !pTest->IsBot() )
+		{
+			pPlayer = pTest;
+		}
+	}
+
+	if ( !pPlayer )
+	{
+		Msg( "tf_movement_record: nobody to record.\n" );
+		return;
+	}
+
+	int nMaxMoves = args.ArgC() > 2 ? MAX( atoi( args[2] ), 1 ) : 10000;
+	TFMovementReplay()->StartRecording( (CBaseTFPlayer*)pPlayer, args[1], nMaxMoves );
+}
+
+static ConCommand tf_movement_record( "tf_movement_record", CC_MovementRecord, "Record your movement (or the first player's, from the server console) into " MOVEMENT_REPLAY_DIR "/<name>." MOVEMENT_REPLAY_EXTENSION " for tf_movement_replay.", FCVAR_CHEAT );
+
+
+static void CC_MovementRecordStop( const CCommand &args )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	TFMovementReplay()->StopRecording();
+}
+
+static ConCommand tf_movement_record_stop( "tf_movement_record_stop", CC_MovementRecordStop, "Stop tf_movement_record and write the file.", FCVAR_CHEAT );
+
+
+static void CC_MovementReplay( const CCommand &args )
+{
+	if ( args.ArgC() < 2 )
+	{
+		Msg( "Usage: tf_movement_replay <name> [passes]\n" );
+		return;
+	}
+
+	int nPasses = args.ArgC() > 2 ? clamp( atoi( args[2] ), 1, 1000 ) : 1;
+	TFMovementReplay()->Replay( args[1], nPasses );
+}
+
+static ConCommand tf_movement_replay( "tf_movement_replay", CC_MovementReplay, "Replay a tf_movement_record file through the class movement code on a bot, check where each move ends up and time it.", FCVAR_CHEAT );
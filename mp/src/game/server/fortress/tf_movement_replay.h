@@ -0,0 +1,123 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Records player movement and replays it through the game movement code to
+//			check the results and time it.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef TF_MOVEMENT_REPLAY_H
+#define TF_MOVEMENT_REPLAY_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "igamesystem.h"
+#include "utlvector.h"
+#include "ehandle.h"
+#include "tf_movedata.h"
+
+
+class CBaseTFPlayer;
+
+
+// ------------------------------------------------------------------------------------------ //
+// CTFMovementReplay.
+//
+// tf_movement_record grabs every usercmd one player runs: the CTFMoveData that SetupMove
+// built, the bits of player state the movement code reads, and where the move ended up.
+// tf_movement_replay loads a recording and feeds each move back through g_pGameMovement on
+// a bot, one move at a time from its recorded starting point, so a bad move doesn't throw
+// off the rest. It reports the moves that don't end up where they did when recorded and
+// how long each class's moves take.
+//
+// It only needs a server with the recording's map loaded, so it runs fine on a dedicated
+// server with nobody connected:
+//
+//     srcds -game tf2 +map <map> +tf_movement_replay <file> 20 +quit
+//
+// Recordings are raw CTFMoveData, so they have to be made again after it changes.
+// ------------------------------------------------------------------------------------------ //
+
+class CTFMovementReplay : public CAutoGameSystem
+{
+public:
+	CTFMovementReplay();
+
+// Overrides.
+public:
+
+	virtual void	LevelShutdownPreEntity();
+
+
+public:
+
+	// Called by CTFPlayerMove around each command.
+	void			OnSetupMove( CBaseTFPlayer *pPlayer, CTFMoveData *pMove );
+	void			OnFinishMove( CBaseTFPlayer *pPlayer, CTFMoveData *pMove );
+
+	// pFilename is a bare recording name, kept under movement_replays/ (see MovementReplayPath).
+	void			StartRecording( CBaseTFPlayer *pPlayer, const char *pFilename, int nMaxMoves );
+	void			StopRecording();
+
+	// Replays the file nPasses times. Only the first pass is checked against the recording,
+	// all of them are timed.
+	void			Replay( const char *pFilename, int nPasses );
+
+
+private:
+
+	// The player state (outside of CMoveData) that the movement code reads.
+	struct PlayerState_t
+	{
+		int			m_fFlags;
+		int			m_iGroundEntity;	// Entity index, -1 for none.
+		int			m_MoveType;
+		int			m_nWaterLevel;
+		bool		m_bDucked;
+		bool		m_bDucking;
+		float		m_flDucktime;
+		float		m_flFallVelocity;
+		float		m_flStepSize;
+		float		m_flWaterJumpTime;
+		float		m_surfaceFriction;
+		Vector		m_vecBaseVelocity;
+		Vector		m_vecViewOffset;
+	};
+
+	struct Move_t
+	{
+		float			m_flCurTime;
+		float			m_flFrameTime;
+		PlayerState_t	m_State;
+		CTFMoveData		m_Move;			// As SetupMove left it.
+		Vector			m_vecEndOrigin;
+		Vector			m_vecEndVelocity;
+	};
+
+	void			SaveState( CBaseTFPlayer *pPlayer, PlayerState_t &state );
+	void			RestoreState( CBaseTFPlayer *pPlayer, const PlayerState_t &state );
+
+	bool			Load( const char *pFilename );
+	CBaseTFPlayer*	GetReplayBot();
+
+
+private:
+
+	// Recording.
+	CHandle<CBaseTFPlayer>	m_hRecordPlayer;
+	char					m_szRecordFile[MAX_PATH];
+	int						m_nRecordMaxMoves;
+	bool					m_bMovePending;
+
+	CUtlVector<Move_t>		m_Moves;
+
+	CHandle<CBaseTFPlayer>	m_hReplayBot;
+};
+
+
+CTFMovementReplay* TFMovementReplay();
+
+
+#endif // TF_MOVEMENT_REPLAY_H
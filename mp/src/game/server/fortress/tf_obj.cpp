@@ -58,6 +58,7 @@ ConVar tf_fastbuild("tf_fastbuild", "0", FCVAR_CHEAT);
 ConVar tf_obj_ground_clearance( "tf_obj_ground_clearance", "60", 0, "Object corners can be this high above the ground" );
 
 extern short g_sModelIndexFireball;
+extern ConVar tf_object_transmit_cache;
 
 // Minimum distance between 2 objects to ensure player movement between them
 #define MINIMUM_OBJECT_SAFE_DISTANCE		100
@@ -214,10 +215,26 @@ void CBaseObject::UpdateOnRemove( void )
 // hogsy start
 int CBaseObject::UpdateTransmitState()
 {
+	// Once it's built, everyone but the builder and the teams whose tactical map shows it
+	// just needs a PVS check, and those get it from CTFTeam::PreCheckTransmit.
+	if ( !IsPlacing() && tf_object_transmit_cache.GetBool() )
+		return SetTransmitState( FL_EDICT_PVSCHECK );
+
 	return SetTransmitState(FL_EDICT_FULLCHECK);
 }
 // hogsy end
 
+void CBaseObject::SetObjectFlags( int flags )
+{
+	// OF_SUPPRESS_VISIBLE_TO_TACTICAL changes who always gets sent this
+	if ( ( m_fObjectFlags ^ flags ) & OF_SUPPRESS_VISIBLE_TO_TACTICAL )
+	{
+		CTFTeam::InvalidateTransmitCache();
+	}
+
+	m_fObjectFlags = flags;
+}
+
 int CBaseObject::ShouldTransmit( const CCheckTransmitInfo *pInfo )
 {
 	// Always transmit to owner
@@ -423,6 +440,8 @@ void CBaseObject::SpawnControlPanels()
 		int nScreen = m_hScreens.AddToTail( );
 		m_hScreens[nScreen].Set( pScreen );
 	}
+
+	CTFTeam::InvalidateTransmitCache();
 }
 
 
@@ -648,6 +667,10 @@ void CBaseObject::SetBuilder( CBaseTFPlayer *pBuilder, bool moveobjects )
 //-----------------------------------------------------------------------------
 void CBaseObject::ObjectMoved( )
 {
+	if ( GetTFTeam() )
+	{
+		GetTFTeam()->ObjectMoved( this );
+	}
 }
 
 int	CBaseObject::ObjectType( ) const
@@ -686,6 +709,7 @@ void CBaseObject::DestroyObject( void )
 		DestroyVGuiScreen( m_hScreens[i].Get() );
 
 	m_hScreens.RemoveAll();
+	CTFTeam::InvalidateTransmitCache();
 }
 
 //-----------------------------------------------------------------------------
@@ -751,6 +775,7 @@ void CBaseObject::StartPlacement( CBaseTFPlayer *pPlayer )
 
 	m_bPlacing = true;
 	m_bBuilding = false;
+	DispatchUpdateTransmitState();
 	if ( pPlayer )
 	{
 		SetBuilder( pPlayer );
@@ -1321,6 +1346,7 @@ bool CBaseObject::StartBuilding( CBaseEntity *pBuilder )
 
 	m_bPlacing = false;
 	m_bBuilding = true;
+	DispatchUpdateTransmitState();
 	SetHealth( OBJECT_CONSTRUCTION_STARTINGHEALTH );
 	m_flPercentageConstructed = 0;
 
@@ -2757,6 +2783,11 @@ void CBaseObject::AttachObjectToObject( const CBaseEntity *pEntity, int iPoint,
 			vecOrigin = GetLocalOrigin();
 		}
 	}
+
+	if ( GetTFTeam() )
+	{
+		GetTFTeam()->ObjectMoved( this );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -2775,6 +2806,11 @@ void CBaseObject::DetachObjectFromObject( void )
 	SetParent( NULL );
 	m_hBuiltOnEntity = NULL;
 	m_iBuiltOnPoint = 0;
+
+	if ( GetTFTeam() )
+	{
+		GetTFTeam()->ObjectMoved( this );
+	}
 }
 
 
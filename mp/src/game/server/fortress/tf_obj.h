@@ -226,7 +226,7 @@ public:
 
 	// Returns the object flags
 	int				GetObjectFlags() const { return m_fObjectFlags; }
-	void			SetObjectFlags( int flags ) { m_fObjectFlags = flags; }
+	void			SetObjectFlags( int flags );
 
 	CResourceZone	*GetResourceZone() { return m_hResourceZone.Get(); }
 
@@ -328,6 +328,10 @@ public:
 	virtual int		ShouldTransmit(const CCheckTransmitInfo *pInfo);
 	virtual void	SetTransmit(CCheckTransmitInfo *pInfo, bool bAlways);
 
+	// True if SetTransmit sends more than just this object (its parent, its screens, or
+	// anything a derived class adds), so the team transmit cache can't just set our bit.
+	virtual bool	HasTransmitDependents( void ) { return ( GetMoveParent() != NULL ) || ( m_hScreens.Count() != 0 ); }
+
 
 protected:
 	// Clean off the object of offensive material, returns true if it found anything
@@ -42,7 +42,7 @@ static ConVar obj_buff_station_health( "obj_buff_station_health","100", FCVAR_NO
 #define BUFF_STATION_BOOST_PLAYER_THINK_INTERVAL	0.1f
 #define BUFF_STATION_BOOST_OBJECT_THINK_INTERVAL	2.0f
 
-#define BUFF_STATION_BUFF_RANGE						( 600 * 600 )
+#define BUFF_STATION_BUFF_RANGE						( BUFF_STATION_BUFF_RANGE_DIST * BUFF_STATION_BUFF_RANGE_DIST )
 
 //=============================================================================
 //
@@ -668,9 +668,6 @@ void CObjectBuffStation::BoostObjectThink( void )
 	if ( IsPlacing() || IsBuilding() || HasPowerup( POWERUP_EMP ) )
 		return;
 
-	float flMaxRangeSq = obj_buff_station_obj_range.GetFloat();
-	flMaxRangeSq *= flMaxRangeSq;
-
 	// Boost objects.
 	for ( int iObject = m_nObjectCount; --iObject >= 0; )
 	{
@@ -681,9 +678,9 @@ void CObjectBuffStation::BoostObjectThink( void )
 			continue;
 		}
 
-		// Check for out of range.
-		float flDistSq = GetAbsOrigin().DistToSqr( pObject->GetAbsOrigin() ); 
-		if ( flDistSq > flMaxRangeSq )
+		// Check for out of range. Unparented objects get checked when they're moved
+		// (see CheckObjectRange), but things on vehicles move without telling anyone.
+		if ( ( GetMoveParent() || pObject->GetMoveParent() ) && !IsWithinBoostRange( pObject ) )
 		{
 			DetachObjectByIndex( iObject );
 			continue;
@@ -742,10 +739,11 @@ void CObjectBuffStation::BuffNearbyObjects( CBaseObject *pObjectToTarget, bool b
 	else
 	{
 		// Find nearby objects 
-		for ( int iObject = 0; iObject < GetTFTeam()->GetNumObjects(); iObject++ )
+		CUtlVector<CBaseObject*> objects;
+		GetTFTeam()->FindObjectsInRadius( -1, GetAbsOrigin(), BUFF_STATION_BUFF_RANGE_DIST, objects );
+		for ( int iObject = 0; iObject < objects.Count(); iObject++ )
 		{
-			CBaseObject *pObject = GetTFTeam()->GetObject( iObject );
-			assert(pObject);
+			CBaseObject *pObject = objects[iObject];
 
 			if ( pObject == this || !pObject->CanBeHookedToBuffStation() || pObject->GetBuffStation() )
 				continue;
@@ -823,6 +821,33 @@ void CObjectBuffStation::CheckBuffConnection( CBaseObject *pObject )
 	DetachObject( pObject );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Detach any objects that have been moved out of boost range. Called
+//          by the team when this station or one of its objects is moved.
+//-----------------------------------------------------------------------------
+void CObjectBuffStation::CheckObjectRange( void )
+{
+	for ( int iObject = m_nObjectCount; --iObject >= 0; )
+	{
+		CBaseObject *pObject = m_hObjects[iObject].Get();
+		if ( pObject && !IsWithinBoostRange( pObject ) )
+		{
+			DetachObjectByIndex( iObject );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Return true if an attached object is still close enough to boost
+//-----------------------------------------------------------------------------
+bool CObjectBuffStation::IsWithinBoostRange( CBaseObject *pObject )
+{
+	float flMaxRangeSq = obj_buff_station_obj_range.GetFloat();
+	flMaxRangeSq *= flMaxRangeSq;
+
+	return ( GetAbsOrigin().DistToSqr( pObject->GetAbsOrigin() ) <= flMaxRangeSq );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Return true if this object is powerable
 //-----------------------------------------------------------------------------
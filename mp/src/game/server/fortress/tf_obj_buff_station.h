@@ -6,6 +6,8 @@
 
 #include "tf_obj.h"
 
+#define BUFF_STATION_BUFF_RANGE_DIST	600
+
 //=============================================================================
 //
 // Portable Power Generator Class (Buff Station)
@@ -44,6 +46,7 @@ public:
 	void	DeBuffObject( CBaseObject *pObject );
 	void	BuffNearbyObjects( CBaseObject *pObjectToTarget, bool bPlacing );
 	void	CheckBuffConnection( CBaseObject *pObject );
+	void	CheckObjectRange( void );
 
 	virtual void	OnActivityChanged( Activity act );
 private:
@@ -73,6 +76,7 @@ private:
 
 	// Buff Helpers
 	bool			IsWithinBuffRange( CBaseObject *pObject );
+	bool			IsWithinBoostRange( CBaseObject *pObject );
 	CBaseObject		*GetBuffedObject( int iIndex );
 
 	// Think
@@ -34,6 +34,7 @@ public:
 	virtual bool ClientCommand(CBaseTFPlayer *pPlayer, const CCommand &args);
 
 	virtual void SetTransmit( CCheckTransmitInfo *pInfo, bool bAlways );
+	virtual bool HasTransmitDependents( void ) { return true; }
 };
 
 
@@ -120,7 +120,7 @@ void CObjectMortar::Use( CBaseEntity *pActivator, CBaseEntity *pCaller, USE_TYPE
 			if ( MortarAmmoTechs[ m_iRoundType ] && MortarAmmoTechs[ m_iRoundType ][0] )
 			{
 				// Does the player have the technology?
-				if ( GetOwner() && GetOwner()->HasNamedTechnology( MortarAmmoTechs[ m_iRoundType ] ) )
+				if ( GetOwner() && GetOwner()->HasTechnology( MortarAmmoTechIDs[ m_iRoundType ] ) )
 				{
 					// Do we have ammo?
 					if ( m_iMortarRounds[ m_iRoundType ] > 0 )
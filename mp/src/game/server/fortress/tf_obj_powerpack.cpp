@@ -162,10 +162,11 @@ void CObjectPowerPack::PowerNearbyObjects( CBaseObject *pObjectToTarget, bool bP
 	else
 	{
 		// Find nearby objects 
-		for ( int i = 0; i < GetTFTeam()->GetNumObjects(); i++ )
+		CUtlVector<CBaseObject*> objects;
+		GetTFTeam()->FindObjectsInRadius( -1, GetAbsOrigin(), POWERPACK_RANGE_DIST, objects );
+		for ( int i = 0; i < objects.Count(); i++ )
 		{
-			CBaseObject *pObject = GetTFTeam()->GetObject(i);
-			assert(pObject);
+			CBaseObject *pObject = objects[i];
 			if ( pObject == this || !pObject->CanPowerupNow(POWERUP_POWER) )
 				continue;
 			// We might be rechecking our power because one of our own objects is dying.
@@ -17,7 +17,8 @@
 // Pack defines
 #define POWERPACK_MINS			Vector(-20, -20, 0)
 #define POWERPACK_MAXS			Vector( 20,  20, 80)
-#define POWERPACK_RANGE			(600 * 600)
+#define POWERPACK_RANGE_DIST	600
+#define POWERPACK_RANGE			(POWERPACK_RANGE_DIST * POWERPACK_RANGE_DIST)
 
 // ------------------------------------------------------------------------ //
 // Resupply object that's built by the player
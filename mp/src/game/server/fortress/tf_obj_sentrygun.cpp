@@ -24,6 +24,7 @@
 #include "engine/IEngineSound.h"
 #include "grenade_rocket.h"
 #include "vguiscreen.h"
+#include "tf_sentry_targets.h"
 
 extern short	g_sModelIndexFireball;
 
@@ -106,6 +107,7 @@ void CObjectSentrygun::Spawn( void )
 	SetThink( &CObjectSentrygun::SentryRotate );
 	SetNextThink( gpGlobals->curtime + 0.5f );
 	m_flNextLook = gpGlobals->curtime;
+	m_bAcquisitionQueued = false;
 	
 	SetTechnology( false, false );
 }
@@ -476,13 +478,10 @@ void CObjectSentrygun::SentryRotate( void )
 		m_flNextLook = gpGlobals->curtime + 1.0;
 
 		// Look for a target
-		m_hEnemy = FindTarget();
+		LookForTarget();
 
 		if ( m_hEnemy != NULL )
-		{
-			FoundTarget();
 			return;
-		}
 	}
 
 	// Rotate
@@ -518,6 +517,78 @@ void CObjectSentrygun::SentryRotate( void )
 // Purpose: Check to see if there's a valid target in sight
 //-----------------------------------------------------------------------------
 CBaseEntity *CObjectSentrygun::FindTarget( void )
+{
+	if ( !GetSentryTargetIndex()->IsActive() )
+		return FindTargetBruteForce();
+
+	CBaseEntity *pHighestPriorityTarget = NULL;
+	float fHighestPriority = 0;
+
+	// If I have a designated enemy, and it's valid, assume it will be the target, unless something higher priority shows up.
+	if ( m_hDesignatedEnemy.Get() && ValidTarget( m_hDesignatedEnemy) )
+	{
+		fHighestPriority = GetPriority( m_hDesignatedEnemy );
+		pHighestPriorityTarget = m_hDesignatedEnemy;
+	}
+
+	// The candidates come back highest priority first, so the first valid one wins.
+	CUtlVector<CSentryTargetIndex::Candidate_t> candidates;
+	GetSentryTargetIndex()->GetCandidates( this, candidates );
+
+	for ( int i = 0; i < candidates.Count(); i++ )
+	{
+		// Nothing left can beat what we've got
+		if ( pHighestPriorityTarget && (candidates[i].m_flPriority <= fHighestPriority) )
+			break;
+
+		if ( ValidTarget( candidates[i].m_pEntity ) )
+			return candidates[i].m_pEntity;
+	}
+
+	return pHighestPriorityTarget;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds a target now, or gets in line for one if the acquisition
+//			scheduler is on. Either way AcquireTarget does the work.
+//-----------------------------------------------------------------------------
+void CObjectSentrygun::LookForTarget( void )
+{
+	if ( GetSentryAcquisitionScheduler()->IsActive() )
+	{
+		GetSentryAcquisitionScheduler()->RequestAcquisition( this );
+	}
+	else
+	{
+		AcquireTarget();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Search for a target, and start attacking it if we find one
+//-----------------------------------------------------------------------------
+void CObjectSentrygun::AcquireTarget( void )
+{
+	m_bAcquisitionQueued = false;
+
+	// Things may have changed while we were waiting in line
+	if ( !ShouldBeActive() || IsTurtled() || IsTurtling() )
+		return;
+
+	m_hEnemy = FindTarget();
+	if ( m_hEnemy )
+	{
+		// Stop supressing and target this new enemy
+		m_bSuppressing = false;
+		m_flStartedSuppressing = 0;
+		FoundTarget();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Searches the world for targets. Used when the target index is off.
+//-----------------------------------------------------------------------------
+CBaseEntity *CObjectSentrygun::FindTargetBruteForce( void )
 {
 	CBaseEntity *pHighestPriorityTarget = NULL;
 	float fHighestPriority = 0;
@@ -613,6 +684,37 @@ int CObjectSentrygun::Range( CBaseEntity *pTarget )
 // Purpose: Check to see if a target's valid
 //-----------------------------------------------------------------------------
 bool CObjectSentrygun::ValidTarget( CBaseEntity *pTarget )
+{
+	if ( !IsTargetable( pTarget ) )
+		return false;
+
+	if ( !FVisible(pTarget) )	
+		return false;
+
+	return HasClearShot( pTarget );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Cheaper check for a target we're already shooting at. Instead of
+//			FVisible's MASK_BLOCKLOS trace followed by the MASK_SHOT one, it does
+//			a single trace against both masks. Anything FVisible would stop at
+//			(solid and moveable brushes, CONTENTS_BLOCKLOS brushes like
+//			func_vis blockers) stops this too, as does anything in MASK_SHOT.
+//			The one difference is that it runs to the target's center rather than
+//			its eyes, the same as the shot itself.
+//-----------------------------------------------------------------------------
+bool CObjectSentrygun::RevalidateTarget( CBaseEntity *pTarget )
+{
+	if ( !IsTargetable( pTarget ) )
+		return false;
+
+	return HasClearShot( pTarget, MASK_SHOT | MASK_BLOCKLOS );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: All the target checks that don't need any traces
+//-----------------------------------------------------------------------------
+bool CObjectSentrygun::IsTargetable( CBaseEntity *pTarget )
 {
 	// Make sure we aren't borked:
 	if ( !pTarget )
@@ -655,9 +757,6 @@ bool CObjectSentrygun::ValidTarget( CBaseEntity *pTarget )
 	if ( pTarget->GetFlags() & FL_NOTARGET )
 		return false;
 
-	if ( !FVisible(pTarget) )	
-		return false;
-
 	// Ignore certain enemy infrastructure type objects:
 	CBaseObject *pObject = dynamic_cast< CBaseObject* >(pTarget);
 	if ( pObject )
@@ -677,8 +776,29 @@ bool CObjectSentrygun::ValidTarget( CBaseEntity *pTarget )
 		// Ignore mapdefined objects
 		if ( pObject->GetType() == OBJ_MAPDEFINED )
 			return false;
+
+		// Don't shoot at turtled sentry guns.
+		if ( pObject->IsSentrygun() && static_cast< CObjectSentrygun* >( pObject )->IsTurtled() )
+			return false;
 	}
 
+	// Range checks are cheap, so do them before any traces (callers do the traces)
+	int iRange = Range(pTarget);
+	if ( iRange == RANGE_FAR )
+		return false;
+
+	// Better sensors allow them to track irrespective of facing
+	if ( iRange == RANGE_MID && (!FInViewCone(pTarget) && !m_bSensors) )
+		return false;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Make sure nothing's between us and the target
+//-----------------------------------------------------------------------------
+bool CObjectSentrygun::HasClearShot( CBaseEntity *pTarget, int nMask )
+{
 	// Make sure there's nothing inbetween us
 	Vector vecSrc = EyePosition();
 
@@ -688,24 +808,11 @@ bool CObjectSentrygun::ValidTarget( CBaseEntity *pTarget )
 	sentryFilter.AddEntityToIgnore( GetOwner() );
 	sentryFilter.AddEntityToIgnore( this );
 	sentryFilter.AddEntityToIgnore( GetMoveParent() );
-	UTIL_TraceLine( vecSrc, pTarget->WorldSpaceCenter(), MASK_SHOT, &sentryFilter, &tr );
+	UTIL_TraceLine( vecSrc, pTarget->WorldSpaceCenter(), nMask, &sentryFilter, &tr );
 	CBaseEntity *pEntity = tr.m_pEnt;
 	if ( (tr.fraction < 1.0) && ( pEntity != pTarget ) )
 		return false;
 
-	int iRange = Range(pTarget);
-	if ( iRange == RANGE_FAR )
-		return false;
-
-	// Better sensors allow them to track irrespective of facing
-	if ( iRange == RANGE_MID && (!FInViewCone(pTarget) && !m_bSensors) )
-		return false;
-
-	// Don't shoot at turtled sentry guns.
-	CObjectSentrygun *pSentry = dynamic_cast< CObjectSentrygun* >( pTarget );
-	if ( pSentry  && pSentry->IsTurtled() )
-		return false;
-
 	// Don't shoot at targets blocked by enemy shields
 	bool bBlocked = TFGameRules()->IsBlockedByEnemyShields( GetAbsOrigin(), pTarget->GetAbsOrigin(), GetTeamNumber() );
 	if( bBlocked )
@@ -768,16 +875,9 @@ void CObjectSentrygun::Attack( void )
 		}
 
 		// Check to see if we can find a valid target to switch to
-		m_hEnemy = FindTarget();
-		if ( m_hEnemy )
-		{
-			// Stop supressing and target this new enemy
-			m_bSuppressing = false;
-			m_flStartedSuppressing = 0;
-			FoundTarget();
-		}
+		LookForTarget();
 	}
-	else if ( !ValidTarget(m_hEnemy) || HasAmmo() == false )
+	else if ( !RevalidateTarget(m_hEnemy) || HasAmmo() == false )
 	{
 		m_hEnemy = NULL;
 
@@ -1178,3 +1278,96 @@ void CObjectSentrygunRocketlauncher::SetTechnology( bool bSmarter, bool bSensors
 	BaseClass::SetTechnology( bSmarter, bSensors );
 	m_iBaseTurnRate	= 2;
 }
+
+//-----------------------------------------------------------------------------
+// Purpose: Times target acquisition for increasing numbers of sentryguns,
+//			with and without the target index.
+//-----------------------------------------------------------------------------
+static void CC_SentryTargetBenchmark( const CCommand &args )
+{
+	CBasePlayer *pPlayer = UTIL_GetCommandClient();
+	if ( !pPlayer )
+		return;
+
+	if ( args.ArgC() < 2 )
+	{
+		Msg( "Usage: obj_sentrygun_benchmark <num sentries> [iterations]\n" );
+		return;
+	}
+
+	int nSentries = clamp( atoi( args[1] ), 1, 128 );
+	int nIterations = args.ArgC() > 2 ? max( atoi( args[2] ), 1 ) : 100;
+
+	// Put the sentries on a team that will shoot at us
+	int iEnemyTeam = ( pPlayer->GetTeamNumber() == TEAM_HUMANS ) ? TEAM_ALIENS : TEAM_HUMANS;
+
+	CUtlVector< CHandle<CObjectSentrygun> > sentries;
+	for ( int i = 0; i < nSentries; i++ )
+	{
+		CObjectSentrygun *pSentry = (CObjectSentrygun*)CreateEntityByName( "obj_sentrygun_plasma" );
+		if ( !pSentry )
+			break;
+
+		float flAngle = 2.0f * M_PI * i / nSentries;
+		Vector vecOrigin = pPlayer->GetAbsOrigin() + Vector( cos( flAngle ), sin( flAngle ), 0 ) * 512;
+		pSentry->SetAbsOrigin( vecOrigin );
+		pSentry->ChangeTeam( iEnemyTeam );
+		DispatchSpawn( pSentry );
+		pSentry->Activate();
+		sentries.AddToTail( pSentry );
+	}
+
+	Msg( "obj_sentrygun_benchmark: %d sentries, %d targetables, %d iterations\n", sentries.Count(), GetSentryTargetIndex()->GetTargetCount(), nIterations );
+	Msg( "  sentries    world search (ms/tick)    target index (ms/tick)    priority mismatches\n" );
+
+	ConVarRef target_index( "obj_sentrygun_target_index" );
+	bool bSaveIndex = target_index.GetBool();
+
+	CUtlVector<CBaseEntity*> picks[2];
+	for ( int nCount = 1; nCount <= sentries.Count(); nCount = min( nCount * 2, sentries.Count() ) )
+	{
+		double flTime[2];
+		for ( int iPass = 0; iPass < 2; iPass++ )
+		{
+			target_index.SetValue( iPass );
+			picks[iPass].SetCount( nCount );
+
+			double flStart = Plat_FloatTime();
+			for ( int iIter = 0; iIter < nIterations; iIter++ )
+			{
+				for ( int i = 0; i < nCount; i++ )
+				{
+					picks[iPass][i] = sentries[i]->FindTarget();
+				}
+			}
+			flTime[iPass] = ( Plat_FloatTime() - flStart ) * 1000.0 / nIterations;
+		}
+
+		// Ties between equal priority targets can go either way, but the priority can't.
+		int nMismatches = 0;
+		for ( int i = 0; i < nCount; i++ )
+		{
+			CBaseEntity *pBrute = picks[0][i];
+			CBaseEntity *pIndex = picks[1][i];
+			if ( ( pBrute == NULL ) != ( pIndex == NULL ) ||
+				( pBrute && sentries[i]->GetPriority( pBrute ) != sentries[i]->GetPriority( pIndex ) ) )
+			{
+				++nMismatches;
+			}
+		}
+
+		Msg( "  %8d    %22.4f    %22.4f    %19d\n", nCount, flTime[0], flTime[1], nMismatches );
+
+		if ( nCount == sentries.Count() )
+			break;
+	}
+
+	target_index.SetValue( bSaveIndex );
+
+	for ( int i = 0; i < sentries.Count(); i++ )
+	{
+		UTIL_Remove( sentries[i] );
+	}
+}
+
+static ConCommand obj_sentrygun_benchmark( "obj_sentrygun_benchmark", CC_SentryTargetBenchmark, "Time sentrygun target acquisition with and without the target index.", FCVAR_CHEAT );
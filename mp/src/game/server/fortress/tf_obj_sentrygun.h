@@ -73,9 +73,12 @@ public:
 
 	virtual void	SetSentryAnim( TFTURRET_ANIM anim );
 	virtual CBaseEntity *FindTarget( void );
+	CBaseEntity		*FindTargetBruteForce( void );
+	void			AcquireTarget( void );
 	virtual float		GetPriority( CBaseEntity *pTarget );
 	virtual void	FoundTarget();
 	virtual bool	ValidTarget( CBaseEntity *pTarget );
+	bool			RevalidateTarget( CBaseEntity *pTarget );
 	virtual int		Range( CBaseEntity *pTarget );
 
 	// Combat functions
@@ -104,6 +107,15 @@ private:
 	// Recompute sentrygun orientation...
 	void RecomputeOrientation();
 
+	// Checks that don't need any traces
+	bool IsTargetable( CBaseEntity *pTarget );
+
+	// Line of sight and enemy shield checks
+	bool HasClearShot( CBaseEntity *pTarget, int nMask = MASK_SHOT );
+
+	// Either searches now or queues a search with the acquisition scheduler
+	void LookForTarget( void );
+
 public:
 	// Variables
 	int		m_iRightBound;
@@ -114,6 +126,7 @@ public:
 	bool	m_bSmarter;
 	bool	m_bSensors;
 	float	m_flNextLook;
+	bool	m_bAcquisitionQueued;
 
 	// Attacking
 	float	m_flNextAttack;
@@ -0,0 +1,329 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Uniform grid over a team's objects for radius and nearest-object queries.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "tf_object_grid.h"
+#include "tf_obj.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+// Coverage queries are all 1000-1500 units, so this keeps them to a few cells per axis.
+#define OBJECT_GRID_CELL_SIZE		1024.0f
+
+#define OBJECT_GRID_CELL_BITS		10
+#define OBJECT_GRID_CELL_MASK		((1 << OBJECT_GRID_CELL_BITS) - 1)
+
+// A search reaching further than this covers the whole world anyway, and callers pass
+// FLT_MAX and the like for "any distance", which would overflow the cell coordinates.
+// Anything this big (or NaN) just looks at every object.
+#define OBJECT_GRID_MAX_SEARCH		( 2.0f * MAX_COORD_FLOAT )
+
+
+static inline int ObjectGridCellCoord( float flCoord )
+{
+	return (int)floor( flCoord / OBJECT_GRID_CELL_SIZE );
+}
+
+static inline bool ObjectGridSearchFits( float flRadius )
+{
+	return ( flRadius < OBJECT_GRID_MAX_SEARCH );
+}
+
+static inline unsigned int ObjectGridCellKey( int x, int y, int z )
+{
+	return	( (unsigned int)( x & OBJECT_GRID_CELL_MASK ) << (OBJECT_GRID_CELL_BITS * 2) ) |
+			( (unsigned int)( y & OBJECT_GRID_CELL_MASK ) << OBJECT_GRID_CELL_BITS ) |
+			(unsigned int)( z & OBJECT_GRID_CELL_MASK );
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// CObjectGrid implementation.
+// ------------------------------------------------------------------------------------------ //
+
+CObjectGrid::CObjectGrid()
+{
+	m_bDirty = true;
+}
+
+
+void CObjectGrid::Insert( CBaseObject *pObject )
+{
+	if ( m_Objects.Find( pObject ) == m_Objects.InvalidIndex() )
+	{
+		m_Objects.AddToTail( pObject );
+	}
+	m_bDirty = true;
+}
+
+
+bool CObjectGrid::Remove( CBaseObject *pObject )
+{
+	if ( !m_Objects.FindAndRemove( pObject ) )
+		return false;
+
+	m_bDirty = true;
+	return true;
+}
+
+
+void CObjectGrid::Update( CBaseObject *pObject )
+{
+	m_bDirty = true;
+}
+
+
+void CObjectGrid::Purge()
+{
+	m_Objects.Purge();
+	m_Entries.Purge();
+	m_Mobile.Purge();
+	m_bDirty = true;
+}
+
+
+int __cdecl CObjectGrid::SortEntries( const Entry_t *pLeft, const Entry_t *pRight )
+{
+	if ( pLeft->m_nKey < pRight->m_nKey )
+		return -1;
+	if ( pLeft->m_nKey > pRight->m_nKey )
+		return 1;
+	return 0;
+}
+
+
+void CObjectGrid::Refresh()
+{
+	m_Entries.RemoveAll();
+	m_Mobile.RemoveAll();
+
+	for ( int i = 0; i < m_Objects.Count(); i++ )
+	{
+		CBaseObject *pObject = m_Objects[i];
+		if ( pObject->GetMoveParent() || pObject->IsAVehicle() )
+		{
+			m_Mobile.AddToTail( pObject );
+			continue;
+		}
+
+		const Vector &vecOrigin = pObject->GetAbsOrigin();
+
+		int j = m_Entries.AddToTail();
+		m_Entries[j].m_pObject = pObject;
+		m_Entries[j].m_vecOrigin = vecOrigin;
+		m_Entries[j].m_nKey = ObjectGridCellKey( ObjectGridCellCoord( vecOrigin.x ), ObjectGridCellCoord( vecOrigin.y ), ObjectGridCellCoord( vecOrigin.z ) );
+	}
+
+	m_Entries.Sort( SortEntries );
+
+	m_bDirty = false;
+}
+
+
+int CObjectGrid::FindFirstInCell( unsigned int nKey ) const
+{
+	int nLow = 0;
+	int nHigh = m_Entries.Count();
+	while ( nLow < nHigh )
+	{
+		int nMid = ( nLow + nHigh ) / 2;
+		if ( m_Entries[nMid].m_nKey < nKey )
+		{
+			nLow = nMid + 1;
+		}
+		else
+		{
+			nHigh = nMid;
+		}
+	}
+	return nLow;
+}
+
+
+int CObjectGrid::CountInRadius( const Vector &vPos, float flRadius, int nMaxCount )
+{
+	if ( !m_Objects.Count() )
+		return 0;
+
+	if ( m_bDirty )
+	{
+		Refresh();
+	}
+
+	float flRadiusSqr = flRadius * flRadius;
+	int nCount = 0;
+
+	for ( int i = 0; i < m_Mobile.Count() && nCount < nMaxCount; i++ )
+	{
+		if ( vPos.DistToSqr( m_Mobile[i]->GetAbsOrigin() ) < flRadiusSqr )
+			++nCount;
+	}
+
+	if ( !ObjectGridSearchFits( flRadius ) )
+	{
+		for ( int i = 0; i < m_Entries.Count() && nCount < nMaxCount; i++ )
+		{
+			if ( vPos.DistToSqr( m_Entries[i].m_vecOrigin ) < flRadiusSqr )
+				++nCount;
+		}
+		return nCount;
+	}
+
+	int x0 = ObjectGridCellCoord( vPos.x - flRadius ), x1 = ObjectGridCellCoord( vPos.x + flRadius );
+	int y0 = ObjectGridCellCoord( vPos.y - flRadius ), y1 = ObjectGridCellCoord( vPos.y + flRadius );
+	int z0 = ObjectGridCellCoord( vPos.z - flRadius ), z1 = ObjectGridCellCoord( vPos.z + flRadius );
+
+	for ( int x = x0; x <= x1; x++ )
+	{
+		for ( int y = y0; y <= y1; y++ )
+		{
+			for ( int z = z0; z <= z1; z++ )
+			{
+				unsigned int nKey = ObjectGridCellKey( x, y, z );
+				for ( int i = FindFirstInCell( nKey ); i < m_Entries.Count() && m_Entries[i].m_nKey == nKey; i++ )
+				{
+					if ( nCount >= nMaxCount )
+						return nCount;
+
+					if ( vPos.DistToSqr( m_Entries[i].m_vecOrigin ) < flRadiusSqr )
+						++nCount;
+				}
+			}
+		}
+	}
+
+	return nCount;
+}
+
+
+int CObjectGrid::FindInRadius( const Vector &vPos, float flRadius, CUtlVector<CBaseObject*> &objects )
+{
+	if ( !m_Objects.Count() )
+		return 0;
+
+	if ( m_bDirty )
+	{
+		Refresh();
+	}
+
+	float flRadiusSqr = flRadius * flRadius;
+	int nStart = objects.Count();
+
+	for ( int i = 0; i < m_Mobile.Count(); i++ )
+	{
+		if ( vPos.DistToSqr( m_Mobile[i]->GetAbsOrigin() ) < flRadiusSqr )
+			objects.AddToTail( m_Mobile[i] );
+	}
+
+	if ( !ObjectGridSearchFits( flRadius ) )
+	{
+		for ( int i = 0; i < m_Entries.Count(); i++ )
+		{
+			if ( vPos.DistToSqr( m_Entries[i].m_vecOrigin ) < flRadiusSqr )
+				objects.AddToTail( m_Entries[i].m_pObject );
+		}
+		return objects.Count() - nStart;
+	}
+
+	int x0 = ObjectGridCellCoord( vPos.x - flRadius ), x1 = ObjectGridCellCoord( vPos.x + flRadius );
+	int y0 = ObjectGridCellCoord( vPos.y - flRadius ), y1 = ObjectGridCellCoord( vPos.y + flRadius );
+	int z0 = ObjectGridCellCoord( vPos.z - flRadius ), z1 = ObjectGridCellCoord( vPos.z + flRadius );
+
+	for ( int x = x0; x <= x1; x++ )
+	{
+		for ( int y = y0; y <= y1; y++ )
+		{
+			for ( int z = z0; z <= z1; z++ )
+			{
+				unsigned int nKey = ObjectGridCellKey( x, y, z );
+				for ( int i = FindFirstInCell( nKey ); i < m_Entries.Count() && m_Entries[i].m_nKey == nKey; i++ )
+				{
+					if ( vPos.DistToSqr( m_Entries[i].m_vecOrigin ) < flRadiusSqr )
+						objects.AddToTail( m_Entries[i].m_pObject );
+				}
+			}
+		}
+	}
+
+	return objects.Count() - nStart;
+}
+
+
+CBaseObject *CObjectGrid::FindNearest( const Vector &vPos, float flMaxDist )
+{
+	if ( !m_Objects.Count() )
+		return NULL;
+
+	if ( m_bDirty )
+	{
+		Refresh();
+	}
+
+	CBaseObject *pNearest = NULL;
+	float flNearestSqr = flMaxDist * flMaxDist;
+
+	for ( int i = 0; i < m_Mobile.Count(); i++ )
+	{
+		float flDistSqr = vPos.DistToSqr( m_Mobile[i]->GetAbsOrigin() );
+		if ( flDistSqr < flNearestSqr )
+		{
+			flNearestSqr = flDistSqr;
+			pNearest = m_Mobile[i];
+		}
+	}
+
+	// Big searches would visit more cells than there are objects. Check the distance
+	// before working out any cell coordinates, since they'd overflow for huge ones.
+	bool bLinear = !ObjectGridSearchFits( flMaxDist );
+
+	int x0 = 0, x1 = 0, y0 = 0, y1 = 0, z0 = 0, z1 = 0;
+	if ( !bLinear )
+	{
+		x0 = ObjectGridCellCoord( vPos.x - flMaxDist ); x1 = ObjectGridCellCoord( vPos.x + flMaxDist );
+		y0 = ObjectGridCellCoord( vPos.y - flMaxDist ); y1 = ObjectGridCellCoord( vPos.y + flMaxDist );
+		z0 = ObjectGridCellCoord( vPos.z - flMaxDist ); z1 = ObjectGridCellCoord( vPos.z + flMaxDist );
+		bLinear = (float)( x1 - x0 + 1 ) * ( y1 - y0 + 1 ) * ( z1 - z0 + 1 ) > m_Entries.Count();
+	}
+
+	if ( bLinear )
+	{
+		for ( int i = 0; i < m_Entries.Count(); i++ )
+		{
+			float flDistSqr = vPos.DistToSqr( m_Entries[i].m_vecOrigin );
+			if ( flDistSqr < flNearestSqr )
+			{
+				flNearestSqr = flDistSqr;
+				pNearest = m_Entries[i].m_pObject;
+			}
+		}
+		return pNearest;
+	}
+
+	for ( int x = x0; x <= x1; x++ )
+	{
+		for ( int y = y0; y <= y1; y++ )
+		{
+			for ( int z = z0; z <= z1; z++ )
+			{
+				unsigned int nKey = ObjectGridCellKey( x, y, z );
+				for ( int i = FindFirstInCell( nKey ); i < m_Entries.Count() && m_Entries[i].m_nKey == nKey; i++ )
+				{
+					float flDistSqr = vPos.DistToSqr( m_Entries[i].m_vecOrigin );
+					if ( flDistSqr < flNearestSqr )
+					{
+						flNearestSqr = flDistSqr;
+						pNearest = m_Entries[i].m_pObject;
+					}
+				}
+			}
+		}
+	}
+
+	return pNearest;
+}
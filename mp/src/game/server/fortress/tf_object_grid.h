@@ -0,0 +1,80 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Uniform grid over a team's objects for radius and nearest-object queries.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef TF_OBJECT_GRID_H
+#define TF_OBJECT_GRID_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "utlvector.h"
+
+
+class CBaseObject;
+
+
+// ------------------------------------------------------------------------------------------ //
+// CObjectGrid.
+//
+// Objects are bucketed into cubic cells, stored as one array sorted by cell key, so a radius
+// query only looks at the objects in the cells the query sphere touches. Distances are
+// compared squared.
+//
+// Insert, Remove and Update (when an object's been moved) mark the grid dirty, and it's
+// re-sorted on the next query. Vehicles and objects that are parented to something (e.g. built
+// on a vehicle) move all the time without telling us, so they're kept in a separate list and
+// always tested at their live position.
+// ------------------------------------------------------------------------------------------ //
+
+class CObjectGrid
+{
+public:
+	CObjectGrid();
+
+	void			Insert( CBaseObject *pObject );
+	bool			Remove( CBaseObject *pObject );
+	void			Update( CBaseObject *pObject );
+	void			Purge();
+
+	int				Count() const	{ return m_Objects.Count(); }
+
+	// Number of objects strictly closer than flRadius to vPos. Stops counting at nMaxCount.
+	int				CountInRadius( const Vector &vPos, float flRadius, int nMaxCount = INT_MAX );
+
+	// Adds the objects strictly closer than flRadius to vPos to the list. Returns how many.
+	int				FindInRadius( const Vector &vPos, float flRadius, CUtlVector<CBaseObject*> &objects );
+
+	// Closest object within flMaxDist of vPos, or NULL.
+	CBaseObject		*FindNearest( const Vector &vPos, float flMaxDist );
+
+
+private:
+
+	struct Entry_t
+	{
+		unsigned int	m_nKey;
+		CBaseObject		*m_pObject;
+		Vector			m_vecOrigin;
+	};
+
+	static int __cdecl	SortEntries( const Entry_t *pLeft, const Entry_t *pRight );
+
+	void			Refresh();
+	int				FindFirstInCell( unsigned int nKey ) const;
+
+
+private:
+
+	CUtlVector<CBaseObject*>	m_Objects;		// Everything in the grid, in insertion order.
+	CUtlVector<Entry_t>			m_Entries;		// Unparented objects, sorted by cell key.
+	CUtlVector<CBaseObject*>	m_Mobile;		// Vehicles and parented objects.
+	bool						m_bDirty;
+};
+
+
+#endif // TF_OBJECT_GRID_H
@@ -233,6 +233,9 @@ CBaseTFPlayer::CBaseTFPlayer() : m_PlayerClasses( this ), m_PlayerAnimState( thi
 	m_iPlayerClass = TFCLASS_UNDECIDED;
 	SetPlayerClass( TFCLASS_UNDECIDED );
 
+	m_nObjectValue = 0;
+	m_nObjectValueSerial = -1;
+
 	m_pCurrentMenu = NULL;
 	m_TFPlayerFlags = 0;
 	m_bDeploying = false;
@@ -545,8 +548,14 @@ void CBaseTFPlayer::ChangeTeam( int iTeamNum )
 	for ( int i = 0 ; i < MAX_TECHNOLOGIES; i++ )
 		m_rgClientTechAvail[ i ].m_nAvailable = -1;
 
+	// Animation time so far counts for the old team
+	TFStats()->FlushPlayerActivity( this );
+
 	BaseClass::ChangeTeam( iTeamNum );
 
+	// Object costs depend on the team
+	UpdateObjectValue();
+
 	// Now handle resources:
 	//  - If it's the first spawn ever, give the player the team's currently calculated resource amount
 	//  - If the player has more resources than the team's joining amount, drop his resources to that amount. Otherwise, he can keep his current.
@@ -594,10 +603,20 @@ void CBaseTFPlayer::PlacePlayerInTeam( void )
 //-----------------------------------------------------------------------------
 bool CBaseTFPlayer::IsClassAvailable( TFClass iClass )
 {
-	char str[128];
-	Q_snprintf( str, sizeof( str ), "class_%s", GetTFClassInfo( iClass )->m_pClassName );
+	static int s_ClassTechIDs[ TFCLASS_CLASS_COUNT ];
+	static bool s_bClassTechIDsInitted = false;
+	if ( !s_bClassTechIDsInitted )
+	{
+		for ( int i=0; i < TFCLASS_CLASS_COUNT; i++ )
+		{
+			char str[128];
+			Q_snprintf( str, sizeof( str ), "class_%s", GetTFClassInfo( i )->m_pClassName );
+			s_ClassTechIDs[i] = TechnologyID_Intern( str );
+		}
+		s_bClassTechIDsInitted = true;
+	}
 
-	return HasNamedTechnology( str );
+	return HasTechnology( s_ClassTechIDs[iClass] );
 }
 
 void CBaseTFPlayer::ChangeClass( TFClass iClass ) {
@@ -1240,6 +1259,7 @@ void CBaseTFPlayer::SetAnimation( PLAYER_ANIM playerAnim )
 
 	animDesired = SelectWeightedSequence( idealActivity );
 
+	TFStats()->PlayerActivityChanged( this, idealActivity );
 	SetActivity( idealActivity );
 
 	// Already using the desired animation?
@@ -1922,11 +1942,19 @@ int CBaseTFPlayer::GetPreferredTechnology( void )
 // Output : Returns true on success, false on failure.
 //-----------------------------------------------------------------------------
 bool CBaseTFPlayer::HasNamedTechnology( const char *name )
+{
+	return HasTechnology( TechnologyID_Find( name ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Same as HasNamedTechnology, but takes a TECH_xxx or interned ID
+//-----------------------------------------------------------------------------
+bool CBaseTFPlayer::HasTechnology( int iTechID )
 {
 	if ( GetTFTeam() == NULL )
 		return false;
 
-	return GetTFTeam()->HasNamedTechnology( name );
+	return GetTFTeam()->HasTechnology( iTechID );
 }
 
 //-----------------------------------------------------------------------------
@@ -2396,6 +2424,48 @@ void CBaseTFPlayer::RemoveObject( CBaseObject *pObject )
 		// Also, while we're at it, remove all other bogus ones too...
 		if ((!m_TFLocal.m_aObjects[i].Get()) || (m_TFLocal.m_aObjects[i] == pObject))
 			m_TFLocal.m_aObjects.FastRemove(i);
+
+	UpdateObjectValue();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Work out what all my objects are worth. Only done when the list or the
+//			object costs change, so the stats don't have to add them up every time
+//			they're collected.
+//-----------------------------------------------------------------------------
+static int s_nObjectValueSerial = 0;
+
+void CBaseTFPlayer::InvalidateObjectValues( void )
+{
+	++s_nObjectValueSerial;
+}
+
+int CBaseTFPlayer::GetObjectValue( void )
+{
+	if ( m_nObjectValueSerial != s_nObjectValueSerial )
+	{
+		UpdateObjectValue();
+	}
+	return m_nObjectValue;
+}
+
+void CBaseTFPlayer::UpdateObjectValue( void )
+{
+	int nCost = 0;
+	int pObjectCount[OBJ_LAST];
+	memset( pObjectCount, 0, OBJ_LAST * sizeof(int) );
+	for (int k = GetObjectCount(); --k >= 0; )
+	{
+		CBaseObject *pObject = GetObject(k);
+		if (pObject)
+		{
+			int nType = pObject->GetType();
+			nCost += CalculateObjectCost( nType, pObjectCount[nType], GetTeamNumber(), false );
+			++pObjectCount[nType];
+		}
+	}
+	m_nObjectValue = nCost;
+	m_nObjectValueSerial = s_nObjectValueSerial;
 }
 
 //-----------------------------------------------------------------------------
@@ -2575,6 +2645,8 @@ void CBaseTFPlayer::AddObject( CBaseObject *pObject )
 	if ( !alreadyInList )
 		m_TFLocal.m_aObjects.AddToTail( hObject );
 
+	UpdateObjectValue();
+
 	// Stop it deterioating, if it is
 	pObject->StopDeteriorating();
 }
@@ -3236,6 +3308,9 @@ void CBaseTFPlayer::SetPlayerClass( TFClass iClass )
 {
 	if ( m_iPlayerClass != iClass )
 	{
+		// Animation time so far counts for the old class
+		TFStats()->FlushPlayerActivity( this );
+
 		m_Timer.End();
 
 		if ( m_iPlayerClass >= 0 && m_iPlayerClass < TFCLASS_CLASS_COUNT )
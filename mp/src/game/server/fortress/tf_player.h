@@ -213,6 +213,8 @@ public:
 	int		CanBuild( int iObjectType );
 	int		GetNumObjects( int iObjectType );
 	int		GetObjectCount( );
+	int		GetObjectValue( );
+	static void InvalidateObjectValues( void );	// Object costs changed for everyone (e.g. a team's MCV count)
 	CBaseObject *GetObject( int iObjectIndex );
 	bool	IsBuilding( void );
 	void	OwnedObjectDestroyed( CBaseObject *pObject );
@@ -243,6 +245,7 @@ public:
 	void	SetCantMove( bool bCantMove );
 
 	bool	HasNamedTechnology( const char *name );
+	bool	HasTechnology( int iTechID );
 	void	SetPreferredTechnology( CTechnologyTree *pTechnologyTree, int iTechIndex );
 	int		GetPreferredTechnology( void );
 	tfplayertech_t &AvailableTech( int i ) { return m_rgClientTechAvail[i]; }
@@ -441,6 +444,9 @@ private:
 
 	void		ApplyDamageForce( const CTakeDamageInfo &info, int nDamageToDo );
 
+	// Objects
+	void		UpdateObjectValue( void );
+
 	// Movement.
 	Vector		m_vecPosDelta;
 
@@ -458,6 +464,8 @@ private:
 	IMPLEMENT_NETWORK_VAR_FOR_DERIVED( m_iMaxHealth ); // Make sure this ent is marked as changed when m_iMaxHealth changes.
 
 	CHandle< CWeaponBuilder > m_hWeaponBuilder;
+	int				m_nObjectValue;		// What all my objects would cost to build now, updated as they come and go
+	int				m_nObjectValueSerial;
 	CHandle< CWeaponCombatShield > m_hWeaponCombatShield;
 	float			m_flKnockdownEndTime;
 
@@ -440,9 +440,9 @@ void CPlayerClass::CreateClass( void )
 		// Give the player any weapons s/he might have just received the tech for
 		for ( int i = 0; i < m_iNumWeaponTechAssociations; i++ )
 		{
-			if ( m_pPlayer->HasNamedTechnology( m_WeaponTechAssociations[i].pWeaponTech ) )
+			if ( m_pPlayer->HasTechnology( m_WeaponTechAssociations[i].iWeaponTechID ) )
 			{
-				CBaseTechnology *tech = pTechTree->GetTechnology( m_WeaponTechAssociations[i].pWeaponTech );
+				CBaseTechnology *tech = pTechTree->GetTechnologyByID( m_WeaponTechAssociations[i].iWeaponTechID );
 				if ( tech )
 				{	
 					for ( int j = 0; j < tech->GetNumWeaponAssociations(); j++ )
@@ -1017,6 +1017,7 @@ void CPlayerClass::AddWeaponTechAssoc( char *pWeaponTech )
 	Assert( m_iNumWeaponTechAssociations < MAX_WEAPONS );
 
 	m_WeaponTechAssociations[m_iNumWeaponTechAssociations].pWeaponTech = pWeaponTech;
+	m_WeaponTechAssociations[m_iNumWeaponTechAssociations].iWeaponTechID = TechnologyID_Intern( pWeaponTech );
 	m_iNumWeaponTechAssociations++;
 }
 
@@ -180,6 +180,7 @@ protected:
 	struct WeaponTechAssociation_t
 	{
 		char	*pWeaponTech;
+		int		iWeaponTechID;
 	};
 	WeaponTechAssociation_t		m_WeaponTechAssociations[ MAX_WEAPONS ];
 	int							m_iNumWeaponTechAssociations;
@@ -10,6 +10,7 @@
 #include "iservervehicle.h"
 #include "tf_class_commando.h"
 #include "ipredictionsystem.h"
+#include "tf_movement_replay.h"
 
 static CTFMoveData g_TFMoveData;
 CMoveData *g_pMoveData = &g_TFMoveData;
@@ -118,6 +119,8 @@ void CTFPlayerMove::SetupMove( CBasePlayer *player, CUserCmd *ucmd, IMoveHelper
 	{
 		pVehicle->SetupMove( player, ucmd, pHelper, move ); 
 	}
+
+	TFMovementReplay()->OnSetupMove( pTFPlayer, pTFMove );
 }
 
 void CTFPlayerMove::SetupMoveRecon( CBaseTFPlayer *pTFPlayer, CUserCmd *pUcmd, IMoveHelper *pHelper, 
@@ -225,6 +228,8 @@ void CTFPlayerMove::FinishMove( CBasePlayer *player, CUserCmd *ucmd, CMoveData *
 	pTFPlayer->m_iMomentumHead = pTFMove->m_iMomentumHead;
 	for ( int iMomentum = 0; iMomentum < CTFMoveData::MOMENTUM_MAXSIZE; iMomentum++ )
 		pTFPlayer->m_aMomentum[iMomentum] = pTFMove->m_aMomentum[iMomentum];
+
+	TFMovementReplay()->OnFinishMove( pTFPlayer, pTFMove );
 }
 
 void CTFPlayerMove::FinishMoveRecon( CBaseTFPlayer *pTFPlayer, CTFMoveData *pTFMove, 
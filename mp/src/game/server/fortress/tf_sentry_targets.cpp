@@ -0,0 +1,351 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Team-partitioned index of things sentryguns can shoot at.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "tf_sentry_targets.h"
+#include "tf_obj_sentrygun.h"
+#include "tf_team.h"
+#include "tf_obj.h"
+#include "ai_basenpc.h"
+#include "collisionutils.h"
+#include "tier0/vprof.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+// Half-size of the box sentries have always searched for targets in
+#define SENTRY_TARGET_SEARCH_EXTENT		2048
+
+
+ConVar obj_sentrygun_target_index( "obj_sentrygun_target_index", "1", 0, "Sentryguns find targets using the per-team target index instead of searching the world." );
+
+ConVar obj_sentrygun_acquire_scheduler( "obj_sentrygun_acquire_scheduler", "1", 0, "Sentryguns queue their target searches and a per-tick budget spreads them across ticks." );
+ConVar obj_sentrygun_acquire_budget_ms( "obj_sentrygun_acquire_budget_ms", "0.5", 0, "Milliseconds per tick that queued sentrygun target searches may use." );
+ConVar obj_sentrygun_acquire_max_per_tick( "obj_sentrygun_acquire_max_per_tick", "4", 0, "Max number of queued sentrygun target searches run per tick." );
+
+extern ConVar obj_sentrygun_range_max;
+
+
+static CSentryTargetIndex g_SentryTargetIndex;
+
+CSentryTargetIndex* GetSentryTargetIndex()
+{
+	return &g_SentryTargetIndex;
+}
+
+
+static CSentryAcquisitionScheduler g_SentryAcquisitionScheduler;
+
+CSentryAcquisitionScheduler* GetSentryAcquisitionScheduler()
+{
+	return &g_SentryAcquisitionScheduler;
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// CSentryTargetIndex implementation.
+// ------------------------------------------------------------------------------------------ //
+
+CSentryTargetIndex::CSentryTargetIndex() : CAutoGameSystemPerFrame( "CSentryTargetIndex" )
+{
+	m_bDirty = true;
+}
+
+
+void CSentryTargetIndex::LevelShutdownPostEntity()
+{
+	m_Targets.Purge();
+	m_bDirty = true;
+}
+
+
+void CSentryTargetIndex::FrameUpdatePreEntityThink()
+{
+	// Don't bother rebuilding until somebody asks.
+	m_bDirty = true;
+}
+
+
+bool CSentryTargetIndex::IsActive() const
+{
+	return obj_sentrygun_target_index.GetBool();
+}
+
+
+int CSentryTargetIndex::GetTargetCount()
+{
+	if ( m_bDirty )
+	{
+		Rebuild();
+	}
+
+	int nCount = 0;
+	for ( int i = 0; i < m_Targets.Count(); i++ )
+	{
+		nCount += m_Targets[i].Count();
+	}
+	return nCount;
+}
+
+
+void CSentryTargetIndex::Rebuild()
+{
+	VPROF( "CSentryTargetIndex::Rebuild" );
+
+	int nTeams = GetNumberOfTeams();
+	if ( m_Targets.Count() != nTeams )
+	{
+		m_Targets.SetCount( nTeams );
+	}
+
+	for ( int i = 0; i < m_Targets.Count(); i++ )
+	{
+		m_Targets[i].RemoveAll();
+	}
+
+	// Players and objects come straight from the teams' lists.
+	for ( int iTeam = 0; iTeam < nTeams; iTeam++ )
+	{
+		CTFTeam *pTeam = GetGlobalTFTeam( iTeam );
+		if ( !pTeam )
+			continue;
+
+		CUtlVector<EHANDLE> &targets = m_Targets[iTeam];
+		for ( int i = 0; i < pTeam->GetNumPlayers(); i++ )
+		{
+			CBasePlayer *pPlayer = pTeam->GetPlayer( i );
+			if ( pPlayer )
+			{
+				targets.AddToTail( pPlayer );
+			}
+		}
+
+		for ( int i = 0; i < pTeam->GetNumObjects(); i++ )
+		{
+			CBaseObject *pObject = pTeam->GetObject( i );
+			if ( pObject )
+			{
+				targets.AddToTail( pObject );
+			}
+		}
+	}
+
+	// NPCs aren't on the team lists, but the AI manager has all of them.
+	CAI_BaseNPC **ppAIs = g_AI_Manager.AccessAIs();
+	for ( int i = 0; i < g_AI_Manager.NumAIs(); i++ )
+	{
+		// Sentries never shoot at things on the neutral team.
+		CAI_BaseNPC *pNPC = ppAIs[i];
+		if ( !pNPC->IsInAnyTeam() )
+			continue;
+
+		int iTeam = pNPC->GetTeamNumber();
+		if ( iTeam >= nTeams )
+			continue;
+
+		m_Targets[iTeam].AddToTail( pNPC );
+	}
+
+	m_bDirty = false;
+}
+
+
+int __cdecl CSentryTargetIndex::SortCandidates( const Candidate_t *pLeft, const Candidate_t *pRight )
+{
+	if ( pLeft->m_flPriority != pRight->m_flPriority )
+		return ( pLeft->m_flPriority > pRight->m_flPriority ) ? -1 : 1;
+
+	if ( pLeft->m_flDistSqr != pRight->m_flDistSqr )
+		return ( pLeft->m_flDistSqr < pRight->m_flDistSqr ) ? -1 : 1;
+
+	return 0;
+}
+
+
+void CSentryTargetIndex::GetCandidates( CObjectSentrygun *pSentry, CUtlVector<Candidate_t> &candidates )
+{
+	VPROF( "CSentryTargetIndex::GetCandidates" );
+
+	candidates.RemoveAll();
+
+	if ( m_bDirty )
+	{
+		Rebuild();
+	}
+
+	// Anything further than this is out in RANGE_FAR, which sentries never shoot at.
+	// Leave a unit of slack for the integer rounding in CObjectSentrygun::Range.
+	float flMaxDist = obj_sentrygun_range_max.GetFloat() + 1.0f;
+	if ( pSentry->m_bSensors )
+	{
+		flMaxDist /= 0.75f;
+	}
+	float flMaxDistSqr = flMaxDist * flMaxDist;
+
+	Vector vecEye = pSentry->EyePosition();
+	Vector vecOrigin = pSentry->GetAbsOrigin();
+	Vector vecDelta( SENTRY_TARGET_SEARCH_EXTENT, SENTRY_TARGET_SEARCH_EXTENT, SENTRY_TARGET_SEARCH_EXTENT );
+	Vector vecSearchMins = vecOrigin - vecDelta;
+	Vector vecSearchMaxs = vecOrigin + vecDelta;
+
+	int iSentryTeam = pSentry->GetTeamNumber();
+	for ( int iTeam = 0; iTeam < m_Targets.Count(); iTeam++ )
+	{
+		if ( iTeam == iSentryTeam )
+			continue;
+
+		const CUtlVector<EHANDLE> &targets = m_Targets[iTeam];
+		for ( int i = 0; i < targets.Count(); i++ )
+		{
+			CBaseEntity *pEntity = targets[i];
+			if ( !pEntity || pEntity == pSentry )
+				continue;
+
+			float flDistSqr = pEntity->EyePosition().DistToSqr( vecEye );
+			if ( flDistSqr >= flMaxDistSqr )
+				continue;
+
+			// Stay inside the box sentries used to search in.
+			Vector vecMins, vecMaxs;
+			pEntity->CollisionProp()->WorldSpaceAABB( &vecMins, &vecMaxs );
+			if ( !IsBoxIntersectingBox( vecMins, vecMaxs, vecSearchMins, vecSearchMaxs ) )
+				continue;
+
+			int j = candidates.AddToTail();
+			candidates[j].m_pEntity = pEntity;
+			candidates[j].m_flPriority = pSentry->GetPriority( pEntity );
+			candidates[j].m_flDistSqr = flDistSqr;
+		}
+	}
+
+	candidates.Sort( SortCandidates );
+
+	VPROF_INCREMENT_COUNTER( "SentryTargets: candidates", candidates.Count() );
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// CSentryAcquisitionScheduler implementation.
+// ------------------------------------------------------------------------------------------ //
+
+CSentryAcquisitionScheduler::CSentryAcquisitionScheduler() : CAutoGameSystemPerFrame( "CSentryAcquisitionScheduler" )
+{
+	ResetStats();
+}
+
+
+void CSentryAcquisitionScheduler::LevelShutdownPostEntity()
+{
+	m_Queue.Purge();
+}
+
+
+bool CSentryAcquisitionScheduler::IsActive() const
+{
+	return obj_sentrygun_acquire_scheduler.GetBool();
+}
+
+
+void CSentryAcquisitionScheduler::RequestAcquisition( CObjectSentrygun *pSentry )
+{
+	if ( pSentry->m_bAcquisitionQueued )
+		return;
+
+	pSentry->m_bAcquisitionQueued = true;
+
+	int i = m_Queue.AddToTail();
+	m_Queue[i].m_hSentry = pSentry;
+	m_Queue[i].m_flRequestTime = gpGlobals->curtime;
+}
+
+
+void CSentryAcquisitionScheduler::FrameUpdatePostEntityThink()
+{
+	if ( !m_Queue.Count() )
+		return;
+
+	VPROF( "CSentryAcquisitionScheduler::FrameUpdatePostEntityThink" );
+
+	double flStart = Plat_FloatTime();
+	double flBudget = obj_sentrygun_acquire_budget_ms.GetFloat() / 1000.0;
+	int nMaxPerTick = max( obj_sentrygun_acquire_max_per_tick.GetInt(), 1 );
+
+	int nServiced = 0;
+	int nProcessed = 0;
+	while ( nProcessed < m_Queue.Count() )
+	{
+		// Always let one through so a tiny budget can't starve everybody.
+		if ( nServiced > 0 && ( nServiced >= nMaxPerTick || Plat_FloatTime() - flStart >= flBudget ) )
+			break;
+
+		const Request_t &request = m_Queue[nProcessed++];
+		CObjectSentrygun *pSentry = request.m_hSentry;
+		if ( !pSentry )
+			continue;
+
+		float flLatency = gpGlobals->curtime - request.m_flRequestTime;
+		m_flTotalLatency += flLatency;
+		m_flMaxLatency = max( m_flMaxLatency, flLatency );
+
+		pSentry->AcquireTarget();
+		++nServiced;
+	}
+
+	m_Queue.RemoveMultipleFromHead( nProcessed );
+
+	float flTime = Plat_FloatTime() - flStart;
+	++m_nTicks;
+	m_nAcquisitions += nServiced;
+	m_nMaxPerTick = max( m_nMaxPerTick, nServiced );
+	m_flTotalTime += flTime;
+	m_flMaxTime = max( m_flMaxTime, flTime );
+	if ( m_Queue.Count() )
+	{
+		++m_nDeferredTicks;
+	}
+
+	VPROF_INCREMENT_COUNTER( "SentryTargets: acquisitions", nServiced );
+}
+
+
+void CSentryAcquisitionScheduler::ResetStats()
+{
+	m_nTicks = 0;
+	m_nAcquisitions = 0;
+	m_nMaxPerTick = 0;
+	m_nDeferredTicks = 0;
+	m_flTotalLatency = 0;
+	m_flMaxLatency = 0;
+	m_flTotalTime = 0;
+	m_flMaxTime = 0;
+}
+
+
+void CSentryAcquisitionScheduler::PrintStats()
+{
+	int nTicks = max( m_nTicks, 1 );
+	int nAcquisitions = max( m_nAcquisitions, 1 );
+
+	Msg( "Sentry acquisition: %d searches over %d busy ticks, %d still queued\n", m_nAcquisitions, m_nTicks, m_Queue.Count() );
+	Msg( "  per tick:  avg %.2f  max %d  (%d ticks ran out of budget)\n", (float)m_nAcquisitions / nTicks, m_nMaxPerTick, m_nDeferredTicks );
+	Msg( "  time:      avg %.3f ms/tick  max %.3f ms/tick\n", m_flTotalTime * 1000.0 / nTicks, m_flMaxTime * 1000.0f );
+	Msg( "  latency:   avg %.1f ms  max %.1f ms\n", m_flTotalLatency * 1000.0 / nAcquisitions, m_flMaxLatency * 1000.0f );
+}
+
+
+static void CC_SentryAcquireStats( const CCommand &args )
+{
+	GetSentryAcquisitionScheduler()->PrintStats();
+
+	if ( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) )
+	{
+		GetSentryAcquisitionScheduler()->ResetStats();
+	}
+}
+
+static ConCommand obj_sentrygun_acquire_stats( "obj_sentrygun_acquire_stats", CC_SentryAcquireStats, "Print sentrygun target acquisition scheduler stats. Pass 'reset' to clear them afterwards." );
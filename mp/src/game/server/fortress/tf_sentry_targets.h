@@ -0,0 +1,145 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Team-partitioned index of things sentryguns can shoot at.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef TF_SENTRY_TARGETS_H
+#define TF_SENTRY_TARGETS_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "igamesystem.h"
+#include "utlvector.h"
+#include "ehandle.h"
+
+
+class CObjectSentrygun;
+
+
+// ------------------------------------------------------------------------------------------ //
+// CSentryTargetIndex.
+//
+// Keeps a list of targetable entities (players, NPCs and objects on a team) for each team,
+// gathered from the team player and object lists and the AI manager rather than the whole
+// entity list. The lists are rebuilt at most once a tick, the first time a sentry asks for
+// them (ticks where nobody searches cost nothing), so spawns, deaths and team changes are
+// picked up within a tick. Positions are always read live, so movement never leaves the
+// index stale.
+//
+// Sentries ask for the hostile candidates in their range band, sorted by priority, and then
+// only run their visibility traces until they find a valid target.
+// ------------------------------------------------------------------------------------------ //
+
+class CSentryTargetIndex : public CAutoGameSystemPerFrame
+{
+public:
+	CSentryTargetIndex();
+
+	struct Candidate_t
+	{
+		CBaseEntity	*m_pEntity;
+		float		m_flPriority;
+		float		m_flDistSqr;
+	};
+
+// Overrides.
+public:
+
+	virtual void	LevelShutdownPostEntity();
+	virtual void	FrameUpdatePreEntityThink();
+
+
+public:
+
+	// Returns true if sentries should use the index instead of searching the world.
+	bool			IsActive() const;
+
+	// Fills in all the targetables that aren't on the sentry's team and are inside its
+	// max range, highest priority first (nearest first within a priority).
+	void			GetCandidates( CObjectSentrygun *pSentry, CUtlVector<Candidate_t> &candidates );
+
+	// Number of targetables currently in the index.
+	int				GetTargetCount();
+
+
+private:
+
+	void			Rebuild();
+
+	static int __cdecl	SortCandidates( const Candidate_t *pLeft, const Candidate_t *pRight );
+
+
+private:
+
+	// One list per team.
+	CUtlVector< CUtlVector<EHANDLE> >	m_Targets;
+	bool								m_bDirty;
+};
+
+
+CSentryTargetIndex* GetSentryTargetIndex();
+
+
+// ------------------------------------------------------------------------------------------ //
+// CSentryAcquisitionScheduler.
+//
+// Sentries that need a new target queue up here instead of searching on the spot. After
+// entities think, queued sentries run FindTarget in request order until the per-tick budget
+// (a time limit and a max count) runs out. The rest wait for the next tick. At least one
+// sentry is always serviced each tick, so nothing starves.
+// ------------------------------------------------------------------------------------------ //
+
+class CSentryAcquisitionScheduler : public CAutoGameSystemPerFrame
+{
+public:
+	CSentryAcquisitionScheduler();
+
+// Overrides.
+public:
+
+	virtual void	LevelShutdownPostEntity();
+	virtual void	FrameUpdatePostEntityThink();
+
+
+public:
+
+	// Returns true if sentries should queue their target searches.
+	bool			IsActive() const;
+
+	// Queues a target search for this sentry. Does nothing if it's already queued.
+	void			RequestAcquisition( CObjectSentrygun *pSentry );
+
+	void			PrintStats();
+	void			ResetStats();
+
+
+private:
+
+	struct Request_t
+	{
+		CHandle<CObjectSentrygun>	m_hSentry;
+		float						m_flRequestTime;
+	};
+
+	CUtlVector<Request_t>	m_Queue;
+
+	// Stats.
+	int			m_nTicks;
+	int			m_nAcquisitions;
+	int			m_nMaxPerTick;
+	int			m_nDeferredTicks;		// Ticks that ended with sentries still waiting.
+	double		m_flTotalLatency;
+	float		m_flMaxLatency;
+	double		m_flTotalTime;
+	float		m_flMaxTime;
+};
+
+
+CSentryAcquisitionScheduler* GetSentryAcquisitionScheduler();
+
+
+#endif // TF_SENTRY_TARGETS_H
@@ -13,10 +13,18 @@
 #include <float.h>
 #include "sendproxy.h"
 #include "mathlib/mathlib.h"
+#include "mathlib/ssemath.h"
+#include "vstdlib/random.h"
+#include "vstdlib/jobthread.h"
+#include "tier0/vprof.h"
+#include "tf_gamerules.h"
 
 #define PROBE_EFFECT_TIME		0.15f
 
 ConVar	shield_explosive_damage( "shield_explosive_damage","10", FCVAR_REPLICATED, "Shield power damage from explosions" );
+ConVar	shield_batch_simulate( "shield_batch_simulate", "1", 0, "Simulate mobile shields all together before entities think instead of in each shield's think." );
+ConVar	shield_batch_threaded( "shield_batch_threaded", "1", 0, "Spread batched shield simulation over the job threads." );
+ConVar	shield_collision_simd( "shield_collision_simd", "1", 0, "Test rays against shields four triangles at a time using a packed copy of each shield's mesh." );
 
 // Percentage of total health that the shield's allowed to go below 0
 #define SHIELD_MIN_HEALTH_FACTOR		(-0.5)
@@ -27,6 +35,575 @@ ConVar	shield_explosive_damage( "shield_explosive_damage","10", FCVAR_REPLICATED
 CUtlVector< CShield* >	CShield::s_Shields;
 
 
+//-----------------------------------------------------------------------------
+// Bounding volume hierarchy over the shields' world space bounds, so a ray only
+// needs to visit the shields whose bounds it actually passes through. It's
+// rebuilt when a shield is created, destroyed or changes shape, or when the
+// once a tick check finds one whose bounds moved (shields attached to things
+// get carried around without thinking); otherwise it's reused across queries
+// and ticks.
+//-----------------------------------------------------------------------------
+#define SHIELD_TREE_LEAF_SIZE	2
+#define SHIELD_TREE_MAX_DEPTH	32
+
+class CShieldTree
+{
+public:
+	CShieldTree() : m_nCheckTick( -1 ), m_bDirty( true ) {}
+
+	void MarkDirty() { m_bDirty = true; }
+
+	// Rebuilds the tree if needed, then walks it.
+	bool IsBlocked( const CUtlVector< CShield* > &shields, const Ray_t &ray, int iIgnoreTeam );
+
+private:
+	struct Node_t
+	{
+		Vector	m_vecMins;
+		Vector	m_vecMaxs;
+		int		m_nFirst;	// First child node for interior nodes, first leaf otherwise.
+		int		m_nCount;	// Number of leaves, or 0 for interior nodes.
+	};
+
+	bool	NeedsRebuild( const CUtlVector< CShield* > &shields );
+	void	Build( const CUtlVector< CShield* > &shields );
+	void	BuildNode( int nNode, int nFirst, int nCount, int nDepth );
+	void	SwapLeaves( int i, int j );
+
+	CUtlVector< Node_t >	m_Nodes;
+	CUtlVector< CShield* >	m_Leaves;
+	CUtlVector< Vector >	m_LeafMins;
+	CUtlVector< Vector >	m_LeafMaxs;
+	int						m_nCheckTick;
+	bool					m_bDirty;
+};
+
+static CShieldTree s_ShieldTree;
+
+
+void CShieldTree::SwapLeaves( int i, int j )
+{
+	V_swap( m_Leaves[i], m_Leaves[j] );
+	V_swap( m_LeafMins[i], m_LeafMins[j] );
+	V_swap( m_LeafMaxs[i], m_LeafMaxs[j] );
+}
+
+
+void CShieldTree::Build( const CUtlVector< CShield* > &shields )
+{
+	m_Nodes.RemoveAll();
+	m_Leaves.CopyArray( shields.Base(), shields.Count() );
+	m_LeafMins.SetCount( shields.Count() );
+	m_LeafMaxs.SetCount( shields.Count() );
+
+	for ( int i = 0; i < m_Leaves.Count(); ++i )
+	{
+		m_Leaves[i]->CollisionProp()->WorldSpaceAABB( &m_LeafMins[i], &m_LeafMaxs[i] );
+	}
+
+	if ( m_Leaves.Count() )
+	{
+		m_Nodes.AddToTail();
+		BuildNode( 0, 0, m_Leaves.Count(), 0 );
+	}
+
+	m_nCheckTick = gpGlobals->tickcount;
+	m_bDirty = false;
+}
+
+
+bool CShieldTree::NeedsRebuild( const CUtlVector< CShield* > &shields )
+{
+	if ( m_bDirty || m_Leaves.Count() != shields.Count() )
+		return true;
+
+	if ( m_nCheckTick == gpGlobals->tickcount )
+		return false;
+
+	m_nCheckTick = gpGlobals->tickcount;
+	for ( int i = 0; i < m_Leaves.Count(); ++i )
+	{
+		Vector vecMins, vecMaxs;
+		m_Leaves[i]->CollisionProp()->WorldSpaceAABB( &vecMins, &vecMaxs );
+		if ( vecMins != m_LeafMins[i] || vecMaxs != m_LeafMaxs[i] )
+			return true;
+	}
+
+	return false;
+}
+
+
+void CShieldTree::BuildNode( int nNode, int nFirst, int nCount, int nDepth )
+{
+	Vector vecMins( FLT_MAX, FLT_MAX, FLT_MAX );
+	Vector vecMaxs( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+	Vector vecCenterMins( FLT_MAX, FLT_MAX, FLT_MAX );
+	Vector vecCenterMaxs( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+	for ( int i = nFirst; i < nFirst + nCount; ++i )
+	{
+		VectorMin( vecMins, m_LeafMins[i], vecMins );
+		VectorMax( vecMaxs, m_LeafMaxs[i], vecMaxs );
+
+		Vector vecCenter = ( m_LeafMins[i] + m_LeafMaxs[i] ) * 0.5f;
+		VectorMin( vecCenterMins, vecCenter, vecCenterMins );
+		VectorMax( vecCenterMaxs, vecCenter, vecCenterMaxs );
+	}
+
+	m_Nodes[nNode].m_vecMins = vecMins;
+	m_Nodes[nNode].m_vecMaxs = vecMaxs;
+
+	if ( nCount <= SHIELD_TREE_LEAF_SIZE || nDepth >= SHIELD_TREE_MAX_DEPTH )
+	{
+		m_Nodes[nNode].m_nFirst = nFirst;
+		m_Nodes[nNode].m_nCount = nCount;
+		return;
+	}
+
+	// Split at the middle of the longest axis of the centers
+	Vector vecExtent = vecCenterMaxs - vecCenterMins;
+	int nAxis = ( vecExtent.x > vecExtent.y ) ? ( ( vecExtent.x > vecExtent.z ) ? 0 : 2 ) : ( ( vecExtent.y > vecExtent.z ) ? 1 : 2 );
+	float flSplit = ( vecCenterMins[nAxis] + vecCenterMaxs[nAxis] ) * 0.5f;
+
+	int nMid = nFirst;
+	for ( int i = nFirst; i < nFirst + nCount; ++i )
+	{
+		if ( ( m_LeafMins[i][nAxis] + m_LeafMaxs[i][nAxis] ) * 0.5f < flSplit )
+		{
+			SwapLeaves( i, nMid );
+			++nMid;
+		}
+	}
+
+	// All the centers are on top of each other; just split the list in half
+	if ( nMid == nFirst || nMid == nFirst + nCount )
+	{
+		nMid = nFirst + nCount / 2;
+	}
+
+	int nChild = m_Nodes.AddMultipleToTail( 2 );
+	m_Nodes[nNode].m_nFirst = nChild;
+	m_Nodes[nNode].m_nCount = 0;
+
+	BuildNode( nChild, nFirst, nMid - nFirst, nDepth + 1 );
+	BuildNode( nChild + 1, nMid, nFirst + nCount - nMid, nDepth + 1 );
+}
+
+
+bool CShieldTree::IsBlocked( const CUtlVector< CShield* > &shields, const Ray_t &ray, int iIgnoreTeam )
+{
+	if ( NeedsRebuild( shields ) )
+	{
+		Build( shields );
+		VPROF_INCREMENT_COUNTER( "Shields: tree rebuilt", 1 );
+	}
+	else
+	{
+		VPROF_INCREMENT_COUNTER( "Shields: tree reused", 1 );
+	}
+
+	if ( !m_Nodes.Count() )
+		return false;
+
+	trace_t tr;
+	int nStack[SHIELD_TREE_MAX_DEPTH + 2];
+	int nStackCount = 0;
+	nStack[nStackCount++] = 0;
+
+	while ( nStackCount )
+	{
+		const Node_t &node = m_Nodes[ nStack[--nStackCount] ];
+		if ( !IsBoxIntersectingRay( node.m_vecMins, node.m_vecMaxs, ray.m_Start, ray.m_Delta ) )
+			continue;
+
+		if ( node.m_nCount == 0 )
+		{
+			nStack[nStackCount++] = node.m_nFirst;
+			nStack[nStackCount++] = node.m_nFirst + 1;
+			continue;
+		}
+
+		for ( int i = node.m_nFirst; i < node.m_nFirst + node.m_nCount; ++i )
+		{
+			CShield *pShield = m_Leaves[i];
+			if ( pShield->GetTeamNumber() == iIgnoreTeam )
+				continue;
+
+			if ( !pShield->ShouldCollide( TFCOLLISION_GROUP_WEAPON, MASK_ALL ) )
+				continue;
+
+			if ( pShield->TestCollision( ray, MASK_ALL, tr ) )
+				return true;
+		}
+	}
+
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Packed copy of a shield's triangles for TestCollision. The triangles go into
+// blocks of four in the same order the scalar loop visits them, and each row
+// of quads gets its own run of blocks plus a bounding box so a ray can skip
+// rows it doesn't come near. The mesh is repacked only when the shield's
+// points or panels change (or it moves), so a shield that's sitting still
+// keeps the same one across any number of queries.
+//
+// The edges and normals are computed here with the same float operations as
+// IntersectRayWithTriangle, and the SIMD test below does the rest of its math
+// in the same order, so a lane comes out bit-for-bit the same as the scalar
+// test of that triangle.
+//-----------------------------------------------------------------------------
+
+// Slop on the row bounds so rounding in the triangle test can't put a hit outside of them.
+#define SHIELD_MESH_ROW_TOLERANCE	1.0f
+
+struct ShieldTriBlock_t
+{
+	FourVectors	m_v1;
+	FourVectors	m_Edge1;
+	FourVectors	m_Edge2;
+	FourVectors	m_Normal;
+	int			m_nTri[4];	// quad * 2 + which triangle of the quad, or -1 for padding
+};
+
+struct ShieldMeshRow_t
+{
+	Vector	m_vecMins;
+	Vector	m_vecMaxs;
+	int		m_nFirstBlock;
+	int		m_nBlockCount;
+};
+
+class CShieldCollisionMesh
+{
+public:
+	CShieldCollisionMesh() : m_nLanes( 4 ), m_bDirty( true ) {}
+
+	void MarkDirty() { m_bDirty = true; }
+
+	// Repacks the shield's triangles if they might have changed.
+	void Update( CShield *pShield );
+
+	// Returns the closest hit as a triangle index, picking the same one the
+	// scalar loop would.
+	bool FindClosestTriangle( const Ray_t &ray, float &mint, int &nTri ) const;
+
+private:
+	void AddTriangle( int nTri, const Vector &v1, const Vector &v2, const Vector &v3 );
+
+	CUtlVector< ShieldTriBlock_t, CUtlMemoryAligned< ShieldTriBlock_t, 16 > >	m_Blocks;
+	CUtlVector< ShieldMeshRow_t >	m_Rows;
+	int		m_nLanes;		// Lanes used in the last block
+	bool	m_bDirty;
+	Vector	m_vecOrigin;
+	QAngle	m_angAngles;
+};
+
+
+//-----------------------------------------------------------------------------
+// IntersectRayWithTriangle compares |denom| against the double 1e-6, which
+// falls between two floats. This is the float that gives the same answer.
+//-----------------------------------------------------------------------------
+static float ComputeDenomEpsilon()
+{
+	union
+	{
+		float	f;
+		uint32	i;
+	} epsilon;
+
+	epsilon.f = 1e-6f;
+	while ( epsilon.f < 1e-6 )
+	{
+		++epsilon.i;
+	}
+	return epsilon.f;
+}
+
+static const float s_flDenomEpsilon = ComputeDenomEpsilon();
+
+
+//-----------------------------------------------------------------------------
+// Same as the one IntersectRayWithTriangle uses (it's static in collisionutils.cpp)
+//-----------------------------------------------------------------------------
+static float ComputeBoxOffset( const Ray_t& ray )
+{
+	if (ray.m_IsRay)
+		return 1e-3f;
+
+	// Find the projection of the box diagonal along the ray...
+	float offset = FloatMakePositive(ray.m_Extents[0] * ray.m_Delta[0]) +
+					FloatMakePositive(ray.m_Extents[1] * ray.m_Delta[1]) +
+					FloatMakePositive(ray.m_Extents[2] * ray.m_Delta[2]);
+
+	offset *= InvRSquared( ray.m_Delta );
+
+	// 1e-3 is an epsilon
+	return offset + 1e-3;
+}
+
+
+//-----------------------------------------------------------------------------
+// DotProduct and CrossProduct four at a time, with the operations in the same order
+//-----------------------------------------------------------------------------
+static FORCEINLINE fltx4 DotProduct4( const FourVectors &a, const FourVectors &b )
+{
+	return AddSIMD( AddSIMD( MulSIMD( a.x, b.x ), MulSIMD( a.y, b.y ) ), MulSIMD( a.z, b.z ) );
+}
+
+static FORCEINLINE void CrossProduct4( const FourVectors &a, const FourVectors &b, FourVectors &result )
+{
+	result.x = SubSIMD( MulSIMD( a.y, b.z ), MulSIMD( a.z, b.y ) );
+	result.y = SubSIMD( MulSIMD( a.z, b.x ), MulSIMD( a.x, b.z ) );
+	result.z = SubSIMD( MulSIMD( a.x, b.y ), MulSIMD( a.y, b.x ) );
+}
+
+static FORCEINLINE void SetLane( FourVectors &v, int nLane, const Vector &vec )
+{
+	v.X( nLane ) = vec.x;
+	v.Y( nLane ) = vec.y;
+	v.Z( nLane ) = vec.z;
+}
+
+
+void CShieldCollisionMesh::AddTriangle( int nTri, const Vector &v1, const Vector &v2, const Vector &v3 )
+{
+	if ( m_nLanes == 4 )
+	{
+		// Unused lanes get a degenerate triangle, which the backface test throws out
+		ShieldTriBlock_t &block = m_Blocks[ m_Blocks.AddToTail() ];
+		block.m_v1.DuplicateVector( vec3_origin );
+		block.m_Edge1.DuplicateVector( vec3_origin );
+		block.m_Edge2.DuplicateVector( vec3_origin );
+		block.m_Normal.DuplicateVector( vec3_origin );
+		for ( int i = 0; i < 4; ++i )
+		{
+			block.m_nTri[i] = -1;
+		}
+		m_nLanes = 0;
+	}
+
+	Vector edge1, edge2, normal;
+	VectorSubtract( v2, v1, edge1 );
+	VectorSubtract( v3, v1, edge2 );
+	CrossProduct( edge1, edge2, normal );
+
+	ShieldTriBlock_t &block = m_Blocks.Tail();
+	SetLane( block.m_v1, m_nLanes, v1 );
+	SetLane( block.m_Edge1, m_nLanes, edge1 );
+	SetLane( block.m_Edge2, m_nLanes, edge2 );
+	SetLane( block.m_Normal, m_nLanes, normal );
+	block.m_nTri[m_nLanes] = nTri;
+	++m_nLanes;
+}
+
+
+void CShieldCollisionMesh::Update( CShield *pShield )
+{
+	// Flat shields work out their points from wherever they are, so catch them moving too
+	if ( !m_bDirty && m_vecOrigin == pShield->GetAbsOrigin() && m_angAngles == pShield->GetAbsAngles() )
+	{
+		VPROF_INCREMENT_COUNTER( "Shields: mesh reused", 1 );
+		return;
+	}
+
+	VPROF_INCREMENT_COUNTER( "Shields: mesh repacked", 1 );
+
+	m_vecOrigin = pShield->GetAbsOrigin();
+	m_angAngles = pShield->GetAbsAngles();
+
+	m_Blocks.RemoveAll();
+	m_Rows.RemoveAll();
+
+	int h = pShield->Height();
+	int w = pShield->Width();
+
+	for (int i = 0; i < h - 1; ++i)
+	{
+		int nFirstBlock = m_Blocks.Count();
+		Vector vecMins( FLT_MAX, FLT_MAX, FLT_MAX );
+		Vector vecMaxs( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+
+		// Each row starts a new block
+		m_nLanes = 4;
+
+		for (int j = 0; j < w - 1; ++j)
+		{
+			if (!pShield->IsPanelActive( j, i ))
+				continue;
+
+			Vector p00 = pShield->GetPoint( j, i );
+			Vector p10 = pShield->GetPoint( j + 1, i );
+			Vector p01 = pShield->GetPoint( j, i + 1 );
+			Vector p11 = pShield->GetPoint( j + 1, i + 1 );
+
+			// Same triangles, same vertex order as the scalar loop
+			int nQuad = i * (w - 1) + j;
+			AddTriangle( nQuad * 2, p01, p11, p00 );
+			AddTriangle( nQuad * 2 + 1, p10, p00, p11 );
+
+			VectorMin( vecMins, p00, vecMins );		VectorMax( vecMaxs, p00, vecMaxs );
+			VectorMin( vecMins, p10, vecMins );		VectorMax( vecMaxs, p10, vecMaxs );
+			VectorMin( vecMins, p01, vecMins );		VectorMax( vecMaxs, p01, vecMaxs );
+			VectorMin( vecMins, p11, vecMins );		VectorMax( vecMaxs, p11, vecMaxs );
+		}
+
+		if ( m_Blocks.Count() == nFirstBlock )
+			continue;
+
+		ShieldMeshRow_t &row = m_Rows[ m_Rows.AddToTail() ];
+		row.m_vecMins = vecMins;
+		row.m_vecMaxs = vecMaxs;
+		row.m_nFirstBlock = nFirstBlock;
+		row.m_nBlockCount = m_Blocks.Count() - nFirstBlock;
+	}
+
+	// Last, since GetPoint can end up marking us dirty again
+	m_bDirty = false;
+}
+
+
+bool CShieldCollisionMesh::FindClosestTriangle( const Ray_t &ray, float &mint, int &nTri ) const
+{
+	mint = FLT_MAX;
+	nTri = -1;
+
+	// A hit can be up to boxt past either end of the ray
+	float boxt = ComputeBoxOffset( ray );
+	Vector vecSlabStart, vecSlabDelta;
+	VectorMA( ray.m_Start, -boxt, ray.m_Delta, vecSlabStart );
+	VectorScale( ray.m_Delta, 1.0f + 2.0f * boxt, vecSlabDelta );
+
+	FourVectors start, delta;
+	start.DuplicateVector( ray.m_Start );
+	delta.DuplicateVector( ray.m_Delta );
+
+	fltx4 fl4Epsilon = ReplicateX4( s_flDenomEpsilon );
+	fltx4 fl4MinT = ReplicateX4( -boxt );
+	fltx4 fl4MaxT = ReplicateX4( 1.0f + boxt );
+
+	for ( int r = 0; r < m_Rows.Count(); ++r )
+	{
+		const ShieldMeshRow_t &row = m_Rows[r];
+		if ( !IsBoxIntersectingRay( row.m_vecMins, row.m_vecMaxs, vecSlabStart, vecSlabDelta, SHIELD_MESH_ROW_TOLERANCE ) )
+			continue;
+
+		for ( int b = row.m_nFirstBlock; b < row.m_nFirstBlock + row.m_nBlockCount; ++b )
+		{
+			const ShieldTriBlock_t &block = m_Blocks[b];
+
+			// Each step below throws out the lanes IntersectRayWithTriangle would
+			// return -1 for at the same step. Comparisons are kept the same way
+			// around as there so NaNs fall the same way too.
+
+			// Cull out one-sided stuff
+			fltx4 reject = CmpGeSIMD( DotProduct4( block.m_Normal, delta ), Four_Zeros );
+			if ( TestSignSIMD( reject ) == 0xF )
+				continue;
+
+			FourVectors dirCrossEdge2;
+			CrossProduct4( delta, block.m_Edge2, dirCrossEdge2 );
+
+			fltx4 denom = DotProduct4( dirCrossEdge2, block.m_Edge1 );
+			reject = OrSIMD( reject, CmpLtSIMD( fabs( denom ), fl4Epsilon ) );
+			denom = DivSIMD( Four_Ones, denom );
+
+			FourVectors org = start;
+			org -= block.m_v1;
+			fltx4 u = MulSIMD( DotProduct4( dirCrossEdge2, org ), denom );
+			reject = OrSIMD( reject, OrSIMD( CmpLtSIMD( u, Four_Zeros ), CmpGtSIMD( u, Four_Ones ) ) );
+
+			FourVectors orgCrossEdge1;
+			CrossProduct4( org, block.m_Edge1, orgCrossEdge1 );
+			fltx4 v = MulSIMD( DotProduct4( orgCrossEdge1, delta ), denom );
+			reject = OrSIMD( reject, OrSIMD( CmpLtSIMD( v, Four_Zeros ), CmpGtSIMD( AddSIMD( v, u ), Four_Ones ) ) );
+
+			fltx4 t = MulSIMD( DotProduct4( orgCrossEdge1, block.m_Edge2 ), denom );
+			reject = OrSIMD( reject, OrSIMD( CmpLtSIMD( t, fl4MinT ), CmpGtSIMD( t, fl4MaxT ) ) );
+
+			int nHits = ~TestSignSIMD( reject ) & 0xF;
+			if ( !nHits )
+				continue;
+
+			// Lanes are in the scalar loop's order, so ties go to the same triangle
+			for ( int k = 0; k < 4; ++k )
+			{
+				if ( !( nHits & ( 1 << k ) ) )
+					continue;
+
+				float flT = clamp( SubFloat( t, k ), 0.f, 1.f );
+				if ((flT >= 0.0f) && (flT < mint))
+				{
+					mint = flT;
+					nTri = block.m_nTri[k];
+				}
+			}
+		}
+	}
+
+	return nTri >= 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Runs the batched shield simulation once a tick, before entities think. The
+// shields' spring simulations and vertex activity traces go out to the job
+// threads, one shield per job, and everything that moves entities or changes
+// networked state happens back on the main thread once they're all done.
+//-----------------------------------------------------------------------------
+class CShieldSimulationSystem : public CAutoGameSystemPerFrame
+{
+public:
+	CShieldSimulationSystem() : CAutoGameSystemPerFrame( "CShieldSimulationSystem" ) {}
+
+	virtual void FrameUpdatePreEntityThink();
+
+private:
+	static void SimulateShield( CShield* &pShield );
+
+	CUtlVector< CShield* >	m_Batch;
+};
+
+static CShieldSimulationSystem s_ShieldSimulationSystem;
+
+
+void CShieldSimulationSystem::SimulateShield( CShield* &pShield )
+{
+	pShield->SimulateBatched();
+}
+
+
+void CShieldSimulationSystem::FrameUpdatePreEntityThink()
+{
+	if ( !shield_batch_simulate.GetBool() )
+		return;
+
+	VPROF( "CShieldSimulationSystem::FrameUpdatePreEntityThink" );
+
+	m_Batch.RemoveAll();
+	for ( int i = 0; i < CShield::s_Shields.Count(); ++i )
+	{
+		CShield *pShield = CShield::s_Shields[i];
+		if ( !pShield->IsMarkedForDeletion() && pShield->BeginBatchedSimulate() )
+		{
+			m_Batch.AddToTail( pShield );
+		}
+	}
+
+	if ( !m_Batch.Count() )
+		return;
+
+	ParallelProcess( "CShield::SimulateBatched", m_Batch.Base(), m_Batch.Count(), &SimulateShield, NULL, NULL, shield_batch_threaded.GetBool() ? INT_MAX : 0 );
+
+	for ( int i = 0; i < m_Batch.Count(); ++i )
+	{
+		m_Batch[i]->EndBatchedSimulate();
+	}
+
+	VPROF_INCREMENT_COUNTER( "Shields: batched", m_Batch.Count() );
+}
+
+
 //-----------------------------------------------------------------------------
 // Returns true if the entity is a shield
 //-----------------------------------------------------------------------------
@@ -55,6 +632,8 @@ END_SEND_TABLE()
 CShield::CShield()
 {
 	s_Shields.AddToTail(this);
+	s_ShieldTree.MarkDirty();
+	m_pCollisionMesh = new CShieldCollisionMesh;
 	AddEFlags( EFL_FORCE_CHECK_TRANSMIT );
 	SetupRecharge( 0,0,0,0 );
 }
@@ -67,6 +646,8 @@ CShield::~CShield()
 	int i = s_Shields.Find(this);
 	if (i >= 0)
 		s_Shields.FastRemove(i);
+	s_ShieldTree.MarkDirty();
+	delete m_pCollisionMesh;
 }
 
 //-----------------------------------------------------------------------------
@@ -164,7 +745,28 @@ void CShield::ActivateShields( bool activate, int team )
 //-----------------------------------------------------------------------------
 // Checks a ray against shields only
 //-----------------------------------------------------------------------------
-bool CShield::IsBlockedByShields( const Vector& src, const Vector& end )
+bool CShield::IsBlockedByShields( const Vector& src, const Vector& end, int iIgnoreTeam )
+{
+	Ray_t ray;
+	ray.Init( src, end );
+
+	return s_ShieldTree.IsBlocked( s_Shields, ray, iIgnoreTeam );
+}
+
+
+void CShield::InvalidateShieldTree()
+{
+	s_ShieldTree.MarkDirty();
+}
+
+
+void CShield::InvalidateCollisionMesh()
+{
+	m_pCollisionMesh->MarkDirty();
+}
+
+
+bool CShield::IsBlockedByShieldsLinear( const Vector& src, const Vector& end, int iIgnoreTeam )
 {
 	trace_t tr;
 	Ray_t ray;
@@ -172,6 +774,9 @@ bool CShield::IsBlockedByShields( const Vector& src, const Vector& end )
 
 	for (int i = s_Shields.Count(); --i >= 0; )
 	{
+		if (s_Shields[i]->GetTeamNumber() == iIgnoreTeam)
+			continue;
+
 		if (!s_Shields[i]->ShouldCollide( TFCOLLISION_GROUP_WEAPON, MASK_ALL ))
 			continue;
 
@@ -325,25 +930,11 @@ void CShield::SetEMPed( bool isEmped )
 #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
 #endif
 
-bool CShield::TestCollision( const Ray_t& ray, unsigned int mask, trace_t& trace )
+bool CShield::FindClosestTriangle( const Ray_t& ray, float &mint, int &ihit, int &jhit, bool &firstTri )
 {
-	// Can't block anything if we're EMPed, or we've got no power left to block
-	if ( IsEMPed() )
-		return false;
-	if ( m_flPower <= 0 )
-		return false;
-
-	// Here, we're gonna test for collision.
-	// If we don't stop this kind of bullet, we'll generate an effect here
-	// but we won't change the trace to indicate a collision.
-
 	// It's just polygon soup...
-	int hitgroup;
-	bool firstTri;
-	int v1[2], v2[2], v3[2];
-	float ihit, jhit;
-	float mint = FLT_MAX;
 	float t;
+	mint = FLT_MAX;
 
 	int h = Height();
 	int w = Width();
@@ -368,9 +959,6 @@ bool CShield::TestCollision( const Ray_t& ray, unsigned int mask, trace_t& trace
 			if ((t >= 0.0f) && (t < mint))
 			{
 				mint = t;
-				v1[0] = j;		v1[1] = i + 1;
-				v2[0] = j + 1;	v2[1] = i + 1;
-				v3[0] = j;		v3[1] = i;
 				ihit = i; jhit = j;
 				firstTri = true;
 			}
@@ -382,18 +970,78 @@ bool CShield::TestCollision( const Ray_t& ray, unsigned int mask, trace_t& trace
 			if ((t >= 0.0f) && (t < mint))
 			{
 				mint = t;
-				v1[0] = j + 1;	v1[1] = i;
-				v2[0] = j;		v2[1] = i;
-				v3[0] = j + 1;	v3[1] = i + 1;
 				ihit = i; jhit = j;
 				firstTri = false;
 			}
 		}
 	}
 
-	if (mint == FLT_MAX)
+	return (mint != FLT_MAX);
+}
+
+
+bool CShield::FindClosestTriangleSIMD( const Ray_t& ray, float &mint, int &ihit, int &jhit, bool &firstTri )
+{
+	m_pCollisionMesh->Update( this );
+
+	int nTri;
+	if ( !m_pCollisionMesh->FindClosestTriangle( ray, mint, nTri ) )
 		return false;
 
+	int nQuad = nTri >> 1;
+	ihit = nQuad / (Width() - 1);
+	jhit = nQuad % (Width() - 1);
+	firstTri = ( nTri & 1 ) == 0;
+	return true;
+}
+
+
+bool CShield::TestCollision( const Ray_t& ray, unsigned int mask, trace_t& trace )
+{
+	// Can't block anything if we're EMPed, or we've got no power left to block
+	if ( IsEMPed() )
+		return false;
+	if ( m_flPower <= 0 )
+		return false;
+
+	// Here, we're gonna test for collision.
+	// If we don't stop this kind of bullet, we'll generate an effect here
+	// but we won't change the trace to indicate a collision.
+	int hitgroup;
+	bool firstTri;
+	int v1[2], v2[2], v3[2];
+	int ihit, jhit;
+	float mint;
+
+	bool bHit;
+	if ( shield_collision_simd.GetBool() )
+	{
+		bHit = FindClosestTriangleSIMD( ray, mint, ihit, jhit, firstTri );
+	}
+	else
+	{
+		bHit = FindClosestTriangle( ray, mint, ihit, jhit, firstTri );
+	}
+
+	if (!bHit)
+		return false;
+
+	if (firstTri)
+	{
+		v1[0] = jhit;		v1[1] = ihit + 1;
+		v2[0] = jhit + 1;	v2[1] = ihit + 1;
+		v3[0] = jhit;		v3[1] = ihit;
+	}
+	else
+	{
+		v1[0] = jhit + 1;	v1[1] = ihit;
+		v2[0] = jhit;		v2[1] = ihit;
+		v3[0] = jhit + 1;	v3[1] = ihit + 1;
+	}
+
+	int h = Height();
+	int w = Width();
+
 	// Stuff the barycentric coordinates of the triangle hit into the hit group 
 	// For the first triangle, the first edge goes along u, the second edge goes
 	// along -v. For the second triangle, the first edge goes along -u,
@@ -439,3 +1087,265 @@ bool CShield::TestCollision( const Ray_t& ray, unsigned int mask, trace_t& trace
 #endif
 
 
+
+
+//-----------------------------------------------------------------------------
+// Weapon trace recording. With shield_trace_record on, every WeaponTraceLine
+// is saved so shield_trace_validate can replay it against the old approach of
+// turning the shooter's shields non-solid for the duration of the trace.
+//-----------------------------------------------------------------------------
+#define SHIELD_TRACE_MAX_RECORDED	4096
+
+ConVar	shield_trace_record( "shield_trace_record", "0", FCVAR_CHEAT, "Record weapon traces for shield_trace_validate." );
+
+struct RecordedShot_t
+{
+	Vector			m_vecSrc;
+	Vector			m_vecEnd;
+	unsigned int	m_nMask;
+	EHANDLE			m_hShooter;
+};
+
+static CUtlVector< RecordedShot_t > s_RecordedShots;
+static int s_nNextRecordedShot = 0;
+
+
+void CShield::RecordShot( const Vector& src, const Vector& end, unsigned int mask, CBaseEntity *pShooter )
+{
+	if ( !shield_trace_record.GetBool() )
+		return;
+
+	// Keep the most recent shots around
+	if ( s_RecordedShots.Count() < SHIELD_TRACE_MAX_RECORDED )
+	{
+		s_RecordedShots.AddToTail();
+		s_nNextRecordedShot = s_RecordedShots.Count() - 1;
+	}
+
+	RecordedShot_t &shot = s_RecordedShots[s_nNextRecordedShot];
+	shot.m_vecSrc = src;
+	shot.m_vecEnd = end;
+	shot.m_nMask = mask;
+	shot.m_hShooter = pShooter;
+
+	s_nNextRecordedShot = ( s_nNextRecordedShot + 1 ) % SHIELD_TRACE_MAX_RECORDED;
+}
+
+
+void CShield::ValidateRecordedShots()
+{
+	CUtlVector< CShield* > disabled;
+	int nTested = 0;
+	int nTraceMismatches = 0;
+	int nBlockMismatches = 0;
+
+	for ( int i = 0; i < s_RecordedShots.Count(); ++i )
+	{
+		const RecordedShot_t &shot = s_RecordedShots[i];
+		CBaseEntity *pShooter = shot.m_hShooter;
+		if ( !pShooter )
+			continue;
+
+		int iTeam = pShooter->GetTeamNumber();
+
+		// The filtered trace (same filters as WeaponTraceLine, without the deflection side effects)...
+		CTraceFilterSimple simpleFilter( pShooter, COLLISION_GROUP_NONE );
+		CTraceFilterIgnoreTeamShields shieldFilter( iTeam );
+		CTraceFilterChain traceFilter( &shieldFilter, &simpleFilter );
+
+		trace_t trFiltered;
+		UTIL_TraceLine( shot.m_vecSrc, shot.m_vecEnd, shot.m_nMask, &traceFilter, &trFiltered );
+
+		// ...vs. turning off our team's shields. Only turn back on the ones we turned off.
+		disabled.RemoveAll();
+		for ( int j = 0; j < s_Shields.Count(); ++j )
+		{
+			if ( s_Shields[j]->GetTeamNumber() == iTeam && !s_Shields[j]->IsSolidFlagSet( FSOLID_NOT_SOLID ) )
+			{
+				s_Shields[j]->ActivateCollisions( false );
+				disabled.AddToTail( s_Shields[j] );
+			}
+		}
+
+		trace_t trToggled;
+		UTIL_TraceLine( shot.m_vecSrc, shot.m_vecEnd, shot.m_nMask, pShooter, COLLISION_GROUP_NONE, &trToggled );
+
+		for ( int j = 0; j < disabled.Count(); ++j )
+		{
+			disabled[j]->ActivateCollisions( true );
+		}
+
+		++nTested;
+		if ( trFiltered.fraction != trToggled.fraction || trFiltered.m_pEnt != trToggled.m_pEnt ||
+			!VectorsAreEqual( trFiltered.endpos, trToggled.endpos, 0.01f ) )
+		{
+			++nTraceMismatches;
+		}
+
+		if ( IsBlockedByShields( shot.m_vecSrc, shot.m_vecEnd, iTeam ) != IsBlockedByShieldsLinear( shot.m_vecSrc, shot.m_vecEnd, iTeam ) )
+		{
+			++nBlockMismatches;
+		}
+	}
+
+	Msg( "shield_trace_validate: %d shots, %d trace mismatches, %d shield tree mismatches\n", nTested, nTraceMismatches, nBlockMismatches );
+}
+
+
+CON_COMMAND_F( shield_trace_validate, "Replays the shots recorded by shield_trace_record and compares shield filtering against the old shield toggling.", FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	CShield::ValidateRecordedShots();
+
+	if ( args.ArgC() > 1 && !Q_stricmp( args[1], "clear" ) )
+	{
+		s_RecordedShots.RemoveAll();
+		s_nNextRecordedShot = 0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Fires random rays through the shields' bounds and times the scalar triangle
+// loop against the packed mesh. Every fourth ray is a small swept box, like the
+// ones the mobile shield pushes things out of the way with.
+//-----------------------------------------------------------------------------
+struct BenchmarkRay_t
+{
+	CShield	*m_pShield;
+	Vector	m_vecStart;
+	Vector	m_vecEnd;
+	bool	m_bBox;
+};
+
+void CShield::RunCollisionBenchmark( int nRays )
+{
+	if ( !s_Shields.Count() )
+	{
+		Msg( "shield_collision_benchmark: no shields\n" );
+		return;
+	}
+
+	CUniformRandomStream random;
+	random.SetSeed( 1 );
+
+	CUtlVector< BenchmarkRay_t > rays;
+	rays.SetCount( nRays );
+	for ( int i = 0; i < nRays; ++i )
+	{
+		BenchmarkRay_t &ray = rays[i];
+		ray.m_pShield = s_Shields[ i % s_Shields.Count() ];
+		ray.m_bBox = ( i % 4 ) == 3;
+
+		Vector vecMins, vecMaxs;
+		ray.m_pShield->CollisionProp()->WorldSpaceAABB( &vecMins, &vecMaxs );
+		Vector vecCenter = ( vecMins + vecMaxs ) * 0.5f;
+		float flRadius = ( vecMaxs - vecMins ).Length() * 0.5f + 32.0f;
+
+		Vector vecDir( random.RandomFloat( -1, 1 ), random.RandomFloat( -1, 1 ), random.RandomFloat( -1, 1 ) );
+		VectorNormalize( vecDir );
+		ray.m_vecStart = vecCenter + vecDir * flRadius * 2.0f;
+
+		Vector vecTarget( random.RandomFloat( vecMins.x, vecMaxs.x ), random.RandomFloat( vecMins.y, vecMaxs.y ), random.RandomFloat( vecMins.z, vecMaxs.z ) );
+		ray.m_vecEnd = ray.m_vecStart + ( vecTarget - ray.m_vecStart ) * 2.0f;
+	}
+
+	Vector vecBoxMins( -4, -4, -4 );
+	Vector vecBoxMaxs( 4, 4, 4 );
+
+	// Repacking is part of what the SIMD path costs, so time it once for every shield
+	double flStart = Plat_FloatTime();
+	for ( int i = 0; i < s_Shields.Count(); ++i )
+	{
+		s_Shields[i]->InvalidateCollisionMesh();
+		s_Shields[i]->m_pCollisionMesh->Update( s_Shields[i] );
+	}
+	double flRepackTime = Plat_FloatTime() - flStart;
+
+	double flTime[2];
+	int nHits[2];
+	for ( int nPass = 0; nPass < 2; ++nPass )
+	{
+		nHits[nPass] = 0;
+		flStart = Plat_FloatTime();
+
+		for ( int i = 0; i < nRays; ++i )
+		{
+			const BenchmarkRay_t &bench = rays[i];
+
+			Ray_t ray;
+			if ( bench.m_bBox )
+			{
+				ray.Init( bench.m_vecStart, bench.m_vecEnd, vecBoxMins, vecBoxMaxs );
+			}
+			else
+			{
+				ray.Init( bench.m_vecStart, bench.m_vecEnd );
+			}
+
+			float mint;
+			int ihit, jhit;
+			bool firstTri;
+			bool bHit = ( nPass == 0 ) ?
+				bench.m_pShield->FindClosestTriangle( ray, mint, ihit, jhit, firstTri ) :
+				bench.m_pShield->FindClosestTriangleSIMD( ray, mint, ihit, jhit, firstTri );
+			if ( bHit )
+			{
+				++nHits[nPass];
+			}
+		}
+
+		flTime[nPass] = Plat_FloatTime() - flStart;
+	}
+
+	// Now make sure both of them pick the same triangle and the same t, down to the bit.
+	// Everything else in the trace is worked out from those.
+	int nMismatches = 0;
+	for ( int i = 0; i < nRays; ++i )
+	{
+		const BenchmarkRay_t &bench = rays[i];
+
+		Ray_t ray;
+		if ( bench.m_bBox )
+		{
+			ray.Init( bench.m_vecStart, bench.m_vecEnd, vecBoxMins, vecBoxMaxs );
+		}
+		else
+		{
+			ray.Init( bench.m_vecStart, bench.m_vecEnd );
+		}
+
+		float mint[2];
+		int ihit[2], jhit[2];
+		bool firstTri[2];
+		bool bHit[2];
+		bHit[0] = bench.m_pShield->FindClosestTriangle( ray, mint[0], ihit[0], jhit[0], firstTri[0] );
+		bHit[1] = bench.m_pShield->FindClosestTriangleSIMD( ray, mint[1], ihit[1], jhit[1], firstTri[1] );
+
+		if ( bHit[0] != bHit[1] )
+		{
+			++nMismatches;
+		}
+		else if ( bHit[0] && ( memcmp( &mint[0], &mint[1], sizeof(float) ) || ihit[0] != ihit[1] || jhit[0] != jhit[1] || firstTri[0] != firstTri[1] ) )
+		{
+			++nMismatches;
+		}
+	}
+
+	Msg( "shield_collision_benchmark: %d rays against %d shields\n", nRays, s_Shields.Count() );
+	Msg( "    scalar: %.3f ms, %.0f rays/sec, %d hits\n", flTime[0] * 1000.0, nRays / max( flTime[0], 1e-9 ), nHits[0] );
+	Msg( "    simd:   %.3f ms, %.0f rays/sec, %d hits (+%.3f ms to repack every shield)\n", flTime[1] * 1000.0, nRays / max( flTime[1], 1e-9 ), nHits[1], flRepackTime * 1000.0 );
+	Msg( "    %.2fx, %d mismatches\n", flTime[0] / max( flTime[1], 1e-9 ), nMismatches );
+}
+
+
+CON_COMMAND_F( shield_collision_benchmark, "Times shield ray tests with and without the packed SIMD mesh and checks they agree. Optional ray count.", FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	int nRays = ( args.ArgC() > 1 ) ? atoi( args[1] ) : 100000;
+	CShield::RunCollisionBenchmark( max( nRays, 1 ) );
+}
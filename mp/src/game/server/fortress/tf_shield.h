@@ -23,6 +23,7 @@ class Vector;
 class CGameTrace;
 typedef CGameTrace trace_t;
 struct edict_t;
+class CShieldCollisionMesh;
 
 
 //-----------------------------------------------------------------------------
@@ -80,6 +81,14 @@ public:
 	// Called when the shield has moved
 	virtual void ShieldMoved() {}
 
+	// Shields that simulate every tick can have it done for all of them at once
+	// before entities think. Begin and End are called on the main thread, and
+	// SimulateBatched on a job thread in between, so it mustn't touch anything
+	// but the shield's own simulation state. Return false from Begin to skip it.
+	virtual bool BeginBatchedSimulate() { return false; }
+	virtual void SimulateBatched() {}
+	virtual void EndBatchedSimulate() {}
+
 	// Called when the shield is EMPed (or de-EMPed)
 	virtual void SetEMPed( bool isEmped );
 
@@ -95,8 +104,24 @@ public:
 	// Make the shield recharge it's health
 	void	ShieldRechargeThink( void );
 
-	// Is this ray blocked by any shields?
-	static bool IsBlockedByShields( const Vector& src, const Vector& end );
+	// Is this ray blocked by any shields? Shields on iIgnoreTeam are skipped.
+	static bool IsBlockedByShields( const Vector& src, const Vector& end, int iIgnoreTeam = -1 );
+
+	// Brute force version of IsBlockedByShields that doesn't use the shield tree.
+	static bool IsBlockedByShieldsLinear( const Vector& src, const Vector& end, int iIgnoreTeam = -1 );
+
+	// Call when a shield moves or changes size so the shield tree gets rebuilt.
+	static void InvalidateShieldTree();
+
+	// Call when the shield's points or active panels change so TestCollision repacks them.
+	void InvalidateCollisionMesh();
+
+	// Times TestCollision with and without the packed mesh and checks they agree.
+	static void RunCollisionBenchmark( int nRays );
+
+	// Records weapon traces so shield_trace_validate can replay them.
+	static void RecordShot( const Vector& src, const Vector& end, unsigned int mask, CBaseEntity *pShooter );
+	static void ValidateRecordedShots();
 
 	virtual void SetOwnerEntity( CBaseEntity *pOwner );
 	
@@ -122,11 +147,20 @@ protected:
 	float			m_flNextRechargeTime;
 
 private:
+	friend class CShieldCollisionMesh;
+	friend class CShieldSimulationSystem;
+
+	// Finds the closest triangle the ray hits, in the order the mesh is walked.
+	bool FindClosestTriangle( const Ray_t& ray, float &mint, int &ihit, int &jhit, bool &firstTri );
+	bool FindClosestTriangleSIMD( const Ray_t& ray, float &mint, int &ihit, int &jhit, bool &firstTri );
+
 	int				m_iBuckshotHitsThisFrame;
 	float			m_flLastProbeTime;
 	CNetworkVar( bool, m_bIsEMPed );
 	CNetworkVar( int, m_nOwningPlayerIndex );
 
+	CShieldCollisionMesh	*m_pCollisionMesh;
+
 	// List of all active shields
 	static CUtlVector< CShield* >	s_Shields;
 };
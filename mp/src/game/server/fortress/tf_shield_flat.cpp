@@ -45,14 +45,23 @@ void CShieldFlat::ShieldMoved( void )
 	Vector forward, right, up;
 	AngleVectors( GetAbsAngles(), &forward, &right, &up );
 
-	VectorMA( GetAbsOrigin(), -m_Width * 0.5, right, m_Pos[0] );
-	VectorMA( m_Pos[0], -m_Height * 0.5, up, m_Pos[0] );
-	VectorMA( m_Pos[0], m_Width, right, m_Pos[1] );
-	VectorMA( m_Pos[0], m_Height, up, m_Pos[2] );
-	VectorMA( m_Pos[2], m_Width, right, m_Pos[3] );
+	Vector vecPos[4];
+	VectorMA( GetAbsOrigin(), -m_Width * 0.5, right, vecPos[0] );
+	VectorMA( vecPos[0], -m_Height * 0.5, up, vecPos[0] );
+	VectorMA( vecPos[0], m_Width, right, vecPos[1] );
+	VectorMA( vecPos[0], m_Height, up, vecPos[2] );
+	VectorMA( vecPos[2], m_Width, right, vecPos[3] );
 
 	m_LastAngles = GetAbsAngles();
 	m_LastPosition = GetAbsOrigin();
+
+	// The shield wall calls this whenever it moves, which doesn't mean we did
+	if ( !memcmp( vecPos, m_Pos, sizeof( m_Pos ) ) )
+		return;
+
+	memcpy( m_Pos, vecPos, sizeof( m_Pos ) );
+	InvalidateShieldTree();
+	InvalidateCollisionMesh();
 }
 
 
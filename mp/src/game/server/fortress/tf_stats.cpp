@@ -15,6 +15,7 @@
 #include "igamesystem.h"
 #include "textstatsmgr.h"
 #include "info_act.h"
+#include "tier0/threadtools.h"
 
 static ConVar tf_stats( "tf_stats", "0", 0, "Enable stat gathering for TF2." );
 
@@ -26,10 +27,17 @@ static ConVar tf_stats( "tf_stats", "0", 0, "Enable stat gathering for TF2." );
 #define TF_STAT_FILE		"tf_stat_total"
 #define TF_TEAM_STAT_FILE	"tf_stat_team"
 #define TF_PLAYER_STAT_FILE "tf_stat_class"
+#define TF_STAT_BINARY_FILE	"tf_stats"
 
-static char s_pStatFile[MAX_PATH];
-static char s_pTeamStatFile[MAX_PATH];
-static char s_pPlayerStatFile[MAX_PATH];
+// Identifies the binary stats file format
+#define TF_STAT_BINARY_MAGIC	"TFS1"
+
+//-----------------------------------------------------------------------------
+// How many snapshots can be waiting for the writer thread
+//-----------------------------------------------------------------------------
+#define TF_STATS_QUEUE_SIZE		32
+
+static ConVar tf_stats_binary( "tf_stats_binary", "0", 0, "Write TF2 stats as one compact binary file (" TF_STAT_BINARY_FILE ".bin) instead of the tab separated text files. Takes effect on the next level." );
 
 //-----------------------------------------------------------------------------
 // Strings assocaited with the stats
@@ -120,16 +128,101 @@ static const char *GetPlayerStatString( int stat )
 }
 
 
+//-----------------------------------------------------------------------------
+// One collection interval's worth of stats, handed from the game thread to the writer
+//-----------------------------------------------------------------------------
+struct TFStatsSnapshot_t
+{
+	bool	m_bStartFiles;		// First snapshot of the level, so (re)create the files and write the headers
+	bool	m_bBinary;			// Only looked at when m_bStartFiles is set
+	int		m_nTime;
+	int		m_Stats[TF_STAT_COUNT];
+	int		m_TeamStats[MAX_TF_TEAMS+1][TF_TEAM_STAT_COUNT];
+	int		m_ClassStats[MAX_TF_TEAMS+1][TFCLASS_CLASS_COUNT][TF_PLAYER_STAT_COUNT];
+};
+
+
+//-----------------------------------------------------------------------------
+// Formats the stats and writes them out on its own thread, so the game thread
+// never touches the disk. The game thread fills in snapshots in a ring buffer;
+// the files are opened once per level and kept open.
+//-----------------------------------------------------------------------------
+class CTFStatsWriter : public CThread
+{
+public:
+	CTFStatsWriter();
+
+	// Game thread. Returns NULL if the writer has fallen too far behind.
+	TFStatsSnapshot_t *BeginSnapshot();
+	void CommitSnapshot();
+
+	// Game thread. Writes out anything queued, then closes the files.
+	void CloseFiles();
+
+	// Game thread. Writes out anything queued, closes the files and waits for the thread to exit.
+	void Stop();
+
+protected:
+	virtual int Run();
+
+private:
+	typedef const char * (*StatNameFunc_t)( int stat );
+
+	void OpenFiles( bool bBinary );
+	void FlushFiles();
+	void CloseFilesNow();
+	void WriteToFile( FileHandle_t fh, CUtlBuffer &buf );
+
+	void WriteSnapshot( const TFStatsSnapshot_t &snapshot );
+
+	// Text format, one tab separated file each for the total, team and class stats
+	void WriteHeader( CUtlBuffer &buf, const char *pPrefix, int nCount, StatNameFunc_t func, bool bTerminate = true );
+	void WriteStatLine( CUtlBuffer &buf, int nCount, const int *pStats, bool bTerminate = true );
+	void WriteAvgStatLine( CUtlBuffer &buf, const TFStatsSnapshot_t &snapshot );
+	void WriteStats( const TFStatsSnapshot_t &snapshot );
+	void WriteTeamStats( const TFStatsSnapshot_t &snapshot );
+	void WritePlayerStats( const TFStatsSnapshot_t &snapshot );
+
+	// Binary format, every stat is a column and each record only has the columns that changed
+	void WriteBinaryHeader();
+	void WriteBinaryRecord( const TFStatsSnapshot_t &snapshot );
+	void GatherColumns( const TFStatsSnapshot_t &snapshot, CUtlVector<int> &columns );
+
+	// Shared with the game thread
+	CThreadMutex		m_Mutex;
+	CThreadEvent		m_Signal;
+	TFStatsSnapshot_t	m_Queue[TF_STATS_QUEUE_SIZE];
+	int					m_nCommitted;
+	int					m_nWritten;
+	bool				m_bCloseRequested;
+	bool				m_bExitRequested;
+
+	// Only touched by the writer thread
+	bool				m_bBinary;
+	FileHandle_t		m_hStatFile;
+	FileHandle_t		m_hTeamStatFile;
+	FileHandle_t		m_hPlayerStatFile;
+	FileHandle_t		m_hBinaryFile;
+	CUtlBuffer			m_TextBuf;
+	CUtlBuffer			m_BinaryBuf;
+	CUtlVector<int>		m_Columns;
+	CUtlVector<int>		m_LastColumns;
+	int					m_nLastRecordTime;
+};
+
+
 //-----------------------------------------------------------------------------
 // Implementation of the TF stats class
 //-----------------------------------------------------------------------------
-class CTFStats : public CAutoGameSystem, public ITFStats
+class CTFStats : public CAutoGameSystemPerFrame, public ITFStats
 {
 public:
 	CTFStats();
 
 	// Inherited from IAutoServerSystem
 	virtual void LevelInitPreEntity();
+	virtual void LevelShutdownPostEntity();
+	virtual void Shutdown();
 	virtual void FrameUpdatePostEntityThink( );
 
 	// Clear out the stats + their history
@@ -144,6 +237,9 @@ public:
 	void IncrementPlayerStat( CBaseEntity *pPlayer, TFPlayerStatId_t stat, int nIncrement );
 	void ClearPlayerStat( int nTeam, TFPlayerStatId_t stat );
 
+	void PlayerActivityChanged( CBaseEntity *pPlayer, Activity newActivity );
+	void FlushPlayerActivity( CBaseEntity *pPlayer );
+
 	// We need to be ticked once a frame
 	void FrameUpdate( );
 
@@ -153,23 +249,20 @@ private:
 		int m_nCount;
 	};
 
-	typedef const char * (*StatNameFunc_t)( int stat );
+	// What each player is currently doing, and since when
+	struct ActivitySpan_t
+	{
+		EHANDLE	m_hPlayer;
+		int		m_nStat;		// Animation stat the span counts towards, or -1 if we don't know yet
+		float	m_flStartTime;
+	};
 
-	// Collects frame-based stats
-	void CollectFrameStats( );
+	bool IsCollecting() const;
 	void CollectStats( );
 
 	int	GetStat( TFStatId_t stat ) const	{ return m_Stats[stat].m_nCount; }
 	int	GetTeamStat( int nTeam, TFTeamStatId_t stat ) const	{ return m_TeamStats[nTeam][stat].m_nCount; }
-	void WriteHeader( CUtlBuffer &buf, const char *pPrefix, int nCount, StatNameFunc_t func, bool bTerminate = true );
-	void WriteStatLine( CUtlBuffer &buf, int nCount, Stat_t *pStats, bool bTerminate = true );
-	void WriteAvgStatLine( CUtlBuffer &buf );
-	void WriteStats();
-	void WriteTeamStats();
-	void WritePlayerStats( );
-	void EraseFile( const char *pFileName );
-	void AppendToFile( const char *pFileName, CUtlBuffer &buf );
-	void ComputeFileNames();
+	bool QueueSnapshot();
 	void ClearStats();
 
 	// Compute class-based stats from the player stats
@@ -180,6 +273,10 @@ private:
 	Stat_t	m_Stats[TF_STAT_COUNT];
 	Stat_t	m_TeamStats[MAX_TF_TEAMS+1][TF_TEAM_STAT_COUNT];
 	Stat_t	m_ClassStats[MAX_TF_TEAMS+1][TFCLASS_CLASS_COUNT][TF_PLAYER_STAT_COUNT];
+
+	ActivitySpan_t	m_ActivitySpans[MAX_PLAYERS+1];
+
+	CTFStatsWriter	m_Writer;
 };
 
 
@@ -196,7 +293,7 @@ ITFStats *TFStats()
 //-----------------------------------------------------------------------------
 // Constructor, destructor
 //-----------------------------------------------------------------------------
-CTFStats::CTFStats()
+CTFStats::CTFStats() : CAutoGameSystemPerFrame( "CTFStats" )
 {
 	ResetStats();
 }
@@ -253,6 +350,17 @@ void CTFStats::LevelInitPreEntity()
 	ResetStats();
 }
 
+void CTFStats::LevelShutdownPostEntity()
+{
+	// Don't hang on to the files between levels
+	m_Writer.CloseFiles();
+}
+
+void CTFStats::Shutdown()
+{
+	m_Writer.Stop();
+}
+
 
 //-----------------------------------------------------------------------------
 // Update stats...
@@ -300,51 +408,78 @@ void CTFStats::ClearPlayerStat( int nTeam, TFPlayerStatId_t stat )
 
 
 //-----------------------------------------------------------------------------
-// We need to be ticked once a frame
+// Are we gathering stats right now?
 //-----------------------------------------------------------------------------
-void CTFStats::CollectFrameStats( )
+bool CTFStats::IsCollecting() const
 {
-	// This collects a bunch of polled stats so we don't have to pollute
-	// a bunch of code
-	for (int i = 1; i < MAX_TF_TEAMS+1; ++i)
+	// Don't stat gather during waiting acts
+	return tf_stats.GetBool() && !CurrentActIsAWaitingAct();
+}
+
+
+//-----------------------------------------------------------------------------
+// Animation time is added up when the activity changes instead of being polled
+// every frame, so it's exact rather than a multiple of the frametime.
+//-----------------------------------------------------------------------------
+static int GetActivityStat( Activity activity )
+{
+	switch( activity )
 	{
-		CTFTeam *pTeam = GetGlobalTFTeam(i);
-		for (int j = pTeam->GetNumPlayers(); --j >= 0; )
-		{
-			CBaseTFPlayer *pPlayer = static_cast<CBaseTFPlayer*>(pTeam->GetPlayer(j));
-			if (!pPlayer)
-				continue;
+	case ACT_IDLE:
+		return TF_PLAYER_STAT_ANIMATION_IDLE;
 
-			int nTimeMS = 1000 * gpGlobals->frametime;
+	case ACT_WALK:
+		return TF_PLAYER_STAT_ANIMATION_WALKING;
 
-			switch( pPlayer->GetActivity() )
-			{
-			case ACT_IDLE:
-				IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_ANIMATION_IDLE, nTimeMS );
-				break;
+	case ACT_RUN:
+		return TF_PLAYER_STAT_ANIMATION_RUNNING;
 
-			case ACT_WALK:
-				IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_ANIMATION_WALKING, nTimeMS );
-				break;
+	case ACT_JUMP:
+		return TF_PLAYER_STAT_ANIMATION_JUMPING;
 
-			case ACT_RUN:
-				IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_ANIMATION_RUNNING, nTimeMS );
-				break;
+	case ACT_CROUCHIDLE:
+		return TF_PLAYER_STAT_ANIMATION_CROUCHING;
 
-			case ACT_JUMP:
-				IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_ANIMATION_JUMPING, nTimeMS );
-				break;
+	default:
+		return TF_PLAYER_STAT_ANIMATION_OTHER;
+	}
+}
 
-			case ACT_CROUCHIDLE:
-				IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_ANIMATION_CROUCHING, nTimeMS );
-				break;
+void CTFStats::PlayerActivityChanged( CBaseEntity *pPlayer, Activity newActivity )
+{
+	int nIndex = pPlayer->entindex();
+	if ( nIndex < 1 || nIndex > MAX_PLAYERS )
+		return;
 
-			default:
-				IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_ANIMATION_OTHER, nTimeMS );
-				break;
-			}
-		}
+	FlushPlayerActivity( pPlayer );
+
+	ActivitySpan_t &span = m_ActivitySpans[nIndex];
+	span.m_hPlayer = pPlayer;
+	span.m_nStat = GetActivityStat( newActivity );
+	span.m_flStartTime = gpGlobals->curtime;
+}
+
+void CTFStats::FlushPlayerActivity( CBaseEntity *pPlayer )
+{
+	int nIndex = pPlayer->entindex();
+	if ( nIndex < 1 || nIndex > MAX_PLAYERS )
+		return;
+
+	ActivitySpan_t &span = m_ActivitySpans[nIndex];
+	if ( span.m_hPlayer != pPlayer )
+	{
+		// Somebody else's, or nothing yet
+		span.m_hPlayer = pPlayer;
+		span.m_nStat = -1;
+	}
+	else if ( span.m_nStat >= 0 && IsCollecting() )
+	{
+		// Round both ends so the pieces of a span add up to the whole thing
+		int nTimeMS = (int)( 1000 * gpGlobals->curtime ) - (int)( 1000 * span.m_flStartTime );
+		IncrementPlayerStat( pPlayer, (TFPlayerStatId_t)span.m_nStat, nTimeMS );
 	}
+
+	span.m_flStartTime = gpGlobals->curtime;
 }
 
 
@@ -388,6 +523,10 @@ void CTFStats::CollectStats( )
 			IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_RESOURCES_CARRIED, pPlayer->GetBankResources() );
 			IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_PLAYER_COUNT, 1 );
 			IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_PLAYER_SECONDS, 1 );
+			IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_CURRENT_OBJECT_VALUE, pPlayer->GetObjectValue() );
+
+			// Count the animation time up to now in this interval, the rest goes in the next one
+			FlushPlayerActivity( pPlayer );
 
 			CPlayerClass *pPlayerClass = pPlayer->GetPlayerClass();
 			int nClass = pPlayerClass ? pPlayerClass->GetTFClass() : TFCLASS_UNDECIDED;
@@ -397,54 +536,302 @@ void CTFStats::CollectStats( )
 				IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_EXISTING_SECONDS, 1 );
 				bClassEncountered[nClass] = true;
 			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Copies the current stats into the writer's queue
+//-----------------------------------------------------------------------------
+bool CTFStats::QueueSnapshot()
+{
+	TFStatsSnapshot_t *pSnapshot = m_Writer.BeginSnapshot();
+	if ( !pSnapshot )
+		return false;
 
-			// Count up the cost of all current objects..
-			int nCost = 0;
-			int pObjectCount[OBJ_LAST];
-			memset( pObjectCount, 0, OBJ_LAST * sizeof(int) );
-			for (int k = pPlayer->GetObjectCount(); --k >= 0; )
+	pSnapshot->m_bStartFiles = !m_bWrittenHeader;
+	pSnapshot->m_bBinary = tf_stats_binary.GetBool();
+	pSnapshot->m_nTime = (int)gpGlobals->curtime;
+
+	int i, j, k;
+	for ( i = 0; i < TF_STAT_COUNT; ++i )
+	{
+		pSnapshot->m_Stats[i] = m_Stats[i].m_nCount;
+	}
+
+	for ( i = 0; i <= MAX_TF_TEAMS; ++i )
+	{
+		for ( j = 0; j < TF_TEAM_STAT_COUNT; ++j )
+		{
+			pSnapshot->m_TeamStats[i][j] = m_TeamStats[i][j].m_nCount;
+		}
+
+		for ( j = 0; j < TFCLASS_CLASS_COUNT; ++j )
+		{
+			for ( k = 0; k < TF_PLAYER_STAT_COUNT; ++k )
 			{
-				CBaseObject *pObject = pPlayer->GetObject(k);
-				if (pObject)
-				{
-					int nType = pObject->GetType();
-					nCost += CalculateObjectCost( nType, pObjectCount[nType], pPlayer->GetTeamNumber(), false );
-					++pObjectCount[nType];
-				}
+				pSnapshot->m_ClassStats[i][j][k] = m_ClassStats[i][j][k].m_nCount;
 			}
-			IncrementPlayerStat( pPlayer, TF_PLAYER_STAT_CURRENT_OBJECT_VALUE, nCost );
 		}
 	}
+
+	m_Writer.CommitSnapshot();
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// We need to be ticked once a frame
+//-----------------------------------------------------------------------------
+void CTFStats::FrameUpdatePostEntityThink( )
+{
+	if ( !IsCollecting() )
+		return;
+
+	// NOTE: We could keep track of the history here if we wanted for later
+	// display when the map ends
+
+	// Record the history every so often
+	if (gpGlobals->curtime - m_nLastWriteTime < TF_STATS_COLLECTION_TIME)
+		return;
+
+	CollectStats();	
+
+	// The writer thread does the formatting and the file I/O.
+	if ( QueueSnapshot() )
+	{
+		// By this point, we've queued the header for each file
+		m_bWrittenHeader = true;
+	}
+	else
+	{
+		DevWarning( "tf_stats: stat writer has fallen behind, dropping %d seconds of stats\n", TF_STATS_COLLECTION_TIME );
+	}
+
+	ClearStats();
+
+	m_nLastWriteTime = gpGlobals->curtime;
+}
+
+
+//-----------------------------------------------------------------------------
+// Binary format helpers. Unsigned LEB128 varints, signed values are zigzagged.
+//-----------------------------------------------------------------------------
+static void PutVarInt( CUtlBuffer &buf, unsigned int nValue )
+{
+	while ( nValue >= 0x80 )
+	{
+		buf.PutUnsignedChar( ( nValue & 0x7F ) | 0x80 );
+		nValue >>= 7;
+	}
+	buf.PutUnsignedChar( nValue );
+}
+
+static void PutSignedVarInt( CUtlBuffer &buf, int nValue )
+{
+	PutVarInt( buf, ( (unsigned int)nValue << 1 ) ^ (unsigned int)( nValue >> 31 ) );
 }
 
 
 //-----------------------------------------------------------------------------
-// Purpose: 
-// Output : char const
+// CTFStatsWriter
 //-----------------------------------------------------------------------------
-void CTFStats::ComputeFileNames()
+CTFStatsWriter::CTFStatsWriter() : 
+	m_TextBuf( 0, 1024, CUtlBuffer::TEXT_BUFFER ),
+	m_BinaryBuf( 0, 1024, 0 )
 {
-	Q_snprintf( s_pStatFile, sizeof( s_pStatFile ), "%s.txt", TF_STAT_FILE );
-	Q_snprintf( s_pTeamStatFile, sizeof( s_pTeamStatFile ), "%s.txt", TF_TEAM_STAT_FILE );
-	Q_snprintf( s_pPlayerStatFile, sizeof( s_pPlayerStatFile ), "%s.txt", TF_PLAYER_STAT_FILE );
+	SetName( "TFStatsWriter" );
+
+	m_nCommitted = 0;
+	m_nWritten = 0;
+	m_bCloseRequested = false;
+	m_bExitRequested = false;
+
+	m_bBinary = false;
+	m_hStatFile = FILESYSTEM_INVALID_HANDLE;
+	m_hTeamStatFile = FILESYSTEM_INVALID_HANDLE;
+	m_hPlayerStatFile = FILESYSTEM_INVALID_HANDLE;
+	m_hBinaryFile = FILESYSTEM_INVALID_HANDLE;
+	m_nLastRecordTime = 0;
 }
 
 
 //-----------------------------------------------------------------------------
-// File access.
+// Game thread side
 //-----------------------------------------------------------------------------
-void CTFStats::EraseFile( const char *pFileName )
+TFStatsSnapshot_t *CTFStatsWriter::BeginSnapshot()
+{
+	if ( !IsAlive() )
+	{
+		m_bExitRequested = false;
+		if ( !Start() )
+			return NULL;
+	}
+
+	AUTO_LOCK( m_Mutex );
+	if ( m_nCommitted - m_nWritten >= TF_STATS_QUEUE_SIZE )
+		return NULL;
+
+	// The writer never looks at slots past m_nCommitted, so this one's ours until it's committed
+	return &m_Queue[ m_nCommitted % TF_STATS_QUEUE_SIZE ];
+}
+
+void CTFStatsWriter::CommitSnapshot()
 {
-	filesystem->RemoveFile( pFileName, "GAME" );
+	{
+		AUTO_LOCK( m_Mutex );
+		++m_nCommitted;
+	}
+	m_Signal.Set();
 }
 
-void CTFStats::AppendToFile( const char *pFileName, CUtlBuffer &buf )
+void CTFStatsWriter::CloseFiles()
 {
-	FileHandle_t fh = filesystem->Open( pFileName, "a", "LOGDIR" );
-	if (fh != FILESYSTEM_INVALID_HANDLE)
+	if ( !IsAlive() )
+		return;
+
+	{
+		AUTO_LOCK( m_Mutex );
+		m_bCloseRequested = true;
+	}
+	m_Signal.Set();
+}
+
+void CTFStatsWriter::Stop()
+{
+	if ( !IsAlive() )
+		return;
+
+	{
+		AUTO_LOCK( m_Mutex );
+		m_bExitRequested = true;
+	}
+	m_Signal.Set();
+	Join();
+}
+
+
+//-----------------------------------------------------------------------------
+// Writer thread side
+//-----------------------------------------------------------------------------
+int CTFStatsWriter::Run()
+{
+	while ( true )
+	{
+		m_Signal.Wait();
+
+		// Grab the requests first so everything queued before them gets written out
+		bool bClose, bExit;
+		{
+			AUTO_LOCK( m_Mutex );
+			bClose = m_bCloseRequested;
+			bExit = m_bExitRequested;
+			m_bCloseRequested = false;
+		}
+
+		while ( true )
+		{
+			int nIndex;
+			{
+				AUTO_LOCK( m_Mutex );
+				if ( m_nWritten == m_nCommitted )
+					break;
+				nIndex = m_nWritten % TF_STATS_QUEUE_SIZE;
+			}
+
+			WriteSnapshot( m_Queue[nIndex] );
+
+			AUTO_LOCK( m_Mutex );
+			++m_nWritten;
+		}
+
+		FlushFiles();
+
+		if ( bClose || bExit )
+		{
+			CloseFilesNow();
+		}
+
+		if ( bExit )
+			break;
+	}
+
+	return 0;
+}
+
+void CTFStatsWriter::OpenFiles( bool bBinary )
+{
+	CloseFilesNow();
+
+	m_bBinary = bBinary;
+
+	char pFileName[MAX_PATH];
+	if ( m_bBinary )
+	{
+		Q_snprintf( pFileName, sizeof( pFileName ), "%s.bin", TF_STAT_BINARY_FILE );
+		m_hBinaryFile = filesystem->Open( pFileName, "wb", "LOGDIR" );
+	}
+	else
+	{
+		Q_snprintf( pFileName, sizeof( pFileName ), "%s.txt", TF_STAT_FILE );
+		m_hStatFile = filesystem->Open( pFileName, "w", "LOGDIR" );
+		Q_snprintf( pFileName, sizeof( pFileName ), "%s.txt", TF_TEAM_STAT_FILE );
+		m_hTeamStatFile = filesystem->Open( pFileName, "w", "LOGDIR" );
+		Q_snprintf( pFileName, sizeof( pFileName ), "%s.txt", TF_PLAYER_STAT_FILE );
+		m_hPlayerStatFile = filesystem->Open( pFileName, "w", "LOGDIR" );
+	}
+}
+
+void CTFStatsWriter::FlushFiles()
+{
+	FileHandle_t pFiles[] = { m_hStatFile, m_hTeamStatFile, m_hPlayerStatFile, m_hBinaryFile };
+	for ( int i = 0; i < ARRAYSIZE( pFiles ); ++i )
+	{
+		if ( pFiles[i] != FILESYSTEM_INVALID_HANDLE )
+		{
+			filesystem->Flush( pFiles[i] );
+		}
+	}
+}
+
+void CTFStatsWriter::CloseFilesNow()
+{
+	FileHandle_t *pFiles[] = { &m_hStatFile, &m_hTeamStatFile, &m_hPlayerStatFile, &m_hBinaryFile };
+	for ( int i = 0; i < ARRAYSIZE( pFiles ); ++i )
+	{
+		if ( *pFiles[i] != FILESYSTEM_INVALID_HANDLE )
+		{
+			filesystem->Close( *pFiles[i] );
+			*pFiles[i] = FILESYSTEM_INVALID_HANDLE;
+		}
+	}
+}
+
+void CTFStatsWriter::WriteToFile( FileHandle_t fh, CUtlBuffer &buf )
+{
+	if ( fh != FILESYSTEM_INVALID_HANDLE )
 	{
 		filesystem->Write( buf.Base(), buf.TellPut(), fh );
-		filesystem->Close( fh );
+	}
+}
+
+void CTFStatsWriter::WriteSnapshot( const TFStatsSnapshot_t &snapshot )
+{
+	if ( snapshot.m_bStartFiles )
+	{
+		OpenFiles( snapshot.m_bBinary );
+	}
+
+	if ( m_bBinary )
+	{
+		WriteBinaryRecord( snapshot );
+	}
+	else
+	{
+		WriteStats( snapshot );
+		WriteTeamStats( snapshot );
+		WritePlayerStats( snapshot );
 	}
 }
 
@@ -452,7 +839,7 @@ void CTFStats::AppendToFile( const char *pFileName, CUtlBuffer &buf )
 //-----------------------------------------------------------------------------
 // Write out a header.
 //-----------------------------------------------------------------------------
-void CTFStats::WriteHeader( CUtlBuffer &buf, const char *pPrefix, int nCount, StatNameFunc_t func, bool bTerminate )
+void CTFStatsWriter::WriteHeader( CUtlBuffer &buf, const char *pPrefix, int nCount, StatNameFunc_t func, bool bTerminate )
 {
 	for (int i = 0; i < nCount-1; ++i)
 	{
@@ -462,17 +849,17 @@ void CTFStats::WriteHeader( CUtlBuffer &buf, const char *pPrefix, int nCount, St
 	buf.Printf( bTerminate ? "%s %s\n" : "%s %s\t", pPrefix, func(nCount-1) );
 }
 
-void CTFStats::WriteStatLine( CUtlBuffer &buf, int nCount, Stat_t *pStats, bool bTerminate )
+void CTFStatsWriter::WriteStatLine( CUtlBuffer &buf, int nCount, const int *pStats, bool bTerminate )
 {
 	for (int i = 0; i < nCount-1; ++i)
 	{
-		buf.Printf("%d\t", pStats[i].m_nCount );
+		buf.Printf("%d\t", pStats[i] );
 	}
 
-	buf.Printf( bTerminate ? "%d\n" : "%d\t", pStats[nCount-1].m_nCount );
+	buf.Printf( bTerminate ? "%d\n" : "%d\t", pStats[nCount-1] );
 }
 
-void CTFStats::WriteAvgStatLine( CUtlBuffer &buf )
+void CTFStatsWriter::WriteAvgStatLine( CUtlBuffer &buf, const TFStatsSnapshot_t &snapshot )
 {
 	int nTeam, i, j;
 	for ( nTeam = 1; nTeam <= MAX_TF_TEAMS; ++nTeam )
@@ -484,7 +871,7 @@ void CTFStats::WriteAvgStatLine( CUtlBuffer &buf )
 				if (!GetTFClassInfo(j)->m_pCurrentlyActive)
 					continue;
 
-				buf.Printf("%d\t", m_ClassStats[nTeam][j][i].m_nCount);
+				buf.Printf("%d\t", snapshot.m_ClassStats[nTeam][j][i]);
 			}
 		}
 	}
@@ -497,32 +884,32 @@ void CTFStats::WriteAvgStatLine( CUtlBuffer &buf )
 //-----------------------------------------------------------------------------
 // Write out total stats...
 //-----------------------------------------------------------------------------
-void CTFStats::WriteStats()
+void CTFStatsWriter::WriteStats( const TFStatsSnapshot_t &snapshot )
 {
-	CUtlBuffer buf( 0, 1024, CUtlBuffer::TEXT_BUFFER );
+	CUtlBuffer &buf = m_TextBuf;
+	buf.Clear();
 
-	if (!m_bWrittenHeader)
+	if ( snapshot.m_bStartFiles )
 	{
-		EraseFile( s_pStatFile );
 		WriteHeader( buf, "", TF_STAT_COUNT, GetStatString );
 	}
 
-	WriteStatLine( buf, TF_STAT_COUNT, m_Stats );
-	AppendToFile( s_pStatFile, buf );
+	WriteStatLine( buf, TF_STAT_COUNT, snapshot.m_Stats );
+	WriteToFile( m_hStatFile, buf );
 }
 
 
 //-----------------------------------------------------------------------------
 // Write out total stats...
 //-----------------------------------------------------------------------------
-void CTFStats::WriteTeamStats()
+void CTFStatsWriter::WriteTeamStats( const TFStatsSnapshot_t &snapshot )
 {
-	CUtlBuffer buf( 0, 1024, CUtlBuffer::TEXT_BUFFER );
+	CUtlBuffer &buf = m_TextBuf;
+	buf.Clear();
 
 	int i,j;
-	if (!m_bWrittenHeader)
+	if ( snapshot.m_bStartFiles )
 	{
-		EraseFile( s_pTeamStatFile );
 		for ( i = 0; i < TF_TEAM_STAT_COUNT; ++i )
 		{
 			for ( j = 1; j <= MAX_TF_TEAMS; ++j )
@@ -539,7 +926,7 @@ void CTFStats::WriteTeamStats()
 	{
 		for ( j = 1; j <= MAX_TF_TEAMS; ++j )
 		{
-			buf.Printf("%d\t", m_TeamStats[j][i].m_nCount );
+			buf.Printf("%d\t", snapshot.m_TeamStats[j][i] );
 		}
 	}
 
@@ -547,21 +934,21 @@ void CTFStats::WriteTeamStats()
 	buf.SeekPut( CUtlBuffer::SEEK_CURRENT, -1 );
 	buf.Printf("\n");
 
-	AppendToFile( s_pTeamStatFile, buf );
+	WriteToFile( m_hTeamStatFile, buf );
 }
 
 
 //-----------------------------------------------------------------------------
 // Write out total stats...
 //-----------------------------------------------------------------------------
-void CTFStats::WritePlayerStats( )
+void CTFStatsWriter::WritePlayerStats( const TFStatsSnapshot_t &snapshot )
 {
-	CUtlBuffer buf( 0, 1024, CUtlBuffer::TEXT_BUFFER );
+	CUtlBuffer &buf = m_TextBuf;
+	buf.Clear();
 
 	int i, j, nTeam;
-	if (!m_bWrittenHeader)
+	if ( snapshot.m_bStartFiles )
 	{
-		EraseFile( s_pPlayerStatFile );
 		for ( nTeam = 1; nTeam <= MAX_TF_TEAMS; ++nTeam )
 		{
 			for ( i = 0; i < TF_PLAYER_STAT_COUNT; ++i )
@@ -581,46 +968,142 @@ void CTFStats::WritePlayerStats( )
 		buf.Printf("\n");
 	}
 
-	WriteAvgStatLine( buf );
+	WriteAvgStatLine( buf, snapshot );
 
-	AppendToFile( s_pPlayerStatFile, buf );
+	WriteToFile( m_hPlayerStatFile, buf );
 }
 
 
 //-----------------------------------------------------------------------------
-// We need to be ticked once a frame
+// Binary stats file:
+//
+//	header:	"TFS1", int32 column count, then the column names as null terminated strings
+//	record:	varint seconds since the last record (since 0 for the first one),
+//			varint number of changed columns, then for each changed column
+//			varint column index minus the previous changed column's index (first is the index + 1),
+//			zigzag varint change in value
+//
+// Every value starts at 0. Integers are little endian. The columns are the same
+// stats as the text files, in the same order: totals, then team stats, then class stats.
 //-----------------------------------------------------------------------------
-void CTFStats::FrameUpdatePostEntityThink( )
+void CTFStatsWriter::GatherColumns( const TFStatsSnapshot_t &snapshot, CUtlVector<int> &columns )
 {
-	if (!tf_stats.GetBool())
-		return;
+	columns.RemoveAll();
 
-	// Don't stat gather during waiting acts
-	if ( CurrentActIsAWaitingAct() )
-		return;
+	int i, j, nTeam;
+	for ( i = 0; i < TF_STAT_COUNT; ++i )
+	{
+		columns.AddToTail( snapshot.m_Stats[i] );
+	}
 
-	CollectFrameStats();	
+	for ( i = 0; i < TF_TEAM_STAT_COUNT; ++i )
+	{
+		for ( j = 1; j <= MAX_TF_TEAMS; ++j )
+		{
+			columns.AddToTail( snapshot.m_TeamStats[j][i] );
+		}
+	}
 
-	// NOTE: We could keep track of the history here if we wanted for later
-	// display when the map ends
+	for ( nTeam = 1; nTeam <= MAX_TF_TEAMS; ++nTeam )
+	{
+		for ( i = 0; i < TF_PLAYER_STAT_COUNT; ++i )
+		{
+			for ( j = 1; j < TFCLASS_CLASS_COUNT; ++j )
+			{
+				if (!GetTFClassInfo(j)->m_pCurrentlyActive)
+					continue;
 
-	// Record the history every so often
-	if (gpGlobals->curtime - m_nLastWriteTime < TF_STATS_COLLECTION_TIME)
-		return;
+				columns.AddToTail( snapshot.m_ClassStats[nTeam][j][i] );
+			}
+		}
+	}
+}
+
+void CTFStatsWriter::WriteBinaryHeader()
+{
+	CUtlBuffer &buf = m_BinaryBuf;
+	buf.Clear();
+	buf.Put( TF_STAT_BINARY_MAGIC, 4 );
+	buf.PutInt( LittleLong( m_LastColumns.Count() ) );
 
-	if (!m_bWrittenHeader)
+	char pName[256];
+	int i, j, nTeam;
+	for ( i = 0; i < TF_STAT_COUNT; ++i )
 	{
-		ComputeFileNames();
+		buf.PutString( GetStatString(i) );
 	}
 
-	CollectStats();	
-	WriteStats();
-	WriteTeamStats();
-	WritePlayerStats();
-	ClearStats();
+	for ( i = 0; i < TF_TEAM_STAT_COUNT; ++i )
+	{
+		for ( j = 1; j <= MAX_TF_TEAMS; ++j )
+		{
+			Q_snprintf( pName, sizeof( pName ), "Team %d %s", j, GetTeamStatString(i) );
+			buf.PutString( pName );
+		}
+	}
+
+	for ( nTeam = 1; nTeam <= MAX_TF_TEAMS; ++nTeam )
+	{
+		for ( i = 0; i < TF_PLAYER_STAT_COUNT; ++i )
+		{
+			for ( j = 1; j < TFCLASS_CLASS_COUNT; ++j )
+			{
+				if (!GetTFClassInfo(j)->m_pCurrentlyActive)
+					continue;
 
-	// By this point, we've written the header for each file
-	m_bWrittenHeader = true;
+				Q_snprintf( pName, sizeof( pName ), "Team %d %s %s", nTeam, GetTFClassInfo( j )->m_pClassName, GetPlayerStatString(i) );
+				buf.PutString( pName );
+			}
+		}
+	}
 
-	m_nLastWriteTime = gpGlobals->curtime;
+	WriteToFile( m_hBinaryFile, buf );
+}
+
+void CTFStatsWriter::WriteBinaryRecord( const TFStatsSnapshot_t &snapshot )
+{
+	GatherColumns( snapshot, m_Columns );
+
+	if ( snapshot.m_bStartFiles )
+	{
+		// Every column starts at zero
+		m_LastColumns.SetCount( m_Columns.Count() );
+		for ( int i = 0; i < m_LastColumns.Count(); ++i )
+		{
+			m_LastColumns[i] = 0;
+		}
+		m_nLastRecordTime = 0;
+
+		WriteBinaryHeader();
+	}
+
+	Assert( m_Columns.Count() == m_LastColumns.Count() );
+
+	int nChanged = 0;
+	for ( int i = 0; i < m_Columns.Count(); ++i )
+	{
+		if ( m_Columns[i] != m_LastColumns[i] )
+			++nChanged;
+	}
+
+	CUtlBuffer &buf = m_BinaryBuf;
+	buf.Clear();
+	PutVarInt( buf, max( snapshot.m_nTime - m_nLastRecordTime, 0 ) );
+	PutVarInt( buf, nChanged );
+
+	int nPrevIndex = -1;
+	for ( int i = 0; i < m_Columns.Count(); ++i )
+	{
+		if ( m_Columns[i] == m_LastColumns[i] )
+			continue;
+
+		PutVarInt( buf, i - nPrevIndex );
+		PutSignedVarInt( buf, m_Columns[i] - m_LastColumns[i] );
+		nPrevIndex = i;
+	}
+
+	WriteToFile( m_hBinaryFile, buf );
+
+	m_LastColumns.Swap( m_Columns );
+	m_nLastRecordTime = snapshot.m_nTime;
 }
@@ -94,6 +94,12 @@ public:
 	virtual void SetTeamStat( int nTeam, TFTeamStatId_t stat, int nAmount ) = 0;
 
 	virtual void IncrementPlayerStat( CBaseEntity *pPlayer, TFPlayerStatId_t stat, int nIncrement ) = 0;
+
+	// The player's animation activity changed; the time spent in the old one is added to its stat
+	virtual void PlayerActivityChanged( CBaseEntity *pPlayer, Activity newActivity ) = 0;
+
+	// Adds the time spent in the player's current activity so far, call before their team or class changes
+	virtual void FlushPlayerActivity( CBaseEntity *pPlayer ) = 0;
 };
 
 
@@ -18,6 +18,8 @@
 #include "engine/IEngineSound.h"
 #include "tf_stats.h"
 #include "tf_obj_buff_station.h"
+#include "tf_tacticalmap.h"
+#include "tier0/vprof.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -27,10 +29,55 @@
 #define RESOURCE_GIVE_AMOUNT 150
 #define RESOURCE_DONATION_AMT_PER_PLAYER 10
 
-bool IsEntityVisibleToTactical( int iLocalTeamNumber, int iLocalTeamPlayers, 
-	int iLocalTeamObjects, int iEntIndex, const char *pEntName, int pEntTeamNumber, const Vector &pEntOrigin );
 extern ConVar tf_destroyobjects;
 
+ConVar tf_team_object_grid( "tf_team_object_grid", "1", 0, "Answer team object coverage queries with the per-type object grids instead of scanning every object." );
+ConVar tf_personal_orders( "tf_personal_orders", "0", FCVAR_CHEAT, "Give players personal orders based on their class." );
+ConVar tf_tech_batch_replication( "tf_tech_batch_replication", "1", 0, "Send each player one packed TechnologyBatch message per tick for the techs that changed, and a shared team snapshot when their HUD restarts, instead of a Technology message per tech." );
+ConVar tf_tactical_transmit_prepass( "tf_tactical_transmit_prepass", "1", 0, "Mark the objects on a player's tactical map for transmission in one pass before the per-entity transmit checks." );
+
+static void TransmitCacheChanged( IConVar *var, const char *pOldValue, float flOldValue );
+ConVar tf_object_transmit_cache( "tf_object_transmit_cache", "1", 0, "Send built objects with a PVS check, and the ones a team always gets from a per-team bit vector, instead of a full ShouldTransmit check per object per client.", TransmitCacheChanged );
+
+static int s_nTransmitCacheSerial = 0;
+
+
+//-----------------------------------------------------------------------------
+// Tactical classes, cached per edict. The class only depends on the classname and
+// whether it's an object, so it's worked out the first time we see an entity and kept
+// until the edict is reused (the serial number changes). Team changes don't affect it.
+//-----------------------------------------------------------------------------
+struct TacticalClassCache_t
+{
+	int		m_nSerialNumber;	// Serial number + 1, so a zeroed entry is never valid
+	int		m_iTacticalClass;
+};
+
+static TacticalClassCache_t s_TacticalClassCache[MAX_EDICTS];
+
+static int GetCachedTacticalClass( CBaseEntity *pEntity )
+{
+	int iIndex = pEntity->entindex();
+	if ( iIndex < 0 )
+		return TACTICAL_CLASS_NONE;
+
+	TacticalClassCache_t &entry = s_TacticalClassCache[iIndex];
+	int nSerialNumber = pEntity->GetRefEHandle().GetSerialNumber() + 1;
+	if ( entry.m_nSerialNumber != nSerialNumber )
+	{
+		int iTacticalClass = GetTacticalClassForName( STRING( pEntity->m_iClassname ) );
+		if ( iTacticalClass == TACTICAL_CLASS_NONE && dynamic_cast<CBaseObject*>( pEntity ) )
+		{
+			iTacticalClass = TACTICAL_CLASS_OBJECT;
+		}
+
+		entry.m_nSerialNumber = nSerialNumber;
+		entry.m_iTacticalClass = iTacticalClass;
+	}
+
+	return entry.m_iTacticalClass;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: SendProxy that converts the UtlVector list of radar scanners to entindexes, where it's reassembled on the client
 //-----------------------------------------------------------------------------
@@ -100,13 +147,23 @@ void CTFTeam::Init( const char *pName, int iNumber )
 	NetworkProp()->SetUpdateInterval( 0.75f );
 
 	m_flTotalResourcesSoFar = m_iLastUpdateSentAt = 0;
+	m_nTechBaselineTick = -1;
+	m_nTransmitCacheSerial = -1;
 }
 
 CTFTeam::~CTFTeam( void )
 {
+	m_OrderPlanner.Purge();
 	m_aResourcesBeingCollected.Purge();
 	m_aResupplyBeacons.Purge();
 	m_aObjects.Purge();
+	for ( int i = 0; i < OBJ_LAST; i++ )
+	{
+		m_ObjectGrids[i].Purge();
+	}
+	m_AllObjectsGrid.Purge();
+	m_SentryGrid.Purge();
+	m_ResupplyGrid.Purge();
 	m_aOrders.Purge();
 
 	delete m_pTechnologyTree;
@@ -157,16 +214,31 @@ void CTFTeam::Think( void )
 
 	UpdateTechnologies();
 	
-#if 0	// FIXME: Re-enable once we figure out what the correct orders should be
-	// Create new personal orders
-	if ( m_flPersonalOrderUpdateTime < gpGlobals->curtime )
+	// FIXME: Turn on by default once we figure out what the correct orders should be
+	if ( tf_personal_orders.GetBool() )
 	{
-		CreatePersonalOrders();
-		m_flPersonalOrderUpdateTime = gpGlobals->curtime + PERSONAL_ORDER_UPDATE_TIME;
+		// Create new personal orders
+		UpdatePersonalOrders();
 	}
-#endif
 }
 
+// Reliable bytes each path has sent, for tf_tech_replication_stats. The overhead is the
+// svc_UserMessage type, message index and length that go in front of every user message.
+#define USERMSG_OVERHEAD_BYTES		3
+#define TECHNOLOGY_MSG_BYTES		( 5 + USERMSG_OVERHEAD_BYTES )
+
+struct TechReplicationStats_t
+{
+	int		m_nMessages;
+	int		m_nBytes;
+	int		m_nTechsSent;
+	int		m_nSnapshots;
+};
+
+static TechReplicationStats_t s_TechStatsLegacy;
+static TechReplicationStats_t s_TechStatsBatched;
+static int s_nTechStatsLegacyEquivalent;	// Technology messages the old path would have sent for the batches
+
 //-----------------------------------------------------------------------------
 // DATA HANDLING
 //-----------------------------------------------------------------------------
@@ -178,41 +250,65 @@ void CTFTeam::UpdateClientData( CBasePlayer *pPlayer )
 	// If we're initialising the hud, update all technologies
 	if ( pTFPlayer->HUDNeedsRestart() )
 	{
-		// Check all the technologies and resend any that differ from this client's representation
-		for ( int i = 0; i < m_pTechnologyTree->GetNumberTechnologies(); i++ )
+		if ( tf_tech_batch_replication.GetBool() )
 		{
-			// Update all technologies
-			CBaseTechnology *technology = m_pTechnologyTree->GetTechnology(i);
-			if ( technology )
+			// Everyone who respawns this tick gets the same snapshot
+			if ( m_nTechBaselineTick != gpGlobals->tickcount )
 			{
-				// Check to see if any resource levels have changed
-				if ( pTFPlayer->AvailableTech(i).m_nResourceLevel != technology->GetResourceLevel() )
-				{
-					UpdateClientTechnology( i, pTFPlayer );
-					continue;
-				}
+				BuildTechnologyBatches( m_TechBaselineBatches, true );
+				m_nTechBaselineTick = gpGlobals->tickcount;
+			}
 
-				if ( technology->GetAvailable() != pTFPlayer->AvailableTech(i).m_nAvailable )
+			for ( int i = 0; i < m_pTechnologyTree->GetNumberTechnologies(); i++ )
+			{
+				if ( ClientTechnologyDiffers( i, pTFPlayer ) )
 				{
-					UpdateClientTechnology( i, pTFPlayer );
-					continue;
+					++s_nTechStatsLegacyEquivalent;
 				}
+			}
 
-				byte pcount = technology->GetPreferenceCount();
-				if ( pTFPlayer->GetPreferredTechnology() == i )
-				{
-					pcount |= 0x80;
-				}
+			SendTechnologyBatches( pTFPlayer, m_TechBaselineBatches, true );
+			return;
+		}
 
-				if ( pcount != pTFPlayer->AvailableTech(i).m_nUserCount )
-				{
-					UpdateClientTechnology( i, pTFPlayer );
-				}
+		// Check all the technologies and resend any that differ from this client's representation
+		for ( int i = 0; i < m_pTechnologyTree->GetNumberTechnologies(); i++ )
+		{
+			if ( ClientTechnologyDiffers( i, pTFPlayer ) )
+			{
+				UpdateClientTechnology( i, pTFPlayer );
 			}
 		}
+
+		++s_TechStatsLegacy.m_nSnapshots;
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Returns true if the player's copy of a technology is out of date
+//-----------------------------------------------------------------------------
+bool CTFTeam::ClientTechnologyDiffers( int iTechID, CBaseTFPlayer *pPlayer )
+{
+	CBaseTechnology *technology = m_pTechnologyTree->GetTechnology( iTechID );
+	if ( !technology )
+		return false;
+
+	// Check to see if any resource levels have changed
+	if ( pPlayer->AvailableTech(iTechID).m_nResourceLevel != technology->GetResourceLevel() )
+		return true;
+
+	if ( technology->GetAvailable() != pPlayer->AvailableTech(iTechID).m_nAvailable )
+		return true;
+
+	byte pcount = technology->GetPreferenceCount();
+	if ( pPlayer->GetPreferredTechnology() == iTechID )
+	{
+		pcount |= 0x80;
+	}
+
+	return ( pcount != pPlayer->AvailableTech(iTechID).m_nUserCount );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Update a technology for a player
 //-----------------------------------------------------------------------------
@@ -238,10 +334,12 @@ void CTFTeam::UpdateClientTechnology( int iTechID, CBaseTFPlayer *pPlayer )
 		WRITE_SHORT( (short)pTechnology->GetResourceLevel() );
 	MessageEnd();
 
+	++s_TechStatsLegacy.m_nMessages;
+	++s_TechStatsLegacy.m_nTechsSent;
+	s_TechStatsLegacy.m_nBytes += TECHNOLOGY_MSG_BYTES;
+
 	// Update the player's client tech representation
-	pPlayer->AvailableTech(iTechID).m_nAvailable = pTechnology->GetAvailable();
-	pPlayer->AvailableTech(iTechID).m_nUserCount = pcount;
-	pPlayer->AvailableTech(iTechID).m_nResourceLevel = pTechnology->GetResourceLevel();
+	RecordClientTechnology( iTechID, pPlayer );
 	
 #if 0
 	Msg( "Sent %s(%d) to %s:\n", pTechnology->GetName(), iTechID, pPlayer->GetPlayerName() );
@@ -256,6 +354,29 @@ void CTFTeam::UpdateClientTechnology( int iTechID, CBaseTFPlayer *pPlayer )
 //-----------------------------------------------------------------------------
 void CTFTeam::UpdateTechnologyData( void )
 {
+	if ( tf_tech_batch_replication.GetBool() )
+	{
+		BuildTechnologyBatches( m_TechDeltaBatches, false );
+		if ( !m_TechDeltaBatches.Count() )
+			return;
+
+		for ( int iPlayer = 0; iPlayer < m_aPlayers.Count(); iPlayer++ )
+		{
+			SendTechnologyBatches( (CBaseTFPlayer *)m_aPlayers[iPlayer], m_TechDeltaBatches, false );
+		}
+
+		for ( int i = 0; i < m_pTechnologyTree->GetNumberTechnologies(); i++ )
+		{
+			CBaseTechnology *pTechnology = m_pTechnologyTree->GetTechnology(i);
+			if ( pTechnology && pTechnology->IsDirty() )
+			{
+				s_nTechStatsLegacyEquivalent += m_aPlayers.Count();
+				pTechnology->SetDirty( false );
+			}
+		}
+		return;
+	}
+
 	for ( int i = 0; i < m_pTechnologyTree->GetNumberTechnologies(); i++ )
 	{
 		// Update all technologies
@@ -274,19 +395,326 @@ void CTFTeam::UpdateTechnologyData( void )
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Copy a technology into the player's record of what their client has
+//-----------------------------------------------------------------------------
+void CTFTeam::RecordClientTechnology( int iTechID, CBaseTFPlayer *pPlayer )
+{
+	CBaseTechnology *pTechnology = m_pTechnologyTree->GetTechnology( iTechID );
+	if ( !pTechnology )
+		return;
+
+	byte pcount = pTechnology->GetPreferenceCount();
+	if ( pPlayer->GetPreferredTechnology() == iTechID )
+		pcount |= 0x80;
+
+	pPlayer->AvailableTech(iTechID).m_nAvailable = pTechnology->GetAvailable();
+	pPlayer->AvailableTech(iTechID).m_nUserCount = pcount;
+	pPlayer->AvailableTech(iTechID).m_nResourceLevel = pTechnology->GetResourceLevel();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pack the dirty technologies (or all of them, for the baseline) into the
+//			bodies of as few TechnologyBatch messages as they fit in.
+//-----------------------------------------------------------------------------
+void CTFTeam::BuildTechnologyBatches( CUtlVector<TechBatch_t> &batches, bool bBaseline )
+{
+	batches.RemoveAll();
+
+	int nTechs = m_pTechnologyTree->GetNumberTechnologies();
+	for ( int iFirst = 0; iFirst < nTechs; iFirst += TECH_BATCH_MAX_TECHS )
+	{
+		int nBatchTechs = min( nTechs - iFirst, TECH_BATCH_MAX_TECHS );
+
+		bool bInBatch[ TECH_BATCH_MAX_TECHS ];
+		bool bAny = false;
+		for ( int i = 0; i < nBatchTechs; i++ )
+		{
+			CBaseTechnology *pTechnology = m_pTechnologyTree->GetTechnology( iFirst + i );
+			bInBatch[i] = pTechnology && ( bBaseline || pTechnology->IsDirty() );
+			bAny |= bInBatch[i];
+		}
+
+		if ( !bAny )
+			continue;
+
+		TechBatch_t &batch = batches[ batches.AddToTail() ];
+		batch.m_iFirstTech = iFirst;
+		batch.m_nTechs = nBatchTechs;
+
+		bf_write buf( "TechBatch", batch.m_Data, sizeof( batch.m_Data ) );
+
+		if ( bBaseline )
+		{
+			batch.m_nTechs |= TECH_BATCH_ALL_PRESENT;
+		}
+		else
+		{
+			for ( int i = 0; i < nBatchTechs; i++ )
+			{
+				buf.WriteOneBit( bInBatch[i] );
+			}
+		}
+
+		for ( int i = 0; i < nBatchTechs; i++ )
+		{
+			CBaseTechnology *pTechnology = m_pTechnologyTree->GetTechnology( iFirst + i );
+			if ( pTechnology && bInBatch[i] )
+			{
+				TechBatch_WriteState( buf, pTechnology->GetAvailable() != 0, pTechnology->GetPreferenceCount(), (short)pTechnology->GetResourceLevel() );
+			}
+			else if ( bBaseline )
+			{
+				// The client reads a record for every tech in a baseline batch
+				TechBatch_WriteState( buf, false, 0, 0 );
+			}
+		}
+
+		Assert( !buf.IsOverflowed() );
+		batch.m_nBits = buf.GetNumBitsWritten();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Send the batches to a player, with their own preferred tech in the header
+//-----------------------------------------------------------------------------
+void CTFTeam::SendTechnologyBatches( CBaseTFPlayer *pPlayer, const CUtlVector<TechBatch_t> &batches, bool bBaseline )
+{
+	int iPreferred = pPlayer->GetPreferredTechnology();
+	if ( iPreferred < 0 || iPreferred >= m_pTechnologyTree->GetNumberTechnologies() )
+	{
+		iPreferred = TECH_BATCH_NO_PREFERENCE;
+	}
+
+	CSingleUserRecipientFilter user( pPlayer );
+	user.MakeReliable();
+
+	for ( int iBatch = 0; iBatch < batches.Count(); iBatch++ )
+	{
+		const TechBatch_t &batch = batches[iBatch];
+
+		UserMessageBegin( user, "TechnologyBatch" );
+			WRITE_BYTE( iPreferred );
+			WRITE_BYTE( batch.m_iFirstTech );
+			WRITE_BYTE( batch.m_nTechs );
+			WRITE_BITS( batch.m_Data, batch.m_nBits );
+		MessageEnd();
+
+		++s_TechStatsBatched.m_nMessages;
+		s_TechStatsBatched.m_nBytes += TECH_BATCH_HEADER_BYTES + ( batch.m_nBits + 7 ) / 8 + USERMSG_OVERHEAD_BYTES;
+
+		// Update the player's client tech representation
+		int nBatchTechs = batch.m_nTechs & ~TECH_BATCH_ALL_PRESENT;
+		for ( int i = batch.m_iFirstTech; i < batch.m_iFirstTech + nBatchTechs; i++ )
+		{
+			CBaseTechnology *pTechnology = m_pTechnologyTree->GetTechnology( i );
+			if ( pTechnology && ( bBaseline || pTechnology->IsDirty() ) )
+			{
+				RecordClientTechnology( i, pPlayer );
+				++s_TechStatsBatched.m_nTechsSent;
+			}
+		}
+	}
+
+	if ( bBaseline )
+	{
+		++s_TechStatsBatched.m_nSnapshots;
+	}
+}
+
+static void PrintTechReplicationStats( const char *pszName, const TechReplicationStats_t &stats )
+{
+	Msg( "%s: %d messages, %d techs, %d HUD restarts, ~%d reliable bytes\n", pszName, stats.m_nMessages, stats.m_nTechsSent, stats.m_nSnapshots, stats.m_nBytes );
+}
+
+static void CC_TechReplicationStats( const CCommand &args )
+{
+	Msg( "Technology replication (tf_tech_batch_replication %d):\n", tf_tech_batch_replication.GetInt() );
+	PrintTechReplicationStats( "  Technology     ", s_TechStatsLegacy );
+	PrintTechReplicationStats( "  TechnologyBatch", s_TechStatsBatched );
+
+	if ( s_nTechStatsLegacyEquivalent )
+	{
+		Msg( "  The batches replaced %d Technology messages (~%d reliable bytes)\n", s_nTechStatsLegacyEquivalent, s_nTechStatsLegacyEquivalent * TECHNOLOGY_MSG_BYTES );
+	}
+
+	if ( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) )
+	{
+		memset( &s_TechStatsLegacy, 0, sizeof( s_TechStatsLegacy ) );
+		memset( &s_TechStatsBatched, 0, sizeof( s_TechStatsBatched ) );
+		s_nTechStatsLegacyEquivalent = 0;
+	}
+}
+
+static ConCommand tf_tech_replication_stats( "tf_tech_replication_stats", CC_TechReplicationStats, "Print the reliable traffic spent sending technology state since the last reset. Run it with 'reset' at the start of a round to measure that round." );
+
 bool CTFTeam::ShouldTransmitToPlayer( CBasePlayer* pRecipient, CBaseEntity* pEntity )
 {
 	return IsEntityVisibleToTactical( pEntity );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Mark everything on the recipient's tactical map that ShouldTransmit would
+//			send anyway, so CheckTransmit skips the per-entity virtual calls for them.
+//			That's every object on the team, plus tunnels on any team.
+//-----------------------------------------------------------------------------
+void CTFTeam::PreCheckTransmit( CCheckTransmitInfo *pInfo, CBasePlayer *pRecipient )
+{
+	if ( tf_object_transmit_cache.GetBool() )
+	{
+		VPROF( "CTFTeam::PreCheckTransmit (cached)" );
+
+		UpdateTransmitCache();
+
+		m_TransmitAlways.Or( *pInfo->m_pTransmitEdict, pInfo->m_pTransmitEdict );
+		if ( pInfo->m_pTransmitAlways )
+		{
+			m_TransmitAlways.Or( *pInfo->m_pTransmitAlways, pInfo->m_pTransmitAlways );
+		}
+
+		for ( int i = 0; i < m_TransmitSpecial.Count(); i++ )
+		{
+			m_TransmitSpecial[i]->SetTransmit( pInfo, true );
+		}
+
+		// Builders always get their own objects. Built objects only do a PVS check now,
+		// so this is the one place that happens.
+		CBaseTFPlayer *pPlayer = ToBaseTFPlayer( pRecipient );
+		if ( pPlayer )
+		{
+			for ( int i = 0; i < pPlayer->GetObjectCount(); i++ )
+			{
+				CBaseObject *pObject = pPlayer->GetObject( i );
+				if ( pObject && pObject->edict() && !pObject->IsPlacing() )
+				{
+					pObject->SetTransmit( pInfo, true );
+				}
+			}
+		}
+		return;
+	}
+
+	if ( !tf_tactical_transmit_prepass.GetBool() )
+		return;
+
+	VPROF( "CTFTeam::PreCheckTransmit" );
+
+	for ( int iTeam = 0; iTeam < GetNumberOfTeams(); iTeam++ )
+	{
+		CTFTeam *pTeam = GetGlobalTFTeam( iTeam );
+		if ( !pTeam )
+			continue;
+
+		for ( int i = 0; i < pTeam->m_aObjects.Count(); i++ )
+		{
+			CBaseObject *pObject = pTeam->m_aObjects[i];
+			if ( !pObject || !pObject->edict() )
+				continue;
+
+			if ( pObject->edict()->m_fStateFlags & FL_EDICT_DONTSEND )
+				continue;
+
+			// Placement models only go to their builder, CBaseObject::ShouldTransmit handles that
+			if ( pObject->IsPlacing() )
+				continue;
+
+			if ( IsEntityVisibleToTactical( pObject ) )
+			{
+				pObject->SetTransmit( pInfo, true );
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rebuild the bits for everything on this team's tactical map, if
+//			anything's changed since last time.
+//-----------------------------------------------------------------------------
+void CTFTeam::UpdateTransmitCache( void )
+{
+	if ( m_nTransmitCacheSerial == s_nTransmitCacheSerial )
+		return;
+
+	VPROF( "CTFTeam::UpdateTransmitCache" );
+	VPROF_INCREMENT_COUNTER( "TFTeam: transmit cache rebuilds", 1 );
+
+	m_nTransmitCacheSerial = s_nTransmitCacheSerial;
+	m_TransmitAlways.ClearAll();
+	m_TransmitSpecial.RemoveAll();
+
+	for ( int iTeam = 0; iTeam < GetNumberOfTeams(); iTeam++ )
+	{
+		CTFTeam *pTeam = GetGlobalTFTeam( iTeam );
+		if ( !pTeam )
+			continue;
+
+		for ( int i = 0; i < pTeam->m_aObjects.Count(); i++ )
+		{
+			CBaseObject *pObject = pTeam->m_aObjects[i];
+			if ( !pObject || !pObject->edict() )
+				continue;
+
+			if ( pObject->edict()->m_fStateFlags & FL_EDICT_DONTSEND )
+				continue;
+
+			// Placement models only go to their builder, CBaseObject::ShouldTransmit handles that
+			if ( pObject->IsPlacing() )
+				continue;
+
+			if ( !IsEntityVisibleToTactical( pObject ) )
+				continue;
+
+			// Anything whose SetTransmit sends other entities along (parents, screens, and
+			// whatever the screens' own SetTransmit pulls in) has to go through SetTransmit.
+			if ( pObject->HasTransmitDependents() )
+			{
+				m_TransmitSpecial.AddToTail( pObject );
+				continue;
+			}
+
+			m_TransmitAlways.Set( pObject->entindex() );
+		}
+	}
+}
+
+void CTFTeam::InvalidateTransmitCache( void )
+{
+	++s_nTransmitCacheSerial;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Built objects switch between a full check and a PVS check with this.
+//-----------------------------------------------------------------------------
+static void TransmitCacheChanged( IConVar *var, const char *pOldValue, float flOldValue )
+{
+	CTFTeam::InvalidateTransmitCache();
+
+	for ( int iTeam = 0; iTeam < GetNumberOfTeams(); iTeam++ )
+	{
+		CTFTeam *pTeam = GetGlobalTFTeam( iTeam );
+		if ( !pTeam )
+			continue;
+
+		for ( int i = 0; i < pTeam->GetNumObjects(); i++ )
+		{
+			pTeam->GetObject( i )->DispatchUpdateTransmitState();
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Is the specified entity visible on this team's tactical view?
 //-----------------------------------------------------------------------------
 bool CTFTeam::IsEntityVisibleToTactical( CBaseEntity *pEntity )
 {
-	return ::IsEntityVisibleToTactical( GetTeamNumber(), GetNumPlayers(), 
-		GetNumObjects(), pEntity->entindex(), (char*)STRING(pEntity->m_iClassname), 
-		pEntity->GetTeamNumber(), pEntity->GetAbsOrigin() );
+	int iTacticalClass = GetCachedTacticalClass( pEntity );
+
+	// Boring objects don't show up at all
+	if ( iTacticalClass == TACTICAL_CLASS_OBJECT && 
+		( static_cast<CBaseObject*>( pEntity )->GetObjectFlags() & OF_SUPPRESS_VISIBLE_TO_TACTICAL ) )
+		return false;
+
+	return IsTacticalClassVisible( iTacticalClass, GetTeamNumber(), pEntity->GetTeamNumber() );
 }
 
 //-----------------------------------------------------------------------------
@@ -613,15 +1041,15 @@ void CTFTeam::RecomputePurchases( void )
 //-----------------------------------------------------------------------------
 bool CTFTeam::HasNamedTechnology( const char *name )
 {
-	// Look it up
-	// FIXME:  This could be too slow, consider using #define'd/indexed names?
-	CBaseTechnology *tech = m_pTechnologyTree->GetTechnology( name ); 
-	if ( !tech )
-		return false;
-	if ( !tech->GetAvailable() )
-		return false;
+	return HasTechnology( TechnologyID_Find( name ) );
+}
 
-	return true;
+//-----------------------------------------------------------------------------
+// Purpose: Return true if the team owns the specified technology
+//-----------------------------------------------------------------------------
+bool CTFTeam::HasTechnology( int iTechID )
+{
+	return m_pTechnologyTree->IsTechnologyAvailable( iTechID );
 }
 
 
@@ -833,6 +1261,7 @@ void CTFTeam::AddResupply( CObjectResupply *pResupply )
 		pResupply, GetName() ) );
 
 	m_aResupplyBeacons.AddToTail( pResupply );
+	m_ResupplyGrid.Insert( pResupply );
 }
 
 //-----------------------------------------------------------------------------
@@ -845,6 +1274,7 @@ void CTFTeam::RemoveResupply( CObjectResupply *pResupply )
 
 	// Now remove the beacon from our list
 	m_aResupplyBeacons.FindAndRemove( pResupply );
+	m_ResupplyGrid.Remove( pResupply );
 }
 
 int CTFTeam::GetNumObjects( int iObjectType )
@@ -884,6 +1314,9 @@ CObjectResupply *CTFTeam::GetResupply( int num )
 
 bool CTFTeam::IsCoveredBySentryGun( const Vector &vPos )
 {
+	if ( tf_team_object_grid.GetBool() )
+		return ( m_SentryGrid.CountInRadius( vPos, OBJECT_COVERED_DIST, 1 ) != 0 );
+
 	for( int i=0; i < m_aObjects.Count(); i++ )
 	{
 		CBaseObject *pObj = m_aObjects[i];
@@ -897,6 +1330,9 @@ bool CTFTeam::IsCoveredBySentryGun( const Vector &vPos )
 
 int CTFTeam::GetNumShieldWallsCoveringPosition( const Vector &vPos )
 {
+	if ( tf_team_object_grid.GetBool() )
+		return m_ObjectGrids[OBJ_SHIELDWALL].CountInRadius( vPos, OBJECT_COVERED_DIST );
+
 	int count = 0;
 
 	for ( int i=0; i < m_aObjects.Count(); i++ )
@@ -915,6 +1351,9 @@ int CTFTeam::GetNumShieldWallsCoveringPosition( const Vector &vPos )
 
 int CTFTeam::GetNumResuppliesCoveringPosition( const Vector &vPos )
 {
+	if ( tf_team_object_grid.GetBool() )
+		return m_ResupplyGrid.CountInRadius( vPos, RESUPPLY_COVER_DIST );
+
 	int count = 0;
 
 	for ( int i=0; i < m_aResupplyBeacons.Count(); i++ )
@@ -930,6 +1369,9 @@ int CTFTeam::GetNumResuppliesCoveringPosition( const Vector &vPos )
 
 int CTFTeam::GetNumRespawnStationsCoveringPosition( const Vector &vPos )
 {
+	if ( tf_team_object_grid.GetBool() )
+		return m_ObjectGrids[OBJ_RESPAWN_STATION].CountInRadius( vPos, OBJECT_COVERED_DIST );
+
 	int count = 0;
 
 	for ( int i=0; i < m_aObjects.Count(); i++ )
@@ -944,6 +1386,189 @@ int CTFTeam::GetNumRespawnStationsCoveringPosition( const Vector &vPos )
 	return count;
 }
 
+CBaseObject *CTFTeam::FindNearestObject( int iObjectType, const Vector &vPos, float flMaxDist )
+{
+	if ( iObjectType < 0 || iObjectType >= OBJ_LAST )
+		return NULL;
+
+	if ( tf_team_object_grid.GetBool() )
+		return m_ObjectGrids[iObjectType].FindNearest( vPos, flMaxDist );
+
+	CBaseObject *pNearest = NULL;
+	float flNearestSqr = flMaxDist * flMaxDist;
+
+	for ( int i=0; i < m_aObjects.Count(); i++ )
+	{
+		CBaseObject *pObj = m_aObjects[i];
+		if ( pObj->GetType() != iObjectType )
+			continue;
+
+		float flDistSqr = vPos.DistToSqr( pObj->GetAbsOrigin() );
+		if ( flDistSqr < flNearestSqr )
+		{
+			flNearestSqr = flDistSqr;
+			pNearest = pObj;
+		}
+	}
+
+	return pNearest;
+}
+
+int CTFTeam::FindObjectsInRadius( int iObjectType, const Vector &vPos, float flRadius, CUtlVector<CBaseObject*> &objects )
+{
+	if ( iObjectType >= OBJ_LAST )
+		return 0;
+
+	if ( tf_team_object_grid.GetBool() )
+	{
+		if ( iObjectType < 0 )
+			return m_AllObjectsGrid.FindInRadius( vPos, flRadius, objects );
+
+		return m_ObjectGrids[iObjectType].FindInRadius( vPos, flRadius, objects );
+	}
+
+	float flRadiusSqr = flRadius * flRadius;
+	int nStart = objects.Count();
+
+	for ( int i=0; i < m_aObjects.Count(); i++ )
+	{
+		CBaseObject *pObj = m_aObjects[i];
+		if ( iObjectType >= 0 && pObj->GetType() != iObjectType )
+			continue;
+
+		if ( vPos.DistToSqr( pObj->GetAbsOrigin() ) < flRadiusSqr )
+			objects.AddToTail( pObj );
+	}
+
+	return objects.Count() - nStart;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: One of our objects moved, so its grid cell may have changed
+//-----------------------------------------------------------------------------
+void CTFTeam::ObjectMoved( CBaseObject *pObject )
+{
+	int iType = pObject->GetType();
+	if ( iType >= 0 && iType < OBJ_LAST )
+	{
+		m_ObjectGrids[iType].Update( pObject );
+	}
+	m_AllObjectsGrid.Update( pObject );
+
+	// It may have been attached to or detached from something
+	InvalidateTransmitCache();
+
+	// Buff station connections are only range checked when one end of them moves
+	if ( iType == OBJ_BUFF_STATION )
+	{
+		static_cast<CObjectBuffStation*>( pObject )->CheckObjectRange();
+	}
+	else if ( pObject->GetBuffStation() )
+	{
+		pObject->GetBuffStation()->CheckObjectRange();
+	}
+
+	if ( pObject->IsSentrygun() )
+	{
+		m_SentryGrid.Update( pObject );
+	}
+
+	m_ResupplyGrid.Update( pObject );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills the caller's team with objects, then checks the object grids
+//			against the brute force coverage queries and times them both.
+//-----------------------------------------------------------------------------
+static void CC_TeamObjectGridTest( const CCommand &args )
+{
+	CBasePlayer *pPlayer = UTIL_GetCommandClient();
+	if ( !pPlayer || !pPlayer->GetTeam() )
+		return;
+
+	CTFTeam *pTeam = (CTFTeam*)pPlayer->GetTeam();
+
+	int nObjects = args.ArgC() > 1 ? clamp( atoi( args[1] ), 1, 1000 ) : 500;
+	int nQueries = args.ArgC() > 2 ? max( atoi( args[2] ), 1 ) : 10000;
+
+	static const char *s_pObjectNames[] = { "obj_sentrygun_plasma", "obj_shieldwall", "obj_respawn_station", "obj_resupply" };
+	static const int s_nObjectTypes[] = { OBJ_SENTRYGUN_PLASMA, OBJ_SHIELDWALL, OBJ_RESPAWN_STATION, OBJ_RESUPPLY };
+
+	// Spread them over a big map's worth of space
+	Vector vecCenter = pPlayer->GetAbsOrigin();
+	Vector vecExtent( 8192, 8192, 1024 );
+
+	CUtlVector<CBaseObject*> objects;
+	for ( int i = 0; i < nObjects; i++ )
+	{
+		CBaseObject *pObject = (CBaseObject*)CreateEntityByName( s_pObjectNames[ i % ARRAYSIZE(s_pObjectNames) ] );
+		if ( !pObject )
+			break;
+
+		Vector vecOrigin = vecCenter + Vector( random->RandomFloat( -vecExtent.x, vecExtent.x ), random->RandomFloat( -vecExtent.y, vecExtent.y ), random->RandomFloat( -vecExtent.z, vecExtent.z ) );
+		pObject->SetAbsOrigin( vecOrigin );
+		DispatchSpawn( pObject );
+		pObject->ChangeTeam( pTeam->GetTeamNumber() );
+		objects.AddToTail( pObject );
+	}
+
+	CUtlVector<Vector> queries;
+	queries.SetCount( nQueries );
+	for ( int i = 0; i < nQueries; i++ )
+	{
+		queries[i] = vecCenter + Vector( random->RandomFloat( -vecExtent.x, vecExtent.x ), random->RandomFloat( -vecExtent.y, vecExtent.y ), random->RandomFloat( -vecExtent.z, vecExtent.z ) );
+	}
+
+	bool bSaveGrid = tf_team_object_grid.GetBool();
+
+	// Pass 0 is brute force, pass 1 uses the grids
+	CUtlVector<int> results[2];
+	double flTime[2];
+	for ( int iPass = 0; iPass < 2; iPass++ )
+	{
+		tf_team_object_grid.SetValue( iPass );
+		results[iPass].EnsureCapacity( nQueries * 8 );
+
+		double flStart = Plat_FloatTime();
+		for ( int i = 0; i < nQueries; i++ )
+		{
+			const Vector &vPos = queries[i];
+			results[iPass].AddToTail( pTeam->IsCoveredBySentryGun( vPos ) );
+			results[iPass].AddToTail( pTeam->GetNumShieldWallsCoveringPosition( vPos ) );
+			results[iPass].AddToTail( pTeam->GetNumResuppliesCoveringPosition( vPos ) );
+			results[iPass].AddToTail( pTeam->GetNumRespawnStationsCoveringPosition( vPos ) );
+			for ( int j = 0; j < ARRAYSIZE(s_nObjectTypes); j++ )
+			{
+				CBaseObject *pNearest = pTeam->FindNearestObject( s_nObjectTypes[j], vPos, OBJECT_COVERED_DIST );
+				results[iPass].AddToTail( pNearest ? pNearest->entindex() : 0 );
+			}
+		}
+		flTime[iPass] = Plat_FloatTime() - flStart;
+	}
+
+	tf_team_object_grid.SetValue( bSaveGrid );
+
+	int nMismatches = 0;
+	for ( int i = 0; i < results[0].Count(); i++ )
+	{
+		if ( results[0][i] != results[1][i] )
+			++nMismatches;
+	}
+
+	Msg( "tf_team_object_grid_test: %d objects on %s, %d queries\n", pTeam->GetNumObjects(), pTeam->GetName(), nQueries );
+	Msg( "  brute force: %.3f ms (%.3f us/query)\n", flTime[0] * 1000.0, flTime[0] * 1000000.0 / nQueries );
+	Msg( "  object grid: %.3f ms (%.3f us/query)\n", flTime[1] * 1000.0, flTime[1] * 1000000.0 / nQueries );
+	Msg( "  %d mismatched results %s\n", nMismatches, nMismatches ? "(FAILED)" : "(ok)" );
+
+	for ( int i = 0; i < objects.Count(); i++ )
+	{
+		UTIL_Remove( objects[i] );
+	}
+}
+
+static ConCommand tf_team_object_grid_test( "tf_team_object_grid_test", CC_TeamObjectGridTest, "Compare the team object grids against the brute force coverage queries: tf_team_object_grid_test [objects] [queries]", FCVAR_CHEAT );
+
 
 //------------------------------------------------------------------------------------------------------------------
 // OBJECTS
@@ -958,7 +1583,28 @@ void CTFTeam::AddObject( CBaseObject *pObject )
 	bool alreadyInList = IsObjectOnTeam( pObject );
 	Assert( !alreadyInList );
 	if ( !alreadyInList )
+	{
 		m_aObjects.AddToTail( pObject );
+
+		int iType = pObject->GetType();
+		if ( iType >= 0 && iType < OBJ_LAST )
+		{
+			m_ObjectGrids[iType].Insert( pObject );
+		}
+		m_AllObjectsGrid.Insert( pObject );
+		InvalidateTransmitCache();
+
+		// The team's first MCV is free, so this changes what everyone's MCVs are worth
+		if ( iType == OBJ_VEHICLE_TELEPORT_STATION )
+		{
+			CBaseTFPlayer::InvalidateObjectValues();
+		}
+
+		if ( pObject->IsSentrygun() )
+		{
+			m_SentryGrid.Insert( pObject );
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -985,6 +1631,25 @@ void CTFTeam::RemoveObject( CBaseObject *pObject )
 			pObject, pObject->GetClassname(), GetName() ) );
 
 		m_aObjects.FindAndRemove( pObject );
+
+		// Check every grid in case the type changed since it was added
+		int iType = pObject->GetType();
+		if ( iType < 0 || iType >= OBJ_LAST || !m_ObjectGrids[iType].Remove( pObject ) )
+		{
+			for ( int i = 0; i < OBJ_LAST; i++ )
+			{
+				if ( m_ObjectGrids[i].Remove( pObject ) )
+					break;
+			}
+		}
+		m_AllObjectsGrid.Remove( pObject );
+		m_SentryGrid.Remove( pObject );
+		InvalidateTransmitCache();
+
+		if ( iType == OBJ_VEHICLE_TELEPORT_STATION )
+		{
+			CBaseTFPlayer::InvalidateObjectValues();
+		}
 	}
 	else
 	{
@@ -1001,6 +1666,9 @@ void CTFTeam::RemoveObject( CBaseObject *pObject )
 void CTFTeam::InitializeOrders( void )
 {
 	m_flPersonalOrderUpdateTime = 0;
+	m_flPersonalOrderCredit = 0;
+	m_iNextPersonalOrderPlayer = 0;
+	m_OrderPlanner.Init( this );
 }
 
 //-----------------------------------------------------------------------------
@@ -1143,6 +1811,55 @@ bool CTFTeam::HasPersonalOrderOfType( CBaseTFPlayer *player, int orderType ) {
 	return false;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Give every player a look for a personal order once every 
+//			PERSONAL_ORDER_UPDATE_TIME. With the order planner on, that's spread
+//			out over the interval a few players a tick, instead of the whole team
+//			in one tick.
+//-----------------------------------------------------------------------------
+void CTFTeam::UpdatePersonalOrders( void )
+{
+	if ( !COrderPlanner::IsActive() )
+	{
+		if ( m_flPersonalOrderUpdateTime < gpGlobals->curtime )
+		{
+			CreatePersonalOrders();
+			m_flPersonalOrderUpdateTime = gpGlobals->curtime + PERSONAL_ORDER_UPDATE_TIME;
+		}
+		return;
+	}
+
+	VPROF( "CTFTeam::UpdatePersonalOrders" );
+
+	int nPlayers = m_aPlayers.Count();
+	if ( !nPlayers )
+	{
+		m_flPersonalOrderCredit = 0;
+		return;
+	}
+
+	// Same rate as doing the whole team every PERSONAL_ORDER_UPDATE_TIME.
+	m_flPersonalOrderCredit += nPlayers * gpGlobals->frametime / PERSONAL_ORDER_UPDATE_TIME;
+	m_flPersonalOrderCredit = MIN( m_flPersonalOrderCredit, (float)nPlayers );
+
+	int nToCheck = (int)m_flPersonalOrderCredit;
+	m_flPersonalOrderCredit -= nToCheck;
+
+	for ( int i = 0; i < nToCheck; i++ )
+	{
+		if ( m_iNextPersonalOrderPlayer >= m_aPlayers.Count() )
+		{
+			m_iNextPersonalOrderPlayer = 0;
+		}
+
+		CBaseTFPlayer *pPlayer = (CBaseTFPlayer *)m_aPlayers[m_iNextPersonalOrderPlayer++];
+		if ( ShouldCreatePersonalOrder( pPlayer ) )
+		{
+			CreatePersonalOrder( pPlayer );
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Create personal orders for all the team's members
 //-----------------------------------------------------------------------------
@@ -1152,21 +1869,29 @@ void CTFTeam::CreatePersonalOrders( void )
 	for ( int i = 0; i < m_aPlayers.Count(); i++ )
 	{
 		CBaseTFPlayer *pPlayer = (CBaseTFPlayer *)m_aPlayers[i];
-		/* TODO:
-		 * Decide if we're going to limit this to something greater.
-		 * If we are, we'll need to double check the order type, otherwise
-		 * the player will just keep being assigned the same order over and over.
-		 */
-		if ( CountOrdersOwnedByPlayer( pPlayer ) != 0 ) {
-			continue;
-		}
-
-		// Don't create orders for bots, undefined or dead people
-		if ( !(pPlayer->GetFlags() & FL_FAKECLIENT) && pPlayer->IsAlive() && !pPlayer->IsClass( TFCLASS_UNDECIDED ) )
+		if ( ShouldCreatePersonalOrder( pPlayer ) )
 			CreatePersonalOrder( pPlayer );
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Returns true if the player is due a new personal order
+//-----------------------------------------------------------------------------
+bool CTFTeam::ShouldCreatePersonalOrder( CBaseTFPlayer *pPlayer )
+{
+	/* TODO:
+	 * Decide if we're going to limit this to something greater.
+	 * If we are, we'll need to double check the order type, otherwise
+	 * the player will just keep being assigned the same order over and over.
+	 */
+	if ( CountOrdersOwnedByPlayer( pPlayer ) != 0 ) {
+		return false;
+	}
+
+	// Don't create orders for bots, undefined or dead people
+	return !(pPlayer->GetFlags() & FL_FAKECLIENT) && pPlayer->IsAlive() && !pPlayer->IsClass( TFCLASS_UNDECIDED );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Create personal orders for specified player
 //-----------------------------------------------------------------------------
@@ -1308,11 +2033,33 @@ void CTFTeam::UpdateMessages( void )
 //-----------------------------------------------------------------------------
 void CTFTeam::UpdatePowerpacks( CObjectPowerPack *pPackToIgnore, CBaseObject *pObjectToTarget )
 {
-	for ( int i = 0; i < GetNumObjects(); i++ )
+	VPROF( "CTFTeam::UpdatePowerpacks" );
+
+	// Only packs in range of the object can power it. A dying pack's objects have already
+	// gone looking for power one by one, so only packs that overlap its range are told to
+	// look around as well.
+	CUtlVector<CBaseObject*> packs;
+	if ( pObjectToTarget )
+	{
+		FindObjectsInRadius( OBJ_POWERPACK, pObjectToTarget->GetAbsOrigin(), POWERPACK_RANGE_DIST, packs );
+	}
+	else if ( pPackToIgnore )
 	{
-		CBaseObject *pObject = GetObject(i);
-		assert(pObject);
-		if ( pObject == pPackToIgnore || pObject->GetType() != OBJ_POWERPACK )
+		FindObjectsInRadius( OBJ_POWERPACK, pPackToIgnore->GetAbsOrigin(), POWERPACK_RANGE_DIST * 2, packs );
+	}
+	else
+	{
+		for ( int i = 0; i < GetNumObjects(); i++ )
+		{
+			if ( GetObject(i)->GetType() == OBJ_POWERPACK )
+				packs.AddToTail( GetObject(i) );
+		}
+	}
+
+	for ( int i = 0; i < packs.Count(); i++ )
+	{
+		CBaseObject *pObject = packs[i];
+		if ( pObject == pPackToIgnore )
 			continue;
 
 		((CObjectPowerPack*)pObject)->PowerNearbyObjects( pObjectToTarget );
@@ -1331,15 +2078,31 @@ void CTFTeam::UpdatePowerpacks( CObjectPowerPack *pPackToIgnore, CBaseObject *pO
 //-----------------------------------------------------------------------------
 void CTFTeam::UpdateBuffStations( CObjectBuffStation *pBuffStationToIgnore, CBaseObject *pObjectToTarget, bool bPlacing )
 {
-	for ( int iObject = 0; iObject < GetNumObjects(); ++iObject )
+	VPROF( "CTFTeam::UpdateBuffStations" );
+
+	// Same as the powerpacks: only stations that could reach the object, or that overlap
+	// the dying station's range.
+	CUtlVector<CBaseObject*> stations;
+	if ( pObjectToTarget )
 	{
-		CBaseObject *pObject = GetObject( iObject );
-		assert( pObject );
-	
-		if ( pObject->GetType() != OBJ_BUFF_STATION )
-			continue;
+		FindObjectsInRadius( OBJ_BUFF_STATION, pObjectToTarget->GetAbsOrigin(), BUFF_STATION_BUFF_RANGE_DIST, stations );
+	}
+	else if ( pBuffStationToIgnore )
+	{
+		FindObjectsInRadius( OBJ_BUFF_STATION, pBuffStationToIgnore->GetAbsOrigin(), BUFF_STATION_BUFF_RANGE_DIST * 2, stations );
+	}
+	else
+	{
+		for ( int i = 0; i < GetNumObjects(); i++ )
+		{
+			if ( GetObject(i)->GetType() == OBJ_BUFF_STATION )
+				stations.AddToTail( GetObject(i) );
+		}
+	}
 
-		CObjectBuffStation *pBuffStation = static_cast<CObjectBuffStation*>( pObject );
+	for ( int iObject = 0; iObject < stations.Count(); ++iObject )
+	{
+		CObjectBuffStation *pBuffStation = static_cast<CObjectBuffStation*>( stations[iObject] );
 		if ( pBuffStation == pBuffStationToIgnore )
 			continue;
 
@@ -1367,3 +2130,85 @@ CTFTeam* CTFTeam::GetEnemyTeam()
 }
 
 
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs every entity through both tactical visibility paths for every team,
+//			checks they agree and times them. Roughly what ShouldTransmit does for each
+//			client each snapshot.
+//-----------------------------------------------------------------------------
+static void CC_TacticalVisibilityTest( const CCommand &args )
+{
+	int nIterations = args.ArgC() > 1 ? max( atoi( args[1] ), 1 ) : 100;
+
+	CUtlVector<CBaseEntity*> entities;
+	for ( CBaseEntity *pEntity = gEntList.FirstEnt(); pEntity; pEntity = gEntList.NextEnt( pEntity ) )
+	{
+		if ( pEntity->edict() )
+		{
+			entities.AddToTail( pEntity );
+		}
+	}
+
+	int nTeams = GetNumberOfTeams();
+	int nChecks = nIterations * nTeams * entities.Count();
+	if ( !nChecks )
+		return;
+
+	// Pass 0 compares classnames, pass 1 uses the cached tactical classes
+	int nVisible[2] = { 0, 0 };
+	double flTime[2];
+	for ( int iPass = 0; iPass < 2; iPass++ )
+	{
+		double flStart = Plat_FloatTime();
+		for ( int iIteration = 0; iIteration < nIterations; iIteration++ )
+		{
+			for ( int iTeam = 0; iTeam < nTeams; iTeam++ )
+			{
+				CTFTeam *pTeam = GetGlobalTFTeam( iTeam );
+				for ( int i = 0; i < entities.Count(); i++ )
+				{
+					CBaseEntity *pEntity = entities[i];
+					bool bVisible;
+					if ( iPass == 0 )
+					{
+						bVisible = ::IsEntityVisibleToTactical( iTeam, pTeam->GetNumPlayers(), pTeam->GetNumObjects(), 
+							pEntity->entindex(), STRING( pEntity->m_iClassname ), pEntity->GetTeamNumber(), pEntity->GetAbsOrigin() );
+					}
+					else
+					{
+						bVisible = pTeam->IsEntityVisibleToTactical( pEntity );
+					}
+
+					if ( bVisible )
+						++nVisible[iPass];
+				}
+			}
+		}
+		flTime[iPass] = Plat_FloatTime() - flStart;
+	}
+
+	int nMismatches = 0;
+	for ( int iTeam = 0; iTeam < nTeams; iTeam++ )
+	{
+		CTFTeam *pTeam = GetGlobalTFTeam( iTeam );
+		for ( int i = 0; i < entities.Count(); i++ )
+		{
+			CBaseEntity *pEntity = entities[i];
+			bool bOld = ::IsEntityVisibleToTactical( iTeam, pTeam->GetNumPlayers(), pTeam->GetNumObjects(), 
+				pEntity->entindex(), STRING( pEntity->m_iClassname ), pEntity->GetTeamNumber(), pEntity->GetAbsOrigin() );
+			if ( bOld != pTeam->IsEntityVisibleToTactical( pEntity ) )
+			{
+				Warning( "  mismatch: %s (%d) for team %d\n", pEntity->GetClassname(), pEntity->entindex(), iTeam );
+				++nMismatches;
+			}
+		}
+	}
+
+	Msg( "tf_tactical_visibility_test: %d entities, %d teams, %d iterations\n", entities.Count(), nTeams, nIterations );
+	Msg( "  classnames:     %.3f ms (%.3f us/check)\n", flTime[0] * 1000.0, flTime[0] * 1000000.0 / nChecks );
+	Msg( "  tactical class: %.3f ms (%.3f us/check)\n", flTime[1] * 1000.0, flTime[1] * 1000000.0 / nChecks );
+	Msg( "  %d visible / %d visible, %d mismatches\n", nVisible[0] / nIterations, nVisible[1] / nIterations, nMismatches );
+}
+
+static ConCommand tf_tactical_visibility_test( "tf_tactical_visibility_test", CC_TacticalVisibilityTest, "Compare the cached tactical visibility classes against the classname checks and time them: tf_tactical_visibility_test [iterations]", FCVAR_CHEAT );
@@ -18,6 +18,10 @@
 #include "techtree.h"
 #include "team.h"
 #include "order_events.h"
+#include "tf_object_grid.h"
+#include "order_planner.h"
+#include "tf_tech_replication.h"
+#include "bitvec.h"
 
 class CBaseTFPlayer;
 class CResourceZone;
@@ -70,9 +74,14 @@ public:
 	virtual void UpdateClientData( CBasePlayer *pPlayer );
 	virtual void UpdateClientTechnology( int iTechID, CBaseTFPlayer *pPlayer );
 	virtual void UpdateTechnologyData( void );
+	bool		 ClientTechnologyDiffers( int iTechID, CBaseTFPlayer *pPlayer );
 	virtual bool ShouldTransmitToPlayer( CBasePlayer *pRecipient, CBaseEntity* pEntity );
+	virtual void PreCheckTransmit( CCheckTransmitInfo *pInfo, CBasePlayer *pRecipient );
 	virtual bool IsEntityVisibleToTactical( CBaseEntity *pEntity );
 
+	// Call when something changes which objects (or object screens) a team always gets sent.
+	static void	 InvalidateTransmitCache( void );
+
 	//-----------------------------------------------------------------------------
 	// Resources
 	//-----------------------------------------------------------------------------
@@ -96,6 +105,7 @@ public:
 	virtual void RecomputePreferences( void );
 	virtual void RecomputePurchases( void );
 	virtual bool HasNamedTechnology( const char *name );
+	bool		 HasTechnology( int iTechID );		// iTechID is a TECH_xxx or interned ID
 	virtual void GainedNewTechnology( CBaseTechnology *pTechnology );
 	virtual void UpdateTechnologies( void );
 	
@@ -135,6 +145,16 @@ public:
 	int		GetNumResuppliesCoveringPosition( const Vector &vPos );
 	int		GetNumRespawnStationsCoveringPosition( const Vector &vPos );
 
+	// Closest object of the specified type within flMaxDist, or NULL.
+	CBaseObject		*FindNearestObject( int iObjectType, const Vector &vPos, float flMaxDist );
+
+	// Adds our objects of the specified type (any type if it's -1) that are closer than
+	// flRadius to vPos to the list. Returns how many were added.
+	int		FindObjectsInRadius( int iObjectType, const Vector &vPos, float flRadius, CUtlVector<CBaseObject*> &objects );
+
+	// Call when one of our objects has been moved, so the coverage grids stay up to date.
+	void	ObjectMoved( CBaseObject *pObject );
+
 
 	//-----------------------------------------------------------------------------
 	// Orders
@@ -161,10 +181,14 @@ public:
 	int		CountOrders( int flags, int iOrderType, CBaseEntity *pTarget=0, CBaseTFPlayer *pOwner=0 );
 	int		CountOrdersOwnedByPlayer( CBaseTFPlayer *pPlayer );
 
+	void	UpdatePersonalOrders( void );
 	void	CreatePersonalOrders( void );
 	void	CreatePersonalOrder( CBaseTFPlayer *pPlayer );
+	bool	ShouldCreatePersonalOrder( CBaseTFPlayer *pPlayer );
 	void	RemoveOrdersToPlayer( CBaseTFPlayer *pPlayer );
 
+	COrderPlanner	*GetOrderPlanner( void ) { return &m_OrderPlanner; }
+
 	//-----------------------------------------------------------------------------
 	// Messages
 	//-----------------------------------------------------------------------------
@@ -201,6 +225,9 @@ private:
 
 	// Orders
 	float	m_flPersonalOrderUpdateTime;
+	float	m_flPersonalOrderCredit;		// Players owed a look this tick when spreading orders out
+	int		m_iNextPersonalOrderPlayer;
+	COrderPlanner	m_OrderPlanner;
 
 	// Used to distribute resources to a team
 	float	m_flNextResourceTime;
@@ -212,6 +239,38 @@ private:
 	CUtlVector< OrderHandle >			m_aOrders;				// Stored in order of priority
 	CUtlVector< CTeamMessage* >			m_aMessages;
 	CUtlVector< CBaseObject* >			m_aObjects;
+
+	// Spatial indices for the coverage queries
+	CObjectGrid							m_ObjectGrids[OBJ_LAST];	// m_aObjects, by type
+	CObjectGrid							m_AllObjectsGrid;			// m_aObjects
+	CObjectGrid							m_SentryGrid;
+	CObjectGrid							m_ResupplyGrid;				// m_aResupplyBeacons
+
+	// Batched technology replication (tf_tech_batch_replication). The bits after the
+	// per-recipient header of each "TechnologyBatch" message, see tf_tech_replication.h.
+	struct TechBatch_t
+	{
+		int		m_iFirstTech;
+		int		m_nTechs;				// Includes TECH_BATCH_ALL_PRESENT for the baseline
+		int		m_nBits;
+		byte	m_Data[ MAX_USER_MSG_DATA - TECH_BATCH_HEADER_BYTES ];
+	};
+
+	void	BuildTechnologyBatches( CUtlVector<TechBatch_t> &batches, bool bBaseline );
+	void	SendTechnologyBatches( CBaseTFPlayer *pPlayer, const CUtlVector<TechBatch_t> &batches, bool bBaseline );
+	void	RecordClientTechnology( int iTechID, CBaseTFPlayer *pPlayer );
+
+	CUtlVector<TechBatch_t>				m_TechDeltaBatches;
+	CUtlVector<TechBatch_t>				m_TechBaselineBatches;	// Every tech, shared by everyone who respawns in a tick
+	int									m_nTechBaselineTick;
+
+	// Transmit cache: the objects every member of this team always gets (the ones on the
+	// tactical map), rebuilt when InvalidateTransmitCache has been called.
+	void	UpdateTransmitCache( void );
+
+	CBitVec<MAX_EDICTS>					m_TransmitAlways;
+	CUtlVector<CBaseObject*>			m_TransmitSpecial;		// Sent with SetTransmit (see CBaseObject::HasTransmitDependents)
+	int									m_nTransmitCacheSerial;
 };
 
 
@@ -0,0 +1,937 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Brush-only line of sight against a ray traced copy of the world.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "tf_worldlos.h"
+#include "filesystem.h"
+#include "bspfile.h"
+#include "vstdlib/random.h"
+#include "tier0/fasttimer.h"
+#include "tier0/vprof.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+// Brush faces start out as a square this big on their plane and get clipped down by the
+// brush's other sides.
+#define WORLDLOS_WINDING_EXTENT		( MAX_COORD_INTEGER * 4 )
+#define WORLDLOS_MAX_WINDING		64
+#define WORLDLOS_CLIP_EPSILON		0.01f
+
+// ddispinfo_t has unsigned longs at the end, so its size in memory isn't the same as in the
+// file on every platform. Only the fields before them get read, and those line up.
+#define WORLDLOS_DISPINFO_SIZE		176
+
+// tf_worldlos_simd_bench makes and traces its rays this many at a time, so ten million of
+// them don't need hundreds of megabytes. Keep it a multiple of 8.
+#define WORLDLOS_SIMD_BENCH_CHUNK	65536
+#define WORLDLOS_SIMD_BENCH_FAN		64
+
+// The engine backs traces off surfaces by DIST_EPSILON and lets rays skim along faces, so a
+// triangle hit only counts as occluded when it's this far from both ends of the segment and
+// the ray isn't nearly parallel to the surface (sine of the angle between them).
+#define WORLDLOS_END_MARGIN			1.0f
+#define WORLDLOS_MIN_HIT_SINE		0.05f
+
+
+static CTFWorldLOS g_TFWorldLOS;
+
+static void TFWorldLOSChanged( IConVar *pConVar, const char *pOldValue, float flOldValue )
+{
+	// Turned on mid-map, build it now instead of waiting for the next one.
+	ConVarRef var( pConVar );
+	if ( var.GetBool() && !g_TFWorldLOS.IsBuilt() && gpGlobals->mapname != NULL_STRING )
+	{
+		g_TFWorldLOS.Build();
+	}
+}
+
+ConVar tf_worldlos( "tf_worldlos", "0", 0, "Answer brush-only line of sight checks from a ray traced copy of the world. The world is only built (at map load, or when this is turned on) while it's 1.", TFWorldLOSChanged );
+
+CTFWorldLOS* GetTFWorldLOS()
+{
+	return &g_TFWorldLOS;
+}
+
+
+//-----------------------------------------------------------------------------
+// Is a hit flDist along vecDelta (flDist in the same units as flLength, the segment's
+// length) clearly inside the segment, and not one the engine would let the ray skim past?
+//-----------------------------------------------------------------------------
+static bool IsClearHit( float flDist, float flLength, const Vector &vecNormal, const Vector &vecDelta )
+{
+	float flDeltaLength = vecDelta.Length();
+	if ( flDeltaLength <= 2.0f * WORLDLOS_END_MARGIN )
+		return false;
+
+	float flMargin = WORLDLOS_END_MARGIN * flLength / flDeltaLength;
+	if ( flDist < flMargin || flDist > flLength - flMargin )
+		return false;
+
+	return fabs( DotProduct( vecNormal, vecDelta ) ) >= WORLDLOS_MIN_HIT_SINE * flDeltaLength;
+}
+
+
+//-----------------------------------------------------------------------------
+// Reads a whole lump. Fails if it's compressed or isn't a whole number of T's.
+//-----------------------------------------------------------------------------
+template< class T >
+static bool ReadLump( FileHandle_t hFile, const dheader_t &header, int iLump, CUtlVector<T> &data, int nSize = sizeof( T ) )
+{
+	const lump_t &lump = header.lumps[iLump];
+	if ( lump.uncompressedSize != 0 || lump.filelen < 0 || ( lump.filelen % nSize ) != 0 )
+		return false;
+
+	data.SetCount( lump.filelen / sizeof( T ) );
+	if ( !lump.filelen )
+		return true;
+
+	filesystem->Seek( hFile, lump.fileofs, FILESYSTEM_SEEK_HEAD );
+	return filesystem->Read( data.Base(), lump.filelen, hFile ) == lump.filelen;
+}
+
+
+//-----------------------------------------------------------------------------
+// A big square on the plane, facing the same way.
+//-----------------------------------------------------------------------------
+static int BaseWindingForPlane( const Vector &vecNormal, float flDist, Vector *pOut )
+{
+	// Find the major axis.
+	int iAxis = 0;
+	for ( int i=1; i < 3; i++ )
+	{
+		if ( fabs( vecNormal[i] ) > fabs( vecNormal[iAxis] ) )
+			iAxis = i;
+	}
+
+	Vector vecUp( 0, 0, 0 );
+	if ( iAxis == 2 )
+		vecUp.x = 1;
+	else
+		vecUp.z = 1;
+
+	vecUp -= vecNormal * DotProduct( vecUp, vecNormal );
+	VectorNormalize( vecUp );
+
+	Vector vecRight = CrossProduct( vecUp, vecNormal );
+	Vector vecOrg = vecNormal * flDist;
+
+	vecUp *= WORLDLOS_WINDING_EXTENT;
+	vecRight *= WORLDLOS_WINDING_EXTENT;
+
+	pOut[0] = vecOrg - vecRight + vecUp;
+	pOut[1] = vecOrg + vecRight + vecUp;
+	pOut[2] = vecOrg + vecRight - vecUp;
+	pOut[3] = vecOrg - vecRight - vecUp;
+	return 4;
+}
+
+
+//-----------------------------------------------------------------------------
+// Keeps the part of the winding behind the plane (inside the brush).
+//-----------------------------------------------------------------------------
+static int ClipWinding( const Vector *pIn, int nIn, Vector *pOut, const Vector &vecNormal, float flDist )
+{
+	float flDists[WORLDLOS_MAX_WINDING];
+	int nFront = 0, nBack = 0;
+
+	for ( int i=0; i < nIn; i++ )
+	{
+		flDists[i] = DotProduct( pIn[i], vecNormal ) - flDist;
+		if ( flDists[i] > WORLDLOS_CLIP_EPSILON )
+			++nFront;
+		else if ( flDists[i] < -WORLDLOS_CLIP_EPSILON )
+			++nBack;
+	}
+
+	if ( !nFront )
+	{
+		memcpy( pOut, pIn, nIn * sizeof( Vector ) );
+		return nIn;
+	}
+
+	if ( !nBack )
+		return 0;
+
+	int nOut = 0;
+	for ( int i=0; i < nIn && nOut < WORLDLOS_MAX_WINDING - 1; i++ )
+	{
+		int iNext = ( i + 1 ) % nIn;
+		float d1 = flDists[i];
+		float d2 = flDists[iNext];
+
+		if ( d1 <= WORLDLOS_CLIP_EPSILON )
+		{
+			pOut[nOut++] = pIn[i];
+		}
+
+		// Crosses the plane on the way to the next point?
+		if ( ( d1 > WORLDLOS_CLIP_EPSILON && d2 < -WORLDLOS_CLIP_EPSILON ) ||
+			 ( d1 < -WORLDLOS_CLIP_EPSILON && d2 > WORLDLOS_CLIP_EPSILON ) )
+		{
+			float t = d1 / ( d1 - d2 );
+			pOut[nOut++] = pIn[i] + ( pIn[iNext] - pIn[i] ) * t;
+		}
+	}
+
+	return nOut;
+}
+
+
+// ------------------------------------------------------------------------------------------ //
+// CTFWorldLOS implementation.
+// ------------------------------------------------------------------------------------------ //
+
+CTFWorldLOS::CTFWorldLOS() : CAutoGameSystem( "CTFWorldLOS" )
+{
+	m_pEnvironment = NULL;
+	m_nBrushTriangles = 0;
+	m_nDispTriangles = 0;
+	m_flBuildTime = 0;
+}
+
+
+void CTFWorldLOS::LevelInitPostEntity()
+{
+	LevelShutdownPostEntity();
+
+	if ( tf_worldlos.GetBool() )
+	{
+		Build();
+	}
+}
+
+
+void CTFWorldLOS::Build()
+{
+	LevelShutdownPostEntity();
+
+	char szFilename[MAX_PATH];
+	Q_snprintf( szFilename, sizeof( szFilename ), "maps/%s.bsp", STRING( gpGlobals->mapname ) );
+
+	CFastTimer timer;
+	timer.Start();
+
+	if ( !BuildFromBSP( szFilename ) )
+	{
+		Warning( "CTFWorldLOS: couldn't build the world from %s, using engine traces.\n", szFilename );
+		LevelShutdownPostEntity();
+		return;
+	}
+
+	timer.End();
+	m_flBuildTime = timer.GetDuration().GetSeconds();
+
+	DevMsg( "CTFWorldLOS: %d brush + %d displacement triangles, %d kd nodes, built in %.2f seconds\n",
+		m_nBrushTriangles, m_nDispTriangles, m_pEnvironment->OptimizedKDTree.Count(), m_flBuildTime );
+}
+
+
+void CTFWorldLOS::LevelShutdownPostEntity()
+{
+	delete m_pEnvironment;
+	m_pEnvironment = NULL;
+	m_nBrushTriangles = 0;
+	m_nDispTriangles = 0;
+}
+
+
+bool CTFWorldLOS::IsBuilt() const
+{
+	return m_pEnvironment != NULL;
+}
+
+
+bool CTFWorldLOS::IsActive() const
+{
+	return m_pEnvironment && tf_worldlos.GetBool();
+}
+
+
+bool CTFWorldLOS::BuildFromBSP( const char *pFilename )
+{
+	FileHandle_t hFile = filesystem->Open( pFilename, "rb", "GAME" );
+	if ( !hFile )
+		return false;
+
+	dheader_t header;
+	if ( filesystem->Read( &header, sizeof( header ), hFile ) != sizeof( header ) ||
+		 header.ident != IDBSPHEADER || header.version < MINBSPVERSION || header.version > BSPVERSION )
+	{
+		filesystem->Close( hFile );
+		return false;
+	}
+
+	CUtlVector<dplane_t> planes;
+	CUtlVector<dbrush_t> brushes;
+	CUtlVector<dbrushside_t> brushSides;
+	CUtlVector<dmodel_t> models;
+	CUtlVector<dnode_t> nodes;
+	CUtlVector<byte> leafs;
+	CUtlVector<unsigned short> leafBrushes;
+	CUtlVector<dface_t> faces;
+	CUtlVector<dedge_t> edges;
+	CUtlVector<int> surfEdges;
+	CUtlVector<dvertex_t> vertexes;
+	CUtlVector<byte> dispInfos;
+	CUtlVector<CDispVert> dispVerts;
+	CUtlVector<CDispTri> dispTris;
+
+	// Old leafs have their ambient lighting in them.
+	int nLeafSize = ( header.lumps[LUMP_LEAFS].version == 0 ) ? sizeof( dleaf_version_0_t ) : sizeof( dleaf_t );
+
+	bool bRead = ReadLump( hFile, header, LUMP_PLANES, planes ) &&
+		ReadLump( hFile, header, LUMP_BRUSHES, brushes ) &&
+		ReadLump( hFile, header, LUMP_BRUSHSIDES, brushSides ) &&
+		ReadLump( hFile, header, LUMP_MODELS, models ) &&
+		ReadLump( hFile, header, LUMP_NODES, nodes ) &&
+		ReadLump( hFile, header, LUMP_LEAFS, leafs, nLeafSize ) &&
+		ReadLump( hFile, header, LUMP_LEAFBRUSHES, leafBrushes ) &&
+		ReadLump( hFile, header, LUMP_FACES, faces ) &&
+		ReadLump( hFile, header, LUMP_EDGES, edges ) &&
+		ReadLump( hFile, header, LUMP_SURFEDGES, surfEdges ) &&
+		ReadLump( hFile, header, LUMP_VERTEXES, vertexes ) &&
+		ReadLump( hFile, header, LUMP_DISPINFO, dispInfos, WORLDLOS_DISPINFO_SIZE ) &&
+		ReadLump( hFile, header, LUMP_DISP_VERTS, dispVerts ) &&
+		ReadLump( hFile, header, LUMP_DISP_TRIS, dispTris );
+
+	filesystem->Close( hFile );
+
+	if ( !bRead || !models.Count() )
+		return false;
+
+	int nLeafs = leafs.Count() / nLeafSize;
+
+	m_pEnvironment = new RayTracingEnvironment;
+	m_pEnvironment->Flags |= RTE_FLAGS_FAST_TREE_GENERATION | RTE_FLAGS_DONT_STORE_TRIANGLE_COLORS | RTE_FLAGS_DONT_STORE_TRIANGLE_MATERIALS;
+
+	//
+	// Brushes. Brush entities have theirs in the same lump, so only take the ones in the
+	// world model's leafs.
+	//
+	CUtlVector<byte> worldBrush;
+	worldBrush.SetCount( brushes.Count() );
+	memset( worldBrush.Base(), 0, worldBrush.Count() );
+
+	CUtlVector<int> nodeStack;
+	nodeStack.AddToTail( models[0].headnode );
+	while ( nodeStack.Count() )
+	{
+		int iNode = nodeStack.Tail();
+		nodeStack.Remove( nodeStack.Count() - 1 );
+
+		if ( iNode >= 0 )
+		{
+			if ( iNode >= nodes.Count() )
+				continue;
+
+			nodeStack.AddToTail( nodes[iNode].children[0] );
+			nodeStack.AddToTail( nodes[iNode].children[1] );
+			continue;
+		}
+
+		int iLeaf = -1 - iNode;
+		if ( iLeaf >= nLeafs )
+			continue;
+
+		const dleaf_t *pLeaf = (const dleaf_t *)( leafs.Base() + iLeaf * nLeafSize );
+		for ( int i=0; i < pLeaf->numleafbrushes; i++ )
+		{
+			int iLeafBrush = pLeaf->firstleafbrush + i;
+			if ( iLeafBrush < leafBrushes.Count() && leafBrushes[iLeafBrush] < brushes.Count() )
+			{
+				worldBrush[leafBrushes[iLeafBrush]] = 1;
+			}
+		}
+	}
+
+	Vector winding[2][WORLDLOS_MAX_WINDING];
+	int nTriangle = 0;
+
+	for ( int iBrush=0; iBrush < brushes.Count(); iBrush++ )
+	{
+		const dbrush_t &brush = brushes[iBrush];
+		if ( !worldBrush[iBrush] || !( brush.contents & MASK_SOLID_BRUSHONLY ) )
+			continue;
+
+		if ( brush.firstside < 0 || brush.firstside + brush.numsides > brushSides.Count() )
+			continue;
+
+		for ( int iSide=0; iSide < brush.numsides; iSide++ )
+		{
+			// Bevels are only there for box traces, they don't change the brush's shape.
+			const dbrushside_t &side = brushSides[brush.firstside + iSide];
+			if ( side.bevel || side.planenum >= planes.Count() )
+				continue;
+
+			int iWinding = 0;
+			int nPoints = BaseWindingForPlane( planes[side.planenum].normal, planes[side.planenum].dist, winding[0] );
+
+			for ( int iClip=0; iClip < brush.numsides && nPoints; iClip++ )
+			{
+				const dbrushside_t &clipSide = brushSides[brush.firstside + iClip];
+				if ( iClip == iSide || clipSide.bevel || clipSide.planenum >= planes.Count() )
+					continue;
+
+				const dplane_t &plane = planes[clipSide.planenum];
+				nPoints = ClipWinding( winding[iWinding], nPoints, winding[!iWinding], plane.normal, plane.dist );
+				iWinding = !iWinding;
+			}
+
+			for ( int i=2; i < nPoints; i++ )
+			{
+				m_pEnvironment->AddTriangle( nTriangle++, winding[iWinding][0], winding[iWinding][i-1], winding[iWinding][i], vec3_origin );
+			}
+		}
+	}
+
+	m_nBrushTriangles = nTriangle;
+
+	//
+	// Displacements, built the same way CCoreDispInfo does it.
+	//
+	int nDispInfos = dispInfos.Count() / WORLDLOS_DISPINFO_SIZE;
+	CUtlVector<Vector> dispPoints;
+
+	for ( int iDisp=0; iDisp < nDispInfos; iDisp++ )
+	{
+		const ddispinfo_t *pDisp = (const ddispinfo_t *)( dispInfos.Base() + iDisp * WORLDLOS_DISPINFO_SIZE );
+		if ( !( pDisp->contents & MASK_SOLID_BRUSHONLY ) || pDisp->m_iMapFace >= faces.Count() )
+			continue;
+
+		const dface_t &face = faces[pDisp->m_iMapFace];
+		if ( face.numedges != 4 || face.firstedge < 0 || face.firstedge + 4 > surfEdges.Count() )
+			continue;
+
+		Vector vecCorners[4];
+		bool bValid = true;
+		for ( int i=0; i < 4 && bValid; i++ )
+		{
+			int iEdge = surfEdges[face.firstedge + i];
+			int iAbsEdge = abs( iEdge );
+			if ( iAbsEdge >= edges.Count() )
+			{
+				bValid = false;
+				break;
+			}
+
+			int iVert = ( iEdge >= 0 ) ? edges[iAbsEdge].v[0] : edges[iAbsEdge].v[1];
+			if ( iVert >= vertexes.Count() )
+			{
+				bValid = false;
+				break;
+			}
+
+			vecCorners[i] = vertexes[iVert].point;
+		}
+
+		int nPostSpacing = ( 1 << pDisp->power ) + 1;
+		int nVerts = nPostSpacing * nPostSpacing;
+		if ( !bValid || pDisp->power < 2 || pDisp->power > 4 ||
+			 pDisp->m_iDispVertStart < 0 || pDisp->m_iDispVertStart + nVerts > dispVerts.Count() )
+			continue;
+
+		// The corner closest to the start position is the first one.
+		int iStart = 0;
+		for ( int i=1; i < 4; i++ )
+		{
+			if ( vecCorners[i].DistToSqr( pDisp->startPosition ) < vecCorners[iStart].DistToSqr( pDisp->startPosition ) )
+				iStart = i;
+		}
+
+		Vector vecPoints[4];
+		for ( int i=0; i < 4; i++ )
+		{
+			vecPoints[i] = vecCorners[( i + iStart ) % 4];
+		}
+
+		// Triangles tagged for removal are holes cut in the displacement.
+		int nTris = 2 * ( nPostSpacing - 1 ) * ( nPostSpacing - 1 );
+		const CDispTri *pTris = NULL;
+		if ( pDisp->m_iDispTriStart >= 0 && pDisp->m_iDispTriStart + nTris <= dispTris.Count() )
+		{
+			pTris = &dispTris[pDisp->m_iDispTriStart];
+		}
+
+		float ooInt = 1.0f / ( nPostSpacing - 1 );
+		dispPoints.SetCount( nVerts );
+
+		for ( int i=0; i < nPostSpacing; i++ )
+		{
+			Vector vecEnd0 = vecPoints[0] + ( vecPoints[1] - vecPoints[0] ) * ( i * ooInt );
+			Vector vecEnd1 = vecPoints[3] + ( vecPoints[2] - vecPoints[3] ) * ( i * ooInt );
+
+			for ( int j=0; j < nPostSpacing; j++ )
+			{
+				int ndx = i * nPostSpacing + j;
+				const CDispVert &vert = dispVerts[pDisp->m_iDispVertStart + ndx];
+				dispPoints[ndx] = vecEnd0 + ( vecEnd1 - vecEnd0 ) * ( j * ooInt ) + vert.m_vVector * vert.m_flDist;
+			}
+		}
+
+		// Same alternating diagonals, in the same order, as the displacement collision
+		// (two triangles per quad, so the tags line up with iTri).
+		int iTri = 0;
+		for ( int i=0; i < nPostSpacing - 1; i++ )
+		{
+			for ( int j=0; j < nPostSpacing - 1; j++, iTri += 2 )
+			{
+				int ndx = i * nPostSpacing + j;
+				const Vector &v00 = dispPoints[ndx];
+				const Vector &v01 = dispPoints[ndx + 1];
+				const Vector &v10 = dispPoints[ndx + nPostSpacing];
+				const Vector &v11 = dispPoints[ndx + nPostSpacing + 1];
+
+				bool bKeep0 = !pTris || !( pTris[iTri].m_uiTags & DISPTRI_TAG_REMOVE );
+				bool bKeep1 = !pTris || !( pTris[iTri + 1].m_uiTags & DISPTRI_TAG_REMOVE );
+
+				if ( ndx % 2 )
+				{
+					if ( bKeep0 )
+						m_pEnvironment->AddTriangle( nTriangle++, v00, v10, v01, vec3_origin );
+					if ( bKeep1 )
+						m_pEnvironment->AddTriangle( nTriangle++, v10, v11, v01, vec3_origin );
+				}
+				else
+				{
+					if ( bKeep0 )
+						m_pEnvironment->AddTriangle( nTriangle++, v00, v10, v11, vec3_origin );
+					if ( bKeep1 )
+						m_pEnvironment->AddTriangle( nTriangle++, v00, v11, v01, vec3_origin );
+				}
+			}
+		}
+	}
+
+	m_nDispTriangles = nTriangle - m_nBrushTriangles;
+
+	if ( !nTriangle )
+		return false;
+
+	m_pEnvironment->SetupAccelerationStructure();
+	return true;
+}
+
+
+int CTFWorldLOS::EngineWorldOccluded( const FourRays &rays, int nRays )
+{
+	CTraceFilterWorldOnly filter;
+	int nOccluded = 0;
+
+	for ( int i=0; i < nRays; i++ )
+	{
+		Vector vecStart = rays.origin.Vec( i );
+		Ray_t ray;
+		ray.Init( vecStart, vecStart + rays.direction.Vec( i ) );
+
+		trace_t tr;
+		enginetrace->TraceRay( ray, MASK_SOLID_BRUSHONLY, &filter, &tr );
+		if ( tr.fraction < 1.0f || tr.startsolid )
+		{
+			nOccluded |= ( 1 << i );
+		}
+	}
+
+	return nOccluded;
+}
+
+
+int CTFWorldLOS::IsWorldOccluded( const FourRays &rays )
+{
+	if ( !IsActive() )
+		return EngineWorldOccluded( rays, 4 );
+
+	VPROF( "CTFWorldLOS::IsWorldOccluded" );
+
+	// Anything past the end of the segment doesn't count.
+	RayTracingResult result;
+	m_pEnvironment->Trace4Rays( rays, Four_Zeros, Four_Ones, &result );
+
+	int nOccluded = 0;
+	for ( int i=0; i < 4; i++ )
+	{
+		if ( result.HitIds[i] != -1 && IsClearHit( SubFloat( result.HitDistance, i ), 1.0f, result.surface_normal.Vec( i ), rays.direction.Vec( i ) ) )
+		{
+			nOccluded |= ( 1 << i );
+		}
+	}
+
+	VPROF_INCREMENT_COUNTER( "TFWorldLOS: packets", 1 );
+	return nOccluded;
+}
+
+
+bool CTFWorldLOS::IsWorldOccluded( const Vector &vecStart, const Vector &vecEnd )
+{
+	FourRays rays;
+	rays.origin.DuplicateVector( vecStart );
+	rays.direction.DuplicateVector( vecEnd - vecStart );
+
+	if ( !IsActive() )
+		return EngineWorldOccluded( rays, 1 ) != 0;
+
+	return IsWorldOccluded( rays ) != 0;
+}
+
+
+void CTFWorldLOS::IsWorldOccluded( int nRays, const Vector *pStarts, const Vector *pEnds, bool *pOccluded )
+{
+	if ( !IsActive() )
+	{
+		for ( int i=0; i < nRays; i++ )
+		{
+			pOccluded[i] = IsWorldOccluded( pStarts[i], pEnds[i] );
+		}
+		return;
+	}
+
+	VPROF( "CTFWorldLOS::IsWorldOccluded (batch)" );
+
+	CUtlVectorFixedGrowable<RayTracingSingleResult, 64> results;
+	results.SetCount( nRays );
+
+	RayStream stream;
+	for ( int i=0; i < nRays; i++ )
+	{
+		m_pEnvironment->AddToRayBatch( stream, pStarts[i], pEnds[i], &results[i] );
+	}
+	m_pEnvironment->FinishRayStream( stream );
+
+	// The batch normalizes the directions, so hits are in units instead of fractions.
+	for ( int i=0; i < nRays; i++ )
+	{
+		pOccluded[i] = ( results[i].HitID != -1 &&
+			IsClearHit( results[i].HitDistance, results[i].ray_length, results[i].surface_normal, pEnds[i] - pStarts[i] ) );
+	}
+
+	VPROF_INCREMENT_COUNTER( "TFWorldLOS: batched rays", nRays );
+}
+
+
+bool CTFWorldLOS::GetBenchmarkPoints( CUtlVector<Vector> &points )
+{
+	// Ray ends are the centers of entities that aren't inside the world, which keeps them in
+	// the playable part of the map.
+	for ( CBaseEntity *pEntity = gEntList.FirstEnt(); pEntity; pEntity = gEntList.NextEnt( pEntity ) )
+	{
+		if ( pEntity->IsWorld() || !pEntity->edict() )
+			continue;
+
+		Vector vecPoint = pEntity->WorldSpaceCenter();
+		if ( !( enginetrace->GetPointContents( vecPoint ) & MASK_SOLID_BRUSHONLY ) )
+		{
+			points.AddToTail( vecPoint );
+		}
+	}
+
+	if ( points.Count() < 2 )
+	{
+		Msg( "Not enough entities on the map to make rays between.\n" );
+		return false;
+	}
+
+	return true;
+}
+
+
+void CTFWorldLOS::RunBenchmark( int nRays )
+{
+	if ( !IsActive() )
+	{
+		Msg( "The ray traced world isn't built (or tf_worldlos is 0).\n" );
+		return;
+	}
+
+	CUtlVector<Vector> points;
+	if ( !GetBenchmarkPoints( points ) )
+		return;
+
+	CUtlVector<Vector> starts, ends;
+	starts.SetCount( nRays );
+	ends.SetCount( nRays );
+
+	for ( int i=0; i < nRays; i++ )
+	{
+		starts[i] = points[RandomInt( 0, points.Count() - 1 )];
+		ends[i] = points[RandomInt( 0, points.Count() - 1 )];
+	}
+
+	CUtlVector<bool> engineResults, singleResults, batchResults;
+	engineResults.SetCount( nRays );
+	singleResults.SetCount( nRays );
+	batchResults.SetCount( nRays );
+
+	CFastTimer timer;
+	double flTimes[4];
+	trace_t tr;
+
+	// What the fortress code does now.
+	timer.Start();
+	for ( int i=0; i < nRays; i++ )
+	{
+		UTIL_TraceLine( starts[i], ends[i], MASK_SOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &tr );
+	}
+	timer.End();
+	flTimes[0] = timer.GetDuration().GetSeconds();
+
+	// The engine against just the world, which is what this is meant to match.
+	CTraceFilterWorldOnly filter;
+	timer.Start();
+	for ( int i=0; i < nRays; i++ )
+	{
+		Ray_t ray;
+		ray.Init( starts[i], ends[i] );
+		enginetrace->TraceRay( ray, MASK_SOLID_BRUSHONLY, &filter, &tr );
+		engineResults[i] = ( tr.fraction < 1.0f || tr.startsolid );
+	}
+	timer.End();
+	flTimes[1] = timer.GetDuration().GetSeconds();
+
+	timer.Start();
+	for ( int i=0; i < nRays; i++ )
+	{
+		singleResults[i] = IsWorldOccluded( starts[i], ends[i] );
+	}
+	timer.End();
+	flTimes[2] = timer.GetDuration().GetSeconds();
+
+	timer.Start();
+	IsWorldOccluded( nRays, starts.Base(), ends.Base(), batchResults.Base() );
+	timer.End();
+	flTimes[3] = timer.GetDuration().GetSeconds();
+
+	int nOccluded = 0, nExtraBlocked = 0, nMissed = 0, nBatchDiffers = 0;
+	for ( int i=0; i < nRays; i++ )
+	{
+		if ( engineResults[i] )
+			++nOccluded;
+
+		if ( singleResults[i] && !engineResults[i] )
+			++nExtraBlocked;
+		else if ( !singleResults[i] && engineResults[i] )
+			++nMissed;
+
+		if ( batchResults[i] != singleResults[i] )
+			++nBatchDiffers;
+	}
+
+	static const char *s_pNames[4] =
+	{
+		"UTIL_TraceLine( MASK_SOLID_BRUSHONLY )",
+		"engine trace, world only",
+		"ray traced world, one at a time",
+		"ray traced world, sorted batch",
+	};
+
+	Msg( "%d rays between %d points on %s (%d blocked by the world)\n", nRays, points.Count(), STRING( gpGlobals->mapname ), nOccluded );
+	Msg( "World: %d brush + %d displacement triangles, built in %.2f seconds\n", m_nBrushTriangles, m_nDispTriangles, m_flBuildTime );
+	for ( int i=0; i < 4; i++ )
+	{
+		Msg( "    %-40s %8.2f ms  %10.0f rays/sec  (%.2fx)\n", s_pNames[i], flTimes[i] * 1000.0,
+			flTimes[i] > 0 ? nRays / flTimes[i] : 0.0, flTimes[i] > 0 ? flTimes[0] / flTimes[i] : 0.0 );
+	}
+	Msg( "Against the world only engine trace: %d blocked that it let through, %d let through that it blocked. %d packet results differ.\n",
+		nExtraBlocked, nMissed, nBatchDiffers );
+}
+
+
+//-----------------------------------------------------------------------------
+// Traces the rays in the order given, 8 at a time, with the directions normalized the same
+// way the ray tracer's batches do it.
+//-----------------------------------------------------------------------------
+static void TraceUnsortedPackets( RayTracingEnvironment *pEnvironment, int nRays, const Vector *pStarts, const Vector *pEnds, RayTracingSingleResult *pResults )
+{
+	for ( int i=0; i < nRays; i += 8 )
+	{
+		FourRays rays[2];
+		for ( int r=0; r < 8; r++ )
+		{
+			int iRay = min( i + r, nRays - 1 );
+			Vector vecDir = pEnds[iRay] - pStarts[iRay];
+			for ( int c=0; c < 3; c++ )
+			{
+				SubFloat( rays[r >> 2].origin[c], r & 3 ) = pStarts[iRay][c];
+				SubFloat( rays[r >> 2].direction[c], r & 3 ) = vecDir[c];
+			}
+		}
+
+		fltx4 TMin[2], TMax[2];
+		for ( int p=0; p < 2; p++ )
+		{
+			TMin[p] = Four_Zeros;
+			TMax[p] = rays[p].direction.length();
+			rays[p].direction *= ReciprocalSaturateSIMD( TMax[p] );
+		}
+
+		RayTracingResult results[2];
+		pEnvironment->Trace8Rays( rays, TMin, TMax, results );
+
+		for ( int r=0; r < 8 && i + r < nRays; r++ )
+		{
+			RayTracingSingleResult &out = pResults[i + r];
+			out.HitID = results[r >> 2].HitIds[r & 3];
+			out.HitDistance = SubFloat( results[r >> 2].HitDistance, r & 3 );
+			out.ray_length = SubFloat( TMax[r >> 2], r & 3 );
+		}
+	}
+}
+
+
+void CTFWorldLOS::RunSIMDBenchmark( int nRays )
+{
+	if ( !m_pEnvironment )
+	{
+		Msg( "The ray traced world isn't built (set tf_worldlos 1).\n" );
+		return;
+	}
+
+	CUtlVector<Vector> points;
+	if ( !GetBenchmarkPoints( points ) )
+		return;
+
+	// Point to point rays go between random pairs of points, so no two are alike and packets
+	// of them are as bad as it gets. Fans are bunches of rays from one point into a narrow
+	// cone, like a sweep of line of sight checks.
+	enum
+	{
+		RAYS_POINT_TO_POINT = 0,
+		RAYS_FANS,
+		NUM_RAY_SETS
+	};
+
+	// Each set goes through unsorted packets of 8, and through the sorted batch.
+	enum
+	{
+		TRACE_PACKETS = 0,
+		TRACE_BATCH,
+		NUM_TRACE_METHODS
+	};
+
+	bool bAVX2 = RayTracingEnvironment::IsAVX2Available();
+	uint32 nOldFlags = m_pEnvironment->Flags;
+
+	double flTimes[NUM_RAY_SETS][NUM_TRACE_METHODS][2];
+	memset( flTimes, 0, sizeof( flTimes ) );
+	int nMismatches = 0;
+
+	CUtlVector<Vector> starts, ends;
+	CUtlVector<RayTracingSingleResult> results[2];
+	CFastTimer timer;
+
+	for ( int iSet=0; iSet < NUM_RAY_SETS; iSet++ )
+	{
+		for ( int iDone=0; iDone < nRays; iDone += WORLDLOS_SIMD_BENCH_CHUNK )
+		{
+			int nChunk = min( nRays - iDone, WORLDLOS_SIMD_BENCH_CHUNK );
+			starts.SetCount( nChunk );
+			ends.SetCount( nChunk );
+
+			for ( int i=0; i < nChunk; i++ )
+			{
+				if ( iSet == RAYS_FANS && ( i % WORLDLOS_SIMD_BENCH_FAN ) != 0 )
+				{
+					// Same start as the first ray in the fan, end moved a bit.
+					float flSpread = starts[i-1].DistTo( ends[i - ( i % WORLDLOS_SIMD_BENCH_FAN )] ) * 0.05f;
+					starts[i] = starts[i-1];
+					ends[i] = ends[i - ( i % WORLDLOS_SIMD_BENCH_FAN )] + RandomVector( -flSpread, flSpread );
+				}
+				else
+				{
+					starts[i] = points[RandomInt( 0, points.Count() - 1 )];
+					ends[i] = points[RandomInt( 0, points.Count() - 1 )];
+				}
+			}
+
+			for ( int iMode=0; iMode < 2; iMode++ )
+			{
+				if ( iMode == 0 )
+					m_pEnvironment->Flags |= RTE_FLAGS_DISABLE_AVX2;
+				else
+					m_pEnvironment->Flags &= ~RTE_FLAGS_DISABLE_AVX2;
+
+				results[iMode].SetCount( nChunk );
+
+				timer.Start();
+				TraceUnsortedPackets( m_pEnvironment, nChunk, starts.Base(), ends.Base(), results[iMode].Base() );
+				timer.End();
+				flTimes[iSet][TRACE_PACKETS][iMode] += timer.GetDuration().GetSeconds();
+
+				timer.Start();
+				RayStream stream;
+				for ( int i=0; i < nChunk; i++ )
+				{
+					m_pEnvironment->AddToRayBatch( stream, starts[i], ends[i], &results[iMode][i] );
+				}
+				m_pEnvironment->FinishRayStream( stream );
+				timer.End();
+				flTimes[iSet][TRACE_BATCH][iMode] += timer.GetDuration().GetSeconds();
+			}
+
+			// Past the end of the ray, the tracers are allowed to disagree about what's there.
+			for ( int i=0; i < nChunk; i++ )
+			{
+				const RayTracingSingleResult &sse = results[0][i];
+				const RayTracingSingleResult &avx2 = results[1][i];
+				bool bSSEHit = ( sse.HitID != -1 && sse.HitDistance <= sse.ray_length );
+				bool bAVX2Hit = ( avx2.HitID != -1 && avx2.HitDistance <= avx2.ray_length );
+				if ( bSSEHit != bAVX2Hit || ( bSSEHit && sse.HitID != avx2.HitID ) )
+					++nMismatches;
+			}
+		}
+	}
+
+	m_pEnvironment->Flags = nOldFlags;
+
+	static const char *s_pNames[NUM_RAY_SETS][NUM_TRACE_METHODS] =
+	{
+		{ "point to point, packets of 8", "point to point, sorted batch" },
+		{ "fans, packets of 8", "fans, sorted batch" },
+	};
+
+	Msg( "%d rays per set on %s (%d brush + %d displacement triangles)\n", nRays, STRING( gpGlobals->mapname ), m_nBrushTriangles, m_nDispTriangles );
+	if ( !bAVX2 )
+	{
+		Msg( "This CPU (or build) has no AVX2, so both columns are the SSE tracer.\n" );
+	}
+	Msg( "    %-32s %14s %14s\n", "", "SSE rays/sec", "AVX2 rays/sec" );
+	for ( int iSet=0; iSet < NUM_RAY_SETS; iSet++ )
+	{
+		for ( int iMethod=0; iMethod < NUM_TRACE_METHODS; iMethod++ )
+		{
+			double *pTimes = flTimes[iSet][iMethod];
+			Msg( "    %-32s %14.0f %14.0f  (%.2fx)\n", s_pNames[iSet][iMethod],
+				pTimes[0] > 0 ? nRays / pTimes[0] : 0.0, pTimes[1] > 0 ? nRays / pTimes[1] : 0.0,
+				pTimes[1] > 0 ? pTimes[0] / pTimes[1] : 0.0 );
+		}
+	}
+	Msg( "SSE and AVX2 disagreed on %d rays.\n", nMismatches );
+}
+
+
+static void CC_TFWorldLOSBench( const CCommand &args )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	int nRays = ( args.ArgC() > 1 ) ? atoi( args[1] ) : 100000;
+	GetTFWorldLOS()->RunBenchmark( clamp( nRays, 4, 10000000 ) );
+}
+
+static ConCommand tf_worldlos_bench( "tf_worldlos_bench", CC_TFWorldLOSBench, "Time world line of sight rays through the engine and through the ray traced world on the current map. Takes the number of rays (default 100000).", FCVAR_CHEAT );
+
+
+static void CC_TFWorldLOSSIMDBench( const CCommand &args )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	int nRays = ( args.ArgC() > 1 ) ? atoi( args[1] ) : 10000000;
+	GetTFWorldLOS()->RunSIMDBenchmark( clamp( nRays, 8, 100000000 ) );
+}
+
+static ConCommand tf_worldlos_simd_bench( "tf_worldlos_simd_bench", CC_TFWorldLOSSIMDBench, "Time the ray tracer's SSE and AVX2 paths against the current map, as unsorted packets and as sorted batches. Takes the number of rays per set (default 10000000).", FCVAR_CHEAT );
@@ -0,0 +1,100 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Brush-only line of sight against a ray traced copy of the world.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef TF_WORLDLOS_H
+#define TF_WORLDLOS_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "igamesystem.h"
+#include "raytrace.h"
+
+
+// ------------------------------------------------------------------------------------------ //
+// CTFWorldLOS.
+//
+// A lot of fortress code only wants to know "is there world geometry between A and B", and
+// pays for a full engine trace (entity enumeration, filters, the works) to find out. With
+// tf_worldlos on, at map load this reads the world's solid brushes (MASK_SOLID_BRUSHONLY) and
+// displacements (minus their holes) out of the .bsp, and builds a RayTracingEnvironment from
+// them, which traces four rays at once. It's off by default: no gameplay code uses it yet,
+// so there's no reason to pay for the kd-tree on every map.
+//
+// Only the world model goes in, so brush entities (doors and the like), static props and
+// every other entity still need an engine trace. Hits near either end of the segment or at
+// a grazing angle aren't counted, since the engine can disagree about those; what's left
+// should be blocked by an engine trace too. It's still triangles against brushes though, so a
+// ray through a seam or past an edge can come out differently. Gameplay decisions (who gets a
+// powerup, who can be hit) need to match the engine, so they shouldn't trust an occluded
+// result without an engine trace to confirm it.
+//
+// If the map couldn't be read, or tf_worldlos is off, the queries below do world-only
+// engine traces instead, so they always give an answer.
+// ------------------------------------------------------------------------------------------ //
+
+class CTFWorldLOS : public CAutoGameSystem
+{
+public:
+	CTFWorldLOS();
+
+// Overrides.
+public:
+
+	virtual void	LevelInitPostEntity();
+	virtual void	LevelShutdownPostEntity();
+
+
+public:
+
+	// Builds the ray traced world for the current map (throwing away any old one).
+	void			Build();
+	bool			IsBuilt() const;
+
+	// True if the ray traced world is built and turned on.
+	bool			IsActive() const;
+
+	// Traces each ray from its origin to origin + direction (the directions are the whole
+	// segment, not normalized). Bit i of the return value is set if ray i is blocked.
+	int				IsWorldOccluded( const FourRays &rays );
+
+	bool			IsWorldOccluded( const Vector &vecStart, const Vector &vecEnd );
+
+	// Hands the rays to the ray tracer as one batch, which sorts them into coherent packets
+	// of 8 and traces them with AVX2 when the CPU has it.
+	void			IsWorldOccluded( int nRays, const Vector *pStarts, const Vector *pEnds, bool *pOccluded );
+
+	// Times the engine against the ray traced world on rays around the current map.
+	void			RunBenchmark( int nRays );
+
+	// Times the ray tracer's SSE and AVX2 paths against each other on the current map.
+	void			RunSIMDBenchmark( int nRays );
+
+
+private:
+
+	bool			BuildFromBSP( const char *pFilename );
+	int				EngineWorldOccluded( const FourRays &rays, int nRays );
+
+	// Centers of entities that aren't in solid, for the benchmarks to shoot rays between.
+	bool			GetBenchmarkPoints( CUtlVector<Vector> &points );
+
+
+private:
+
+	RayTracingEnvironment	*m_pEnvironment;
+	int						m_nBrushTriangles;
+	int						m_nDispTriangles;
+	float					m_flBuildTime;
+};
+
+
+CTFWorldLOS* GetTFWorldLOS();
+
+
+#endif // TF_WORLDLOS_H
@@ -55,6 +55,7 @@
 #include "shareddefs.h"
 #include "props.h"
 #include "timedeventmgr.h"
+#include "team.h"
 #include "gameinterface.h"
 #include "eventqueue.h"
 #include "hltvdirector.h"
@@ -2454,6 +2455,12 @@ void CServerGameEnts::CheckTransmit( CCheckTransmitInfo *pInfo, const unsigned s
 	CBasePlayer *pRecipientPlayer = static_cast<CBasePlayer*>( pRecipientEntity );
 	const int skyBoxArea = pRecipientPlayer->m_Local.m_skybox3d.area;
 
+	// Team rules may mark a batch of entities up front, the loop below skips anything already marked
+	if ( pRecipientPlayer->GetTeam() )
+	{
+		pRecipientPlayer->GetTeam()->PreCheckTransmit( pInfo, pRecipientPlayer );
+	}
+
 #ifndef _X360
 	const bool bIsHLTV = pRecipientPlayer->IsHLTV();
 	const bool bIsReplay = pRecipientPlayer->IsReplay();
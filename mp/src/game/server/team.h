@@ -44,6 +44,9 @@ public:
 	virtual void		UpdateClientData( CBasePlayer *pPlayer );
 	virtual bool		ShouldTransmitToPlayer( CBasePlayer* pRecipient, CBaseEntity* pEntity );
 
+	// Lets team rules mark entities for transmission in bulk before the per-entity checks
+	virtual void		PreCheckTransmit( CCheckTransmitInfo *pInfo, CBasePlayer *pRecipient ) {}
+
 	//-----------------------------------------------------------------------------
 	// Spawnpoints
 	//-----------------------------------------------------------------------------
@@ -75,6 +75,18 @@ public:
 	//-------------------------------------------------------------------------
 	float GetDamageRadius( void );
 
+	//-------------------------------------------------------------------------
+	// Sweeps the whole world-space path against the static world once and
+	// stores when and where the object hits it.  Call after the object has
+	// been converted to world space.  Returns false if it never hits.
+	//-------------------------------------------------------------------------
+	bool CalcWorldImpact( const Vector &vecMins, const Vector &vecMaxs );
+
+	//-------------------------------------------------------------------------
+	// Returns whether or not the object has reached its world impact.
+	//-------------------------------------------------------------------------
+	bool HasImpacted( float flTime );
+
 public:
 
 	int		m_nID;					// unique identifier
@@ -104,6 +116,10 @@ public:
 
 	float	m_flDamageRadius;			// 
 
+	// Where and when the path first hits the static world (see CalcWorldImpact).
+	float	m_flImpactTime;
+	Vector	m_vecImpactPoint;
+
 private:
 
 	// Calculate the enter/exit times. (called from Init)
@@ -28,6 +28,8 @@ CEnvMeteorShared::CEnvMeteorShared()
 	m_flWorldEnterTime = METEOR_INVALID_TIME;
 	m_flWorldExitTime = METEOR_INVALID_TIME;
 	m_nLocation = METEOR_LOCATION_INVALID;
+	m_flImpactTime = METEOR_INVALID_TIME;
+	m_vecImpactPoint.Init();
 }
 
 //-----------------------------------------------------------------------------
@@ -136,6 +138,73 @@ float CEnvMeteorShared::GetDamageRadius( void )
 	return m_flDamageRadius;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: The path is a straight line and the static world doesn't move, so
+//          a swept trace from the world entry to the world exit tells us
+//          everything the old per-think traces did.  Sky brushes don't stop
+//          the meteor, so on a sky hit we keep tracing from just past it.
+//-----------------------------------------------------------------------------
+#define METEOR_MAX_SKY_TRACES	16
+#define METEOR_SKY_STEP			1.0f
+
+bool CEnvMeteorShared::CalcWorldImpact( const Vector &vecMins, const Vector &vecMaxs )
+{
+	m_flImpactTime = METEOR_INVALID_TIME;
+
+	if ( m_nLocation != METEOR_LOCATION_WORLD || m_flWorldExitTime == METEOR_INVALID_TIME )
+		return false;
+
+	Vector vecEnterPosition, vecExitPosition;
+	GetPositionAtTime( m_flPosTime, vecEnterPosition );
+	GetPositionAtTime( m_flWorldExitTime, vecExitPosition );
+
+	Vector vecPath = vecExitPosition - vecEnterPosition;
+	float flPathLength = VectorNormalize( vecPath );
+	if ( flPathLength <= 0.0f )
+		return false;
+
+	trace_t trace;
+	CTraceFilterWorldOnly traceFilter;
+	Vector vecStart = vecEnterPosition;
+	float flStartDist = 0.0f;
+	for ( int iTrace = 0; iTrace < METEOR_MAX_SKY_TRACES; ++iTrace )
+	{
+		UTIL_TraceHull( vecStart, vecExitPosition, vecMins, vecMaxs,
+			            MASK_SOLID_BRUSHONLY, &traceFilter, &trace );
+		if ( trace.fraction == 1.0f )
+			return false;
+
+		float flHitDist = flStartDist + ( ( flPathLength - flStartDist ) * trace.fraction );
+		// A continuation trace that starts solid is still inside the sky brush.
+		bool bInSky = ( trace.surface.flags & SURF_SKY ) || ( trace.startsolid && ( iTrace > 0 ) );
+		if ( !bInSky )
+		{
+			m_flImpactTime = m_flPosTime + ( ( m_flWorldExitTime - m_flPosTime ) * ( flHitDist / flPathLength ) );
+			m_vecImpactPoint = trace.endpos;
+			return true;
+		}
+
+		// Passed through sky - step past it and keep going.
+		flStartDist = flHitDist + METEOR_SKY_STEP;
+		if ( flStartDist >= flPathLength )
+			return false;
+
+		VectorMA( vecEnterPosition, flStartDist, vecPath, vecStart );
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+bool CEnvMeteorShared::HasImpacted( float flTime )
+{
+	if ( m_flImpactTime == METEOR_INVALID_TIME )
+		return false;
+
+	return ( flTime >= m_flImpactTime );
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 void CEnvMeteorShared::CalcEnterAndExitTimes( const Vector &vecTriggerMins, 
@@ -0,0 +1,149 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Wire format for the gasoline blobs in a fire field.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef FIRE_FIELD_SHARED_H
+#define FIRE_FIELD_SHARED_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "worldsize.h"
+#include "gasoline_shared.h"
+
+
+// Downward acceleration on blobs with BLOBFLAG_USE_GRAVITY.
+#define GASOLINE_BLOB_GRAVITY		800
+
+
+// ------------------------------------------------------------------------------------------ //
+// Fire field records.
+//
+// Blobs aren't entities. Each team has a fire field entity with a ring of blob slots, and each
+// slot goes over the wire as a few fixed-point ints. A slot only changes when its blob spawns,
+// lands, lights or goes away, so the delta for a tick only holds those slots. The client
+// simulates the flight from the spawn velocity.
+// ------------------------------------------------------------------------------------------ //
+
+#define FIRE_FIELD_MAX_BLOBS			256
+
+// Info: serial | flags | lifetime. Serial 0 means the slot is empty.
+#define FIRE_FIELD_SERIAL_BITS			8
+#define FIRE_FIELD_LIFETIME_BITS		8		// Tenths of a second.
+#define FIRE_FIELD_INFO_BITS			(FIRE_FIELD_SERIAL_BITS + NUM_BLOB_FLAGS + FIRE_FIELD_LIFETIME_BITS)
+
+// Times: low bits of the create tick | ticks between creation and getting lit.
+#define FIRE_FIELD_CREATE_TICK_BITS		16
+#define FIRE_FIELD_LIT_DELAY_BITS		12
+#define FIRE_FIELD_TIMES_BITS			(FIRE_FIELD_CREATE_TICK_BITS + FIRE_FIELD_LIT_DELAY_BITS)
+
+#define FIRE_FIELD_COORD_BITS			16		// Half units, covers the whole map.
+#define FIRE_FIELD_VELOCITY_AXIS_BITS	10		// 2 units/sec, +/- 1022.
+#define FIRE_FIELD_VELOCITY_BITS		(FIRE_FIELD_VELOCITY_AXIS_BITS * 3)
+#define FIRE_FIELD_NORMAL_AXIS_BITS		8
+#define FIRE_FIELD_NORMAL_BITS			(FIRE_FIELD_NORMAL_AXIS_BITS * 3)
+
+
+inline int FireField_PackInfo( int iSerial, int blobFlags, float flLifetime )
+{
+	int nLifetime = clamp( (int)( flLifetime * 10 + 0.5f ), 0, (1 << FIRE_FIELD_LIFETIME_BITS) - 1 );
+	return iSerial | ( blobFlags << FIRE_FIELD_SERIAL_BITS ) | ( nLifetime << (FIRE_FIELD_SERIAL_BITS + NUM_BLOB_FLAGS) );
+}
+
+inline int FireField_InfoSerial( int nInfo )
+{
+	return nInfo & ((1 << FIRE_FIELD_SERIAL_BITS) - 1);
+}
+
+inline int FireField_InfoFlags( int nInfo )
+{
+	return ( nInfo >> FIRE_FIELD_SERIAL_BITS ) & ((1 << NUM_BLOB_FLAGS) - 1);
+}
+
+inline float FireField_InfoLifetime( int nInfo )
+{
+	return ( nInfo >> (FIRE_FIELD_SERIAL_BITS + NUM_BLOB_FLAGS) ) * 0.1f;
+}
+
+
+inline int FireField_PackTimes( int nCreateTick, int nLitTick )
+{
+	int nLitDelay = 0;
+	if ( nLitTick >= nCreateTick )
+		nLitDelay = min( nLitTick - nCreateTick, (1 << FIRE_FIELD_LIT_DELAY_BITS) - 1 );
+
+	return ( nCreateTick & ((1 << FIRE_FIELD_CREATE_TICK_BITS) - 1) ) | ( nLitDelay << FIRE_FIELD_CREATE_TICK_BITS );
+}
+
+// Returns how many ticks before nCurrentTick the blob was created. The create tick wraps, but
+// blobs don't live anywhere near long enough for that to matter.
+inline int FireField_TimesAge( int nTimes, int nCurrentTick )
+{
+	return ( nCurrentTick - nTimes ) & ((1 << FIRE_FIELD_CREATE_TICK_BITS) - 1);
+}
+
+inline int FireField_TimesLitDelay( int nTimes )
+{
+	return ( nTimes >> FIRE_FIELD_CREATE_TICK_BITS ) & ((1 << FIRE_FIELD_LIT_DELAY_BITS) - 1);
+}
+
+
+inline int FireField_PackCoord( float flCoord )
+{
+	return clamp( (int)floor( ( flCoord + MAX_COORD_INTEGER ) * 2 + 0.5f ), 0, (1 << FIRE_FIELD_COORD_BITS) - 1 );
+}
+
+inline float FireField_UnpackCoord( int nCoord )
+{
+	return nCoord * 0.5f - MAX_COORD_INTEGER;
+}
+
+
+inline int FireField_PackAxis( float flValue, float flScale, int nBits )
+{
+	int nMax = (1 << (nBits - 1)) - 1;
+	int nValue = clamp( (int)floor( flValue * flScale + 0.5f ), -nMax, nMax );
+	return nValue + nMax + 1;
+}
+
+inline float FireField_UnpackAxis( int nPacked, float flScale, int nBits )
+{
+	int nValue = ( nPacked & ((1 << nBits) - 1) ) - (1 << (nBits - 1));
+	return nValue / flScale;
+}
+
+inline int FireField_PackVelocity( const Vector &vVelocity )
+{
+	return	FireField_PackAxis( vVelocity.x, 0.5f, FIRE_FIELD_VELOCITY_AXIS_BITS ) |
+			( FireField_PackAxis( vVelocity.y, 0.5f, FIRE_FIELD_VELOCITY_AXIS_BITS ) << FIRE_FIELD_VELOCITY_AXIS_BITS ) |
+			( FireField_PackAxis( vVelocity.z, 0.5f, FIRE_FIELD_VELOCITY_AXIS_BITS ) << (FIRE_FIELD_VELOCITY_AXIS_BITS * 2) );
+}
+
+inline void FireField_UnpackVelocity( int nVelocity, Vector &vVelocity )
+{
+	vVelocity.x = FireField_UnpackAxis( nVelocity, 0.5f, FIRE_FIELD_VELOCITY_AXIS_BITS );
+	vVelocity.y = FireField_UnpackAxis( nVelocity >> FIRE_FIELD_VELOCITY_AXIS_BITS, 0.5f, FIRE_FIELD_VELOCITY_AXIS_BITS );
+	vVelocity.z = FireField_UnpackAxis( nVelocity >> (FIRE_FIELD_VELOCITY_AXIS_BITS * 2), 0.5f, FIRE_FIELD_VELOCITY_AXIS_BITS );
+}
+
+inline int FireField_PackNormal( const Vector &vNormal )
+{
+	return	FireField_PackAxis( vNormal.x, 127, FIRE_FIELD_NORMAL_AXIS_BITS ) |
+			( FireField_PackAxis( vNormal.y, 127, FIRE_FIELD_NORMAL_AXIS_BITS ) << FIRE_FIELD_NORMAL_AXIS_BITS ) |
+			( FireField_PackAxis( vNormal.z, 127, FIRE_FIELD_NORMAL_AXIS_BITS ) << (FIRE_FIELD_NORMAL_AXIS_BITS * 2) );
+}
+
+inline void FireField_UnpackNormal( int nNormal, Vector &vNormal )
+{
+	vNormal.x = FireField_UnpackAxis( nNormal, 127, FIRE_FIELD_NORMAL_AXIS_BITS );
+	vNormal.y = FireField_UnpackAxis( nNormal >> FIRE_FIELD_NORMAL_AXIS_BITS, 127, FIRE_FIELD_NORMAL_AXIS_BITS );
+	vNormal.z = FireField_UnpackAxis( nNormal >> (FIRE_FIELD_NORMAL_AXIS_BITS * 2), 127, FIRE_FIELD_NORMAL_AXIS_BITS );
+	VectorNormalize( vNormal );
+}
+
+
+#endif // FIRE_FIELD_SHARED_H
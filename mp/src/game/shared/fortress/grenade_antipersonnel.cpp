@@ -28,6 +28,7 @@ IMPLEMENT_SERVERCLASS_ST(CGrenadeAntiPersonnel, DT_GrenadeAntiPersonnel)
 END_SEND_TABLE()
 
 LINK_ENTITY_TO_CLASS( grenade_antipersonnel, CGrenadeAntiPersonnel );
+DEFINE_ENTITY_POOL( CGrenadeAntiPersonnel, 32 );
 PRECACHE_WEAPON_REGISTER(grenade_antipersonnel);
 
 //-----------------------------------------------------------------------------
@@ -14,6 +14,7 @@
 class CSprite;
 
 #include "grenade_base_empable.h"
+#include "tf_entity_pool.h"
 
 //-----------------------------------------------------------------------------
 // Purpose: Antipersonnel grenade
@@ -21,6 +22,7 @@ class CSprite;
 class CGrenadeAntiPersonnel : public CBaseEMPableGrenade
 {
 	DECLARE_CLASS( CGrenadeAntiPersonnel, CBaseEMPableGrenade );
+	DECLARE_ENTITY_POOL( CGrenadeAntiPersonnel );
 public:
 	CGrenadeAntiPersonnel();
 
@@ -47,6 +47,7 @@ END_PREDICTION_DATA()
 #endif
 
 LINK_ENTITY_TO_CLASS( grenade_emp, CGrenadeEMP );
+DEFINE_ENTITY_POOL( CGrenadeEMP, 16 );
 PRECACHE_REGISTER(grenade_emp);
 
 //-----------------------------------------------------------------------------
@@ -14,6 +14,7 @@
 class CSprite;
 
 #include "grenade_base_empable.h"
+#include "tf_entity_pool.h"
 
 #if defined( CLIENT_DLL )
 
@@ -27,6 +28,7 @@ class CSprite;
 class CGrenadeEMP : public CBaseEMPableGrenade
 {
 	DECLARE_CLASS( CGrenadeEMP, CBaseEMPableGrenade );
+	DECLARE_ENTITY_POOL( CGrenadeEMP );
 public:
 	CGrenadeEMP();
 
@@ -106,6 +106,7 @@ BEGIN_NETWORK_TABLE( CBasePlasmaProjectile, DT_BasePlasmaProjectile )
 END_NETWORK_TABLE()
 
 LINK_ENTITY_TO_CLASS( base_plasmaprojectile, CBasePlasmaProjectile );
+DEFINE_ENTITY_POOL( CBasePlasmaProjectile, 128 );
 PRECACHE_REGISTER(base_plasmaprojectile);
 
 BEGIN_PREDICTION_DATA( CBasePlasmaProjectile )
@@ -826,6 +827,7 @@ BEGIN_NETWORK_TABLE( CPowerPlasmaProjectile, DT_PowerPlasmaProjectile)
 END_NETWORK_TABLE()
 
 LINK_ENTITY_TO_CLASS( powerplasmaprojectile, CPowerPlasmaProjectile );
+DEFINE_ENTITY_POOL( CPowerPlasmaProjectile, 128 );
 PRECACHE_REGISTER(powerplasmaprojectile);
 
 BEGIN_PREDICTION_DATA( CPowerPlasmaProjectile )
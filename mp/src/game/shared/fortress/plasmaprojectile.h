@@ -8,6 +8,7 @@
 
 #include "baseparticleentity.h"
 #include "plasmaprojectile_shared.h"
+#include "tf_entity_pool.h"
 
 #if !defined( CLIENT_DLL )
 #include "iscorer.h"
@@ -44,6 +45,7 @@ class CBasePlasmaProjectile : public CBaseParticleEntity
 #endif
 {
 	DECLARE_CLASS( CBasePlasmaProjectile, CBaseParticleEntity );
+	DECLARE_ENTITY_POOL( CBasePlasmaProjectile );
 public:
 	CBasePlasmaProjectile();
 	~CBasePlasmaProjectile();
@@ -201,6 +203,7 @@ private:
 class CPowerPlasmaProjectile : public CBasePlasmaProjectile
 {
 	DECLARE_CLASS( CPowerPlasmaProjectile, CBasePlasmaProjectile );
+	DECLARE_ENTITY_POOL( CPowerPlasmaProjectile );
 public:
 	DECLARE_NETWORKCLASS();
 	DECLARE_PREDICTABLE();
@@ -8,6 +8,7 @@
 #include "info_customtech.h"
 #endif
 #include "techtree.h"
+#include "tier1/generichash.h"
 
 bool ParseTechnologyFile( CUtlVector< CBaseTechnology* > &pTechnologyList, IFileSystem* pFileSystem, int nTeamNumber, char *sFileName );
 
@@ -17,11 +18,118 @@ rescolor sResourceColor = { 64,	255, 64 };
 // Prototype names for resources
 char sResourceName[] = "Jojierium";
 
+
+//====================================================================================================================
+// TECHNOLOGY IDS
+//====================================================================================================================
+// Open addressed, so keep it at least twice as big as the number of IDs. Must be a power of two.
+#define TECHID_HASH_SIZE	( MAX_TECHNOLOGY_IDS * 2 )
+
+class CTechnologyIDTable
+{
+public:
+	CTechnologyIDTable()
+	{
+		m_nIDs = 0;
+		memset( m_HashSlots, 0xFF, sizeof( m_HashSlots ) );
+
+		// The known techs take the first IDs so TECH_xxx matches what they intern to.
+#define INTERN_TECH_ID( id, name )	Verify( Intern( name ) == id );
+		TF_TECHNOLOGY_IDS( INTERN_TECH_ID )
+#undef INTERN_TECH_ID
+	}
+
+	int Find( const char *pName )
+	{
+		return m_HashSlots[ FindSlot( pName ) ];
+	}
+
+	int Intern( const char *pName )
+	{
+		int iSlot = FindSlot( pName );
+		if ( m_HashSlots[iSlot] != TECHID_INVALID )
+			return m_HashSlots[iSlot];
+
+		if ( m_nIDs >= MAX_TECHNOLOGY_IDS )
+		{
+			Warning( "Too many technology names (%d), can't add %s!\n", MAX_TECHNOLOGY_IDS, pName );
+			return TECHID_INVALID;
+		}
+
+		Q_strncpy( m_szNames[m_nIDs], pName, sizeof( m_szNames[0] ) );
+		m_HashSlots[iSlot] = m_nIDs;
+		return m_nIDs++;
+	}
+
+	const char *GetName( int iTechID )
+	{
+		if ( iTechID < 0 || iTechID >= m_nIDs )
+			return NULL;
+
+		return m_szNames[iTechID];
+	}
+
+	int Count()
+	{
+		return m_nIDs;
+	}
+
+private:
+	// Returns the slot holding the name, or the empty slot it would go in.
+	int FindSlot( const char *pName )
+	{
+		int iSlot = HashStringCaseless( pName ) & ( TECHID_HASH_SIZE - 1 );
+		while ( m_HashSlots[iSlot] != TECHID_INVALID )
+		{
+			if ( !Q_stricmp( m_szNames[ m_HashSlots[iSlot] ], pName ) )
+				break;
+
+			iSlot = ( iSlot + 1 ) & ( TECHID_HASH_SIZE - 1 );
+		}
+
+		return iSlot;
+	}
+
+	int		m_nIDs;
+	short	m_HashSlots[ TECHID_HASH_SIZE ];
+	char	m_szNames[ MAX_TECHNOLOGY_IDS ][ TECHNOLOGY_NAME_LENGTH ];
+};
+
+static CTechnologyIDTable &TechnologyIDs()
+{
+	static CTechnologyIDTable s_Table;
+	return s_Table;
+}
+
+int TechnologyID_Intern( const char *pName )
+{
+	return TechnologyIDs().Intern( pName );
+}
+
+int TechnologyID_Find( const char *pName )
+{
+	return TechnologyIDs().Find( pName );
+}
+
+const char *TechnologyID_GetName( int iTechID )
+{
+	return TechnologyIDs().GetName( iTechID );
+}
+
+int TechnologyID_Count()
+{
+	return TechnologyIDs().Count();
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
 CBaseTechnology::CBaseTechnology( void )
 {
+	m_pTree = NULL;
+	m_bAvailable = false;
+	m_nTechID = TECHID_INVALID;
 	m_nTechLevel = 0;
 	ZeroPreferences();
 	SetAvailable( false );
@@ -85,6 +193,7 @@ static bool NameStartsWith( const char *name, const char *prefix )
 void CBaseTechnology::SetName( const char *pName )
 {
 	Q_strncpy( m_pszName, pName, sizeof(m_pszName) );
+	m_nTechID = TechnologyID_Intern( m_pszName );
 
 	// Determine special information about this technology
 	m_bClassUpgrade		= NameStartsWith( pName, "class_" );
@@ -228,6 +337,7 @@ void CBaseTechnology::SetClassResultDescription( int iClass, const char *pDesc )
 void CBaseTechnology::AddContainedTechnology( const char *pszTech )
 {
 	Q_strncpy( m_apszContainedTechs[ m_iContainedTechs ], pszTech, sizeof(m_apszContainedTechs[0])  );
+	m_nContainedTechIDs[ m_iContainedTechs ] = TechnologyID_Intern( m_apszContainedTechs[ m_iContainedTechs ] );
 	m_iContainedTechs++;
 }
 
@@ -237,6 +347,7 @@ void CBaseTechnology::AddContainedTechnology( const char *pszTech )
 void CBaseTechnology::AddDependentTechnology( const char *pszTech )
 {
 	Q_strncpy( m_apszDependentTechs[ m_iDependentTechs ], pszTech, sizeof(m_apszDependentTechs[0])  );
+	m_nDependentTechIDs[ m_iDependentTechs ] = TechnologyID_Intern( m_apszDependentTechs[ m_iDependentTechs ] );
 	m_iDependentTechs++;
 }
 
@@ -517,6 +628,11 @@ void CBaseTechnology::SetAvailable( bool state )
 	}
 
 	m_bAvailable = state;
+
+	if ( m_pTree )
+	{
+		m_pTree->SetTechnologyAvailable( m_nTechID, state );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -612,6 +728,15 @@ const char *CBaseTechnology::GetContainedTechName( int iTech )
 	return m_apszContainedTechs[ iTech ];
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: 
+//-----------------------------------------------------------------------------
+int CBaseTechnology::GetContainedTechID( int iTech )
+{
+	Assert( iTech >= 0 && iTech < m_iContainedTechs );
+	return m_nContainedTechIDs[ iTech ];
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -638,6 +763,15 @@ const char *CBaseTechnology::GetDependentTechName( int iTech )
 	return m_apszDependentTechs[ iTech ];
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: 
+//-----------------------------------------------------------------------------
+int CBaseTechnology::GetDependentTechID( int iTech )
+{
+	Assert( iTech >= 0 && iTech < m_iDependentTechs );
+	return m_nDependentTechIDs[ iTech ];
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -698,6 +832,14 @@ void CBaseTechnology::SetDirty( bool bDirty )
 	m_bDirty = bDirty;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: 
+//-----------------------------------------------------------------------------
+void CBaseTechnology::SetTree( CTechnologyTree *pTree )
+{
+	m_pTree = pTree;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Set availability state for item
 // Input  : state - 
@@ -896,6 +1038,9 @@ CTechnologyTree::CTechnologyTree( IFileSystem* pFileSystem, int nTeamNumber )
 	// Reset preference counter
 	ClearPreferenceCount();
 
+	memset( m_TechIndexByID, 0xFF, sizeof( m_TechIndexByID ) );
+	m_AvailableTechs.ClearAll();
+
 	// Parse the list from the data file
 	if ( ParseTechnologyFile( m_Technologies, pFileSystem, nTeamNumber, "scripts/technologytree.txt" ) == false )
 	{
@@ -903,6 +1048,7 @@ CTechnologyTree::CTechnologyTree( IFileSystem* pFileSystem, int nTeamNumber )
 		return;
 	}
 
+	BuildIndex();
 	LinkContainedTechnologies();
 	LinkDependentTechnologies();
 }
@@ -916,8 +1062,7 @@ void CTechnologyTree::LinkContainedTechnologies( void )
 	{
 		for ( int j = 0; j < m_Technologies[i]->GetNumberContainedTechs(); j++ )
 		{
-			const char *pName = m_Technologies[i]->GetContainedTechName( j );
-			CBaseTechnology *pTech = GetTechnology( pName );
+			CBaseTechnology *pTech = GetTechnologyByID( m_Technologies[i]->GetContainedTechID( j ) );
 			if ( pTech )
 			{
 				m_Technologies[i]->SetContainedTech( j, pTech );
@@ -935,15 +1080,14 @@ void CTechnologyTree::LinkDependentTechnologies( void )
 	{
 		for ( int j = 0; j < m_Technologies[i]->GetNumberDependentTechs(); j++ )
 		{
-			const char *pName = m_Technologies[i]->GetDependentTechName( j );
-			CBaseTechnology *pTech = GetTechnology( pName );
+			CBaseTechnology *pTech = GetTechnologyByID( m_Technologies[i]->GetDependentTechID( j ) );
 			if ( pTech )
 			{
 				m_Technologies[i]->SetDependentTech( j, pTech );
 			}
 			else
 			{
-				Warning("Unable to find dependent technology %s!\n", pName );
+				Warning("Unable to find dependent technology %s!\n", m_Technologies[i]->GetDependentTechName( j ) );
 			}
 		}
 	}
@@ -970,6 +1114,42 @@ void CTechnologyTree::Shutdown( void )
 		delete pItem;
 	}
 	m_Technologies.Purge();
+
+	memset( m_TechIndexByID, 0xFF, sizeof( m_TechIndexByID ) );
+	m_AvailableTechs.ClearAll();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Point each tech ID at its slot in m_Technologies and pick up availability
+//-----------------------------------------------------------------------------
+void CTechnologyTree::BuildIndex( void )
+{
+	memset( m_TechIndexByID, 0xFF, sizeof( m_TechIndexByID ) );
+	m_AvailableTechs.ClearAll();
+
+	for ( int i=0; i < m_Technologies.Size(); i++)
+	{
+		CBaseTechnology *pTech = m_Technologies[i];
+		pTech->SetTree( this );
+
+		int iTechID = pTech->GetTechID();
+		if ( iTechID == TECHID_INVALID )
+			continue;
+
+		m_TechIndexByID[iTechID] = i;
+		SetTechnologyAvailable( iTechID, pTech->GetAvailable() != 0 );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 
+//-----------------------------------------------------------------------------
+void CTechnologyTree::SetTechnologyAvailable( int iTechID, bool bAvailable )
+{
+	if ( iTechID < 0 || iTechID >= MAX_TECHNOLOGY_IDS )
+		return;
+
+	m_AvailableTechs.Set( iTechID, bAvailable );
 }
 
 //-----------------------------------------------------------------------------
@@ -978,6 +1158,10 @@ void CTechnologyTree::Shutdown( void )
 void CTechnologyTree::AddTechnologyFile( IFileSystem* pFileSystem, int nTeamNumber, char *sFileName )
 {
 	ParseTechnologyFile( m_Technologies, pFileSystem, nTeamNumber, sFileName );
+
+	BuildIndex();
+	LinkContainedTechnologies();
+	LinkDependentTechnologies();
 }
 
 //-----------------------------------------------------------------------------
@@ -985,13 +1169,10 @@ void CTechnologyTree::AddTechnologyFile( IFileSystem* pFileSystem, int nTeamNumb
 //-----------------------------------------------------------------------------
 int	CTechnologyTree::GetIndex( CBaseTechnology *pItem )
 {
-	for ( int i=0; i < m_Technologies.Size(); i++)
-	{
-		if ( m_Technologies[i] == pItem )
-			return i;
-	}
+	if ( !pItem || GetTechnologyByID( pItem->GetTechID() ) != pItem )
+		return -1;
 
-	return -1;
+	return m_TechIndexByID[ pItem->GetTechID() ];
 }
 
 //-----------------------------------------------------------------------------
@@ -1010,13 +1191,7 @@ CBaseTechnology *CTechnologyTree::GetTechnology( int index )
 //-----------------------------------------------------------------------------
 CBaseTechnology* CTechnologyTree::GetTechnology( const char *pName )
 {
-	for ( int i=0; i < m_Technologies.Size(); i++)
-	{
-		if( stricmp( pName, m_Technologies[i]->GetName() ) == 0 )
-			return m_Technologies[i];
-	}
-	
-	return NULL;
+	return GetTechnologyByID( TechnologyID_Find( pName ) );
 }
 
 //-----------------------------------------------------------------------------
@@ -70,7 +70,11 @@ extern rescolor sResourceColor;
 
 
 #include "utlvector.h"
+#include "bitvec.h"
 #include "tf_shareddefs.h"
+#include "techtree_ids.h"
+
+class CTechnologyTree;
 
 
 //===========================================================================================
@@ -119,6 +123,8 @@ public:
 	virtual int			GetLevel( void );
 	// Returns the internal name of the technology ( no spaces )
 	virtual const char	*GetName( void );
+	// Returns the interned ID of the name (see techtree_ids.h)
+	int					GetTechID( void ) const { return m_nTechID; }
 	// Returns the printable name of the technology
 	virtual const char	*GetPrintName( void );
 	// Returns the button name of the technology;
@@ -169,11 +175,13 @@ public:
 	// Contained Technology access
 	int					GetNumberContainedTechs( void );
 	const char			*GetContainedTechName( int iTech );
+	int					GetContainedTechID( int iTech );
 	void				SetContainedTech( int iTech, CBaseTechnology *pTech );
 
 	// Dependent Technology access
 	int					GetNumberDependentTechs( void );
 	const char			*GetDependentTechName( int iTech );
+	int					GetDependentTechID( int iTech );
 	void				SetDependentTech( int iTech, CBaseTechnology *pTech );
 	bool				DependsOn( CBaseTechnology *pTech );
 	bool				HasInactiveDependencies( void );
@@ -182,6 +190,9 @@ public:
 	bool				IsDirty( void );
 	void				SetDirty( bool bDirty );
 
+	// The tree that owns this tech, so availability changes reach its bitset
+	void				SetTree( CTechnologyTree *pTree );
+
 // Evil, Game DLL only code
 #ifndef CLIENT_DLL
 	// The technology has been acquired by the team.
@@ -212,6 +223,7 @@ public:
 private:
 	// Name of the technology. Used to identify it in code.
 	char				m_pszName[ TECHNOLOGY_NAME_LENGTH ];
+	int					m_nTechID;
 	// Print name of the technology. Used to print the name of this technology to users.
 	char				m_pszPrintName[ TECHNOLOGY_PRINTNAME_LENGTH ];
 	// Button name of technology in the tech tree
@@ -234,11 +246,13 @@ private:
 
 	// Technologies contained within this one
 	char				m_apszContainedTechs[ MAX_CONTAINED_TECHNOLOGIES ][ TECHNOLOGY_NAME_LENGTH ];
+	int					m_nContainedTechIDs[ MAX_CONTAINED_TECHNOLOGIES ];
 	int					m_iContainedTechs;
 	CBaseTechnology		*m_pContainedTechs[ MAX_CONTAINED_TECHNOLOGIES ];
 
 	// Technologies this tech depends on
 	char				m_apszDependentTechs[ MAX_DEPENDANT_TECHNOLOGIES ][ TECHNOLOGY_NAME_LENGTH ];
+	int					m_nDependentTechIDs[ MAX_DEPENDANT_TECHNOLOGIES ];
 	int					m_iDependentTechs;
 	CBaseTechnology		*m_pDependentTechs[ MAX_DEPENDANT_TECHNOLOGIES ];
 
@@ -248,6 +262,7 @@ private:
 
 	// Does the team have access to the technology
 	bool				m_bAvailable;
+	CTechnologyTree		*m_pTree;
 
 	// Is this a "placeholder" tech that shouldn't show up in the real tree
 	bool				m_bHidden;
@@ -295,11 +310,16 @@ public:
 	int				GetIndex( CBaseTechnology *pItem );		// Get the index of the specified item
 	CBaseTechnology *GetTechnology( int index );
 	CBaseTechnology *GetTechnology( const char *pName );
+	CBaseTechnology *GetTechnologyByID( int iTechID );
 	float			GetPercentageOfTechLevelOwned( int iTechLevel );
 
 	// Size of list
 	int				GetNumberTechnologies( void );
 
+	// One bit per tech ID, set while the tech is available. Unknown IDs aren't available.
+	bool			IsTechnologyAvailable( int iTechID ) const;
+	void			SetTechnologyAvailable( int iTechID, bool bAvailable );
+
 	// Local client's preferred item
 	void			SetPreferredTechnology( CBaseTechnology *pItem );
 	CBaseTechnology *GetPreferredTechnology( void );
@@ -314,7 +334,34 @@ public:
 	CUtlVector< CBaseTechnology * > m_Technologies;
 
 	int				m_nPreferenceCount;
+
+private:
+	// Rebuilds the ID -> index table and the availability bits after techs are added
+	void			BuildIndex( void );
+
+	short			m_TechIndexByID[ MAX_TECHNOLOGY_IDS ];
+	CBitVec< MAX_TECHNOLOGY_IDS > m_AvailableTechs;
 };
 
 
+//-----------------------------------------------------------------------------
+// Inlines
+//-----------------------------------------------------------------------------
+inline CBaseTechnology *CTechnologyTree::GetTechnologyByID( int iTechID )
+{
+	if ( iTechID < 0 || iTechID >= MAX_TECHNOLOGY_IDS || m_TechIndexByID[iTechID] < 0 )
+		return NULL;
+
+	return m_Technologies[ m_TechIndexByID[iTechID] ];
+}
+
+inline bool CTechnologyTree::IsTechnologyAvailable( int iTechID ) const
+{
+	if ( iTechID < 0 || iTechID >= MAX_TECHNOLOGY_IDS )
+		return false;
+
+	return m_AvailableTechs.IsBitSet( iTechID );
+}
+
+
 #endif // TECHTREE_H
\ No newline at end of file
@@ -0,0 +1,73 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Interned technology IDs.
+//
+//			Every technology name gets a small dense ID the first time it's seen, so the
+//			tech trees can index and bit-test by ID instead of comparing strings. The names
+//			code checks for every tick are registered first, in the order below, so their
+//			IDs are compile-time constants (TECH_xxx) that can be passed straight to
+//			HasTechnology().
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef TECHTREE_IDS_H
+#define TECHTREE_IDS_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#define TECHID_INVALID			-1
+#define MAX_TECHNOLOGY_IDS		256		// Distinct tech names across every tree and custom tech file
+
+
+// Techs that code checks by name. Add new ones to the end.
+#define TF_TECHNOLOGY_IDS( _ ) \
+	_( TECH_EMP1,						"emp1" ) \
+	_( TECH_EMP3,						"emp3" ) \
+	_( TECH_EMP4,						"emp4" ) \
+	_( TECH_EMP5,						"emp5" ) \
+	_( TECH_SNIPER_DEPLOY_STEALTH,		"sniper_deploy_stealth" ) \
+	_( TECH_INF_CONSUME_CORPSE,			"inf_consume_corpse" ) \
+	_( TECH_OBJ_AUTOREPAIR,				"obj_autorepair" ) \
+	_( TECH_COM_OBJ_RALLYFLAG,			"com_obj_rallyflag" ) \
+	_( TECH_COM_ADRENALIN_RUSH,			"com_adrenalin_rush" ) \
+	_( TECH_COM_ADRENALIN_BATTLECRY,	"com_adrenalin_battlecry" ) \
+	_( TECH_COM_ADRENALIN_RAMPAGE,		"com_adrenalin_rampage" ) \
+	_( TECH_COM_COMBOSHIELD_CHARGE,		"com_comboshield_charge" ) \
+	_( TECH_COM_COMBOSHIELD_TRIPLESHOT,	"com_comboshield_tripleshot" ) \
+	_( TECH_COM_COMBOSHIELD_PARRY,		"com_comboshield_parry" ) \
+	_( TECH_REC_B_RADAR_SCANNERS,		"rec_b_radar_scanners" ) \
+	_( TECH_SENTRYGUN_TWO,				"sentrygun_two" ) \
+	_( TECH_SENTRYGUN_THREE,			"sentrygun_three" ) \
+	_( TECH_SENTRYGUN_AI,				"sentrygun_ai" ) \
+	_( TECH_SENTRYGUN_SENSORS,			"sentrygun_sensors" ) \
+	_( TECH_SENTRYGUN_ROCKET,			"sentrygun_rocket" ) \
+	_( TECH_MORTAR_RANGE,				"mortar_range" ) \
+	_( TECH_MORTAR_ACCURACY,			"mortar_accuracy" ) \
+	_( TECH_MORTAR_AMMO_CLUSTER,		"mortar_ammo_cluster" ) \
+	_( TECH_MORTAR_AMMO_STARBURST,		"mortar_ammo_starburst" ) \
+	_( TECH_TARGETINGINFO,				"targetinginfo" )
+
+#define DECLARE_TECH_ID( id, name )		id,
+enum
+{
+	TF_TECHNOLOGY_IDS( DECLARE_TECH_ID )
+	TECH_NUM_KNOWN_IDS
+};
+#undef DECLARE_TECH_ID
+
+
+// Returns the name's ID, giving it the next free one if it hasn't been seen yet.
+// Returns TECHID_INVALID if all MAX_TECHNOLOGY_IDS are taken. Names are case insensitive.
+int				TechnologyID_Intern( const char *pName );
+
+// Returns TECHID_INVALID if the name has never been interned.
+int				TechnologyID_Find( const char *pName );
+
+const char		*TechnologyID_GetName( int iTechID );
+int				TechnologyID_Count();
+
+
+#endif // TECHTREE_IDS_H
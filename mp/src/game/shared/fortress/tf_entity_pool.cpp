@@ -0,0 +1,170 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Fixed-size pools for entities that are created and removed all the time.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cbase.h"
+#include "tf_entity_pool.h"
+#include "igamesystem.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+CEntityPool *CEntityPool::s_pFirst = NULL;
+
+
+CEntityPool::CEntityPool( const char *pszClassName, int nEntitySize, int nSlabSize ) :
+	CUtlMemoryPool( nEntitySize, nSlabSize, UTLMEMORYPOOL_GROW_SLOW, pszClassName, 16 )
+{
+	m_pszClassName = pszClassName;
+	m_nSlabSize = nSlabSize;
+	m_nLastLevelPeak = 0;
+	m_nHeapAllocs = 0;
+
+	m_pNext = s_pFirst;
+	s_pFirst = this;
+}
+
+
+void *CEntityPool::AllocEntity( size_t size )
+{
+	Assert( size != 0 );
+
+	// Returns NULL if it's a subclass that doesn't fit
+	void *pMem = AllocZero( size );
+	if ( pMem )
+		return pMem;
+
+	++m_nHeapAllocs;
+
+	MEM_ALLOC_CREDIT_( m_pszClassName );
+	pMem = MemAlloc_Alloc( size );
+	memset( pMem, 0, size );
+	return pMem;
+}
+
+
+void CEntityPool::FreeEntity( void *pMem )
+{
+	if ( !pMem )
+		return;
+
+	if ( IsPoolMemory( pMem ) )
+	{
+		Free( pMem );
+	}
+	else
+	{
+		MemAlloc_Free( pMem );
+	}
+}
+
+
+bool CEntityPool::IsPoolMemory( void *pMem )
+{
+	// There's normally only a slab or two to look through.
+	for ( CBlob *pBlob = m_BlobHead.m_pNext; pBlob != &m_BlobHead; pBlob = pBlob->m_pNext )
+	{
+		if ( pMem >= pBlob->m_Data && (char*)pMem < pBlob->m_Data + pBlob->m_NumBytes + m_nAlignment )
+			return true;
+	}
+
+	return false;
+}
+
+
+int CEntityPool::GetCapacity( void )
+{
+	int nBytes = 0;
+	for ( CBlob *pBlob = m_BlobHead.m_pNext; pBlob != &m_BlobHead; pBlob = pBlob->m_pNext )
+	{
+		nBytes += pBlob->m_NumBytes;
+	}
+
+	return nBytes / m_BlockSize;
+}
+
+
+void CEntityPool::LevelInit( void )
+{
+	int nWanted = max( m_nSlabSize, m_nLastLevelPeak );
+	while ( GetCapacity() - m_BlocksAllocated < nWanted )
+	{
+		// New blobs go on the front of the free list, so this doesn't lose the old free blocks.
+		void *pOldFree = m_pHeadOfFreeList;
+		AddNewBlob();
+		if ( !m_pHeadOfFreeList )
+			break;
+
+		void **ppLast = (void**)m_pHeadOfFreeList;
+		while ( *ppLast )
+		{
+			ppLast = (void**)*ppLast;
+		}
+		*ppLast = pOldFree;
+	}
+
+	m_PeakAlloc = m_BlocksAllocated;
+	m_nHeapAllocs = 0;
+}
+
+
+void CEntityPool::LevelShutdown( void )
+{
+	m_nLastLevelPeak = m_PeakAlloc;
+}
+
+
+void CEntityPool::PrintStats( void )
+{
+	Msg( "%-28s %5d bytes  %4d in use  %4d peak  %4d capacity  %2d slabs  %4d heap\n",
+		m_pszClassName, m_BlockSize, m_BlocksAllocated, m_PeakAlloc, GetCapacity(), m_NumBlobs, m_nHeapAllocs );
+}
+
+
+//-----------------------------------------------------------------------------
+// Tops up the pools when a map loads.
+//-----------------------------------------------------------------------------
+class CEntityPoolSystem : public CAutoGameSystem
+{
+public:
+	CEntityPoolSystem() : CAutoGameSystem( "CEntityPoolSystem" )
+	{
+	}
+
+	virtual void LevelInitPreEntity()
+	{
+		for ( CEntityPool *pPool = CEntityPool::GetFirst(); pPool; pPool = pPool->GetNext() )
+		{
+			pPool->LevelInit();
+		}
+	}
+
+	virtual void LevelShutdownPostEntity()
+	{
+		for ( CEntityPool *pPool = CEntityPool::GetFirst(); pPool; pPool = pPool->GetNext() )
+		{
+			pPool->LevelShutdown();
+		}
+	}
+};
+
+static CEntityPoolSystem g_EntityPoolSystem;
+
+
+static void CC_EntityPoolStats( const CCommand &args )
+{
+	for ( CEntityPool *pPool = CEntityPool::GetFirst(); pPool; pPool = pPool->GetNext() )
+	{
+		pPool->PrintStats();
+	}
+}
+
+#ifdef CLIENT_DLL
+static ConCommand cl_entity_pool_stats( "cl_entity_pool_stats", CC_EntityPoolStats, "Print how full each client entity pool is and its high-water mark for this map." );
+#else
+static ConCommand tf_entity_pool_stats( "tf_entity_pool_stats", CC_EntityPoolStats, "Print how full each entity pool is and its high-water mark for this map." );
+#endif
@@ -0,0 +1,71 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Fixed-size pools for entities that are created and removed all the time
+//			(projectiles, grenades, resource chunks).
+//
+//			Put DECLARE_ENTITY_POOL( CMyEntity ) in the class and
+//			DEFINE_ENTITY_POOL( CMyEntity, slabsize ) in its .cpp. The entity's memory then
+//			comes out of slabs of slabsize entities that are set up at map load and reused
+//			after that. A subclass that doesn't declare its own pool doesn't fit in the
+//			slots, so it goes to the heap as before.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef TF_ENTITY_POOL_H
+#define TF_ENTITY_POOL_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "tier1/mempool.h"
+
+
+class CEntityPool : public CUtlMemoryPool
+{
+public:
+					CEntityPool( const char *pszClassName, int nEntitySize, int nSlabSize );
+
+	// Zeroed memory, like the entity allocator gives out
+	void			*AllocEntity( size_t size );
+	void			FreeEntity( void *pMem );
+
+	// Makes sure there's room for at least a slab, or as many as the last map needed,
+	// so the pool doesn't have to grow during the map.
+	void			LevelInit( void );
+	void			LevelShutdown( void );
+
+	void			PrintStats( void );
+
+	static CEntityPool	*GetFirst( void ) { return s_pFirst; }
+	CEntityPool		*GetNext( void ) { return m_pNext; }
+
+private:
+	bool			IsPoolMemory( void *pMem );
+	int				GetCapacity( void );
+
+	const char		*m_pszClassName;
+	int				m_nSlabSize;
+	int				m_nLastLevelPeak;
+	int				m_nHeapAllocs;		// Subclasses that were too big for the slots
+
+	CEntityPool		*m_pNext;
+	static CEntityPool	*s_pFirst;
+};
+
+
+#define DECLARE_ENTITY_POOL( _class )																					\
+	public:																												\
+		void *operator new( size_t size ) { return s_EntityPool.AllocEntity( size ); }									\
+		void *operator new( size_t size, int nBlockUse, const char *pFileName, int nLine ) { return s_EntityPool.AllocEntity( size ); }	\
+		void operator delete( void *pMem ) { s_EntityPool.FreeEntity( pMem ); }										\
+		void operator delete( void *pMem, int nBlockUse, const char *pFileName, int nLine ) { s_EntityPool.FreeEntity( pMem ); }	\
+	private:																											\
+		static CEntityPool s_EntityPool
+
+#define DEFINE_ENTITY_POOL( _class, _slabsize )																		\
+	CEntityPool _class::s_EntityPool( #_class, sizeof( _class ), _slabsize )
+
+
+#endif // TF_ENTITY_POOL_H
@@ -22,6 +22,9 @@ enum
 #define SPEED_CROP_FRACTION_USING		0.3f
 #define SPEED_CROP_FRACTION_DUCKING		0.3f
 
+// Client and server have to agree on this or prediction will drift.
+ConVar tf_movement_ground_cache( "tf_movement_ground_cache", "1", FCVAR_REPLICATED | FCVAR_CHEAT, "Answer repeated ground checks within a movement command from the command's last downward trace." );
+
 char    *va(char *format, ...);
 
 /*	Basically, in the original code-base the following would call up the base class' ProcessMovement func
@@ -37,6 +40,20 @@ void CTFGameMovement::ProcessMovement( CBasePlayer *pPlayer, CMoveData *pMove )
 	Assert( mv );
 	Assert( player );
 
+	m_nTraces = 0;
+	m_nTracesReused = 0;
+
+	ProcessMovementInterval();
+
+	// Divide by the command count for traces per player per tick. Long commands are split up
+	// below, but they still only count once.
+	VPROF_INCREMENT_COUNTER( "TFMovement: commands", 1 );
+	VPROF_INCREMENT_COUNTER( "TFMovement: hull traces", m_nTraces );
+	VPROF_INCREMENT_COUNTER( "TFMovement: hull traces reused", m_nTracesReused );
+}
+
+void CTFGameMovement::ProcessMovementInterval( void )
+{
 	m_iSpeedCropped = SPEED_CROPPED_RESET;
 
 	// bisect time interval for very long commands
@@ -48,7 +65,7 @@ void CTFGameMovement::ProcessMovement( CBasePlayer *pPlayer, CMoveData *pMove )
 
 		gpGlobals->frametime = t;
 		
-		ProcessMovement( player, mv );
+		ProcessMovementInterval();
 
 		// NOTE:  Only fire impulse on first time through
 		mv->m_nImpulseCommand = 0;
@@ -56,7 +73,7 @@ void CTFGameMovement::ProcessMovement( CBasePlayer *pPlayer, CMoveData *pMove )
 		// Make sure frametime is valid
 		gpGlobals->frametime = t;
 
-		ProcessMovement( player, mv );
+		ProcessMovementInterval();
 
 		// Reset frametime so other functionas after this aren't hosed
 		gpGlobals->frametime = savet;
@@ -66,6 +83,11 @@ void CTFGameMovement::ProcessMovement( CBasePlayer *pPlayer, CMoveData *pMove )
 
 	mv->m_flMaxSpeed = sv_maxspeed.GetFloat();
 
+	// Nothing else moves while a command runs, so a ground trace is good until the end of it.
+	// It can't be kept across commands: other entities move between them, and the client
+	// re-predicts commands without the server's cache history.
+	m_bGroundTraceValid = false;
+
 	// Run the command.
 	PlayerMove();
 
@@ -972,11 +994,106 @@ bool CTFGameMovement::CalcWishVelocityAndPosition( Vector &vWishPos, Vector &vWi
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Counts the movement hull traces, and answers vertical ones from the
+//          command's last downward trace when it can.
+//-----------------------------------------------------------------------------
+void CTFGameMovement::TracePlayerBBox( const Vector &vStart, const Vector &vEnd, 
+							unsigned int fMask, int collisionGroup, trace_t &trace )
+{
+	bool bVertical = ( vStart.x == vEnd.x ) && ( vStart.y == vEnd.y );
+	bool bDown = bVertical && ( vEnd.z < vStart.z );
+	if ( bVertical && tf_movement_ground_cache.GetBool() )
+	{
+		if ( ReuseGroundTrace( vStart, vEnd, fMask, collisionGroup, trace ) )
+		{
+			++m_nTracesReused;
+			return;
+		}
+	}
+
+	++m_nTraces;
+	BaseClass::TracePlayerBBox( vStart, vEnd, fMask, collisionGroup, trace );
+
+	if ( bDown )
+	{
+		m_bGroundTraceValid = true;
+		m_GroundTrace = trace;
+		m_vecGroundTraceMins = GetPlayerMins();
+		m_vecGroundTraceMaxs = GetPlayerMaxs();
+		m_fGroundTraceMask = fMask;
+		m_nGroundTraceCollisionGroup = collisionGroup;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The saved trace swept the hull clear from its start down to its end
+//          position and then hit something.  A downward trace along the same
+//          line that starts inside that clear stretch and reaches at least as
+//          far down hits the same thing at the same spot.  A trace that stays
+//          inside the clear stretch (StayOnGround's 2 unit trace up from where
+//          StepMove put us down) doesn't hit anything.
+//-----------------------------------------------------------------------------
+bool CTFGameMovement::ReuseGroundTrace( const Vector &vStart, const Vector &vEnd, 
+							unsigned int fMask, int collisionGroup, trace_t &trace )
+{
+	if ( !m_bGroundTraceValid )
+		return false;
+
+	const trace_t &ground = m_GroundTrace;
+	if ( ground.startsolid || ground.allsolid || ( ground.fraction >= 1.0f ) )
+		return false;
+
+	if ( ( fMask != m_fGroundTraceMask ) || ( collisionGroup != m_nGroundTraceCollisionGroup ) )
+		return false;
+
+	if ( ( vStart.x != ground.startpos.x ) || ( vStart.y != ground.startpos.y ) )
+		return false;
+
+	if ( ( vStart.z > ground.startpos.z ) || ( vStart.z < ground.endpos.z ) )
+		return false;
+
+	if ( ( GetPlayerMins() != m_vecGroundTraceMins ) || ( GetPlayerMaxs() != m_vecGroundTraceMaxs ) )
+		return false;
+
+	if ( ( vEnd.z >= ground.endpos.z ) && ( vEnd.z <= ground.startpos.z ) )
+	{
+		trace = ground;
+		trace.startpos = vStart;
+		trace.endpos = vEnd;
+		trace.fraction = 1.0f;
+		trace.fractionleftsolid = 0.0f;
+		trace.contents = 0;
+		trace.hitgroup = 0;
+		trace.hitbox = 0;
+		trace.physicsbone = 0;
+		trace.m_pEnt = NULL;
+		trace.plane.normal.Init();
+		trace.plane.dist = 0.0f;
+		trace.plane.type = 0;
+		trace.plane.signbits = 0;
+		trace.surface.name = "**empty**";
+		trace.surface.flags = 0;
+		trace.surface.surfaceProps = 0;
+		return true;
+	}
+
+	if ( vEnd.z > ground.endpos.z )
+		return false;
+
+	trace = ground;
+	trace.startpos = vStart;
+	trace.fraction = ( vStart.z - ground.endpos.z ) / ( vStart.z - vEnd.z );
+	return true;
+}
+
 inline void CTFGameMovement::TracePlayerBBoxWithStep( const Vector &vStart, const Vector &vEnd, 
 							unsigned int fMask, int collisionGroup, trace_t &trace )
 {
 	VPROF( "CTFGameMovement::TracePlayerBBoxWithStep" );
 
+	++m_nTraces;
+
 	Vector vHullMin = GetPlayerMins( player->m_Local.m_bDucked );
 	vHullMin.z += player->m_Local.m_flStepSize;
 	Vector vHullMax = GetPlayerMaxs( player->m_Local.m_bDucked );
@@ -33,6 +33,9 @@ public:
 
 protected:
 
+	// Runs the command, in halves if it's a long one.
+	void			ProcessMovementInterval( void );
+
 	// Player movement functions.
 	virtual bool	PrePlayerMove( void );
 	virtual void	HandlePlayerMove( void );
@@ -64,7 +67,9 @@ protected:
 
 	// Movement helpers.
 	virtual bool	CalcWishVelocityAndPosition( Vector &vWishPos, Vector &vWishDir, float &flWishSpeed );
+	virtual void	TracePlayerBBox( const Vector &vStart, const Vector &vEnd, unsigned int fMask, int collisionGroup, trace_t &trace ) override;
 	inline void		TracePlayerBBoxWithStep( const Vector &vStart, const Vector &vEnd, unsigned int fMask, int collisionGroup, trace_t &trace );
+	bool			ReuseGroundTrace( const Vector &vStart, const Vector &vEnd, unsigned int fMask, int collisionGroup, trace_t &trace );
 
 	// Momentum
 	void			SetMomentumList( float flValue = 1.0f );
@@ -86,6 +91,20 @@ protected:
 	Vector					m_vecOriginalVelocity;
 	int						m_nLanding;
 
+	// The last downward hull trace of this command. CategorizePosition runs before and after
+	// the move, and StepMove and StayOnGround trace down just before the second one, so a
+	// later vertical trace along the same line can be answered from it. Reset every command.
+	bool					m_bGroundTraceValid;
+	trace_t					m_GroundTrace;
+	Vector					m_vecGroundTraceMins;
+	Vector					m_vecGroundTraceMaxs;
+	unsigned int			m_fGroundTraceMask;
+	int						m_nGroundTraceCollisionGroup;
+
+	// Hull traces made and saved by the ground trace this command (vprof counters).
+	int						m_nTraces;
+	int						m_nTracesReused;
+
 	enum { MAX_IMPACT_PLANES = 5 };
 	int						m_nImpactPlaneCount;
 	Vector					m_aImpactPlaneNormals[MAX_IMPACT_PLANES];
@@ -37,6 +37,8 @@
 	#include "weapon_builder.h"
 	#include "weapon_objectselection.h"
 	#include "ndebugoverlay.h"
+	#include "fire_field.h"
+	#include "tf_lagcompensation.h"
 #endif
 
 // memdbgon must be the last include file in a .cpp file!!!
@@ -733,15 +735,8 @@ END_NETWORK_TABLE()
 	//-----------------------------------------------------------------------------
 	bool CTeamFortress::IsBlockedByEnemyShields( const Vector& src, const Vector& end, int nFriendlyTeam )
 	{
-		// Iterate over all shields on the same team, disable them so
-		// we don't intersect with them...
-		CShield::ActivateShields( false, nFriendlyTeam );
-
-		bool bBlocked = CShield::IsBlockedByShields( src, end );
-
-		CShield::ActivateShields( true, nFriendlyTeam );
-
-		return bBlocked;
+		// Shields on our own team don't block us.
+		return CShield::IsBlockedByShields( src, end, nFriendlyTeam );
 	}
 
 
@@ -753,9 +748,10 @@ END_NETWORK_TABLE()
 	{
 		int damageType = pEntity->GetDamageType();
 
-		// Iterate over all shields on the same team, disable them so
-		// we don't intersect with them...
-		CShield::ActivateShields( false, pEntity->GetTeamNumber() );
+		// Don't intersect with shields on the same team...
+		CTraceFilterEntity entityFilter( pEntity, pEntity->GetCollisionGroup() );
+		CTraceFilterIgnoreTeamShields shieldFilter( pEntity->GetTeamNumber() );
+		CTraceFilterChain traceFilter( &shieldFilter, &entityFilter );
 
 		// Trace it baby...
 		float damage = 1.0f;
@@ -765,7 +761,7 @@ END_NETWORK_TABLE()
 			// FIXME: Optimize so we don't test the same ray but start at the
 			// previous collision point
 			done = true;
-			UTIL_TraceEntity( pEntity, src, end, mask, pTrace );
+			UTIL_TraceEntity( pEntity, src, end, mask, &traceFilter, pTrace );
 
 			// Shield check...
 			if (pTrace->fraction != 1.0)
@@ -794,7 +790,7 @@ END_NETWORK_TABLE()
 
 						// FIXME: DMG_BULLET should be something else
 						pShield->RegisterPassThru( vecDir, damageType, pTrace );
-						pShield->ActivateCollisions( false );
+						shieldFilter.SkipShield( pShield );
 
 						done = false;
 					}
@@ -810,9 +806,6 @@ END_NETWORK_TABLE()
 		if (damage != 0.0)
 			pEntity->SetDamage(pEntity->GetDamage() * damage);
 
-		// Reactivate all shields
-		CShield::ActivateShields( true );
-
 		return damage;
 	}
 
@@ -821,10 +814,6 @@ END_NETWORK_TABLE()
 	//-----------------------------------------------------------------------------
 	bool CTeamFortress::IsTraceBlockedByWorldOrShield( const Vector& src, const Vector& end, CBaseEntity *pShooter, int damageType, trace_t* pTrace )
 	{
-		// Iterate over all shields on the same team, disable them so
-		// we don't intersect with them...
-		CShield::ActivateShields( false, pShooter->GetTeamNumber() );
-
 		//NDebugOverlay::Line( src, pTrace->endpos, 255,255,255, true, 5.0 );
 		//NDebugOverlay::Box( pTrace->endpos, Vector(-2,-2,-2), Vector(2,2,2), 255,255,255, true, 5.0 );
 
@@ -834,6 +823,7 @@ END_NETWORK_TABLE()
 		public:
 			CShieldWorldFilter( CBaseEntity *pShooter ) : CTraceFilterSimple( pShooter, TFCOLLISION_GROUP_WEAPON )
 			{
+				m_iShooterTeam = pShooter->GetTeamNumber();
 			}
 
 			virtual bool ShouldHitEntity( IHandleEntity *pHandleEntity, int contentsMask )
@@ -848,11 +838,17 @@ END_NETWORK_TABLE()
 				if ( pEnt->GetCollisionGroup() != TFCOLLISION_GROUP_SHIELD )
 					return false;
 
+				// ...and we don't intersect with shields on the same team.
+				if ( pEnt->GetTeamNumber() == m_iShooterTeam )
+					return false;
+
 				return CTraceFilterSimple::ShouldHitEntity( pHandleEntity, contentsMask );
 			}
+
+		private:
+			int m_iShooterTeam;
 		};
 
-		trace_t tr;
 		CShieldWorldFilter shieldworldFilter( pShooter );
 		UTIL_TraceLine( src, end, MASK_SOLID, &shieldworldFilter, pTrace );
 
@@ -871,9 +867,6 @@ END_NETWORK_TABLE()
 			}
 		}
 
-		// Reactivate all shields
-		CShield::ActivateShields( true );
-
 		return ( pTrace->fraction < 1.0 );
 	}
 
@@ -984,6 +977,24 @@ END_NETWORK_TABLE()
 				}
 			}
 		}
+
+		// Gasoline blobs aren't entities, so the sphere query doesn't find them. Explosions
+		// still light them.
+		CGasolineBlob *pBlobs[128];
+		int nBlobs = FindGasolineBlobsInSphere( pBlobs, ARRAYSIZE( pBlobs ), vecSrc, flRadius );
+		for ( int i=0; i < nBlobs; i++ )
+		{
+			const Vector &vecBlob = pBlobs[i]->GetAbsOrigin();
+			UTIL_TraceLine( vecSrc, vecBlob, MASK_SHOT & (~CONTENTS_HITBOX), info.GetInflictor(), COLLISION_GROUP_NONE, &tr );
+			if ( tr.fraction != 1.0 )
+				continue;
+
+			flAdjustedDamage = info.GetDamage() - ( vecSrc - vecBlob ).Length() * falloff;
+			if ( flAdjustedDamage > 0 )
+			{
+				pBlobs[i]->AddHeat( flAdjustedDamage );
+			}
+		}
 	}
 
 	//-----------------------------------------------------------------------------
@@ -1378,13 +1389,59 @@ static bool CheckCollisionGroupPlayerMovement( int collisionGroup0, int collisio
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Skips shields on the ignored team, plus any shields we've been told to skip
+//-----------------------------------------------------------------------------
+bool CTraceFilterIgnoreTeamShields::ShouldHitEntity( IHandleEntity *pHandleEntity, int contentsMask )
+{
+	CBaseEntity *pEnt = EntityFromEntityHandle( pHandleEntity );
+	if ( !pEnt || pEnt->GetCollisionGroup() != TFCOLLISION_GROUP_SHIELD )
+		return true;
+
+	if ( pEnt->GetTeamNumber() == m_iIgnoreTeam )
+		return false;
+
+	return ( m_SkippedShields.Find( pEnt ) == m_SkippedShields.InvalidIndex() );
+}
+
+
 void CTeamFortress::WeaponTraceLine( const Vector& src, const Vector& end, unsigned int mask, CBaseEntity *pShooter, int damageType, trace_t* pTrace )
 {
-	// Iterate over all shields on the same team, disable them so
-	// we don't intersect with them...
-	CShield::ActivateShields( false, pShooter->GetTeamNumber() );
+	// Don't intersect with shields on the same team...
+	CTraceFilterSimple simpleFilter( pShooter, /* TFCOLLISION_GROUP_WEAPON */ COLLISION_GROUP_NONE );
+	CTraceFilterIgnoreTeamShields shieldFilter( pShooter->GetTeamNumber() );
+	CTraceFilterChain traceFilter( &shieldFilter, &simpleFilter );
 
-	UTIL_TraceLine(src, end, mask, pShooter, /* TFCOLLISION_GROUP_WEAPON */ COLLISION_GROUP_NONE, pTrace);
+#ifndef CLIENT_DLL
+	// Single hitscan shots get lag compensated here, FireBullets does its own for all the pellets.
+	bool bLagCompensated = false;
+	if ( !( damageType & DMG_PROBE ) && !GetTFLagCompensation()->IsCompensating() )
+	{
+		CBasePlayer *pPlayer = ToBasePlayer( pShooter );
+		if ( !pPlayer && pShooter->MyCombatWeaponPointer() )
+		{
+			pPlayer = ToBasePlayer( pShooter->MyCombatWeaponPointer()->GetOwner() );
+		}
+
+		if ( pPlayer )
+		{
+			Vector vecDir = end - src;
+			float flRange = VectorNormalize( vecDir );
+			bLagCompensated = GetTFLagCompensation()->StartShot( pPlayer, src, vecDir, flRange, 0.0f );
+		}
+	}
+#endif
+
+	UTIL_TraceLine( src, end, mask, &traceFilter, pTrace );
+
+#ifndef CLIENT_DLL
+	if ( bLagCompensated )
+	{
+		GetTFLagCompensation()->FinishShot();
+	}
+
+	CShield::RecordShot( src, end, mask, pShooter );
+#endif
 
 #if 0
 #if !defined( CLIENT_DLL )
@@ -1407,9 +1464,6 @@ void CTeamFortress::WeaponTraceLine( const Vector& src, const Vector& end, unsig
 			pShield->RegisterDeflection( vecDir, damageType, pTrace );
 		}
 	}
-
-	// Reactivate all shields
-	CShield::ActivateShields( true );
 }
 
 
@@ -1507,6 +1561,14 @@ void CTeamFortress::FireBullets( const CTakeDamageInfo &info, int cShots, const
 
 	int seed = 0;
 
+#ifndef CLIENT_DLL
+	// Move everything in the spread cone back to where the shooter saw it, for all the pellets
+	// and the damage they do.
+	CBasePlayer *pShooter = ToBasePlayer( subInfo.GetAttacker() );
+	bool bLagCompensated = pShooter && GetTFLagCompensation()->StartShot( pShooter, vecSrc, vecDirShooting, flDistance,
+		FastSqrt( vecSpreadMod.x * vecSpreadMod.x + vecSpreadMod.y * vecSpreadMod.y ) );
+#endif
+
 	for (int iShot = 0; iShot < cShots; iShot++)
 	{
 		// get circular gaussian spread
@@ -1607,6 +1669,11 @@ void CTeamFortress::FireBullets( const CTakeDamageInfo &info, int cShots, const
 	// Apply any damage we've stacked up
 #ifndef CLIENT_DLL
 	ApplyMultiDamage();
+
+	if ( bLagCompensated )
+	{
+		GetTFLagCompensation()->FinishShot();
+	}
 #endif
 }
 
@@ -17,6 +17,27 @@
 #endif
 
 
+//-----------------------------------------------------------------------------
+// Trace filter that lets traces pass through the shields of one team (and any
+// shields that have been explicitly skipped) without touching the shields'
+// collision state. Chain it with the filter the trace would normally use.
+//-----------------------------------------------------------------------------
+class CTraceFilterIgnoreTeamShields : public CTraceFilter
+{
+public:
+	CTraceFilterIgnoreTeamShields( int iIgnoreTeam ) : m_iIgnoreTeam( iIgnoreTeam ) {}
+
+	virtual bool ShouldHitEntity( IHandleEntity *pHandleEntity, int contentsMask );
+
+	// Lets this trace through a particular shield (used for shields that only partially block).
+	void SkipShield( CBaseEntity *pShield ) { m_SkippedShields.AddToTail( pShield ); }
+
+private:
+	int		m_iIgnoreTeam;
+	CUtlVector<CBaseEntity*> m_SkippedShields;
+};
+
+
 class CTeamFortress : public CTeamplayRules
 {
 public:
@@ -6,12 +6,14 @@
 //=============================================================================
 #include "cbase.h"
 #include "tf_shareddefs.h"
+#include "techtree_ids.h"
 #include "tier0/dbg.h"
 #include "basetypes.h"
 #include <KeyValues.h>
 
 #ifndef CLIENT_DLL
 	#include "tf_team.h"
+	#include "tf_player.h"
 	#include "tf_class_commando.h"
 	#include "tf_class_defender.h"
 	#include "tf_class_escort.h"
@@ -43,7 +45,15 @@
 
 ConVar inv_demo( "inv_demo", "0", FCVAR_REPLICATED | FCVAR_CHEAT, "Invasion demo." );
 ConVar lod_effect_distance( "lod_effect_distance","3240000", FCVAR_REPLICATED, "Distance at which effects LOD." );
-ConVar tf_cheapobjects( "tf_cheapobjects","0", FCVAR_REPLICATED | FCVAR_CHEAT, "Set to 1 and all objects will cost 0" );
+static void CheapObjectsChanged( IConVar *var, const char *pOldValue, float flOldValue );
+ConVar tf_cheapobjects( "tf_cheapobjects","0", FCVAR_REPLICATED | FCVAR_CHEAT, "Set to 1 and all objects will cost 0", CheapObjectsChanged );
+
+static void CheapObjectsChanged( IConVar *var, const char *pOldValue, float flOldValue )
+{
+#ifndef CLIENT_DLL
+	CBaseTFPlayer::InvalidateObjectValues();
+#endif
+}
 
 
 //--------------------------------------------------------------------------
@@ -732,6 +742,14 @@ char *MortarAmmoTechs[ MA_LASTAMMOTYPE ] =
 	"mortar_ammo_starburst",
 };
 
+// MortarAmmoTechs as tech IDs
+int MortarAmmoTechIDs[ MA_LASTAMMOTYPE ] =
+{
+	TECHID_INVALID,
+	TECH_MORTAR_AMMO_CLUSTER,
+	TECH_MORTAR_AMMO_STARBURST,
+};
+
 // Max amounts of each mortar ammo type in a single mortar
 int	MortarAmmoMax[ MA_LASTAMMOTYPE ] = 
 {
@@ -342,6 +342,7 @@ enum MortarAmmoType
 
 extern char *MortarAmmoNames[ MA_LASTAMMOTYPE ];
 extern char *MortarAmmoTechs[ MA_LASTAMMOTYPE ];
+extern int	MortarAmmoTechIDs[ MA_LASTAMMOTYPE ];
 extern int	MortarAmmoMax[ MA_LASTAMMOTYPE ];
 
 //--------------------------------------------------------------------------
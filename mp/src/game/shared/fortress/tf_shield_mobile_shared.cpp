@@ -133,11 +133,29 @@ public:
 	// Inherited from IEntityEnumerator
 	virtual bool EnumEntity( IHandleEntity *pHandleEntity ); 
 
+#ifndef CLIENT_DLL
+	// Batched simulation (see CShieldSimulationSystem)
+	virtual bool BeginBatchedSimulate();
+	virtual void SimulateBatched();
+	virtual void EndBatchedSimulate();
+#endif
+
 private:
 	// Teleport!
 	void OnTeleported(  );
 	void SimulateShield( void );
 
+	// SimulateShield in pieces: the part that reads the owner, the spring
+	// simulation, and the part that moves the entity and pushes things around.
+	bool StartSimulateShield( Vector &vecOldOrigin );
+	void FinishSimulateShield( const Vector &vecOldOrigin );
+
+#ifndef CLIENT_DLL
+	// Invalidates the shield tree and collision mesh if the simulation changed
+	// the shield's shape.
+	void CheckGeometryChanged( void );
+#endif
+
 private:
 	struct SweepContext_t
 	{
@@ -183,6 +201,14 @@ private:
 	CNetworkVar( QAngle, m_angLockedAngles );
 	SweepContext_t *m_pEnumCtx;
 
+#ifndef CLIENT_DLL
+	int					m_nBatchSimulateTick;
+	Vector				m_vecBatchOldOrigin;
+	ShieldProbeResult_t	m_BatchProbes[SHIELD_TESTS_PER_FRAME];
+	int					m_nBatchProbes;
+	int					m_nLastGeometryVersion;
+#endif
+
 	// This is the width + height of the shield, not the current theta, phi
 	CNetworkVar( float, m_flShieldTheta );
 	CNetworkVar( float, m_flShieldPhi );
@@ -312,6 +338,12 @@ CShieldMobile::CShieldMobile()
 	SetThetaPhi( SHIELD_INITIAL_THETA, SHIELD_INITIAL_PHI ); 
 	m_nAttachmentIndex = 0;
 
+#ifndef CLIENT_DLL
+	m_nBatchSimulateTick = -1;
+	m_nBatchProbes = 0;
+	m_nLastGeometryVersion = -1;
+#endif
+
 #ifdef CLIENT_DLL
 	InitShield( SHIELD_NUM_HORIZONTAL_POINTS, SHIELD_NUM_VERTICAL_POINTS, NUM_SUBDIVISIONS );
 #endif
@@ -534,6 +566,22 @@ bool CShieldMobile::EnumEntity( IHandleEntity *pHandleEntity )
 // Update the shield position: 
 //-----------------------------------------------------------------------------
 void CShieldMobile::SimulateShield( void )
+{
+	Vector vecOldOrigin;
+	if ( !StartSimulateShield( vecOldOrigin ) )
+		return;
+
+	m_ShieldEffect.Simulate(gpGlobals->frametime);
+	DetermineObstructions();
+	FinishSimulateShield( vecOldOrigin );
+}
+
+
+//-----------------------------------------------------------------------------
+// Works out where the owner wants the shield. Returns false if the shield
+// got teleported there instead and there's nothing left to simulate.
+//-----------------------------------------------------------------------------
+bool CShieldMobile::StartSimulateShield( Vector &vecOldOrigin )
 {
 	CBaseEntity *owner = GetOwnerEntity();
 	Vector origin;
@@ -586,7 +634,7 @@ void CShieldMobile::SimulateShield( void )
 		origin = vec3_origin;
 	}
 
-	Vector vecOldOrigin = m_ShieldEffect.GetCurrentPosition();
+	vecOldOrigin = m_ShieldEffect.GetCurrentPosition();
 	
 	Vector vecDelta;
 	VectorSubtract( origin, vecOldOrigin, vecDelta );
@@ -595,12 +643,19 @@ void CShieldMobile::SimulateShield( void )
 	if (vecDelta.LengthSqr() > flMaxDist * flMaxDist )
 	{
 		OnTeleported();
-		return;
+		return false;
 	}
 
 	m_ShieldEffect.SetDesiredOrigin( origin );
-	m_ShieldEffect.Simulate(gpGlobals->frametime);
-	DetermineObstructions();
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Moves the entity to where the simulation put the shield
+//-----------------------------------------------------------------------------
+void CShieldMobile::FinishSimulateShield( const Vector &vecOldOrigin )
+{
 	SetAbsOrigin( m_ShieldEffect.GetCurrentPosition() );
 	SetAbsAngles( m_ShieldEffect.GetCurrentAngles() );
 
@@ -645,16 +700,68 @@ void CShieldMobile::SimulateShield( void )
 //-----------------------------------------------------------------------------
 void CShieldMobile::ShieldThink( void )
 {
-	SimulateShield();
+#ifndef CLIENT_DLL
+	// Already done for this tick if the shields were simulated together
+	if ( m_nBatchSimulateTick != gpGlobals->tickcount )
+#endif
+	{
+		SimulateShield();
+	}
 
 #ifdef CLIENT_DLL
 	m_ShieldEffect.ComputeControlPoints();
 	m_ShieldEffect.ComputePanelActivity();
+#else
+	CheckGeometryChanged();
 #endif
 
 	SetNextThink( gpGlobals->curtime + 0.01f );
 }
 
+#ifndef CLIENT_DLL
+
+void CShieldMobile::CheckGeometryChanged( void )
+{
+	if ( m_nLastGeometryVersion == m_ShieldEffect.GetGeometryVersion() )
+		return;
+
+	m_nLastGeometryVersion = m_ShieldEffect.GetGeometryVersion();
+	InvalidateShieldTree();
+	InvalidateCollisionMesh();
+}
+
+
+//-----------------------------------------------------------------------------
+// Batched simulation. Begin and End run on the main thread; SimulateBatched
+// runs on a job thread and only touches the shield effect.
+//-----------------------------------------------------------------------------
+bool CShieldMobile::BeginBatchedSimulate()
+{
+	// Not spawned yet
+	if ( GetNextThinkTick() == TICK_NEVER_THINK )
+		return false;
+
+	m_nBatchSimulateTick = gpGlobals->tickcount;
+	m_nBatchProbes = 0;
+	return StartSimulateShield( m_vecBatchOldOrigin );
+}
+
+void CShieldMobile::SimulateBatched()
+{
+	m_ShieldEffect.Simulate( gpGlobals->frametime );
+	m_nBatchProbes = m_ShieldEffect.ProbeVertexActivity( m_BatchProbes, SHIELD_TESTS_PER_FRAME );
+}
+
+void CShieldMobile::EndBatchedSimulate()
+{
+	m_ShieldEffect.CommitVertexActivity( m_BatchProbes, m_nBatchProbes );
+	FinishSimulateShield( m_vecBatchOldOrigin );
+	CheckGeometryChanged();
+}
+
+#endif
+
+
 void CShieldMobile::ClientThink()
 {
 #ifdef CLIENT_DLL
@@ -49,6 +49,9 @@ END_PREDICTION_DATA()
 //-----------------------------------------------------------------------------
 CShieldEffect::CShieldEffect( )
 {
+	m_bControlPointsMoved = true;
+	m_nStillProbes = 0;
+	m_nGeometryVersion = 0;
 }
 
 
@@ -195,11 +198,17 @@ void CShieldEffect::ComputePanelActivity()
 			int idx = i + j * (SHIELD_NUM_HORIZONTAL_POINTS - 1);
 
 			// Test the neighbors
-			m_pActivePanels[idx] = 
+			bool bActive = 
 				IsVertexActive( i, j ) ||
 				IsVertexActive( i+1, j ) ||
 				IsVertexActive( i, j+1 ) ||
 				IsVertexActive( i+1, j+1 );
+
+			if ( m_pActivePanels[idx] != bActive )
+			{
+				m_pActivePanels[idx] = bActive;
+				++m_nGeometryVersion;
+			}
 		}
 	}
 }
@@ -208,17 +217,32 @@ void CShieldEffect::ComputePanelActivity()
 //-----------------------------------------------------------------------------
 // Compute vertex activity
 //-----------------------------------------------------------------------------
-
-enum
+void CShieldEffect::ComputeVertexActivity()
 {
-	SHIELD_TESTS_PER_FRAME = 4
-};
+	ShieldProbeResult_t results[SHIELD_TESTS_PER_FRAME];
+	int nProbes = ProbeVertexActivity( results, SHIELD_TESTS_PER_FRAME );
+	CommitVertexActivity( results, nProbes );
+}
 
 
-void CShieldEffect::ComputeVertexActivity()
+int CShieldEffect::ProbeVertexActivity( ShieldProbeResult_t *pResults, int nMaxProbes )
 {
+	// The probes only hit world brushes, which don't move, so once every point
+	// has been tested since the shield last moved there's nothing new to find.
+	if ( m_bControlPointsMoved )
+	{
+		m_bControlPointsMoved = false;
+		m_nStillProbes = 0;
+	}
+	else if ( m_nStillProbes >= SHIELD_NUM_CONTROL_POINTS )
+	{
+		return 0;
+	}
+
+	int nProbes = min( nMaxProbes, (int)SHIELD_TESTS_PER_FRAME );
+
 	int i;
-	for ( i = 0; i < SHIELD_TESTS_PER_FRAME; ++i )
+	for ( i = 0; i < nProbes; ++i )
 	{
 		// Visit points in random order...
 		int pt = m_PointList[m_TestPoint];
@@ -230,13 +254,24 @@ void CShieldEffect::ComputeVertexActivity()
 		CTraceFilterWorldOnly traceFilter;
 		UTIL_TraceHull( m_Position, m_pControlPoint[pt], 
 			m_PanelBoxMin, m_PanelBoxMax, MASK_SOLID_BRUSHONLY, &traceFilter, &tr );
-		bool isActive = (!tr.allsolid) && ( (tr.fraction - 1.0f) >= 0.0f );
 
-		m_pActiveVerts->SetActiveVertState( pt, isActive );
+		pResults[i].m_nPoint = pt;
+		pResults[i].m_bActive = (!tr.allsolid) && ( (tr.fraction - 1.0f) >= 0.0f );
 
 		if (++m_TestPoint >= SHIELD_NUM_CONTROL_POINTS)
 			m_TestPoint = 0;
+	}
 
+	m_nStillProbes += nProbes;
+	return nProbes;
+}
+
+
+void CShieldEffect::CommitVertexActivity( const ShieldProbeResult_t *pResults, int nProbes )
+{
+	for ( int i = 0; i < nProbes; ++i )
+	{
+		m_pActiveVerts->SetActiveVertState( pResults[i].m_nPoint, pResults[i].m_bActive );
 	}
 
 	ComputePanelActivity();
@@ -342,8 +377,11 @@ void CShieldEffect::Spawn( const Vector& currentPosition, const QAngle& currentA
 
 	// No points are visible initially
 	memset( m_pActivePanels, 0, SHIELD_PANELS_COUNT );
+	++m_nGeometryVersion;
 
 	m_TestPoint = 0;
+	m_bControlPointsMoved = true;
+	m_nStillProbes = 0;
 
 	// Choose random order to visit shield verts
 	int i;
@@ -380,13 +418,27 @@ void CShieldEffect::ComputeControlPoints()
 	Vector forward, right, up;
 	AngleVectors(m_CurrentAngles, &forward, &right, &up);
 
+	bool bMoved = false;
 	for ( int i = 0; i < SHIELD_NUM_CONTROL_POINTS; ++i )
 	{
 		// Compute the world space position...
-		VectorCopy( m_Position, m_pControlPoint[i] );
-		m_pControlPoint[i] += right * m_pFixedDirection[i].x;
-		m_pControlPoint[i] += up * m_pFixedDirection[i].z;
-		m_pControlPoint[i] += forward * m_pFixedDirection[i].y;
+		Vector vecPoint;
+		VectorCopy( m_Position, vecPoint );
+		vecPoint += right * m_pFixedDirection[i].x;
+		vecPoint += up * m_pFixedDirection[i].z;
+		vecPoint += forward * m_pFixedDirection[i].y;
+
+		if ( vecPoint != m_pControlPoint[i] )
+		{
+			m_pControlPoint[i] = vecPoint;
+			bMoved = true;
+		}
+	}
+
+	if ( bMoved )
+	{
+		m_bControlPointsMoved = true;
+		++m_nGeometryVersion;
 	}
 }
 
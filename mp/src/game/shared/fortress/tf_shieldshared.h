@@ -33,7 +33,8 @@ enum
 	SHIELD_VERTICAL_PANEL_COUNT = (SHIELD_NUM_VERTICAL_POINTS - 1),
 	SHIELD_PANELS_COUNT = (SHIELD_HORIZONTAL_PANEL_COUNT * SHIELD_VERTICAL_PANEL_COUNT),
 	SHIELD_VERTEX_BYTES = (SHIELD_NUM_CONTROL_POINTS + 7) >> 3,
-	SHIELD_TIME_SUBVISIBIONS = 2
+	SHIELD_TIME_SUBVISIBIONS = 2,
+	SHIELD_TESTS_PER_FRAME = 4
 };
 
 //--------------------------------------------------------------------------
@@ -92,6 +93,17 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------
+// One vertex activity test, so the traces can be done somewhere other than
+// where the results get applied
+//-----------------------------------------------------------------------------
+struct ShieldProbeResult_t
+{
+	int		m_nPoint;
+	bool	m_bActive;
+};
+
+
 class CShieldEffect
 {
 	DECLARE_CLASS_NOBASE( CShieldEffect );
@@ -131,6 +143,10 @@ public:
 	// Computes control points
 	void ComputeControlPoints();
 
+	// Bumped whenever a control point moves or a panel turns on or off, so
+	// collision data built from them knows when it's stale.
+	int GetGeometryVersion() const { return m_nGeometryVersion; }
+
 	// The current angles (computed by Simulate on the server)
 	const QAngle& GetCurrentAngles() const;
 	void SetCurrentAngles( const QAngle& angles);
@@ -142,6 +158,13 @@ public:
 	// Compute vertex activity
 	void ComputeVertexActivity();
 
+	// ComputeVertexActivity in two halves. ProbeVertexActivity only does the
+	// traces (so it's safe on a job thread) and returns how many it did; it does
+	// none once every point has been tested without the shield moving.
+	// CommitVertexActivity applies the results.
+	int ProbeVertexActivity( ShieldProbeResult_t *pResults, int nMaxProbes );
+	void CommitVertexActivity( const ShieldProbeResult_t *pResults, int nProbes );
+
 	// Recompute whether the panels are active or not
 	void ComputePanelActivity();
 
@@ -210,6 +233,13 @@ private:
 	int		m_TestPoint;
 	int		m_PointList[SHIELD_NUM_CONTROL_POINTS];
 
+	// Set when ComputeControlPoints moves a point; the probes count up from
+	// there and stop once they've been around every point
+	bool	m_bControlPointsMoved;
+	int		m_nStillProbes;
+
+	int		m_nGeometryVersion;
+
 	// desired position + orientation
 	Vector	m_vecDesiredOrigin;
 	QAngle	m_angDesiredAngles;
@@ -2,6 +2,7 @@
 // Purpose: Shared stuff for the Tactical map
 
 #include "cbase.h"
+#include "tf_tacticalmap.h"
 
 // Unfortunate hack.
 // Needed to cycle through the player & radar scanner entities in both the client and game dlls
@@ -78,42 +79,51 @@ static inline bool IsEntityAnObject( int iEntIndex )
 
 
 //-----------------------------------------------------------------------------
-// Purpose: Return true if the entity is visible on this player's tactical map
+// Purpose: Work out how an entity shows up on the tactical map from its name
 //-----------------------------------------------------------------------------
-bool IsEntityVisibleToTactical( int iLocalTeamNumber, int iLocalTeamPlayers, 
-	int iLocalTeamObjects, int entIndex, const char *pEntName, int iEntTeamNumber, const Vector &entOrigin )
+int GetTacticalClassForName( const char *pEntName )
 {
 	// Resource zones are always visible
 	if ( !strcmp( pEntName, "trigger_resourcezone") )
-		return true;
+		return TACTICAL_CLASS_ALWAYS;
 
 	// Tunnels are always visible
 	if ( !strcmp( pEntName, "obj_tunnel") || !strcmp( pEntName, "obj_tunnel_prop") )
-		return true;
+		return TACTICAL_CLASS_ALWAYS;
 
 	// Fixed shields are never visible
 	if ( !strcmp( pEntName, "shield") )
-		return false;
+		return TACTICAL_CLASS_NEVER;
+
+	// Players are always visible to their team
+	if ( !Q_strncmp( pEntName, "player", 7) )
+		return TACTICAL_CLASS_TEAM;
+
+	// Resource collectors are always visible to their team
+	if ( !strcmp( pEntName, "npc_rescollector_aerial") )
+		return TACTICAL_CLASS_TEAM;
+
+	return TACTICAL_CLASS_NONE;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Return true if the entity is visible on this player's tactical map
+//-----------------------------------------------------------------------------
+bool IsEntityVisibleToTactical( int iLocalTeamNumber, int iLocalTeamPlayers, 
+	int iLocalTeamObjects, int entIndex, const char *pEntName, int iEntTeamNumber, const Vector &entOrigin )
+{
+	int iTacticalClass = GetTacticalClassForName( pEntName );
 
 	// NOTE: If you're looking for various object types, fix the ugly hack
 	// in mapdata.cpp!!
-	if ( iLocalTeamNumber == iEntTeamNumber )
+	// Objects are always visible to their team
+	if ( iTacticalClass == TACTICAL_CLASS_NONE && iLocalTeamNumber == iEntTeamNumber && IsEntityAnObject( entIndex ) )
 	{
-		// Objects are always visible to their team
-		if (IsEntityAnObject( entIndex ))
-			return true;
-
-		// Players are always visible to their team
-		if (!Q_strncmp( pEntName, "player", 7) )
-			return true;
-
-		// Resource collectors are always visible to their team
-		if ( !strcmp( pEntName, "npc_rescollector_aerial") )
-			return true;
+		iTacticalClass = TACTICAL_CLASS_OBJECT;
 	}
 
-	return false;
+	return IsTacticalClassVisible( iTacticalClass, iLocalTeamNumber, iEntTeamNumber );
 }
 
 
-
@@ -0,0 +1,43 @@
+
+// Purpose: Shared stuff for the Tactical map
+
+#ifndef TF_TACTICALMAP_H
+#define TF_TACTICALMAP_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+// How an entity shows up on the tactical map. Only depends on what the entity is,
+// so it can be worked out once and cached instead of comparing classnames every time.
+enum TacticalClass_t
+{
+	TACTICAL_CLASS_NONE = 0,	// Nothing special, only visible if it turns out to be an object
+	TACTICAL_CLASS_NEVER,		// Never visible (fixed shields)
+	TACTICAL_CLASS_ALWAYS,		// Visible to everybody (resource zones, tunnels)
+	TACTICAL_CLASS_TEAM,		// Visible to its own team (players, resource collectors)
+	TACTICAL_CLASS_OBJECT,		// Visible to its own team unless it suppresses it
+};
+
+// Classifies an entity by classname. Returns TACTICAL_CLASS_NONE for anything that isn't
+// named specially; the caller decides whether it's an object.
+int GetTacticalClassForName( const char *pEntName );
+
+// Is something of this tactical class on iEntTeamNumber visible to iLocalTeamNumber?
+// Objects that suppress tactical visibility should be passed in as TACTICAL_CLASS_NONE.
+inline bool IsTacticalClassVisible( int iTacticalClass, int iLocalTeamNumber, int iEntTeamNumber )
+{
+	if ( iTacticalClass == TACTICAL_CLASS_ALWAYS )
+		return true;
+
+	if ( iTacticalClass == TACTICAL_CLASS_TEAM || iTacticalClass == TACTICAL_CLASS_OBJECT )
+		return iLocalTeamNumber == iEntTeamNumber;
+
+	return false;
+}
+
+bool IsEntityVisibleToTactical( int iLocalTeamNumber, int iLocalTeamPlayers, 
+	int iLocalTeamObjects, int entIndex, const char *pEntName, int iEntTeamNumber, const Vector &entOrigin );
+
+
+#endif // TF_TACTICALMAP_H
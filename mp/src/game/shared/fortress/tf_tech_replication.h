@@ -0,0 +1,67 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Wire format for the "TechnologyBatch" user message.
+//
+//			The old "Technology" message carries one tech per message. A batch carries up
+//			to TECH_BATCH_MAX_TECHS consecutive techs from the tree:
+//
+//				byte	preferred tech index for the recipient (TECH_BATCH_NO_PREFERENCE if none)
+//				byte	first tech index in the batch
+//				byte	number of techs the batch covers, | TECH_BATCH_ALL_PRESENT if every one
+//						of them is in it (the team baseline). Otherwise a bitmap of which ones
+//						are in it follows, one bit per tech.
+//
+//			Then one TechBatch_WriteState record per tech that's in the batch. A tech nobody
+//			has touched yet packs into 3 bits.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef TF_TECH_REPLICATION_H
+#define TF_TECH_REPLICATION_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+#include "tier1/bitbuf.h"
+
+
+#define TECH_BATCH_MAX_TECHS		64		// Keeps the worst case (every bit set) under MAX_USER_MSG_DATA
+#define TECH_BATCH_ALL_PRESENT		0x80
+#define TECH_BATCH_NO_PREFERENCE	0xFF
+#define TECH_BATCH_HEADER_BYTES		3
+
+#define TECH_BATCH_VOTER_BITS		7
+#define TECH_BATCH_LEVEL_BITS		16		// Matches the short in the "Technology" message
+
+#define TECH_BATCH_MAX_STATE_BITS	( 3 + TECH_BATCH_VOTER_BITS + TECH_BATCH_LEVEL_BITS )
+
+
+inline void TechBatch_WriteState( bf_write &buf, bool bAvailable, int nVoters, int nResourceLevel )
+{
+	buf.WriteOneBit( bAvailable );
+
+	buf.WriteOneBit( nVoters != 0 );
+	if ( nVoters )
+	{
+		buf.WriteUBitLong( nVoters & ( ( 1 << TECH_BATCH_VOTER_BITS ) - 1 ), TECH_BATCH_VOTER_BITS );
+	}
+
+	buf.WriteOneBit( nResourceLevel != 0 );
+	if ( nResourceLevel )
+	{
+		buf.WriteSBitLong( (short)nResourceLevel, TECH_BATCH_LEVEL_BITS );
+	}
+}
+
+
+inline void TechBatch_ReadState( bf_read &buf, bool &bAvailable, int &nVoters, int &nResourceLevel )
+{
+	bAvailable = buf.ReadOneBit() != 0;
+	nVoters = buf.ReadOneBit() ? buf.ReadUBitLong( TECH_BATCH_VOTER_BITS ) : 0;
+	nResourceLevel = buf.ReadOneBit() ? buf.ReadSBitLong( TECH_BATCH_LEVEL_BITS ) : 0;
+}
+
+
+#endif // TF_TECH_REPLICATION_H
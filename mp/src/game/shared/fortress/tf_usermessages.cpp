@@ -39,6 +39,7 @@ void RegisterUserMessages( void )
 	usermessages->Register( "Accuracy", 2 );		// unused
 	usermessages->Register( "ZoneState", 1 );		// unused
 	usermessages->Register( "Technology", -1 );
+	usermessages->Register( "TechnologyBatch", -1 );	// See tf_tech_replication.h
 	usermessages->Register( "MinimapPulse", -1 );
 	usermessages->Register( "ActBegin", -1 );
 	usermessages->Register( "ActEnd", -1 );
@@ -88,7 +88,7 @@ void CWeaponCombat_ChargeablePlasma::GainedNewTechnology( CBaseTechnology *pTech
 	if ( pPlayer )
 	{
 		// Charge-up mode?
-		if ( pPlayer->HasNamedTechnology( "com_comboshield_charge" ) )
+		if ( pPlayer->HasTechnology( TECH_COM_COMBOSHIELD_CHARGE ) )
 		{
 			m_bHasCharge = true;
 		}
@@ -98,7 +98,7 @@ void CWeaponCombat_ChargeablePlasma::GainedNewTechnology( CBaseTechnology *pTech
 		}
 
 		// Burst shot mode?
-		if ( pPlayer->HasNamedTechnology( "com_comboshield_tripleshot" ) )
+		if ( pPlayer->HasTechnology( TECH_COM_COMBOSHIELD_TRIPLESHOT ) )
 		{
 			m_bHasBurstShot = true;
 		}
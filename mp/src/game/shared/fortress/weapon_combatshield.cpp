@@ -400,7 +400,7 @@ void CWeaponCombatShield::GainedNewTechnology( CBaseTechnology *pTechnology )
 	if ( pPlayer )
 	{
 		// Has a parry?
-		if ( pPlayer->HasNamedTechnology( "com_comboshield_parry" ) )
+		if ( pPlayer->HasTechnology( TECH_COM_COMBOSHIELD_PARRY ) )
 		{
 			m_bHasShieldParry = true;
 		}
@@ -38,6 +38,7 @@
 
 #else
 	#include "gasoline_blob.h"
+	#include "fire_field.h"
 	#include "fire_damage_mgr.h"
 	#include "tf_gamerules.h"
 	
@@ -253,7 +254,7 @@ void CWeaponFlameThrower::PrimaryAttack()
 				flPercent = 0.1f;
 
 			float flDamage = flPercent * FLAMETHROWER_DAMAGE_PER_SEC;
-			GetFireDamageMgr()->AddDamage( pEnt, GetOwner(), flDamage, !IsGasolineBlob( pEnt ) );
+			GetFireDamageMgr()->AddDamage( pEnt, GetOwner(), flDamage, true );
 		}
 		
 		// Drop a new petrol blob.
@@ -404,24 +405,18 @@ void CWeaponFlameThrower::PrimaryAttack()
 		if ( !pOwner )
 			return;
 
+		// Blobs used to be found by their bounds, so reach out to the edge of them.
 		Vector vOrigin = pOwner->Weapon_ShootPosition( );
-		CBaseEntity *ents[128];
-		float dists[128];
-		int nEnts = FindBurnableEntsInSphere(
-			ents,
-			dists,
-			ARRAYSIZE( dists ),
+		CGasolineBlob *pBlobs[128];
+		int nBlobs = FindGasolineBlobsInSphere(
+			pBlobs,
+			ARRAYSIZE( pBlobs ),
 			vOrigin,
-			50,
-			pOwner );
+			50 + GASOLINE_BLOB_RADIUS );
 
-		for ( int i=0; i < nEnts; i++ )
+		for ( int i=0; i < nBlobs; i++ )
 		{
-			CGasolineBlob *pBlob = dynamic_cast< CGasolineBlob* >( ents[i] );
-			if ( pBlob )
-			{
-				GetFireDamageMgr()->AddDamage( pBlob, pOwner, 500, false );
-			}
+			pBlobs[i]->QueueHeat( 500 );
 		}
 	}
 
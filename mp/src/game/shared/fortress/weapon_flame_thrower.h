@@ -22,7 +22,7 @@
 
 #else
 
-	class CGasolineBlob;
+	#include "gasoline_blob.h"
 
 #endif
 
@@ -74,7 +74,7 @@ public:
 private:
 
 	// Used to link the blobs together.
-	CHandle<CGasolineBlob>	m_hPrevBlob;
+	CGasolineBlobHandle		m_hPrevBlob;
 
 
 #endif
@@ -247,7 +247,7 @@ void CWeaponMortar::SetRoundType( int iRoundType )
 		if ( !pPlayer )
 			return;
 		// Does the player have the technology?
-		if ( pPlayer->HasNamedTechnology( MortarAmmoTechs[ iRoundType ] ) == false )
+		if ( pPlayer->HasTechnology( MortarAmmoTechIDs[ iRoundType ] ) == false )
 			return;
 	}
 
@@ -326,13 +326,13 @@ void CWeaponMortar::GainedNewTechnology( CBaseTechnology *pTechnology )
 	if ( pPlayer )
 	{
 		// Range upgraded?
-		if ( pPlayer->HasNamedTechnology("mortar_range") )
+		if ( pPlayer->HasTechnology(TECH_MORTAR_RANGE) )
 			m_bRangeUpgraded = true;
 		else
 			m_bRangeUpgraded = false;
 
 		// Accuracy upgraded?
-		if ( pPlayer->HasNamedTechnology("mortar_accuracy") )
+		if ( pPlayer->HasTechnology(TECH_MORTAR_ACCURACY) )
 			m_bAccuracyUpgraded = true;
 		else
 			m_bAccuracyUpgraded = false;
@@ -39,6 +39,30 @@ static int s_nNumCacheMisses = 0;
 static int s_SuccessfulSpeculatives = 0;
 static int s_WastedSpeculativeUpdates = 0;
 
+// CTraceFilterSimple with the callback, that can skip a second entity (the dest entity of a los check).
+class CTraceFilterQueryCache : public CTraceFilterSimple
+{
+public:
+	DECLARE_CLASS( CTraceFilterQueryCache, CTraceFilterSimple );
+
+	CTraceFilterQueryCache( const IHandleEntity *passentity, const IHandleEntity *passentity2, int collisionGroup,
+							ShouldHitFunc_t pExtraShouldHitCheckFn ) :
+		BaseClass( passentity, collisionGroup, pExtraShouldHitCheckFn ), m_pPassEnt2( passentity2 )
+	{
+	}
+
+	virtual bool ShouldHitEntity( IHandleEntity *pHandleEntity, int contentsMask )
+	{
+		if ( m_pPassEnt2 && !PassServerEntityFilter( pHandleEntity, m_pPassEnt2 ) )
+			return false;
+
+		return BaseClass::ShouldHitEntity( pHandleEntity, contentsMask );
+	}
+
+private:
+	const IHandleEntity *m_pPassEnt2;
+};
+
 void QueryCacheKey_t::ComputeHashIndex( void )
 {
 	unsigned int ret = ( unsigned int ) m_Type;
@@ -279,9 +303,13 @@ void QueryCacheEntry_t::IssueQuery( void )
 		CalculateOffsettedPosition( pEntity, m_QueryParams.m_nOffsetMode[i],
 									&( m_QueryParams.m_Points[i] ) );
 	}
-	CTraceFilterSimple filter( m_QueryParams.m_pEntities[2],
-							   m_QueryParams.m_nCollisionGroup,
-							   m_QueryParams.m_pTraceFilterFunction );
+	CBaseEntity *pPassEntity2 = NULL;
+	if ( m_QueryParams.m_Type == EQUERY_ENTITY_LOS_CHECK_IGNORE_DEST )
+		pPassEntity2 = m_QueryParams.m_pEntities[1];
+	CTraceFilterQueryCache filter( m_QueryParams.m_pEntities[2],
+								   pPassEntity2,
+								   m_QueryParams.m_nCollisionGroup,
+								   m_QueryParams.m_pTraceFilterFunction );
 	trace_t result;
 	s_nNumCacheMisses++;
 	UTIL_TraceLine( m_QueryParams.m_Points[0], m_QueryParams.m_Points[1],
@@ -299,10 +327,11 @@ bool IsLineOfSightBetweenTwoEntitiesClear( CBaseEntity *pSrcEntity,
 										   int nCollisionGroup,
 										   unsigned int nTraceMask,
 										   ShouldHitFunc_t pTraceFilterCallback,
-										   float flMinimumUpdateInterval )
+										   float flMinimumUpdateInterval,
+										   bool bIgnoreDestEntity )
 {
 	QueryCacheKey_t entry;
-	entry.m_Type = EQUERY_ENTITY_LOS_CHECK;
+	entry.m_Type = bIgnoreDestEntity ? EQUERY_ENTITY_LOS_CHECK_IGNORE_DEST : EQUERY_ENTITY_LOS_CHECK;
 	entry.m_pEntities[0] = pSrcEntity;
 	entry.m_pEntities[1] = pDestEntity;
 	entry.m_pEntities[2] = pSkipEntity;
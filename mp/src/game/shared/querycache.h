@@ -28,6 +28,7 @@ enum EQueryType_t
 	EQUERY_INVALID = 0,									// an invalid or unused entry
 	EQUERY_TRACELINE,
 	EQUERY_ENTITY_LOS_CHECK,
+	EQUERY_ENTITY_LOS_CHECK_IGNORE_DEST,				// los check that doesn't stop on the dest entity
 
 };
 
@@ -85,7 +86,8 @@ bool IsLineOfSightBetweenTwoEntitiesClear( CBaseEntity *pSrcEntity,
 										   int nCollisionGroup,
 										   unsigned int nTraceMask,
 										   ShouldHitFunc_t pTraceFilterCallback,
-										   float flMinimumUpdateInterval = 0.2
+										   float flMinimumUpdateInterval = 0.2,
+										   bool bIgnoreDestEntity = false
 	);
 
 
@@ -549,54 +549,42 @@ bool UTIL_EntityHasMatchingRootParent( CBaseEntity *pRootParent, CBaseEntity *pE
 //-----------------------------------------------------------------------------
 // Sweep an entity from the starting to the ending position 
 //-----------------------------------------------------------------------------
-class CTraceFilterEntity : public CTraceFilterSimple
+CTraceFilterEntity::CTraceFilterEntity( CBaseEntity *pEntity, int nCollisionGroup ) 
+	: CTraceFilterSimple( pEntity, nCollisionGroup )
 {
-	DECLARE_CLASS( CTraceFilterEntity, CTraceFilterSimple );
+	m_pRootParent = pEntity->GetRootMoveParent();
+	m_pEntity = pEntity;
+	m_checkHash = g_EntityCollisionHash->IsObjectInHash(pEntity);
+}
 
-public:
-	CTraceFilterEntity( CBaseEntity *pEntity, int nCollisionGroup ) 
-		: CTraceFilterSimple( pEntity, nCollisionGroup )
-	{
-		m_pRootParent = pEntity->GetRootMoveParent();
-		m_pEntity = pEntity;
-		m_checkHash = g_EntityCollisionHash->IsObjectInHash(pEntity);
-	}
+bool CTraceFilterEntity::ShouldHitEntity( IHandleEntity *pHandleEntity, int contentsMask )
+{
+	CBaseEntity *pEntity = EntityFromEntityHandle( pHandleEntity );
+	if ( !pEntity )
+		return false;
 
-	bool ShouldHitEntity( IHandleEntity *pHandleEntity, int contentsMask )
-	{
-		CBaseEntity *pEntity = EntityFromEntityHandle( pHandleEntity );
-		if ( !pEntity )
-			return false;
+	// Check parents against each other
+	// NOTE: Don't let siblings/parents collide.
+	if ( UTIL_EntityHasMatchingRootParent( m_pRootParent, pEntity ) )
+		return false;
 
-		// Check parents against each other
-		// NOTE: Don't let siblings/parents collide.
-		if ( UTIL_EntityHasMatchingRootParent( m_pRootParent, pEntity ) )
+	if ( m_checkHash )
+	{
+		if ( g_EntityCollisionHash->IsObjectPairInHash( m_pEntity, pEntity ) )
 			return false;
-
-		if ( m_checkHash )
-		{
-			if ( g_EntityCollisionHash->IsObjectPairInHash( m_pEntity, pEntity ) )
-				return false;
-		}
+	}
 
 #ifndef CLIENT_DLL
-		if ( m_pEntity->IsNPC() )
-		{
-			if ( NPC_CheckBrushExclude( m_pEntity, pEntity ) )
-				 return false;
-
-		}
-#endif
+	if ( m_pEntity->IsNPC() )
+	{
+		if ( NPC_CheckBrushExclude( m_pEntity, pEntity ) )
+			 return false;
 
-		return BaseClass::ShouldHitEntity( pHandleEntity, contentsMask );
 	}
+#endif
 
-private:
-
-	CBaseEntity *m_pRootParent;
-	CBaseEntity *m_pEntity;
-	bool		m_checkHash;
-};
+	return BaseClass::ShouldHitEntity( pHandleEntity, contentsMask );
+}
 
 class CTraceFilterEntityIgnoreOther : public CTraceFilterEntity
 {
@@ -258,6 +258,24 @@ private:
 	ITraceFilter	*m_pTraceFilter2;
 };
 
+//-----------------------------------------------------------------------------
+// Sweep an entity from the starting to the ending position 
+//-----------------------------------------------------------------------------
+class CTraceFilterEntity : public CTraceFilterSimple
+{
+	DECLARE_CLASS( CTraceFilterEntity, CTraceFilterSimple );
+
+public:
+	CTraceFilterEntity( CBaseEntity *pEntity, int nCollisionGroup );
+	bool ShouldHitEntity( IHandleEntity *pHandleEntity, int contentsMask );
+
+private:
+
+	CBaseEntity *m_pRootParent;
+	CBaseEntity *m_pEntity;
+	bool		m_checkHash;
+};
+
 // helper
 void DebugDrawLine( const Vector& vecAbsStart, const Vector& vecAbsEnd, int r, int g, int b, bool test, float duration );
 
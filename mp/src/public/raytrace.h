@@ -13,9 +13,17 @@
 #include <mathlib/mathlib.h>
 #include <bspfile.h>
 
-// fast SSE-ONLY ray tracing module. Based upon various "real time ray tracing" research.
+// fast SSE-ONLY ray tracing module. Based upon various "real time ray tracing" research. CPUs
+// with AVX2 can trace 8 rays at a time through Trace8Rays.
 //#define DEBUG_RAYTRACE 1
 
+// the AVX2 tracer is only compiled with compilers that can turn AVX2 on for single functions,
+// so the rest of the library (and anything inline it pulls in) stays baseline SSE.
+#if ( defined( _MSC_VER ) && ( _MSC_VER >= 1700 ) ) || defined( __clang__ ) || \
+	( defined( __GNUC__ ) && ( ( __GNUC__ > 4 ) || ( ( __GNUC__ == 4 ) && ( __GNUC_MINOR__ >= 9 ) ) ) )
+#define RAYTRACE_AVX2 1
+#endif
+
 class FourRays
 {
 public:
@@ -220,6 +228,7 @@ public:
 #define RTE_FLAGS_FAST_TREE_GENERATION 1
 #define RTE_FLAGS_DONT_STORE_TRIANGLE_COLORS 2				// saves memory if not needed
 #define RTE_FLAGS_DONT_STORE_TRIANGLE_MATERIALS 4
+#define RTE_FLAGS_DISABLE_AVX2 8							// always use the 4-wide SSE tracer
 
 enum RayTraceLightingMode_t {
 	DIRECT_LIGHTING,										// just dot product lighting
@@ -236,6 +245,12 @@ class RayStream
 	int n_in_stream[8];
 	FourRays PendingRays[8];
 
+	// rays added with AddToRayBatch. these aren't traced until FinishRayStream, which sorts
+	// them into coherent packets first.
+	CUtlVector<Vector> BatchStarts;
+	CUtlVector<Vector> BatchEnds;
+	CUtlVector<RayTracingSingleResult *> BatchOutputs;
+
 public:
 	RayStream(void)
 	{
@@ -310,6 +325,23 @@ public:
 					RayTracingResult *rslt_out,
 					int32 skip_id=-1, ITransparentTriangleCallback *pCallback = NULL);
 
+	// traces 4 rays whose directions don't have to match in sign. each ray keeps its own t
+	// interval at every split, so the packet never has to be broken up. Trace4Rays calls this
+	// when the signs don't match.
+	void Trace4RaysAnyDirection(const FourRays &rays, fltx4 TMin, fltx4 TMax,
+								RayTracingResult *rslt_out,
+								int32 skip_id=-1, ITransparentTriangleCallback *pCallback = NULL);
+
+	// traces rays[0] and rays[1] (and their TMin, TMax and rslt_out entries) as one packet of
+	// 8 on CPUs with AVX2, and as two packets of 4 otherwise. Directions can have any signs.
+	// Transparent triangles are treated as solid.
+	void Trace8Rays(const FourRays *rays, const fltx4 *TMin, const fltx4 *TMax,
+					RayTracingResult *rslt_out, int32 skip_id=-1);
+
+	// true if this CPU (and OS) can run the AVX2 tracer, and it was compiled in
+	// (RAYTRACE_AVX2).
+	static bool IsAVX2Available(void);
+
 	// compute virtual light sources to model inter-reflection
 	void ComputeVirtualLightSources(void);
 
@@ -337,13 +369,26 @@ public:
 
 	inline void FlushStreamEntry(RayStream &s,int msk);
 
+	/// queues a ray without tracing it. meant for big batches of rays that aren't in any
+	/// particular order: FinishRayStream sorts the whole batch by direction and origin and
+	/// traces it 8 at a time.
+	void AddToRayBatch(RayStream &s,
+					   Vector const &start,Vector const &end,RayTracingSingleResult *rslt_out);
+
+	void FlushRayBatch(RayStream &s);
+
 	/// call this when you are done. handles all cleanup. After this is called, all rslt ptrs
-	/// previously passed to AddToRaySteam will have been filled in.
+	/// previously passed to AddToRaySteam or AddToRayBatch will have been filled in.
 	void FinishRayStream(RayStream &s);
 
 
 	int MakeLeafNode(int first_tri, int last_tri);
 
+	// the AVX2 version of Trace8Rays. lives in raytrace_avx2.cpp, where only the tracer's own
+	// functions are compiled for AVX2. only call it if IsAVX2Available.
+	void Trace8RaysAVX2(const FourRays *rays, const fltx4 *TMin, const fltx4 *TMax,
+						RayTracingResult *rslt_out, int32 skip_id);
+
 
 	float CalculateCostsOfSplit(
 		int split_plane,int32 const *tri_list,int ntris,
@@ -5,13 +5,13 @@
 #include <filesystem_tools.h>
 #include <cmdlib.h>
 #include <stdio.h>
-
-static bool SameSign(float a, float b)
-{
-	int32 aa=*((int *) &a);
-	int32 bb=*((int *) &b);
-	return ((aa^bb)&0x80000000)==0;
-}
+#ifdef RAYTRACE_AVX2
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
 
 int FourRays::CalculateDirectionSignMask(void) const
 {
@@ -276,70 +276,138 @@ static float BoxSurfaceArea(Vector const &boxmin, Vector const &boxmax)
 	return 2.0*((boxdim[0]*boxdim[2])+(boxdim[0]*boxdim[1])+(boxdim[1]*boxdim[2]));
 }
 
-void RayTracingEnvironment::Trace4Rays(const FourRays &rays, fltx4 TMin, fltx4 TMax,
-									   RayTracingResult *rslt_out,
-									   int32 skip_id, ITransparentTriangleCallback *pCallback)
+// tests the rays against every triangle in a leaf, keeping the closest hit for each ray in
+// rslt_out. shared by both 4-wide tracers.
+static FORCEINLINE void IntersectLeafTriangles(RayTracingEnvironment &env,
+											   CacheOptimizedKDNode const *CurNode,
+											   const FourRays &rays, int32 *mailboxids,
+											   int32 skip_id, ITransparentTriangleCallback *pCallback,
+											   RayTracingResult *rslt_out)
 {
-	int msk=rays.CalculateDirectionSignMask();
-	if (msk!=-1)
-		Trace4Rays(rays,TMin,TMax,msk,rslt_out,skip_id, pCallback);
-	else
+	int ntris=CurNode->NumberOfTrianglesInLeaf();
+	int32 const *tlist=&(env.TriangleIndexList[CurNode->TriangleIndexStart()]);
+	do
 	{
-		// sucky case - can't trace 4 rays at once. in the worst case, need to trace all 4
-		// separately, but usually we will still get 2x, Since our tracer only does 4 at a
-		// time, we will have to cover up the undesired rays with the desired ray
+		int tnum=*(tlist++);
+		//printf("try tri %d\n",tnum);
+		// check mailbox
+		int mbox_slot=tnum & (MAILBOX_HASH_SIZE-1);
+		TriIntersectData_t const *tri = &( env.OptimizedTriangleList[tnum].m_Data.m_IntersectData );
+		if ( ( mailboxids[mbox_slot] != tnum ) && ( tri->m_nTriangleID != skip_id ) )
+		{
+			n_intersection_calculations++;
+			mailboxids[mbox_slot] = tnum;
+			// compute plane intersection
 
-		//!! speed!! there is room for some sse-ization here
-		FourRays tmprays;
-		tmprays.origin=rays.origin;
 
-		uint8 need_trace[4]={1,1,1,1};
-		for(int try_trace=0;try_trace<4;try_trace++)
-		{
-			if (need_trace[try_trace])
+			FourVectors N;
+			N.x = ReplicateX4( tri->m_flNx );
+			N.y = ReplicateX4( tri->m_flNy );
+			N.z = ReplicateX4( tri->m_flNz );
+
+			fltx4 DDotN = rays.direction * N;
+			// mask off zero or near zero (ray parallel to surface)
+			fltx4 did_hit = OrSIMD( CmpGtSIMD( DDotN,FourEpsilons ),
+									CmpLtSIMD( DDotN, FourNegativeEpsilons ) );
+
+			fltx4 numerator=SubSIMD( ReplicateX4( tri->m_flD ), rays.origin * N );
+
+			fltx4 isect_t=DivSIMD( numerator,DDotN );
+			// now, we have the distance to the plane. lets update our mask
+			did_hit = AndSIMD( did_hit, CmpGtSIMD( isect_t, FourZeros ) );
+			//did_hit=AndSIMD(did_hit,CmpLtSIMD(isect_t,TMax));
+			did_hit = AndSIMD( did_hit, CmpLtSIMD( isect_t, rslt_out->HitDistance ) );
+
+			if ( ! IsAnyNegative( did_hit ) )
+				continue;
+
+			// now, check 3 edges
+			fltx4 hitc1 = AddSIMD( rays.origin[tri->m_nCoordSelect0],
+								MulSIMD( isect_t, rays.direction[ tri->m_nCoordSelect0] ) );
+			fltx4 hitc2 = AddSIMD( rays.origin[tri->m_nCoordSelect1],
+								   MulSIMD( isect_t, rays.direction[tri->m_nCoordSelect1] ) );
+			
+			// do barycentric coordinate check
+			fltx4 B0 = MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[0] ), hitc1 );
+
+			B0 = AddSIMD(
+				B0,
+				MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[1] ), hitc2 ) );
+			B0 = AddSIMD(
+				B0, ReplicateX4( tri->m_ProjectedEdgeEquations[2] ) );
+
+			did_hit = AndSIMD( did_hit, CmpGeSIMD( B0, FourZeros ) );
+
+			fltx4 B1 = MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[3] ), hitc1 );
+			B1 = AddSIMD(
+				B1,
+				MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[4]), hitc2 ) );
+
+			B1 = AddSIMD(
+				B1, ReplicateX4( tri->m_ProjectedEdgeEquations[5] ) );
+			
+			did_hit = AndSIMD( did_hit, CmpGeSIMD( B1, FourZeros ) );
+
+			fltx4 B2 = AddSIMD( B1, B0 );
+			did_hit = AndSIMD( did_hit, CmpLeSIMD( B2, Four_Ones ) );
+
+			if ( ! IsAnyNegative( did_hit ) )
+				continue;
+
+			// if the triangle is transparent
+			if ( tri->m_nFlags & FCACHETRI_TRANSPARENT )
 			{
-				need_trace[try_trace]=2;			// going to trace it
-				// replicate the ray being traced into all 4 rays
-				tmprays.direction.x=ReplicateX4(rays.direction.X(try_trace));
-				tmprays.direction.y=ReplicateX4(rays.direction.Y(try_trace));
-				tmprays.direction.z=ReplicateX4(rays.direction.Z(try_trace));
-				// now, see if any of the other remaining rays can be handled at the same time.
-				for(int try2=try_trace+1;try2<4;try2++)
-					if (need_trace[try2])
-					{
-						if (
-							SameSign(rays.direction.X(try2),
-									 rays.direction.X(try_trace)) &&
-							SameSign(rays.direction.Y(try2),
-									 rays.direction.Y(try_trace)) &&
-							SameSign(rays.direction.Z(try2),
-									 rays.direction.Z(try_trace)))
-						{
-							need_trace[try2]=2;
-							tmprays.direction.X(try2) = rays.direction.X(try2);
-							tmprays.direction.Y(try2) = rays.direction.Y(try2);
-							tmprays.direction.Z(try2) = rays.direction.Z(try2);
-						}
-					}
-				// ok, now trace between 1 and 3 rays, and output the results
-				RayTracingResult tmpresults;
-				msk=tmprays.CalculateDirectionSignMask();
-				assert(msk!=-1);
-				Trace4Rays(tmprays,TMin,TMax,msk,&tmpresults,skip_id, pCallback);
-				// now, move results to proper place
-				for(int i=0;i<4;i++)
-					if (need_trace[i]==2)
+				if ( pCallback )
+				{
+					// assuming a triangle indexed as v0, v1, v2
+					// the projected edge equations are set up such that the vert opposite the first
+					// equation is v2, and the vert opposite the second equation is v0
+					// Therefore we pass them back in 1, 2, 0 order
+					// Also B2 is currently B1 + B0 and needs to be 1 - (B1+B0) in order to be a real
+					// barycentric coordinate.  Compute that now and pass it to the callback
+					fltx4 b2 = SubSIMD( Four_Ones, B2 );
+					if ( pCallback->VisitTriangle_ShouldContinue( *tri, rays, &did_hit, &B1, &b2, &B0, tnum ) )
 					{
-						need_trace[i]=0;
-						rslt_out->HitIds[i]=tmpresults.HitIds[i];
-						SubFloat(rslt_out->HitDistance, i) = SubFloat(tmpresults.HitDistance, i);
-						rslt_out->surface_normal.X(i) = tmpresults.surface_normal.X(i);
-						rslt_out->surface_normal.Y(i) = tmpresults.surface_normal.Y(i);
-						rslt_out->surface_normal.Z(i) = tmpresults.surface_normal.Z(i);
+						did_hit = Four_Zeros;
 					}
-				
+				}
 			}
+			// now, set the hit_id and closest_hit fields for any enabled rays
+			fltx4 replicated_n = ReplicateIX4(tnum);
+			StoreAlignedSIMD((float *) rslt_out->HitIds,
+						 OrSIMD(AndSIMD(replicated_n,did_hit),
+								   AndNotSIMD(did_hit,LoadAlignedSIMD(
+													 (float *) rslt_out->HitIds))));
+			rslt_out->HitDistance=OrSIMD(AndSIMD(isect_t,did_hit),
+							 AndNotSIMD(did_hit,rslt_out->HitDistance));
+
+			rslt_out->surface_normal.x=OrSIMD(
+				AndSIMD(N.x,did_hit),
+				AndNotSIMD(did_hit,rslt_out->surface_normal.x));
+			rslt_out->surface_normal.y=OrSIMD(
+				AndSIMD(N.y,did_hit),
+				AndNotSIMD(did_hit,rslt_out->surface_normal.y));
+			rslt_out->surface_normal.z=OrSIMD(
+				AndSIMD(N.z,did_hit),
+				AndNotSIMD(did_hit,rslt_out->surface_normal.z));
+			
 		}
+	} while (--ntris);
+}
+
+
+void RayTracingEnvironment::Trace4Rays(const FourRays &rays, fltx4 TMin, fltx4 TMax,
+									   RayTracingResult *rslt_out,
+									   int32 skip_id, ITransparentTriangleCallback *pCallback)
+{
+	int msk=rays.CalculateDirectionSignMask();
+	if (msk!=-1)
+		Trace4Rays(rays,TMin,TMax,msk,rslt_out,skip_id, pCallback);
+	else
+	{
+		// the signs don't match, so there's no one order to visit the children of a split in
+		// that's right for all 4 rays. the any-direction tracer sorts that out per ray.
+		Trace4RaysAnyDirection(rays,TMin,TMax,rslt_out,skip_id, pCallback);
 	}
 }
 
@@ -466,132 +534,218 @@ void RayTracingEnvironment::Trace4Rays(const FourRays &rays, fltx4 TMin, fltx4 T
 		int ntris=CurNode->NumberOfTrianglesInLeaf();
 		if (ntris)
 		{
-			int32 const *tlist=&(TriangleIndexList[CurNode->TriangleIndexStart()]);
-			do
+			IntersectLeafTriangles(*this,CurNode,rays,mailboxids,skip_id,pCallback,rslt_out);
+			// now, check if all rays have terminated
+			fltx4 raydone=CmpLeSIMD(TMax,rslt_out->HitDistance);
+			if (! IsAnyNegative(raydone))
 			{
-				int tnum=*(tlist++);
-				//printf("try tri %d\n",tnum);
-				// check mailbox
-				int mbox_slot=tnum & (MAILBOX_HASH_SIZE-1);
-				TriIntersectData_t const *tri = &( OptimizedTriangleList[tnum].m_Data.m_IntersectData );
-				if ( ( mailboxids[mbox_slot] != tnum ) && ( tri->m_nTriangleID != skip_id ) )
-				{
-					n_intersection_calculations++;
-					mailboxids[mbox_slot] = tnum;
-					// compute plane intersection
+				return;
+			}
+		}
+		
+ 		if (stack_ptr==&NodeQueue[MAX_NODE_STACK_LEN])
+		{
+			return;
+		}
+		// pop stack!
+		CurNode=stack_ptr->node;
+		TMin=stack_ptr->TMin;
+		TMax=stack_ptr->TMax;
+		stack_ptr++;
+	}
+}
 
 
-					FourVectors N;
-					N.x = ReplicateX4( tri->m_flNx );
-					N.y = ReplicateX4( tri->m_flNy );
-					N.z = ReplicateX4( tri->m_flNz );
+void RayTracingEnvironment::Trace4RaysAnyDirection(const FourRays &rays, fltx4 TMin, fltx4 TMax,
+												   RayTracingResult *rslt_out,
+												   int32 skip_id, ITransparentTriangleCallback *pCallback)
+{
+	memset(rslt_out->HitIds,0xff,sizeof(rslt_out->HitIds));
 
-					fltx4 DDotN = rays.direction * N;
-					// mask off zero or near zero (ray parallel to surface)
-					fltx4 did_hit = OrSIMD( CmpGtSIMD( DDotN,FourEpsilons ),
-											CmpLtSIMD( DDotN, FourNegativeEpsilons ) );
+	rslt_out->HitDistance=ReplicateX4(1.0e23);
 
-					fltx4 numerator=SubSIMD( ReplicateX4( tri->m_flD ), rays.origin * N );
+	rslt_out->surface_normal.DuplicateVector(Vector(0.,0.,0.));
+	FourVectors OneOverRayDir=rays.direction;
+	OneOverRayDir.MakeReciprocalSaturate();
+	
+	// now, clip rays against bounding box
+	for(int c=0;c<3;c++)
+	{
+		fltx4 isect_min_t=
+			MulSIMD(SubSIMD(ReplicateX4(m_MinBound[c]),rays.origin[c]),OneOverRayDir[c]);
+		fltx4 isect_max_t=
+			MulSIMD(SubSIMD(ReplicateX4(m_MaxBound[c]),rays.origin[c]),OneOverRayDir[c]);
+		TMin=MaxSIMD(TMin,MinSIMD(isect_min_t,isect_max_t));
+		TMax=MinSIMD(TMax,MaxSIMD(isect_min_t,isect_max_t));
+	}
+	fltx4 active=CmpLeSIMD(TMin,TMax);					// mask of which rays are active
+	if (! IsAnyNegative(active) )
+		return;												// missed bounding box
 
-					fltx4 isect_t=DivSIMD( numerator,DDotN );
-					// now, we have the distance to the plane. lets update our mask
-					did_hit = AndSIMD( did_hit, CmpGtSIMD( isect_t, FourZeros ) );
-					//did_hit=AndSIMD(did_hit,CmpLtSIMD(isect_t,TMax));
-					did_hit = AndSIMD( did_hit, CmpLtSIMD( isect_t, rslt_out->HitDistance ) );
+	// which rays run from the high side of each axis to the low side. the reciprocal keeps the
+	// sign of -0, so this matches the sign used for the plane distances below.
+	fltx4 goes_negative[3];
+	for(int c=0;c<3;c++)
+		goes_negative[c]=CmpLtSIMD(OneOverRayDir[c],Four_Zeros);
 
-					if ( ! IsAnyNegative( did_hit ) )
-						continue;
+	int32 mailboxids[MAILBOX_HASH_SIZE];					// used to avoid redundant triangle tests
+	memset(mailboxids,0xff,sizeof(mailboxids));
 
-					// now, check 3 edges
-					fltx4 hitc1 = AddSIMD( rays.origin[tri->m_nCoordSelect0],
-										MulSIMD( isect_t, rays.direction[ tri->m_nCoordSelect0] ) );
-					fltx4 hitc2 = AddSIMD( rays.origin[tri->m_nCoordSelect1],
-										   MulSIMD( isect_t, rays.direction[tri->m_nCoordSelect1] ) );
-					
-					// do barycentric coordinate check
-					fltx4 B0 = MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[0] ), hitc1 );
+	NodeToVisit NodeQueue[MAX_NODE_STACK_LEN];
+	CacheOptimizedKDNode const *CurNode=&(OptimizedKDTree[0]);
+	NodeToVisit *stack_ptr=&NodeQueue[MAX_NODE_STACK_LEN];
+	while(1)
+	{
+		while (CurNode->NodeType() != KDNODE_STATE_LEAF)		// traverse until next leaf
+		{	   
+			int split_plane_number=CurNode->NodeType();
+			CacheOptimizedKDNode const *LeftChild=&(OptimizedKDTree[CurNode->LeftChild()]);
+			
+			fltx4 dist_to_sep_plane=						// dist=(split-org)/dir
+				MulSIMD(
+					SubSIMD(ReplicateX4(CurNode->SplittingPlaneValue),
+							   rays.origin[split_plane_number]),OneOverRayDir[split_plane_number]);
 
-					B0 = AddSIMD(
-						B0,
-						MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[1] ), hitc2 ) );
-					B0 = AddSIMD(
-						B0, ReplicateX4( tri->m_ProjectedEdgeEquations[2] ) );
+			// each ray's interval on the side of the plane it starts on, and on the side it
+			// crosses into. then swap those into low (left) and high (right) child order for
+			// the rays going the negative way.
+			fltx4 near_max=MinSIMD(TMax,dist_to_sep_plane);
+			fltx4 far_min=MaxSIMD(TMin,dist_to_sep_plane);
+			fltx4 neg=goes_negative[split_plane_number];
 
-					did_hit = AndSIMD( did_hit, CmpGeSIMD( B0, FourZeros ) );
+			fltx4 left_min=MaskedAssign(neg,far_min,TMin);
+			fltx4 left_max=MaskedAssign(neg,TMax,near_max);
+			fltx4 right_min=MaskedAssign(neg,TMin,far_min);
+			fltx4 right_max=MaskedAssign(neg,near_max,TMax);
 
-					fltx4 B1 = MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[3] ), hitc1 );
-					B1 = AddSIMD(
-						B1,
-						MulSIMD( ReplicateX4( tri->m_ProjectedEdgeEquations[4]), hitc2 ) );
+			fltx4 hits_left=CmpLeSIMD(left_min,left_max);
+			fltx4 hits_right=CmpLeSIMD(right_min,right_max);
 
-					B1 = AddSIMD(
-						B1, ReplicateX4( tri->m_ProjectedEdgeEquations[5] ) );
-					
-					did_hit = AndSIMD( did_hit, CmpGeSIMD( B1, FourZeros ) );
+			if (! IsAnyNegative(hits_right))
+			{
+				CurNode=LeftChild;
+				TMin=left_min;
+				TMax=left_max;
+			}
+			else if (! IsAnyNegative(hits_left))
+			{
+				CurNode=LeftChild+1;
+				TMin=right_min;
+				TMax=right_max;
+			}
+			else
+			{
+				// some rays hit both. go down whichever side most of the live rays reach
+				// first, and push the other.
+				assert(stack_ptr>NodeQueue);
+				--stack_ptr;
+				fltx4 live=OrSIMD(hits_left,hits_right);
+				int n_neg=TestSignSIMD(AndSIMD(live,neg));
+				int n_pos=TestSignSIMD(AndNotSIMD(neg,live));
+				n_neg=(n_neg&1)+((n_neg>>1)&1)+((n_neg>>2)&1)+((n_neg>>3)&1);
+				n_pos=(n_pos&1)+((n_pos>>1)&1)+((n_pos>>2)&1)+((n_pos>>3)&1);
+				if (n_pos>=n_neg)
+				{
+					stack_ptr->node=LeftChild+1;
+					stack_ptr->TMin=right_min;
+					stack_ptr->TMax=right_max;
+					CurNode=LeftChild;
+					TMin=left_min;
+					TMax=left_max;
+				}
+				else
+				{
+					stack_ptr->node=LeftChild;
+					stack_ptr->TMin=left_min;
+					stack_ptr->TMax=left_max;
+					CurNode=LeftChild+1;
+					TMin=right_min;
+					TMax=right_max;
+				}
+			}
+		}
+		// hit a leaf! must do intersection check
+		if (CurNode->NumberOfTrianglesInLeaf())
+			IntersectLeafTriangles(*this,CurNode,rays,mailboxids,skip_id,pCallback,rslt_out);
+
+		// the nodes on the stack aren't in front to back order for every ray, so rather than
+		// stopping at the first hit, drop each popped node's rays past their closest hit so far.
+		do
+		{
+			if (stack_ptr==&NodeQueue[MAX_NODE_STACK_LEN])
+				return;
+			CurNode=stack_ptr->node;
+			TMin=stack_ptr->TMin;
+			TMax=MinSIMD(stack_ptr->TMax,rslt_out->HitDistance);
+			stack_ptr++;
+		} while (! IsAnyNegative(CmpLeSIMD(TMin,TMax)));
+	}
+}
 
-					fltx4 B2 = AddSIMD( B1, B0 );
-					did_hit = AndSIMD( did_hit, CmpLeSIMD( B2, Four_Ones ) );
 
-					if ( ! IsAnyNegative( did_hit ) )
-						continue;
+#ifdef RAYTRACE_AVX2
+static void GetCPUID(int nLeaf, uint32 *pRegs)
+{
+#ifdef _MSC_VER
+	__cpuidex((int *) pRegs,nLeaf,0);
+#else
+	__cpuid_count(nLeaf,0,pRegs[0],pRegs[1],pRegs[2],pRegs[3]);
+#endif
+}
 
-					// if the triangle is transparent
-					if ( tri->m_nFlags & FCACHETRI_TRANSPARENT )
-					{
-						if ( pCallback )
-						{
-							// assuming a triangle indexed as v0, v1, v2
-							// the projected edge equations are set up such that the vert opposite the first
-							// equation is v2, and the vert opposite the second equation is v0
-							// Therefore we pass them back in 1, 2, 0 order
-							// Also B2 is currently B1 + B0 and needs to be 1 - (B1+B0) in order to be a real
-							// barycentric coordinate.  Compute that now and pass it to the callback
-							fltx4 b2 = SubSIMD( Four_Ones, B2 );
-							if ( pCallback->VisitTriangle_ShouldContinue( *tri, rays, &did_hit, &B1, &b2, &B0, tnum ) )
-							{
-								did_hit = Four_Zeros;
-							}
-						}
-					}
-					// now, set the hit_id and closest_hit fields for any enabled rays
-					fltx4 replicated_n = ReplicateIX4(tnum);
-					StoreAlignedSIMD((float *) rslt_out->HitIds,
-								 OrSIMD(AndSIMD(replicated_n,did_hit),
-										   AndNotSIMD(did_hit,LoadAlignedSIMD(
-															 (float *) rslt_out->HitIds))));
-					rslt_out->HitDistance=OrSIMD(AndSIMD(isect_t,did_hit),
-									 AndNotSIMD(did_hit,rslt_out->HitDistance));
-
-					rslt_out->surface_normal.x=OrSIMD(
-						AndSIMD(N.x,did_hit),
-						AndNotSIMD(did_hit,rslt_out->surface_normal.x));
-					rslt_out->surface_normal.y=OrSIMD(
-						AndSIMD(N.y,did_hit),
-						AndNotSIMD(did_hit,rslt_out->surface_normal.y));
-					rslt_out->surface_normal.z=OrSIMD(
-						AndSIMD(N.z,did_hit),
-						AndNotSIMD(did_hit,rslt_out->surface_normal.z));
-					
-				}
-			} while (--ntris);
-			// now, check if all rays have terminated
-			fltx4 raydone=CmpLeSIMD(TMax,rslt_out->HitDistance);
-			if (! IsAnyNegative(raydone))
+static uint32 GetXCR0(void)
+{
+#ifdef _MSC_VER
+	return (uint32) _xgetbv(0);
+#else
+	// xgetbv, spelled out for assemblers that don't know it
+	uint32 eax,edx;
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0));
+	return eax;
+#endif
+}
+#endif
+
+bool RayTracingEnvironment::IsAVX2Available(void)
+{
+#ifdef RAYTRACE_AVX2
+	static int s_nAVX2Available=-1;
+	if (s_nAVX2Available==-1)
+	{
+		// need AVX, the OS saving the ymm registers (OSXSAVE, then the SSE and AVX bits of
+		// XCR0), and then AVX2 itself.
+		bool bAvailable=false;
+		uint32 regs[4];
+		GetCPUID(0,regs);
+		if (regs[0]>=7)
+		{
+			GetCPUID(1,regs);
+			if ((regs[2] & (1<<27)) && (regs[2] & (1<<28)) && ((GetXCR0() & 6)==6))
 			{
-				return;
+				GetCPUID(7,regs);
+				bAvailable=(regs[1] & (1<<5))!=0;
 			}
 		}
-		
- 		if (stack_ptr==&NodeQueue[MAX_NODE_STACK_LEN])
-		{
-			return;
-		}
-		// pop stack!
-		CurNode=stack_ptr->node;
-		TMin=stack_ptr->TMin;
-		TMax=stack_ptr->TMax;
-		stack_ptr++;
+		s_nAVX2Available=bAvailable;
+	}
+	return s_nAVX2Available!=0;
+#else
+	// this compiler can't build the AVX2 tracer.
+	return false;
+#endif
+}
+
+
+void RayTracingEnvironment::Trace8Rays(const FourRays *rays, const fltx4 *TMin, const fltx4 *TMax,
+									   RayTracingResult *rslt_out, int32 skip_id)
+{
+	if ( ( ! ( Flags & RTE_FLAGS_DISABLE_AVX2 ) ) && IsAVX2Available() )
+	{
+		Trace8RaysAVX2(rays,TMin,TMax,rslt_out,skip_id);
+		return;
 	}
+	for(int p=0;p<2;p++)
+		Trace4Rays(rays[p],TMin[p],TMax[p],rslt_out+p,skip_id);
 }
 
 
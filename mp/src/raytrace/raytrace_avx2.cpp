@@ -0,0 +1,319 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+// $Id$
+//
+// 8-wide AVX2 version of RayTracingEnvironment::Trace4RaysAnyDirection, used by Trace8Rays.
+// The file is built like the rest of the library; only the functions marked AVX2_TARGET get
+// AVX2 code generation, and none of them may run before IsAVX2Available has said yes.
+
+#include "raytrace.h"
+
+
+#ifdef RAYTRACE_AVX2
+
+#include <immintrin.h>
+
+// msvc emits AVX2 intrinsics wherever they're used, gcc and clang need to be told per function.
+#ifdef _MSC_VER
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+// same as raytrace.cpp
+#define MAILBOX_HASH_SIZE 256
+#define MAX_TREE_DEPTH 21
+#define MAX_NODE_STACK_LEN (40*MAX_TREE_DEPTH)
+
+typedef __m256 fltx8;
+
+struct NodeToVisit8 {
+	CacheOptimizedKDNode const *node;
+	fltx8 TMin;
+	fltx8 TMax;
+};
+
+struct EightRays_t
+{
+	fltx8 origin[3];
+	fltx8 direction[3];
+	fltx8 OneOverRayDir[3];
+};
+
+struct EightResults_t
+{
+	fltx8 HitIds;											// int bits
+	fltx8 HitDistance;
+	fltx8 surface_normal[3];
+};
+
+
+static AVX2_TARGET FORCEINLINE fltx8 LoadFltx8(const fltx4 &lo, const fltx4 &hi)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo),hi,1);
+}
+
+static AVX2_TARGET FORCEINLINE void StoreFltx8(const fltx8 &v, fltx4 &lo, fltx4 &hi)
+{
+	lo=_mm256_castps256_ps128(v);
+	hi=_mm256_extractf128_ps(v,1);
+}
+
+static AVX2_TARGET FORCEINLINE fltx8 MaskedAssign8(const fltx8 &ReplacementMask, const fltx8 &NewValue, const fltx8 &OldValue)
+{
+	return _mm256_blendv_ps(OldValue,NewValue,ReplacementMask);
+}
+
+static FORCEINLINE int CountBits8(int msk)
+{
+	msk=msk-((msk>>1)&0x55);
+	msk=(msk&0x33)+((msk>>2)&0x33);
+	return (msk+(msk>>4))&0x0f;
+}
+
+// exactly what MakeReciprocalSaturate does, 8 at a time, so both tracers see the same
+// plane distances.
+static AVX2_TARGET FORCEINLINE fltx8 ReciprocalSaturate8(const fltx8 &a)
+{
+	fltx8 zero_mask=_mm256_cmp_ps(a,_mm256_setzero_ps(),_CMP_EQ_OQ);
+	fltx8 a_safe=_mm256_or_ps(a,_mm256_and_ps(LoadFltx8(Four_Epsilons,Four_Epsilons),zero_mask));
+	fltx8 ret=_mm256_rcp_ps(a_safe);
+	// newton iteration is: Y(n+1) = 2*Y(n)-a*Y(n)^2
+	return _mm256_sub_ps(_mm256_add_ps(ret,ret),_mm256_mul_ps(a_safe,_mm256_mul_ps(ret,ret)));
+}
+
+
+// the triangle test from raytrace.cpp, 8 rays at a time, without transparency callbacks.
+static AVX2_TARGET FORCEINLINE void IntersectLeafTriangles8(RayTracingEnvironment &env,
+															CacheOptimizedKDNode const *CurNode,
+															const EightRays_t &rays, int32 *mailboxids,
+															int32 skip_id, EightResults_t &rslt)
+{
+	// the SSE tracer's "zeros" are really 1.0e-10
+	const fltx8 epsilons=_mm256_set1_ps(1.0e-10f);
+	const fltx8 negative_epsilons=_mm256_set1_ps(-1.0e-10f);
+	const fltx8 ones=_mm256_set1_ps(1.0f);
+
+	int ntris=CurNode->NumberOfTrianglesInLeaf();
+	int32 const *tlist=&(env.TriangleIndexList[CurNode->TriangleIndexStart()]);
+	do
+	{
+		int tnum=*(tlist++);
+		// check mailbox
+		int mbox_slot=tnum & (MAILBOX_HASH_SIZE-1);
+		TriIntersectData_t const *tri = &( env.OptimizedTriangleList[tnum].m_Data.m_IntersectData );
+		if ( ( mailboxids[mbox_slot] == tnum ) || ( tri->m_nTriangleID == skip_id ) )
+			continue;
+		mailboxids[mbox_slot] = tnum;
+
+		// compute plane intersection
+		fltx8 Nx=_mm256_set1_ps(tri->m_flNx);
+		fltx8 Ny=_mm256_set1_ps(tri->m_flNy);
+		fltx8 Nz=_mm256_set1_ps(tri->m_flNz);
+
+		fltx8 DDotN=_mm256_mul_ps(rays.direction[0],Nx);
+		DDotN=_mm256_add_ps(_mm256_mul_ps(rays.direction[1],Ny),DDotN);
+		DDotN=_mm256_add_ps(_mm256_mul_ps(rays.direction[2],Nz),DDotN);
+
+		// mask off zero or near zero (ray parallel to surface)
+		fltx8 did_hit=_mm256_or_ps(_mm256_cmp_ps(DDotN,epsilons,_CMP_GT_OQ),
+								   _mm256_cmp_ps(DDotN,negative_epsilons,_CMP_LT_OQ));
+
+		fltx8 ODotN=_mm256_mul_ps(rays.origin[0],Nx);
+		ODotN=_mm256_add_ps(_mm256_mul_ps(rays.origin[1],Ny),ODotN);
+		ODotN=_mm256_add_ps(_mm256_mul_ps(rays.origin[2],Nz),ODotN);
+
+		fltx8 isect_t=_mm256_div_ps(_mm256_sub_ps(_mm256_set1_ps(tri->m_flD),ODotN),DDotN);
+		did_hit=_mm256_and_ps(did_hit,_mm256_cmp_ps(isect_t,epsilons,_CMP_GT_OQ));
+		did_hit=_mm256_and_ps(did_hit,_mm256_cmp_ps(isect_t,rslt.HitDistance,_CMP_LT_OQ));
+
+		if (! _mm256_movemask_ps(did_hit))
+			continue;
+
+		// now, check 3 edges
+		int c0=tri->m_nCoordSelect0;
+		int c1=tri->m_nCoordSelect1;
+		fltx8 hitc1=_mm256_add_ps(rays.origin[c0],_mm256_mul_ps(isect_t,rays.direction[c0]));
+		fltx8 hitc2=_mm256_add_ps(rays.origin[c1],_mm256_mul_ps(isect_t,rays.direction[c1]));
+
+		// do barycentric coordinate check
+		fltx8 B0=_mm256_mul_ps(_mm256_set1_ps(tri->m_ProjectedEdgeEquations[0]),hitc1);
+		B0=_mm256_add_ps(B0,_mm256_mul_ps(_mm256_set1_ps(tri->m_ProjectedEdgeEquations[1]),hitc2));
+		B0=_mm256_add_ps(B0,_mm256_set1_ps(tri->m_ProjectedEdgeEquations[2]));
+		did_hit=_mm256_and_ps(did_hit,_mm256_cmp_ps(B0,epsilons,_CMP_GE_OQ));
+
+		fltx8 B1=_mm256_mul_ps(_mm256_set1_ps(tri->m_ProjectedEdgeEquations[3]),hitc1);
+		B1=_mm256_add_ps(B1,_mm256_mul_ps(_mm256_set1_ps(tri->m_ProjectedEdgeEquations[4]),hitc2));
+		B1=_mm256_add_ps(B1,_mm256_set1_ps(tri->m_ProjectedEdgeEquations[5]));
+		did_hit=_mm256_and_ps(did_hit,_mm256_cmp_ps(B1,epsilons,_CMP_GE_OQ));
+
+		fltx8 B2=_mm256_add_ps(B1,B0);
+		did_hit=_mm256_and_ps(did_hit,_mm256_cmp_ps(B2,ones,_CMP_LE_OQ));
+
+		if (! _mm256_movemask_ps(did_hit))
+			continue;
+
+		// now, set the hit_id and closest_hit fields for any enabled rays
+		rslt.HitIds=MaskedAssign8(did_hit,_mm256_castsi256_ps(_mm256_set1_epi32(tnum)),rslt.HitIds);
+		rslt.HitDistance=MaskedAssign8(did_hit,isect_t,rslt.HitDistance);
+		rslt.surface_normal[0]=MaskedAssign8(did_hit,Nx,rslt.surface_normal[0]);
+		rslt.surface_normal[1]=MaskedAssign8(did_hit,Ny,rslt.surface_normal[1]);
+		rslt.surface_normal[2]=MaskedAssign8(did_hit,Nz,rslt.surface_normal[2]);
+	} while (--ntris);
+}
+
+
+static AVX2_TARGET void TraceEightRays(RayTracingEnvironment &env, const EightRays_t &rays,
+									   fltx8 TMin, fltx8 TMax, int32 skip_id, EightResults_t &rslt)
+{
+	// now, clip rays against bounding box
+	for(int c=0;c<3;c++)
+	{
+		fltx8 isect_min_t=
+			_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(env.m_MinBound[c]),rays.origin[c]),rays.OneOverRayDir[c]);
+		fltx8 isect_max_t=
+			_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(env.m_MaxBound[c]),rays.origin[c]),rays.OneOverRayDir[c]);
+		TMin=_mm256_max_ps(TMin,_mm256_min_ps(isect_min_t,isect_max_t));
+		TMax=_mm256_min_ps(TMax,_mm256_max_ps(isect_min_t,isect_max_t));
+	}
+	if (! _mm256_movemask_ps(_mm256_cmp_ps(TMin,TMax,_CMP_LE_OQ)))
+		return;												// missed bounding box
+
+	fltx8 goes_negative[3];
+	for(int c=0;c<3;c++)
+		goes_negative[c]=_mm256_cmp_ps(rays.OneOverRayDir[c],_mm256_setzero_ps(),_CMP_LT_OQ);
+
+	int32 mailboxids[MAILBOX_HASH_SIZE];					// used to avoid redundant triangle tests
+	memset(mailboxids,0xff,sizeof(mailboxids));
+
+	NodeToVisit8 NodeQueue[MAX_NODE_STACK_LEN];
+	CacheOptimizedKDNode const *CurNode=&(env.OptimizedKDTree[0]);
+	NodeToVisit8 *stack_ptr=&NodeQueue[MAX_NODE_STACK_LEN];
+	while(1)
+	{
+		while (CurNode->NodeType() != KDNODE_STATE_LEAF)		// traverse until next leaf
+		{
+			int split_plane_number=CurNode->NodeType();
+			CacheOptimizedKDNode const *LeftChild=&(env.OptimizedKDTree[CurNode->LeftChild()]);
+
+			fltx8 dist_to_sep_plane=						// dist=(split-org)/dir
+				_mm256_mul_ps(
+					_mm256_sub_ps(_mm256_set1_ps(CurNode->SplittingPlaneValue),
+								  rays.origin[split_plane_number]),rays.OneOverRayDir[split_plane_number]);
+
+			// each ray's near and far intervals, swapped into low/high child order for the
+			// rays going the negative way. see Trace4RaysAnyDirection.
+			fltx8 near_max=_mm256_min_ps(TMax,dist_to_sep_plane);
+			fltx8 far_min=_mm256_max_ps(TMin,dist_to_sep_plane);
+			fltx8 neg=goes_negative[split_plane_number];
+
+			fltx8 left_min=MaskedAssign8(neg,far_min,TMin);
+			fltx8 left_max=MaskedAssign8(neg,TMax,near_max);
+			fltx8 right_min=MaskedAssign8(neg,TMin,far_min);
+			fltx8 right_max=MaskedAssign8(neg,near_max,TMax);
+
+			int hits_left=_mm256_movemask_ps(_mm256_cmp_ps(left_min,left_max,_CMP_LE_OQ));
+			int hits_right=_mm256_movemask_ps(_mm256_cmp_ps(right_min,right_max,_CMP_LE_OQ));
+
+			if (! hits_right)
+			{
+				CurNode=LeftChild;
+				TMin=left_min;
+				TMax=left_max;
+			}
+			else if (! hits_left)
+			{
+				CurNode=LeftChild+1;
+				TMin=right_min;
+				TMax=right_max;
+			}
+			else
+			{
+				// some rays hit both. go down whichever side most of the live rays reach
+				// first, and push the other.
+				assert(stack_ptr>NodeQueue);
+				--stack_ptr;
+				int live=hits_left|hits_right;
+				int neg_msk=_mm256_movemask_ps(neg);
+				if (CountBits8(live&~neg_msk)>=CountBits8(live&neg_msk))
+				{
+					stack_ptr->node=LeftChild+1;
+					stack_ptr->TMin=right_min;
+					stack_ptr->TMax=right_max;
+					CurNode=LeftChild;
+					TMin=left_min;
+					TMax=left_max;
+				}
+				else
+				{
+					stack_ptr->node=LeftChild;
+					stack_ptr->TMin=left_min;
+					stack_ptr->TMax=left_max;
+					CurNode=LeftChild+1;
+					TMin=right_min;
+					TMax=right_max;
+				}
+			}
+		}
+		// hit a leaf! must do intersection check
+		if (CurNode->NumberOfTrianglesInLeaf())
+			IntersectLeafTriangles8(env,CurNode,rays,mailboxids,skip_id,rslt);
+
+		// pop, dropping each node's rays past their closest hit so far
+		do
+		{
+			if (stack_ptr==&NodeQueue[MAX_NODE_STACK_LEN])
+				return;
+			CurNode=stack_ptr->node;
+			TMin=stack_ptr->TMin;
+			TMax=_mm256_min_ps(stack_ptr->TMax,rslt.HitDistance);
+			stack_ptr++;
+		} while (! _mm256_movemask_ps(_mm256_cmp_ps(TMin,TMax,_CMP_LE_OQ)));
+	}
+}
+
+
+AVX2_TARGET void RayTracingEnvironment::Trace8RaysAVX2(const FourRays *rays, const fltx4 *TMin, const fltx4 *TMax,
+													   RayTracingResult *rslt_out, int32 skip_id)
+{
+	EightRays_t rays8;
+	for(int c=0;c<3;c++)
+	{
+		rays8.origin[c]=LoadFltx8(rays[0].origin[c],rays[1].origin[c]);
+		rays8.direction[c]=LoadFltx8(rays[0].direction[c],rays[1].direction[c]);
+		rays8.OneOverRayDir[c]=ReciprocalSaturate8(rays8.direction[c]);
+	}
+
+	EightResults_t rslt;
+	rslt.HitIds=_mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	rslt.HitDistance=_mm256_set1_ps(1.0e23f);
+	for(int c=0;c<3;c++)
+		rslt.surface_normal[c]=_mm256_setzero_ps();
+
+	TraceEightRays(*this,rays8,LoadFltx8(TMin[0],TMin[1]),LoadFltx8(TMax[0],TMax[1]),skip_id,rslt);
+
+	fltx4 HitIds[2];
+	StoreFltx8(rslt.HitIds,HitIds[0],HitIds[1]);
+	StoreFltx8(rslt.HitDistance,rslt_out[0].HitDistance,rslt_out[1].HitDistance);
+	StoreFltx8(rslt.surface_normal[0],rslt_out[0].surface_normal.x,rslt_out[1].surface_normal.x);
+	StoreFltx8(rslt.surface_normal[1],rslt_out[0].surface_normal.y,rslt_out[1].surface_normal.y);
+	StoreFltx8(rslt.surface_normal[2],rslt_out[0].surface_normal.z,rslt_out[1].surface_normal.z);
+	for(int p=0;p<2;p++)
+		StoreAlignedSIMD((float *) rslt_out[p].HitIds,HitIds[p]);
+
+	// leave the upper halves of the ymm registers clean for any SSE code that follows
+	_mm256_zeroupper();
+}
+
+
+#else // RAYTRACE_AVX2
+
+// this compiler can't build the AVX2 tracer, so Trace8Rays always uses the SSE one.
+
+void RayTracingEnvironment::Trace8RaysAVX2(const FourRays *rays, const fltx4 *TMin, const fltx4 *TMax,
+										   RayTracingResult *rslt_out, int32 skip_id)
+{
+	for(int p=0;p<2;p++)
+		Trace4Rays(rays[p],TMin[p],TMax[p],rslt_out+p,skip_id);
+}
+
+#endif // RAYTRACE_AVX2
@@ -373,4 +373,126 @@ void RayTracingEnvironment::FinishRayStream(RayStream &s)
 			FlushStreamEntry(s,msk);
 		}
 	}
+	FlushRayBatch(s);
+}
+
+
+void RayTracingEnvironment::AddToRayBatch(RayStream &s,
+										  Vector const &start,Vector const &end,
+										  RayTracingSingleResult *rslt_out)
+{
+	s.BatchStarts.AddToTail(start);
+	s.BatchEnds.AddToTail(end);
+	s.BatchOutputs.AddToTail(rslt_out);
+}
+
+
+struct RayBatchSortEntry_t
+{
+	uint32 m_nKey;
+	int m_nRay;
+};
+
+static int __cdecl RayBatchSortFunc(const RayBatchSortEntry_t *a, const RayBatchSortEntry_t *b)
+{
+	if (a->m_nKey!=b->m_nKey)
+		return (a->m_nKey<b->m_nKey) ? -1 : 1;
+	return a->m_nRay-b->m_nRay;
+}
+
+// spreads the low 9 bits of x out to every third bit, for interleaving 3 coordinates
+static uint32 SpreadBitsBy3(uint32 x)
+{
+	x&=0x1ff;
+	x=(x|(x<<16))&0x030000ff;
+	x=(x|(x<<8))&0x0300f00f;
+	x=(x|(x<<4))&0x030c30c3;
+	x=(x|(x<<2))&0x09249249;
+	return x;
+}
+
+void RayTracingEnvironment::FlushRayBatch(RayStream &s)
+{
+	int nRays=s.BatchStarts.Count();
+	if (! nRays)
+		return;
+
+	// sort the rays so that each run of 8 is likely to visit the same nodes: by direction sign
+	// mask, then by major axis of the direction, then along a z-order curve through the
+	// scene's bounds by origin.
+	CUtlVector<RayBatchSortEntry_t> order;
+	order.SetCount(nRays);
+	Vector extent=m_MaxBound-m_MinBound;
+	Vector scale(511.0/max(extent.x,1.0f),511.0/max(extent.y,1.0f),511.0/max(extent.z,1.0f));
+	for(int i=0;i<nRays;i++)
+	{
+		Vector const &start=s.BatchStarts[i];
+		Vector delta=s.BatchEnds[i]-start;
+		int major_axis=0;
+		for(int c=1;c<3;c++)
+			if (fabs(delta[c])>fabs(delta[major_axis]))
+				major_axis=c;
+
+		uint32 morton=0;
+		for(int c=0;c<3;c++)
+		{
+			int cell=(start[c]-m_MinBound[c])*scale[c];
+			cell=clamp(cell,0,511);
+			morton|=SpreadBitsBy3(cell)<<c;
+		}
+		order[i].m_nKey=(GetSignMask(delta)<<29)|(major_axis<<27)|morton;
+		order[i].m_nRay=i;
+	}
+	order.Sort(RayBatchSortFunc);
+
+	for(int i=0;i<nRays;i+=8)
+	{
+		FourRays rays[2];
+		RayTracingSingleResult *outputs[8];
+		for(int r=0;r<8;r++)
+		{
+			// a short last packet repeats its last ray
+			int ray=order[min(i+r,nRays-1)].m_nRay;
+			Vector const &start=s.BatchStarts[ray];
+			Vector delta=s.BatchEnds[ray]-start;
+			FourRays &packet=rays[r>>2];
+			packet.origin.X(r&3)=start.x;
+			packet.origin.Y(r&3)=start.y;
+			packet.origin.Z(r&3)=start.z;
+			packet.direction.X(r&3)=delta.x;
+			packet.direction.Y(r&3)=delta.y;
+			packet.direction.Z(r&3)=delta.z;
+			outputs[r]=(i+r<nRays) ? s.BatchOutputs[ray] : NULL;
+		}
+
+		fltx4 TMin[2],TMax[2];
+		for(int p=0;p<2;p++)
+		{
+			TMin[p]=Four_Zeros;
+			TMax[p]=rays[p].direction.length();
+			rays[p].direction*=ReciprocalSaturateSIMD(TMax[p]);	// normalize
+		}
+
+		RayTracingResult results[2];
+		Trace8Rays(rays,TMin,TMax,results);
+
+		// now, write out results
+		for(int r=0;r<8;r++)
+		{
+			RayTracingSingleResult *out=outputs[r];
+			if (! out)
+				continue;
+			RayTracingResult const &result=results[r>>2];
+			out->ray_length=SubFloat( TMax[r>>2], r&3 );
+			out->surface_normal.x=result.surface_normal.X(r&3);
+			out->surface_normal.y=result.surface_normal.Y(r&3);
+			out->surface_normal.z=result.surface_normal.Z(r&3);
+			out->HitID=result.HitIds[r&3];
+			out->HitDistance=SubFloat( result.HitDistance, r&3 );
+		}
+	}
+
+	s.BatchStarts.RemoveAll();
+	s.BatchEnds.RemoveAll();
+	s.BatchOutputs.RemoveAll();
 }